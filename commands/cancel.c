@@ -9,13 +9,60 @@
 // information.
 //
 
-#include "localize.h"
+#include "conn.h"
+#include "pool.h"
+#include <fnmatch.h>
+#include <limits.h>
+
+
+//
+// Local types...
+//
+
+typedef struct cancel_filter_s		// Job selection filter
+{
+  bool		active;			// Any filters specified?
+  time_t	older_than;		// Minimum age in seconds or 0
+  int		larger_than;		// Minimum size in k-octets or -1
+  unsigned	states;			// Bitmask of job states or 0 for active
+  const char	*name_glob,		// Job name pattern or `NULL`
+		*user_glob;		// Job owner pattern or `NULL`
+  cups_array_t	*dests;			// Destinations or `NULL` for all
+  bool		dry_run;		// Only list the matching jobs?
+} cancel_filter_t;
+
+typedef struct cancel_dest_s		// Queued destination request
+{
+  const char	*name;			// Destination name
+  ipp_op_t	op;			// Operation
+} cancel_dest_t;
+
+typedef struct cancel_job_s		// Job table entry
+{
+  int		id;			// job-id
+  ipp_jstate_t	state;			// job-state
+  int		k_octets;		// job-k-octets
+  time_t	created;		// time-at-creation
+  char		dest[128],		// Destination name
+		user[64],		// job-originating-user-name
+		name[128];		// job-name
+} cancel_job_t;
 
 
 //
 // Local functions...
 //
 
+static int	cancel_filtered_jobs(const char *command, http_t *http, cancel_filter_t *filter, size_t batch_size, size_t parallel, const char *user, bool purge);
+static int	cancel_job_ids(const char *command, http_t *http, size_t num_job_ids, int *job_ids, size_t batch_size, size_t parallel, const char *user, bool purge);
+static size_t	cancel_job_ids_individually(const char *command, size_t num_job_ids, int *job_ids, size_t parallel, const char *user, bool purge);
+static int	compare_jobs(cancel_job_t *a, cancel_job_t *b, void *data);
+static bool	finish_dests(const char *command, pool_t *pool, cancel_dest_t *dests);
+static bool	finish_job_ids(const char *command, http_t **http, size_t *num_job_ids, int *job_ids, size_t batch_size, size_t parallel, const char *user, bool purge);
+static bool	match_job(cancel_filter_t *filter, cancel_job_t *job, const char *user, time_t curtime);
+static bool	parse_duration(const char *s, time_t *seconds);
+static bool	parse_size(const char *s, int *k_octets);
+static bool	parse_states(const char *s, unsigned *states);
 static void	usage(void) _CUPS_NORETURN;
 
 
@@ -30,6 +77,18 @@ main(int  argc,				// I - Number of command-line arguments
   http_t	*http;			// HTTP connection to server
   int		i;			// Looping var
   int		job_id;			// Job ID
+  size_t	num_job_ids,		// Number of job IDs to cancel
+		alloc_job_ids,		// Allocated job IDs
+		batch_size,		// Number of job IDs per request
+		parallel;		// Number of concurrent requests
+  int		*job_ids;		// Job IDs to cancel
+  pool_t	*pool;			// Requests for destinations
+  size_t	num_pool_dests,		// Number of destination requests
+		alloc_pool_dests;	// Allocated destination requests
+  cancel_dest_t	*pool_dests;		// Destination requests
+  const char	*resource;		// Resource path
+  int		status;			// Exit status
+  cancel_filter_t filter;		// Job selection filter
   size_t	num_dests;		// Number of destinations
   cups_dest_t	*dests;			// Destinations
   char		*opt,			// Option pointer
@@ -37,6 +96,7 @@ main(int  argc,				// I - Number of command-line arguments
 		*job,			// Job ID pointer
 		*user;			// Cancel jobs for a user
   bool		purge;			// Purge or cancel jobs?
+  bool		seen_job_ids;		// Any job IDs on the command-line?
   char		uri[1024];		// Printer or job URI
   ipp_t		*request;		// IPP request
   ipp_t		*response;		// IPP response
@@ -57,6 +117,39 @@ main(int  argc,				// I - Number of command-line arguments
   num_dests = 0;
   dests     = NULL;
 
+  num_job_ids   = 0;
+  alloc_job_ids = 0;
+  job_ids       = NULL;
+  seen_job_ids  = false;
+  batch_size    = 100;
+  parallel      = POOL_MAX_CONNECTIONS;
+
+  pool             = NULL;
+  num_pool_dests   = 0;
+  alloc_pool_dests = 0;
+  pool_dests       = NULL;
+  status           = 0;
+
+  memset(&filter, 0, sizeof(filter));
+  filter.larger_than = -1;
+
+  // Job filters apply to every destination on the command-line, including
+  // ones named before the filter options, so look for them before canceling
+  // anything...
+  for (i = 1; i < argc; i ++)
+  {
+    if (!strcmp(argv[i], "--dry-run") || !strcmp(argv[i], "--larger-than") || !strcmp(argv[i], "--name-glob") || !strcmp(argv[i], "--older-than") || !strcmp(argv[i], "--state") || !strcmp(argv[i], "--user-glob"))
+    {
+      filter.active = true;
+      break;
+    }
+    else if (!strcmp(argv[i], "--batch-size") || !strcmp(argv[i], "--parallel") || !strcmp(argv[i], "-U") || !strcmp(argv[i], "-h") || !strcmp(argv[i], "-u"))
+    {
+      // Skip the option value...
+      i ++;
+    }
+  }
+
 
  /*
   * Process command-line arguments...
@@ -68,8 +161,106 @@ main(int  argc,				// I - Number of command-line arguments
     {
       usage();
     }
+    else if (!strcmp(argv[i], "--batch-size"))
+    {
+      i ++;
+      if (i >= argc || atoi(argv[i]) < 1)
+      {
+        cupsLangPrintf(stderr, _("%s: Error - expected count after \"--batch-size\" option."), argv[0]);
+        usage();
+      }
+
+      batch_size = (size_t)atoi(argv[i]);
+    }
+    else if (!strcmp(argv[i], "--parallel"))
+    {
+      i ++;
+      if (i >= argc || atoi(argv[i]) < 1)
+      {
+        cupsLangPrintf(stderr, _("%s: Error - expected count after \"--parallel\" option."), argv[0]);
+        usage();
+      }
+
+      parallel = (size_t)atoi(argv[i]);
+    }
+    else if (!strcmp(argv[i], "--dry-run"))
+    {
+      filter.dry_run = true;
+      filter.active  = true;
+    }
+    else if (!strcmp(argv[i], "--larger-than"))
+    {
+      i ++;
+      if (i >= argc || !parse_size(argv[i], &filter.larger_than))
+      {
+        cupsLangPrintf(stderr, _("%s: Error - expected size after \"--larger-than\" option."), argv[0]);
+        usage();
+      }
+
+      filter.active = true;
+    }
+    else if (!strcmp(argv[i], "--name-glob"))
+    {
+      i ++;
+      if (i >= argc)
+      {
+        cupsLangPrintf(stderr, _("%s: Error - expected pattern after \"--name-glob\" option."), argv[0]);
+        usage();
+      }
+
+      filter.name_glob = argv[i];
+      filter.active    = true;
+    }
+    else if (!strcmp(argv[i], "--older-than"))
+    {
+      i ++;
+      if (i >= argc || !parse_duration(argv[i], &filter.older_than))
+      {
+        cupsLangPrintf(stderr, _("%s: Error - expected time after \"--older-than\" option."), argv[0]);
+        usage();
+      }
+
+      filter.active = true;
+    }
+    else if (!strcmp(argv[i], "--state"))
+    {
+      i ++;
+      if (i >= argc || !parse_states(argv[i], &filter.states))
+      {
+        cupsLangPrintf(stderr, _("%s: Error - expected job state(s) after \"--state\" option."), argv[0]);
+        usage();
+      }
+
+      filter.active = true;
+    }
+    else if (!strcmp(argv[i], "--user-glob"))
+    {
+      i ++;
+      if (i >= argc)
+      {
+        cupsLangPrintf(stderr, _("%s: Error - expected pattern after \"--user-glob\" option."), argv[0]);
+        usage();
+      }
+
+      filter.user_glob = argv[i];
+      filter.active    = true;
+    }
     else if (argv[i][0] == '-' && argv[i][1])
     {
+      // Options change how the following arguments are handled, so finish
+      // the requests for the preceding arguments first...
+      if (pool)
+      {
+	if (!finish_dests(argv[0], pool, pool_dests))
+	  status = 1;
+
+	pool           = NULL;
+	num_pool_dests = 0;
+      }
+
+      if (!finish_job_ids(argv[0], &http, &num_job_ids, job_ids, batch_size, parallel, user, purge))
+        status = 1;
+
       for (opt = argv[i] + 1; *opt; opt ++)
       {
 	switch (*opt)
@@ -105,11 +296,7 @@ main(int  argc,				// I - Number of command-line arguments
 	      break;
 
 	  case 'h' : // Connect to host
-	      if (http != NULL)
-	      {
-		httpClose(http);
-		http = NULL;
-	      }
+	      http = NULL;
 
 	      if (opt[1] != '\0')
 	      {
@@ -175,6 +362,24 @@ main(int  argc,				// I - Number of command-line arguments
       if (num_dests == 0)
         num_dests = cupsGetDests(http, &dests);
 
+      if (filter.active)
+      {
+        cups_dest_t	*fdest;		// Filtered destination
+
+        // Limit the filtered jobs to the named destinations...
+        if ((fdest = cupsGetDest(argv[i], NULL, num_dests, dests)) == NULL)
+        {
+	  cupsLangPrintf(stderr, _("%s: Error - unknown destination \"%s\"."), argv[0], argv[i]);
+	  return (1);
+        }
+
+        if (!filter.dests)
+          filter.dests = cupsArrayNewStrings(NULL, '\0');
+
+        cupsArrayAdd(filter.dests, fdest->name);
+        continue;
+      }
+
       if (!strcmp(argv[i], "-"))
       {
         // Delete the current job...
@@ -213,14 +418,69 @@ main(int  argc,				// I - Number of command-line arguments
       if (job_id && (i + 1) < argc && cupsGetDest(argv[i + 1], NULL, num_dests, dests) != NULL)
         i ++;
 
-      // Open a connection to the server...
-      if (http == NULL)
+      if (!dest)
       {
-	if ((http = httpConnect(cupsGetServer(), ippGetPort(), /*addrlist*/NULL, AF_UNSPEC, cupsGetEncryption(), /*blocking*/true, /*msec*/30000, /*cancel*/NULL)) == NULL)
-	{
-	  cupsLangPrintf(stderr, _("%s: Unable to connect to server."), argv[0]);
+        if (filter.active)
+        {
+	  cupsLangPrintf(stderr, _("%s: Error - job IDs cannot be used with job filters."), argv[0]);
 	  return (1);
-	}
+        }
+
+        // Finish the preceding destination requests, then collect job IDs
+        // so they can be canceled in batches...
+        if (pool)
+        {
+	  if (!finish_dests(argv[0], pool, pool_dests))
+	    status = 1;
+
+	  pool           = NULL;
+	  num_pool_dests = 0;
+        }
+
+        if (num_job_ids >= alloc_job_ids)
+        {
+          int	*temp;			// New job IDs
+
+          alloc_job_ids += 1024;
+
+          if ((temp = realloc(job_ids, alloc_job_ids * sizeof(int))) == NULL)
+          {
+	    cupsLangPrintf(stderr, _("%s: Unable to allocate memory."), argv[0]);
+	    return (1);
+          }
+
+          job_ids = temp;
+        }
+
+        job_ids[num_job_ids ++] = job_id;
+        seen_job_ids = true;
+        continue;
+      }
+
+      // Cancel the preceding job IDs, then collect requests for destinations
+      // so they can be sent concurrently...
+      if (!finish_job_ids(argv[0], &http, &num_job_ids, job_ids, batch_size, parallel, user, purge))
+        status = 1;
+
+      if (!pool && (pool = pool_new(parallel)) == NULL)
+      {
+	cupsLangPrintf(stderr, _("%s: Unable to allocate memory."), argv[0]);
+	return (1);
+      }
+
+      if (num_pool_dests >= alloc_pool_dests)
+      {
+        cancel_dest_t	*temp;		// New destination requests
+
+        alloc_pool_dests += 64;
+
+        if ((temp = realloc(pool_dests, alloc_pool_dests * sizeof(cancel_dest_t))) == NULL)
+        {
+	  cupsLangPrintf(stderr, _("%s: Unable to allocate memory."), argv[0]);
+	  return (1);
+        }
+
+        pool_dests = temp;
       }
 
       // Build an IPP request, which requires the following
@@ -258,36 +518,69 @@ main(int  argc,				// I - Number of command-line arguments
       if (purge)
 	ippAddBoolean(request, IPP_TAG_OPERATION, "purge-jobs", purge);
 
-      // Do the request and get back a response...
+      // Queue the request...
       if (op == IPP_OP_CANCEL_JOBS && (!user || strcasecmp(user, cupsGetUser())))
-        response = cupsDoRequest(http, request, "/admin/");
+        resource = "/admin/";
       else
-        response = cupsDoRequest(http, request, "/jobs/");
+        resource = "/jobs/";
 
-      if (response == NULL || ippGetStatusCode(response) > IPP_STATUS_OK_CONFLICTING)
-      {
-        if (op == IPP_OP_PURGE_JOBS)
-	  cupsLangPrintf(stderr, _("%s: purge-jobs failed: %s"), argv[0], cupsLastErrorString());
-        else if (op == IPP_OP_CANCEL_JOB)
-	  cupsLangPrintf(stderr, _("%s: cancel-job failed: %s"), argv[0], cupsLastErrorString());
-	else
-	  cupsLangPrintf(stderr, _("%s: cancel-jobs failed: %s"), argv[0], cupsLastErrorString());
+      pool_dests[num_pool_dests].name = dest;
+      pool_dests[num_pool_dests].op   = op;
+      num_pool_dests ++;
+
+      pool_add_request(pool, request, resource);
+    }
+  }
+
+  if (pool)
+  {
+    // Send the requests for all destinations and report the results...
+    if (!finish_dests(argv[0], pool, pool_dests))
+      status = 1;
+  }
+
+  free(pool_dests);
+
+  if (filter.active)
+  {
+    if (seen_job_ids)
+    {
+      cupsLangPrintf(stderr, _("%s: Error - job IDs cannot be used with job filters."), argv[0]);
+      return (1);
+    }
 
-	ippDelete(response);
+    // Jobs that have already finished can only be purged...
+    if ((filter.states & ((1 << IPP_JSTATE_CANCELED) | (1 << IPP_JSTATE_ABORTED) | (1 << IPP_JSTATE_COMPLETED))) && !purge && !filter.dry_run)
+    {
+      cupsLangPrintf(stderr, _("%s: Error - canceled, aborted, and completed jobs can only be purged with \"-x\"."), argv[0]);
+      return (1);
+    }
 
+    // Open a connection to the server...
+    if (http == NULL)
+    {
+      if ((http = conn_get_default()) == NULL)
+      {
+	cupsLangPrintf(stderr, _("%s: Unable to connect to server."), argv[0]);
 	return (1);
       }
-
-      ippDelete(response);
     }
+
+    if (cancel_filtered_jobs(argv[0], http, &filter, batch_size, parallel, user, purge))
+      status = 1;
+
+    return (status);
   }
 
+  if (!finish_job_ids(argv[0], &http, &num_job_ids, job_ids, batch_size, parallel, user, purge))
+    status = 1;
+
   if (num_dests == 0 && op != IPP_OP_CANCEL_JOB)
   {
     // Open a connection to the server...
     if (http == NULL)
     {
-      if ((http = httpConnect(cupsGetServer(), ippGetPort(), /*addrlist*/NULL, AF_UNSPEC, cupsGetEncryption(), /*blocking*/true, /*msec*/30000, /*cancel*/NULL)) == NULL)
+      if ((http = conn_get_default()) == NULL)
       {
 	cupsLangPrintf(stderr, _("%s: Unable to contact server."), argv[0]);
 	return (1);
@@ -337,7 +630,679 @@ main(int  argc,				// I - Number of command-line arguments
     ippDelete(response);
   }
 
-  return (0);
+  return (status);
+}
+
+
+//
+// 'cancel_filtered_jobs()' - Cancel the jobs that match a filter.
+//
+// The active jobs (or all jobs when a terminal state is requested) are read
+// into a job table using a single Get-Jobs request per page of 500 jobs, and
+// the matching jobs are then canceled in batches.
+//
+
+static int				// O - Exit status
+cancel_filtered_jobs(
+    const char      *command,		// I - Command name
+    http_t          *http,		// I - HTTP connection to server
+    cancel_filter_t *filter,		// I - Job selection filter
+    size_t          batch_size,		// I - Maximum job IDs per request
+    size_t          parallel,		// I - Maximum concurrent requests
+    const char      *user,		// I - User name or `NULL` for current user
+    bool            purge)		// I - Purge jobs?
+{
+  int		status = 0;		// Exit status
+  int		first_index = 1,	// First job in page
+		limit = 500;		// Jobs per page
+  size_t	num_page,		// Number of jobs in page
+		num_new;		// Number of new jobs in page
+  ipp_t		*request,		// IPP request
+		*response;		// IPP response
+  ipp_attribute_t *attr;		// Current attribute
+  cups_array_t	*table;			// Job table
+  cancel_job_t	*job,			// Current job
+		temp;			// Job being read
+  size_t	num_job_ids = 0;	// Number of matching jobs
+  int		*job_ids;		// Matching job IDs
+  time_t	curtime = time(NULL);	// Current time
+  const char	*which_jobs;		// Value for which-jobs
+  static const char * const jattrs[] =	// Attributes we need for jobs...
+  {
+    "job-id",
+    "job-k-octets",
+    "job-name",
+    "job-originating-user-name",
+    "job-printer-uri",
+    "job-state",
+    "time-at-creation"
+  };
+
+
+  // Canceled, aborted, and completed jobs are only listed with "all"...
+  if (filter->states & ((1 << IPP_JSTATE_CANCELED) | (1 << IPP_JSTATE_ABORTED) | (1 << IPP_JSTATE_COMPLETED)))
+    which_jobs = "all";
+  else
+    which_jobs = "not-completed";
+
+  table = cupsArrayNew((cups_array_cb_t)compare_jobs, NULL, NULL, 0, NULL, (cups_afree_cb_t)free);
+
+  do
+  {
+    // Build a Get-Jobs request, which requires the following attributes:
+    //
+    //   attributes-charset
+    //   attributes-natural-language
+    //   printer-uri
+    //   requested-attributes
+    //   requesting-user-name
+    //   which-jobs
+    //   first-index
+    //   limit
+    request = ippNewRequest(IPP_OP_GET_JOBS);
+
+    ippAddString(request, IPP_TAG_OPERATION, IPP_TAG_URI, "printer-uri", NULL, "ipp://localhost/");
+    ippAddStrings(request, IPP_TAG_OPERATION, IPP_TAG_KEYWORD, "requested-attributes", sizeof(jattrs) / sizeof(jattrs[0]), NULL, jattrs);
+    ippAddString(request, IPP_TAG_OPERATION, IPP_TAG_NAME, "requesting-user-name", NULL, cupsGetUser());
+    ippAddString(request, IPP_TAG_OPERATION, IPP_TAG_KEYWORD, "which-jobs", NULL, which_jobs);
+    ippAddInteger(request, IPP_TAG_OPERATION, IPP_TAG_INTEGER, "first-index", first_index);
+    ippAddInteger(request, IPP_TAG_OPERATION, IPP_TAG_INTEGER, "limit", limit);
+
+    // Do the request and get back a response...
+    response = cupsDoRequest(http, request, "/");
+
+    if (cupsLastError() > IPP_STATUS_OK_CONFLICTING)
+    {
+      cupsLangPrintf(stderr, "%s: %s", command, cupsLastErrorString());
+      ippDelete(response);
+      cupsArrayDelete(table);
+      return (1);
+    }
+
+    // Add the jobs in this page to the table...
+    for (attr = ippGetFirstAttribute(response), num_page = 0, num_new = 0; attr; attr = ippGetNextAttribute(response))
+    {
+      // Skip leading attributes until we hit a job...
+      while (attr && ippGetGroupTag(attr) != IPP_TAG_JOB)
+        attr = ippGetNextAttribute(response);
+
+      if (!attr)
+        break;
+
+      // Pull the needed attributes from this job...
+      memset(&temp, 0, sizeof(temp));
+      temp.state    = IPP_JSTATE_PENDING;
+      temp.k_octets = 0;
+
+      while (attr && ippGetGroupTag(attr) == IPP_TAG_JOB)
+      {
+        const char	*name = ippGetName(attr);
+					// Attribute name
+        ipp_tag_t	value_tag = ippGetValueTag(attr);
+					// Value tag
+
+        if (!strcmp(name, "job-id") && value_tag == IPP_TAG_INTEGER)
+        {
+          temp.id = ippGetInteger(attr, 0);
+        }
+        else if (!strcmp(name, "job-k-octets") && value_tag == IPP_TAG_INTEGER)
+        {
+          temp.k_octets = ippGetInteger(attr, 0);
+        }
+        else if (!strcmp(name, "job-name") && (value_tag == IPP_TAG_NAME || value_tag == IPP_TAG_NAMELANG))
+        {
+          cupsCopyString(temp.name, ippGetString(attr, 0, NULL), sizeof(temp.name));
+        }
+        else if (!strcmp(name, "job-originating-user-name") && (value_tag == IPP_TAG_NAME || value_tag == IPP_TAG_NAMELANG))
+        {
+          cupsCopyString(temp.user, ippGetString(attr, 0, NULL), sizeof(temp.user));
+        }
+        else if (!strcmp(name, "job-printer-uri") && value_tag == IPP_TAG_URI)
+        {
+          const char *dest = strrchr(ippGetString(attr, 0, NULL), '/');
+					// Destination name
+
+          if (dest)
+            cupsCopyString(temp.dest, dest + 1, sizeof(temp.dest));
+        }
+        else if (!strcmp(name, "job-state") && value_tag == IPP_TAG_ENUM)
+        {
+          temp.state = (ipp_jstate_t)ippGetInteger(attr, 0);
+        }
+        else if (!strcmp(name, "time-at-creation") && value_tag == IPP_TAG_INTEGER)
+        {
+          temp.created = (time_t)ippGetInteger(attr, 0);
+        }
+
+        attr = ippGetNextAttribute(response);
+      }
+
+      if (temp.id > 0)
+      {
+        num_page ++;
+
+        // Jobs can move between pages as other jobs finish, so only add
+        // jobs we haven't seen before...
+        if (!cupsArrayFind(table, &temp) && (job = malloc(sizeof(cancel_job_t))) != NULL)
+        {
+          memcpy(job, &temp, sizeof(cancel_job_t));
+          cupsArrayAdd(table, job);
+          num_new ++;
+        }
+      }
+
+      if (!attr)
+        break;
+    }
+
+    ippDelete(response);
+
+    first_index += limit;
+  }
+  while (num_page >= (size_t)limit && num_new > 0);
+
+  // Evaluate the filter over the job table...
+  if ((job_ids = calloc((size_t)cupsArrayGetCount(table) + 1, sizeof(int))) == NULL)
+  {
+    cupsLangPrintf(stderr, _("%s: Unable to allocate memory."), command);
+    cupsArrayDelete(table);
+    return (1);
+  }
+
+  for (job = (cancel_job_t *)cupsArrayGetFirst(table); job; job = (cancel_job_t *)cupsArrayGetNext(table))
+  {
+    if (!match_job(filter, job, user, curtime))
+      continue;
+
+    job_ids[num_job_ids ++] = job->id;
+
+    if (filter->dry_run)
+    {
+      char	id[256];		// Destination-ID string
+
+      snprintf(id, sizeof(id), "%s-%d", job->dest, job->id);
+      cupsLangPrintf(stdout, "%-23s %-13s %8.0f %s", id, job->user, 1024.0 * job->k_octets, job->name);
+    }
+  }
+
+  if (!filter->dry_run && num_job_ids > 0)
+    status = cancel_job_ids(command, http, num_job_ids, job_ids, batch_size, parallel, user, purge);
+
+  free(job_ids);
+  cupsArrayDelete(table);
+
+  return (status);
+}
+
+
+//
+// 'cancel_job_ids()' - Cancel a list of jobs.
+//
+// Jobs are canceled in batches using Cancel-My-Jobs with the "job-ids"
+// attribute, or Cancel-Jobs when root or canceling another user's jobs.  Jobs
+// the server reports as failing in the "job-ids" attribute of the unsupported
+// attributes group are reported individually.  When the server rejects a
+// batch for any other reason or does not support "job-ids", the jobs are
+// canceled with individual Cancel-Job requests sent over several connections
+// instead.
+//
+// CUPS rejects a whole Cancel-My-Jobs batch when any of the jobs belongs to
+// another user, so batching stops after such a failure.
+//
+
+static int				// O - Exit status
+cancel_job_ids(const char *command,	// I - Command name
+               http_t     *http,	// I - HTTP connection to server
+               size_t     num_job_ids,	// I - Number of job IDs
+               int        *job_ids,	// I - Job IDs
+               size_t     batch_size,	// I - Maximum job IDs per request
+               size_t     parallel,	// I - Maximum concurrent requests
+               const char *user,	// I - User name or `NULL` for current user
+               bool       purge)	// I - Purge jobs?
+{
+  size_t	i,			// Looping var
+		start,			// First job ID in batch
+		count,			// Number of job IDs in batch
+		failed = 0;		// Number of failed jobs
+  bool		batch;			// Use Cancel-Jobs?
+  ipp_op_t	op;			// Operation
+  const char	*resource;		// Resource path
+  ipp_t		*request,		// IPP request
+		*response;		// IPP response
+  ipp_attribute_t *attr;		// job-ids attribute
+
+
+  batch = batch_size > 1 && num_job_ids > 1;
+
+  if ((user && strcasecmp(user, cupsGetUser())) || (!user && !getuid()))
+  {
+    op       = IPP_OP_CANCEL_JOBS;
+    resource = "/admin/";
+  }
+  else
+  {
+    op       = IPP_OP_CANCEL_MY_JOBS;
+    resource = "/jobs/";
+  }
+
+  for (start = 0; start < num_job_ids; start += count)
+  {
+    if (!batch)
+    {
+      // Cancel the remaining jobs individually...
+      count  = num_job_ids - start;
+      failed += cancel_job_ids_individually(command, count, job_ids + start, parallel, user, purge);
+      continue;
+    }
+
+    if ((count = num_job_ids - start) > batch_size)
+      count = batch_size;
+
+    // Build a Cancel-Jobs or Cancel-My-Jobs request, which requires the
+    // following attributes:
+    //
+    //   attributes-charset
+    //   attributes-natural-language
+    //   printer-uri
+    //   requesting-user-name
+    //   job-ids
+    //   [purge-jobs]
+    request = ippNewRequest(op);
+
+    ippAddString(request, IPP_TAG_OPERATION, IPP_TAG_URI, "printer-uri", NULL, "ipp://localhost/printers/");
+    ippAddString(request, IPP_TAG_OPERATION, IPP_TAG_NAME, "requesting-user-name", NULL, user ? user : cupsGetUser());
+    ippAddIntegers(request, IPP_TAG_OPERATION, IPP_TAG_INTEGER, "job-ids", count, job_ids + start);
+
+    if (purge)
+      ippAddBoolean(request, IPP_TAG_OPERATION, "purge-jobs", purge);
+
+    // Do the request and get back a response...
+    response = cupsDoRequest(http, request, resource);
+
+    if (response && ippGetStatusCode(response) <= IPP_STATUS_OK_CONFLICTING)
+    {
+      ippDelete(response);
+      continue;
+    }
+
+    if ((attr = ippFindAttribute(response, "job-ids", IPP_TAG_ZERO)) != NULL && ippGetGroupTag(attr) == IPP_TAG_UNSUPPORTED_GROUP && ippGetCount(attr) < count)
+    {
+      // Report the jobs that could not be canceled and retry the rest
+      // individually, since the server may have skipped them...
+      size_t	j,			// Looping var
+		acount = ippGetCount(attr);
+					// Number of failed job IDs
+
+      for (i = 0; i < acount; i ++)
+      {
+        int	job_id = ippGetInteger(attr, i);
+					// Failed job ID
+
+        for (j = start; j < (start + count); j ++)
+        {
+          if (job_ids[j] == job_id)
+          {
+	    cupsLangPrintf(stderr, _("%s: Unable to cancel job %d: %s"), command, job_id, cupsLastErrorString());
+	    job_ids[j] = 0;
+	    failed ++;
+	    break;
+          }
+        }
+      }
+
+      for (i = start, j = start; i < (start + count); i ++)
+      {
+        if (job_ids[i])
+          job_ids[j ++] = job_ids[i];
+      }
+
+      failed += cancel_job_ids_individually(command, j - start, job_ids + start, parallel, user, purge);
+    }
+    else
+    {
+      // The whole batch was rejected, either because the server does not
+      // support "job-ids" or because one of the jobs could not be canceled,
+      // so cancel each job individually.  Stop batching when a job does not
+      // belong to the user, since other batches will likely fail too...
+      if (attr || cupsLastError() == IPP_STATUS_ERROR_OPERATION_NOT_SUPPORTED || cupsLastError() == IPP_STATUS_ERROR_ATTRIBUTES_OR_VALUES || (op == IPP_OP_CANCEL_MY_JOBS && (cupsLastError() == IPP_STATUS_ERROR_NOT_FOUND || cupsLastError() == IPP_STATUS_ERROR_FORBIDDEN || cupsLastError() == IPP_STATUS_ERROR_NOT_AUTHORIZED)))
+        batch = false;
+
+      failed += cancel_job_ids_individually(command, count, job_ids + start, parallel, user, purge);
+    }
+
+    ippDelete(response);
+  }
+
+  return (failed > 0);
+}
+
+
+//
+// 'cancel_job_ids_individually()' - Cancel a list of jobs using Cancel-Job.
+//
+
+static size_t				// O - Number of failed jobs
+cancel_job_ids_individually(
+    const char *command,		// I - Command name
+    size_t     num_job_ids,		// I - Number of job IDs
+    int        *job_ids,		// I - Job IDs
+    size_t     parallel,		// I - Maximum concurrent requests
+    const char *user,			// I - User name or `NULL` for current user
+    bool       purge)			// I - Purge jobs?
+{
+  size_t	i,			// Looping var
+		failed = 0;		// Number of failed jobs
+  pool_t	*pool;			// Request pool
+  ipp_t		*request;		// IPP request
+  char		uri[1024];		// Job URI
+
+
+  if (num_job_ids == 0)
+    return (0);
+
+  if ((pool = pool_new(parallel)) == NULL)
+  {
+    cupsLangPrintf(stderr, _("%s: Unable to allocate memory."), command);
+    return (num_job_ids);
+  }
+
+  for (i = 0; i < num_job_ids; i ++)
+  {
+    // Build a Cancel-Job request, which requires the following attributes:
+    //
+    //   attributes-charset
+    //   attributes-natural-language
+    //   job-uri
+    //   requesting-user-name
+    //   [purge-jobs]
+    request = ippNewRequest(IPP_OP_CANCEL_JOB);
+
+    snprintf(uri, sizeof(uri), "ipp://localhost/jobs/%d", job_ids[i]);
+    ippAddString(request, IPP_TAG_OPERATION, IPP_TAG_URI, "job-uri", NULL, uri);
+
+    if (user)
+    {
+      ippAddString(request, IPP_TAG_OPERATION, IPP_TAG_NAME, "requesting-user-name", NULL, user);
+      ippAddBoolean(request, IPP_TAG_OPERATION, "my-jobs", true);
+    }
+    else
+      ippAddString(request, IPP_TAG_OPERATION, IPP_TAG_NAME, "requesting-user-name", NULL, cupsGetUser());
+
+    if (purge)
+      ippAddBoolean(request, IPP_TAG_OPERATION, "purge-jobs", purge);
+
+    pool_add_request(pool, request, "/jobs/");
+  }
+
+  // Send the requests and report any failures in order...
+  if (!pool_run(pool))
+  {
+    for (i = 0; i < num_job_ids; i ++)
+    {
+      if (pool_get_status(pool, i) > IPP_STATUS_OK_CONFLICTING)
+      {
+        cupsLangPrintf(stderr, _("%s: Unable to cancel job %d: %s"), command, job_ids[i], pool_get_status_message(pool, i));
+        failed ++;
+      }
+    }
+  }
+
+  pool_delete(pool);
+
+  return (failed);
+}
+
+
+//
+// 'compare_jobs()' - Compare two job table entries.
+//
+
+static int				// O - Result of comparison
+compare_jobs(cancel_job_t *a,		// I - First job
+             cancel_job_t *b,		// I - Second job
+             void         *data)	// I - Callback data (unused)
+{
+  (void)data;
+
+  return (a->id - b->id);
+}
+
+
+//
+// 'finish_dests()' - Send the queued destination requests and report results.
+//
+// Results are reported in the order the destinations were named.  The pool
+// is freed.
+//
+
+static bool				// O - `true` on success, `false` on error
+finish_dests(const char    *command,	// I - Command name
+             pool_t        *pool,	// I - Request pool
+             cancel_dest_t *dests)	// I - Destination requests
+{
+  size_t	i,			// Looping var
+		count;			// Number of requests
+  bool		ret;			// Return value
+
+
+  if ((ret = pool_run(pool)) == false)
+  {
+    for (i = 0, count = pool_get_count(pool); i < count; i ++)
+    {
+      if (pool_get_status(pool, i) <= IPP_STATUS_OK_CONFLICTING)
+        continue;
+
+      if (dests[i].op == IPP_OP_PURGE_JOBS)
+	cupsLangPrintf(stderr, _("%s: purge-jobs failed for \"%s\": %s"), command, dests[i].name, pool_get_status_message(pool, i));
+      else if (dests[i].op == IPP_OP_CANCEL_JOB)
+	cupsLangPrintf(stderr, _("%s: cancel-job failed for \"%s\": %s"), command, dests[i].name, pool_get_status_message(pool, i));
+      else
+	cupsLangPrintf(stderr, _("%s: cancel-jobs failed for \"%s\": %s"), command, dests[i].name, pool_get_status_message(pool, i));
+    }
+  }
+
+  pool_delete(pool);
+
+  return (ret);
+}
+
+
+//
+// 'finish_job_ids()' - Cancel the job IDs collected so far.
+//
+
+static bool				// O  - `true` on success, `false` on error
+finish_job_ids(const char *command,	// I  - Command name
+               http_t     **http,	// IO - HTTP connection to server
+               size_t     *num_job_ids,	// IO - Number of job IDs
+               int        *job_ids,	// I  - Job IDs
+               size_t     batch_size,	// I  - Number of job IDs per request
+               size_t     parallel,	// I  - Number of concurrent requests
+               const char *user,	// I  - User name or `NULL`
+               bool       purge)	// I  - Purge jobs?
+{
+  size_t	count = *num_job_ids;	// Number of job IDs
+
+
+  if (count == 0)
+    return (true);
+
+  *num_job_ids = 0;
+
+  // Open a connection to the server...
+  if (*http == NULL && (*http = conn_get_default()) == NULL)
+  {
+    cupsLangPrintf(stderr, _("%s: Unable to connect to server."), command);
+    return (false);
+  }
+
+  return (!cancel_job_ids(command, *http, count, job_ids, batch_size, parallel, user, purge));
+}
+
+
+//
+// 'match_job()' - Determine whether a job matches a filter.
+//
+
+static bool				// O - `true` if the job matches
+match_job(cancel_filter_t *filter,	// I - Job selection filter
+          cancel_job_t    *job,		// I - Job
+          const char      *user,	// I - User name or `NULL` for any user
+          time_t          curtime)	// I - Current time
+{
+  if (filter->states)
+  {
+    if (!(filter->states & (1U << job->state)))
+      return (false);
+  }
+  else if (job->state >= IPP_JSTATE_CANCELED)
+  {
+    return (false);
+  }
+
+  if (filter->older_than > 0 && (job->created <= 0 || (curtime - job->created) < filter->older_than))
+    return (false);
+
+  if (filter->larger_than >= 0 && job->k_octets <= filter->larger_than)
+    return (false);
+
+  if (filter->dests && !cupsArrayFind(filter->dests, job->dest))
+    return (false);
+
+  if (user && strcasecmp(job->user, user))
+    return (false);
+
+  if (filter->user_glob && fnmatch(filter->user_glob, job->user, 0))
+    return (false);
+
+  if (filter->name_glob && fnmatch(filter->name_glob, job->name, 0))
+    return (false);
+
+  return (true);
+}
+
+
+//
+// 'parse_duration()' - Parse a duration such as "90", "30m", "12h", or "7d".
+//
+
+static bool				// O - `true` on success, `false` on error
+parse_duration(const char *s,		// I - Duration string
+               time_t     *seconds)	// O - Duration in seconds
+{
+  long	value;				// Numeric value
+  char	*units;				// Pointer to units
+
+
+  if ((value = strtol(s, &units, 10)) <= 0 || units == s)
+    return (false);
+
+  if (!*units || !strcmp(units, "s"))
+    *seconds = (time_t)value;
+  else if (!strcmp(units, "m"))
+    *seconds = (time_t)value * 60;
+  else if (!strcmp(units, "h"))
+    *seconds = (time_t)value * 3600;
+  else if (!strcmp(units, "d"))
+    *seconds = (time_t)value * 86400;
+  else if (!strcmp(units, "w"))
+    *seconds = (time_t)value * 604800;
+  else
+    return (false);
+
+  return (true);
+}
+
+
+//
+// 'parse_size()' - Parse a size such as "500k", "10m", or "1g".
+//
+// A size without units is in bytes.  The result is in k-octets, matching the
+// "job-k-octets" attribute.
+//
+
+static bool				// O - `true` on success, `false` on error
+parse_size(const char *s,		// I - Size string
+           int        *k_octets)	// O - Size in k-octets
+{
+  long long	value;			// Numeric value
+  char		*units;			// Pointer to units
+
+
+  errno = 0;
+
+  if ((value = strtoll(s, &units, 10)) < 0 || units == s || errno == ERANGE || value > INT_MAX)
+    return (false);
+
+  if (!*units)
+    value /= 1024;
+  else if (!strcasecmp(units, "m"))
+    value *= 1024;
+  else if (!strcasecmp(units, "g"))
+    value *= 1048576;
+  else if (strcasecmp(units, "k"))
+    return (false);
+
+  // job-k-octets is a 32-bit integer...
+  if (value > INT_MAX)
+    return (false);
+
+  *k_octets = (int)value;
+
+  return (true);
+}
+
+
+//
+// 'parse_states()' - Parse a comma-delimited list of job states.
+//
+
+static bool				// O - `true` on success, `false` on error
+parse_states(const char *s,		// I - Job state list
+             unsigned   *states)	// O - Bitmask of job states
+{
+  char		buffer[1024],		// Copy of list
+		*name,			// Current state name
+		*next;			// Next state name
+  size_t	i;			// Looping var
+  static const struct
+  {
+    const char		*name;		// Keyword
+    ipp_jstate_t	state;		// Job state
+  }		names[] =		// Job state names
+  {
+    { "pending",		IPP_JSTATE_PENDING },
+    { "held",			IPP_JSTATE_HELD },
+    { "pending-held",		IPP_JSTATE_HELD },
+    { "processing",		IPP_JSTATE_PROCESSING },
+    { "stopped",		IPP_JSTATE_STOPPED },
+    { "processing-stopped",	IPP_JSTATE_STOPPED },
+    { "canceled",		IPP_JSTATE_CANCELED },
+    { "aborted",		IPP_JSTATE_ABORTED },
+    { "completed",		IPP_JSTATE_COMPLETED }
+  };
+
+
+  cupsCopyString(buffer, s, sizeof(buffer));
+
+  for (name = buffer; name && *name; name = next)
+  {
+    if ((next = strchr(name, ',')) != NULL)
+      *next++ = '\0';
+
+    for (i = 0; i < (sizeof(names) / sizeof(names[0])); i ++)
+    {
+      if (!strcmp(name, names[i].name))
+        break;
+    }
+
+    if (i >= (sizeof(names) / sizeof(names[0])))
+      return (false);
+
+    *states |= 1U << names[i].state;
+  }
+
+  return (*states != 0);
 }
 
 
@@ -352,6 +1317,14 @@ usage(void)
                          "       cancel [options] [destination]\n"
                          "       cancel [options] [destination-id]"));
   cupsLangPuts(stdout, _("Options:"));
+  cupsLangPuts(stdout, _("--batch-size count      Cancel up to count jobs per request"));
+  cupsLangPuts(stdout, _("--dry-run               List the matching jobs without canceling them"));
+  cupsLangPuts(stdout, _("--larger-than size      Cancel jobs larger than size (bytes, or k/m/g)"));
+  cupsLangPuts(stdout, _("--name-glob pattern     Cancel jobs whose name matches pattern"));
+  cupsLangPuts(stdout, _("--older-than time       Cancel jobs older than time (seconds, or m/h/d/w)"));
+  cupsLangPuts(stdout, _("--parallel count        Send up to count requests at the same time"));
+  cupsLangPuts(stdout, _("--state state[,...]     Cancel jobs in the given state(s)"));
+  cupsLangPuts(stdout, _("--user-glob pattern     Cancel jobs whose owner matches pattern"));
   cupsLangPuts(stdout, _("-a                      Cancel all jobs"));
   cupsLangPuts(stdout, _("-E                      Encrypt the connection to the server"));
   cupsLangPuts(stdout, _("-h server[:port]        Connect to the named server and port"));
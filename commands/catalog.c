@@ -0,0 +1,446 @@
+//
+// Message catalogs for the CUPS commands.
+//
+// Copyright © 2026 by OpenPrinting.
+//
+// Licensed under Apache License v2.0.  See the file "LICENSE" for more
+// information.
+//
+// A catalog is a ".strings" file compiled into a hash table that is mapped
+// read-only at run time, so looking up a message needs no parsing and no
+// memory allocation.  The file starts with a `catalog_header_t`, followed by
+// the `catalog_slot_t` hash slots and then a pool of nul-terminated strings.
+// Slots use open addressing with linear probing.  Offset 0 in the pool is an
+// empty string which marks an unused slot.
+//
+// Catalogs use the native byte order, so they are built for the machine that
+// reads them with "make catalogs" and are not installed.
+//
+
+#include "catalog.h"
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+
+//
+// Local types...
+//
+
+typedef struct catalog_pair_s		// Message pair from ".strings" file
+{
+  char		*key,			// Key string
+		*value;			// Value string
+  uint32_t	hash;			// Hash of key
+} catalog_pair_t;
+
+
+//
+// Local functions...
+//
+
+static uint32_t	catalog_hash(const char *s);
+static char	*catalog_read_string(char **ptr);
+static void	catalog_skip_space(char **ptr);
+
+
+//
+// 'catalog_close()' - Unmap a catalog.
+//
+
+void
+catalog_close(catalog_t *cat)		// I - Catalog
+{
+  if (cat->data)
+    munmap(cat->data, cat->datasize);
+
+  memset(cat, 0, sizeof(catalog_t));
+}
+
+
+//
+// 'catalog_compile()' - Compile a ".strings" file into a catalog.
+//
+// The catalog is written to a temporary file which then replaces the
+// destination file.  Later definitions of a key replace earlier ones.
+//
+
+bool					// O - `true` on success, `false` on error
+catalog_compile(
+    const char *strings_file,		// I - ".strings" file
+    const char *catalog_file)		// I - Catalog file
+{
+  bool			ret = false;	// Return value
+  int			fd;		// File descriptor
+  struct stat		fileinfo;	// File information
+  char			*data = NULL,	// File contents
+			*ptr;		// Pointer into file
+  catalog_pair_t	*pairs = NULL,	// Message pairs
+			*pair;		// Current pair
+  size_t		i,		// Looping var
+			num_pairs = 0,	// Number of pairs
+			alloc_pairs = 0;// Allocated pairs
+  catalog_header_t	header;		// Catalog header
+  catalog_slot_t	*slots = NULL,	// Hash slots
+			*slot;		// Current slot
+  char			*pool = NULL;	// String pool
+  size_t		pool_size = 1;	// Size of string pool
+  uint32_t		num_slots;	// Number of hash slots
+  FILE			*fp;		// Catalog file
+  char			temp[1024];	// Temporary file
+
+
+  // Load the ".strings" file...
+  if ((fd = open(strings_file, O_RDONLY)) < 0)
+  {
+    fprintf(stderr, "%s: %s\n", strings_file, strerror(errno));
+    return (false);
+  }
+
+  if (fstat(fd, &fileinfo) || (data = malloc((size_t)fileinfo.st_size + 1)) == NULL || read(fd, data, (size_t)fileinfo.st_size) != (ssize_t)fileinfo.st_size)
+  {
+    fprintf(stderr, "%s: %s\n", strings_file, strerror(errno));
+    close(fd);
+    free(data);
+    return (false);
+  }
+
+  close(fd);
+  data[fileinfo.st_size] = '\0';
+
+  // Parse "key" = "value"; lines...
+  for (ptr = data;;)
+  {
+    catalog_skip_space(&ptr);
+
+    if (!*ptr)
+      break;
+
+    if (num_pairs >= alloc_pairs)
+    {
+      catalog_pair_t *temppairs;	// New pairs
+
+      alloc_pairs += 1024;
+
+      if ((temppairs = realloc(pairs, alloc_pairs * sizeof(catalog_pair_t))) == NULL)
+      {
+        fprintf(stderr, "%s: %s\n", strings_file, strerror(errno));
+        goto done;
+      }
+
+      pairs = temppairs;
+    }
+
+    pair = pairs + num_pairs;
+
+    if ((pair->key = catalog_read_string(&ptr)) == NULL)
+      goto syntax_error;
+
+    catalog_skip_space(&ptr);
+    if (*ptr != '=')
+      goto syntax_error;
+    ptr ++;
+
+    catalog_skip_space(&ptr);
+    if ((pair->value = catalog_read_string(&ptr)) == NULL)
+      goto syntax_error;
+
+    catalog_skip_space(&ptr);
+    if (*ptr != ';')
+      goto syntax_error;
+    ptr ++;
+
+    pair->hash = catalog_hash(pair->key);
+    pool_size  += strlen(pair->key) + strlen(pair->value) + 2;
+
+    num_pairs ++;
+  }
+
+  // Size the hash table for a load factor of 50% or less...
+  for (num_slots = 16; num_slots < 2 * num_pairs; num_slots *= 2);
+
+  if ((slots = calloc(num_slots, sizeof(catalog_slot_t))) == NULL || (pool = malloc(pool_size)) == NULL)
+  {
+    fprintf(stderr, "%s: %s\n", catalog_file, strerror(errno));
+    goto done;
+  }
+
+  // Add the strings to the pool and hash slots...
+  pool[0]   = '\0';
+  pool_size = 1;
+
+  for (i = num_pairs, pair = pairs; i > 0; i --, pair ++)
+  {
+    for (slot = slots + (pair->hash & (num_slots - 1)); slot->key; slot = slot + 1 < slots + num_slots ? slot + 1 : slots)
+    {
+      if (slot->hash == pair->hash && !strcmp(pool + slot->key, pair->key))
+        break;
+    }
+
+    if (!slot->key)
+    {
+      slot->hash = pair->hash;
+      slot->key  = (uint32_t)pool_size;
+
+      cupsCopyString(pool + pool_size, pair->key, strlen(pair->key) + 1);
+      pool_size += strlen(pair->key) + 1;
+    }
+
+    slot->value = (uint32_t)pool_size;
+
+    cupsCopyString(pool + pool_size, pair->value, strlen(pair->value) + 1);
+    pool_size += strlen(pair->value) + 1;
+  }
+
+  // Write the catalog...
+  memset(&header, 0, sizeof(header));
+  cupsCopyString(header.magic, CATALOG_MAGIC, sizeof(header.magic));
+  header.byte_order  = CATALOG_BYTE_ORDER;
+  header.num_strings = (uint32_t)num_pairs;
+  header.num_slots   = num_slots;
+  header.pool_size   = (uint32_t)pool_size;
+
+  snprintf(temp, sizeof(temp), "%s.%d", catalog_file, (int)getpid());
+
+  if ((fp = fopen(temp, "wb")) == NULL)
+  {
+    fprintf(stderr, "%s: %s\n", temp, strerror(errno));
+    goto done;
+  }
+
+  fwrite(&header, sizeof(header), 1, fp);
+  fwrite(slots, sizeof(catalog_slot_t), num_slots, fp);
+  fwrite(pool, 1, pool_size, fp);
+
+  if (fclose(fp) || rename(temp, catalog_file))
+  {
+    fprintf(stderr, "%s: %s\n", catalog_file, strerror(errno));
+    unlink(temp);
+    goto done;
+  }
+
+  ret = true;
+  goto done;
+
+  // Report syntax errors...
+  syntax_error:
+
+  for (i = 1; ptr > data; ptr --)
+  {
+    if (*ptr == '\n')
+      i ++;
+  }
+
+  fprintf(stderr, "%s:%u: Syntax error.\n", strings_file, (unsigned)i);
+
+  // Free memory and return...
+  done:
+
+  free(data);
+  free(pairs);
+  free(slots);
+  free(pool);
+
+  return (ret);
+}
+
+
+//
+// 'catalog_lookup()' - Look up a message in a catalog.
+//
+
+const char *				// O - Localized message or `NULL` if not found
+catalog_lookup(catalog_t  *cat,		// I - Catalog
+               const char *key)		// I - Message key
+{
+  uint32_t		hash,		// Hash of key
+			i,		// Current slot
+			count;		// Number of slots checked
+  const catalog_slot_t	*slot;		// Current slot
+
+
+  if (!cat->data || !key)
+    return (NULL);
+
+  hash = catalog_hash(key);
+
+  for (i = hash & (cat->num_slots - 1), count = 0; count < cat->num_slots; i = (i + 1) & (cat->num_slots - 1), count ++)
+  {
+    slot = cat->slots + i;
+
+    if (!slot->key || slot->key >= cat->pool_size || slot->value >= cat->pool_size)
+      break;
+
+    if (slot->hash == hash && !strcmp(cat->pool + slot->key, key))
+      return (cat->pool + slot->value);
+  }
+
+  return (NULL);
+}
+
+
+//
+// 'catalog_open()' - Map a catalog file.
+//
+
+bool					// O - `true` on success, `false` on error
+catalog_open(catalog_t  *cat,		// I - Catalog
+             const char *filename)	// I - Catalog file
+{
+  int			fd;		// File descriptor
+  struct stat		fileinfo;	// File information
+  void			*data;		// Mapped file
+  const catalog_header_t *header;	// Catalog header
+  size_t		slots_size;	// Size of hash slots
+
+
+  memset(cat, 0, sizeof(catalog_t));
+
+  if ((fd = open(filename, O_RDONLY)) < 0)
+    return (false);
+
+  if (fstat(fd, &fileinfo) || (size_t)fileinfo.st_size < sizeof(catalog_header_t))
+  {
+    close(fd);
+    return (false);
+  }
+
+  data = mmap(NULL, (size_t)fileinfo.st_size, PROT_READ, MAP_SHARED, fd, 0);
+
+  close(fd);
+
+  if (data == MAP_FAILED)
+    return (false);
+
+  // Validate the header so that lookups stay inside the mapping...
+  header     = (const catalog_header_t *)data;
+  slots_size = (size_t)header->num_slots * sizeof(catalog_slot_t);
+
+  if (memcmp(header->magic, CATALOG_MAGIC, sizeof(CATALOG_MAGIC)) || header->byte_order != CATALOG_BYTE_ORDER || header->num_slots == 0 || (header->num_slots & (header->num_slots - 1)) || header->pool_size == 0 || sizeof(catalog_header_t) + slots_size + header->pool_size != (size_t)fileinfo.st_size || ((const char *)data)[fileinfo.st_size - 1])
+  {
+    munmap(data, (size_t)fileinfo.st_size);
+    return (false);
+  }
+
+  cat->data      = data;
+  cat->datasize  = (size_t)fileinfo.st_size;
+  cat->slots     = (const catalog_slot_t *)(header + 1);
+  cat->num_slots = header->num_slots;
+  cat->pool      = (const char *)data + sizeof(catalog_header_t) + slots_size;
+  cat->pool_size = header->pool_size;
+
+  return (true);
+}
+
+
+//
+// 'catalog_hash()' - Compute the FNV-1a hash of a string.
+//
+
+static uint32_t				// O - Hash value
+catalog_hash(const char *s)		// I - String
+{
+  uint32_t	hash = 2166136261U;	// Hash value
+
+
+  while (*s)
+  {
+    hash ^= (uint8_t)*s++;
+    hash *= 16777619U;
+  }
+
+  return (hash);
+}
+
+
+//
+// 'catalog_read_string()' - Read a quoted string from a ".strings" file.
+//
+// The string is unescaped in place.
+//
+
+static char *				// O - String or `NULL` on error
+catalog_read_string(char **ptr)		// IO - Pointer into file
+{
+  char	*start,				// Start of string
+	*src,				// Source pointer
+	*dst;				// Destination pointer
+
+
+  if (**ptr != '\"')
+    return (NULL);
+
+  for (start = dst = src = *ptr + 1; *src && *src != '\"'; src ++)
+  {
+    if (*src == '\\' && src[1])
+    {
+      switch (*(++ src))
+      {
+        case 'n' :
+            *dst++ = '\n';
+            break;
+        case 'r' :
+            *dst++ = '\r';
+            break;
+        case 't' :
+            *dst++ = '\t';
+            break;
+        default :
+            *dst++ = *src;
+            break;
+      }
+    }
+    else
+    {
+      *dst++ = *src;
+    }
+  }
+
+  if (*src != '\"')
+    return (NULL);
+
+  *dst = '\0';
+  *ptr = src + 1;
+
+  return (start);
+}
+
+
+//
+// 'catalog_skip_space()' - Skip whitespace and comments in a ".strings" file.
+//
+
+static void
+catalog_skip_space(char **ptr)		// IO - Pointer into file
+{
+  char	*s = *ptr;			// Pointer into file
+
+
+  for (;;)
+  {
+    while (isspace(*s & 255))
+      s ++;
+
+    if (!strncmp(s, "/*", 2))
+    {
+      if ((s = strstr(s + 2, "*/")) == NULL)
+      {
+        s = *ptr + strlen(*ptr);
+        break;
+      }
+
+      s += 2;
+    }
+    else if (!strncmp(s, "//", 2))
+    {
+      while (*s && *s != '\n')
+        s ++;
+    }
+    else
+    {
+      break;
+    }
+  }
+
+  *ptr = s;
+}
@@ -0,0 +1,67 @@
+//
+// Message catalog definitions for the CUPS commands.
+//
+// Copyright © 2026 by OpenPrinting.
+//
+// Licensed under Apache License v2.0.  See the file "LICENSE" for more
+// information.
+//
+
+#ifndef CATALOG_H
+#  define CATALOG_H
+#  include "localize.h"
+#  include <stdint.h>
+
+
+//
+// Constants...
+//
+
+#  define CATALOG_MAGIC		"CUPSCAT"
+					// Magic string at start of file
+#  define CATALOG_BYTE_ORDER	0x01020304
+					// Byte order marker
+
+
+//
+// Types...
+//
+
+typedef struct catalog_header_s		// Catalog file header
+{
+  char		magic[8];		// CATALOG_MAGIC
+  uint32_t	byte_order,		// CATALOG_BYTE_ORDER in native order
+		num_strings,		// Number of strings
+		num_slots,		// Number of hash slots (power of 2)
+		pool_size;		// Size of string pool
+} catalog_header_t;
+
+typedef struct catalog_slot_s		// Hash slot
+{
+  uint32_t	hash,			// Hash of key
+		key,			// Offset of key in pool or 0 if empty
+		value;			// Offset of value in pool
+} catalog_slot_t;
+
+typedef struct catalog_s		// Memory-mapped catalog
+{
+  void			*data;		// Mapped file
+  size_t		datasize;	// Size of mapped file
+  const catalog_slot_t	*slots;		// Hash slots
+  uint32_t		num_slots;	// Number of hash slots
+  const char		*pool;		// String pool
+  uint32_t		pool_size;	// Size of string pool
+} catalog_t;
+
+
+//
+// Functions...
+//
+
+extern void		catalog_close(catalog_t *cat);
+extern bool		catalog_compile(const char *strings_file, const char *catalog_file);
+extern const char	*catalog_lookup(catalog_t *cat, const char *key);
+extern bool		catalog_open(catalog_t *cat, const char *filename);
+
+
+#endif // !CATALOG_H
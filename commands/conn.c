@@ -0,0 +1,380 @@
+//
+// Connection manager for the CUPS commands.
+//
+// Copyright © 2026 by OpenPrinting.
+//
+// Licensed under Apache License v2.0.  See the file "LICENSE" for more
+// information.
+//
+// The connection manager keeps the connections a command opens to each
+// server, keyed by host name, port, and encryption, so that each connection is
+// only opened (and TLS only negotiated) once per run.
+//
+// `conn_get` returns the shared connection for a server, which is used for
+// ordinary requests one at a time.  Work that runs in parallel with other
+// requests (request pools, streamed responses) gets a connection of its own
+// with `conn_acquire` and hands it back with `conn_release`, after which it
+// stays open for the next caller.  `conn_borrow` lends out the shared
+// connection itself when nothing else is using it; while it is lent out,
+// `conn_get` opens another shared connection.  Callers never close managed connections;
+// they are all closed when the program exits.
+//
+// When the default server is a domain socket, requests for "localhost" use
+// the domain socket too.
+//
+// `conn_get_agent` returns the shared connection to the user's cups-agent for
+// the current server, if one is running, which answers the list requests of
+// lpstat, lpq, and lpc from memory.
+//
+
+#include "conn.h"
+#include <sys/stat.h>
+#include <sys/un.h>
+
+
+//
+// Local types...
+//
+
+typedef struct conn_s			// Managed connection
+{
+  char		host[256];		// Host name or domain socket
+  int		port;			// Port number
+  http_encryption_t encryption;		// Type of encryption
+  http_t	*http;			// HTTP connection to server
+  bool		shared,			// Shared connection?
+		in_use;			// Acquired by a caller?
+} conn_t;
+
+
+//
+// Local globals...
+//
+
+static cups_mutex_t	conn_mutex = CUPS_MUTEX_INITIALIZER;
+					// Mutex for connection list
+static size_t		conn_count = 0,	// Number of connections
+			conn_alloc = 0;	// Allocated connections
+static conn_t		*conns = NULL;	// Connections
+
+
+//
+// Local functions...
+//
+
+static char	*conn_agent_path(char *buffer, size_t bufsize);
+static http_t	*conn_open(const char *host, int port, http_encryption_t encryption, bool shared);
+
+
+//
+// 'conn_acquire()' - Get a connection for exclusive use.
+//
+// An idle connection to the server is reused when there is one, otherwise a
+// new connection is opened.  The connection must be given back with
+// `conn_release`.
+//
+
+http_t *				// O - HTTP connection or `NULL` on error
+conn_acquire(
+    const char        *host,		// I - Host name or domain socket
+    int               port,		// I - Port number
+    http_encryption_t encryption)	// I - Type of encryption
+{
+  return (conn_open(host, port, encryption, /*shared*/false));
+}
+
+
+//
+// 'conn_borrow()' - Borrow a shared connection for exclusive use.
+//
+// An idle shared connection is lent out as-is.  When the shared connection is
+// already lent out, a connection of its own to the same server is acquired
+// instead.  Either way the connection must be given back with `conn_release`.
+// Connections that are not shared are left alone.
+//
+
+bool					// O - `true` if the connection must be given back, `false` otherwise
+conn_borrow(http_t **http)		// IO - HTTP connection, `NULL` on error
+{
+  size_t	i;			// Looping var
+  conn_t	*conn;			// Current connection
+  char		host[256];		// Host name or domain socket
+  int		port;			// Port number
+  http_encryption_t encryption;		// Type of encryption
+
+
+  if (!*http)
+    return (false);
+
+  cupsMutexLock(&conn_mutex);
+
+  for (i = conn_count, conn = conns; i > 0; i --, conn ++)
+  {
+    if (conn->http == *http)
+      break;
+  }
+
+  if (i == 0 || !conn->shared)
+  {
+    // Not a shared connection...
+    cupsMutexUnlock(&conn_mutex);
+    return (false);
+  }
+  else if (!conn->in_use)
+  {
+    // Lend out the shared connection...
+    conn->in_use = true;
+
+    cupsMutexUnlock(&conn_mutex);
+    return (true);
+  }
+
+  cupsCopyString(host, conn->host, sizeof(host));
+  port       = conn->port;
+  encryption = conn->encryption;
+
+  cupsMutexUnlock(&conn_mutex);
+
+  // The shared connection is busy, use one of our own...
+  *http = conn_acquire(host, port, encryption);
+
+  return (*http != NULL);
+}
+
+
+//
+// 'conn_close_all()' - Close all connections.
+//
+
+void
+conn_close_all(void)
+{
+  size_t	i;			// Looping var
+
+
+  cupsMutexLock(&conn_mutex);
+
+  for (i = 0; i < conn_count; i ++)
+    httpClose(conns[i].http);
+
+  free(conns);
+
+  conns      = NULL;
+  conn_count = 0;
+  conn_alloc = 0;
+
+  cupsMutexUnlock(&conn_mutex);
+}
+
+
+//
+// 'conn_get()' - Get the shared connection to a server.
+//
+// A shared connection that has been lent out with `conn_borrow` is skipped.
+//
+
+http_t *				// O - HTTP connection or `NULL` on error
+conn_get(const char        *host,	// I - Host name or domain socket
+         int               port,	// I - Port number
+         http_encryption_t encryption)	// I - Type of encryption
+{
+  return (conn_open(host, port, encryption, /*shared*/true));
+}
+
+
+//
+// 'conn_get_agent()' - Get the shared connection to the agent for the current server.
+//
+// The given connection is returned when no agent is running.
+//
+
+http_t *				// O - HTTP connection
+conn_get_agent(http_t *http)		// I - Connection to use without an agent
+{
+  char		path[1024];		// Domain socket
+  http_t	*agent;			// Connection to agent
+
+
+  if (!conn_agent_path(path, sizeof(path)) || (agent = conn_open(path, 0, HTTP_ENCRYPTION_IF_REQUESTED, /*shared*/true)) == NULL)
+    return (http);
+
+  return (agent);
+}
+
+
+//
+// 'conn_get_agent_path()' - Get the domain socket of the agent for a server.
+//
+// Each server gets its own socket in "~/.cups", named using a hash of the
+// server name and port.
+//
+
+char *					// O - Domain socket or `NULL` on error
+conn_get_agent_path(
+    const char *host,			// I - Host name or domain socket
+    int        port,			// I - Port number
+    char       *buffer,			// I - Buffer
+    size_t     bufsize)			// I - Size of buffer
+{
+  const char	*home,			// Home directory
+		*ptr;			// Pointer into host name
+  unsigned	hash = 2166136261U;	// FNV-1a hash of host name and port
+  struct sockaddr_un addr;		// Domain socket address
+
+
+  if ((home = getenv("HOME")) == NULL)
+    return (NULL);
+
+  if (host[0] == '/')
+    port = 0;
+
+  for (ptr = host; *ptr; ptr ++)
+    hash = (hash ^ (unsigned)tolower(*ptr & 255)) * 16777619U;
+
+  hash = (hash ^ (unsigned)port) * 16777619U;
+
+  // Make sure the name fits in a socket address...
+  if ((size_t)snprintf(buffer, bufsize, "%s/.cups/agent-%08x.sock", home, hash) >= bufsize || strlen(buffer) >= sizeof(addr.sun_path))
+    return (NULL);
+
+  return (buffer);
+}
+
+
+//
+// 'conn_get_default()' - Get the shared connection to the current server.
+//
+
+http_t *				// O - HTTP connection or `NULL` on error
+conn_get_default(void)
+{
+  return (conn_open(cupsGetServer(), ippGetPort(), cupsGetEncryption(), /*shared*/true));
+}
+
+
+//
+// 'conn_release()' - Give back a connection from `conn_acquire` or `conn_borrow`.
+//
+
+void
+conn_release(http_t *http)		// I - HTTP connection
+{
+  size_t	i;			// Looping var
+
+
+  if (!http)
+    return;
+
+  cupsMutexLock(&conn_mutex);
+
+  for (i = 0; i < conn_count; i ++)
+  {
+    if (conns[i].http == http)
+    {
+      conns[i].in_use = false;
+      break;
+    }
+  }
+
+  cupsMutexUnlock(&conn_mutex);
+}
+
+
+//
+// 'conn_agent_path()' - Get the domain socket of a running agent for the current server.
+//
+
+static char *				// O - Domain socket or `NULL` if no agent
+conn_agent_path(char   *buffer,		// I - Buffer
+                size_t bufsize)		// I - Size of buffer
+{
+  struct stat	info;			// Socket information
+
+
+  if (!conn_get_agent_path(cupsGetServer(), ippGetPort(), buffer, bufsize) || stat(buffer, &info) || !S_ISSOCK(info.st_mode))
+    return (NULL);
+
+  return (buffer);
+}
+
+
+//
+// 'conn_open()' - Find or open a connection.
+//
+
+static http_t *				// O - HTTP connection or `NULL` on error
+conn_open(const char        *host,	// I - Host name or domain socket
+          int               port,	// I - Port number
+          http_encryption_t encryption,	// I - Type of encryption
+          bool              shared)	// I - Shared connection?
+{
+  size_t	i;			// Looping var
+  conn_t	*conn;			// Current connection
+  http_t	*http;			// New connection
+  const char	*server = cupsGetServer();
+					// Default server
+  static bool	registered = false;	// Registered `conn_close_all`?
+
+
+  // Use the domain socket for the local server...
+  if (server[0] == '/' && !strcasecmp(host, "localhost"))
+    host = server;
+
+  if (host[0] == '/')
+    port = 0;
+
+  // Look for an existing connection...
+  cupsMutexLock(&conn_mutex);
+
+  for (i = conn_count, conn = conns; i > 0; i --, conn ++)
+  {
+    if (conn->shared == shared && !conn->in_use && conn->port == port && conn->encryption == encryption && !strcasecmp(conn->host, host))
+    {
+      conn->in_use = !shared;
+      http         = conn->http;
+
+      cupsMutexUnlock(&conn_mutex);
+      return (http);
+    }
+  }
+
+  cupsMutexUnlock(&conn_mutex);
+
+  // Open a new connection...
+  if ((http = httpConnect(host, port, /*addrlist*/NULL, AF_UNSPEC, encryption, /*blocking*/true, /*msec*/30000, /*cancel*/NULL)) == NULL)
+    return (NULL);
+
+  cupsMutexLock(&conn_mutex);
+
+  if (conn_count >= conn_alloc)
+  {
+    if ((conn = realloc(conns, (conn_alloc + 8) * sizeof(conn_t))) == NULL)
+    {
+      cupsMutexUnlock(&conn_mutex);
+      httpClose(http);
+      return (NULL);
+    }
+
+    conns      = conn;
+    conn_alloc += 8;
+  }
+
+  conn = conns + conn_count ++;
+
+  cupsCopyString(conn->host, host, sizeof(conn->host));
+  conn->port       = port;
+  conn->encryption = encryption;
+  conn->http       = http;
+  conn->shared     = shared;
+  conn->in_use     = !shared;
+
+  if (!registered)
+  {
+    atexit(conn_close_all);
+    registered = true;
+  }
+
+  cupsMutexUnlock(&conn_mutex);
+
+  return (http);
+}
@@ -0,0 +1,29 @@
+//
+// Connection manager definitions for the CUPS commands.
+//
+// Copyright © 2026 by OpenPrinting.
+//
+// Licensed under Apache License v2.0.  See the file "LICENSE" for more
+// information.
+//
+
+#ifndef CONN_H
+#  define CONN_H
+#  include "localize.h"
+
+
+//
+// Functions...
+//
+
+extern http_t		*conn_acquire(const char *host, int port, http_encryption_t encryption);
+extern bool		conn_borrow(http_t **http);
+extern void		conn_close_all(void);
+extern http_t		*conn_get(const char *host, int port, http_encryption_t encryption);
+extern http_t		*conn_get_agent(http_t *http);
+extern char		*conn_get_agent_path(const char *host, int port, char *buffer, size_t bufsize);
+extern http_t		*conn_get_default(void);
+extern void		conn_release(http_t *http);
+
+
+#endif // !CONN_H
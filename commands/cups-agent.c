@@ -0,0 +1,1518 @@
+//
+// Per-user printer and job state agent for the CUPS commands.
+//
+// Copyright © 2026 by OpenPrinting.
+//
+// Licensed under Apache License v2.0.  See the file "LICENSE" for more
+// information.
+//
+// Usage:
+//
+//   cups-agent [-E] [-U USERNAME] [-h SERVER[:PORT]]
+//
+// The agent keeps the printers and active jobs of a server in memory and
+// answers the CUPS-Get-Printers, CUPS-Get-Classes, Get-Printer-Attributes,
+// Get-Jobs, and Get-Job-Attributes requests of lpstat, lpq, and lpc from them
+// on a domain socket in the user's "~/.cups" directory (see
+// `conn_get_agent`).
+//
+// Everything is loaded once at startup.  After that the agent subscribes to
+// the server's printer and job events and, for each event it pulls with
+// Get-Notifications, fetches only the printer or job that changed.  If events
+// are lost or the subscription goes away, everything is loaded again.
+//
+// Requests that cannot be answered from memory - other operations, attributes
+// the agent does not keep, completed jobs - are sent to the server unchanged,
+// as is every request while the agent is out of sync with the server.
+//
+// Answers can lag the server by the time it takes an event to arrive, so a
+// job that was just submitted may not be listed right away.
+//
+
+#include "conn.h"
+#include "stream.h"
+#include <poll.h>
+#include <signal.h>
+#include <sys/stat.h>
+
+
+//
+// Local constants...
+//
+
+#define AGENT_LEASE		3600	// Lease for subscription in seconds
+#define AGENT_MAX_CHANGES	256	// Maximum changes per Get-Notifications
+#define AGENT_RETRY		5	// Delay before reconnecting in seconds
+
+
+//
+// Local types...
+//
+
+typedef struct agent_auth_s		// Password state for a thread
+{
+  char		password[256];		// Password for this thread
+  int		tries;			// Number of passwords given
+} agent_auth_t;
+
+typedef struct agent_dest_s		// Printer or class
+{
+  char		name[256];		// Name
+  ipp_t		*attrs;			// Printer attributes
+} agent_dest_t;
+
+typedef struct agent_job_s		// Active job
+{
+  int		id,			// Job ID
+		priority;		// Job priority
+  char		dest[256],		// Destination name
+		user[256];		// Job owner
+  ipp_t		*attrs;			// Job attributes
+} agent_job_t;
+
+
+//
+// Local globals...
+//
+
+static cups_mutex_t	agent_mutex = CUPS_MUTEX_INITIALIZER;
+					// Mutex for printers, jobs, and subscription
+static cups_array_t	*agent_dests = NULL,
+					// Printers and classes
+			*agent_jobs = NULL;
+					// Active jobs, in scheduling order
+static bool		agent_synced = false;
+					// Printers and jobs up to date?
+static char		agent_server[256],
+					// Server name
+			agent_user[256];// User name
+static int		agent_port,	// Port number
+			agent_sub_id = 0;
+					// Subscription ID
+static http_encryption_t agent_encryption;
+					// Type of encryption
+static volatile sig_atomic_t agent_stop = 0;
+					// Stop the agent?
+static cups_mutex_t	agent_password_mutex = CUPS_MUTEX_INITIALIZER;
+					// Mutex for password
+static char		agent_password[256] = "";
+					// Last password from the user
+
+static const char * const agent_events[] =
+{					// Events to subscribe to
+  "job-completed",
+  "job-config-changed",
+  "job-created",
+  "job-state-changed",
+  "printer-added",
+  "printer-config-changed",
+  "printer-deleted",
+  "printer-modified",
+  "printer-state-changed",
+  "server-restarted"
+};
+static const char * const agent_jattrs[] =
+{					// Job attributes kept in memory (sorted)
+  "copies",
+  "job-id",
+  "job-k-octets",
+  "job-name",
+  "job-originating-user-name",
+  "job-printer-state-message",
+  "job-printer-uri",
+  "job-priority",
+  "job-state",
+  "job-state-reasons",
+  "time-at-completed",
+  "time-at-creation"
+};
+static const char * const agent_operation[] =
+{					// Operation attributes understood (sorted)
+  "attributes-charset",
+  "attributes-natural-language",
+  "job-id",
+  "job-uri",
+  "limit",
+  "my-jobs",
+  "printer-type",
+  "printer-type-mask",
+  "printer-uri",
+  "requested-attributes",
+  "requesting-user-name",
+  "which-jobs"
+};
+static const char * const agent_pattrs[] =
+{					// Printer attributes kept in memory (sorted)
+  "device-uri",
+  "member-names",
+  "printer-info",
+  "printer-is-accepting-jobs",
+  "printer-location",
+  "printer-make-and-model",
+  "printer-name",
+  "printer-state",
+  "printer-state-change-time",
+  "printer-state-message",
+  "printer-state-reasons",
+  "printer-type",
+  "printer-uri-supported",
+  "queued-job-count",
+  "requesting-user-name-allowed",
+  "requesting-user-name-denied"
+};
+
+
+//
+// Local functions...
+//
+
+static void	add_groups(cups_array_t *dests, cups_array_t *jobs, ipp_t *ipp);
+static bool	can_answer(ipp_t *request, cups_array_t *ra, const char * const *attrs, size_t num_attrs);
+static int	compare_dests(agent_dest_t *a, agent_dest_t *b, void *data);
+static int	compare_jobs(agent_job_t *a, agent_job_t *b, void *data);
+static int	compare_names(const char **a, const char **b);
+static bool	filter_attr(cups_array_t *ra, ipp_t *dst, ipp_attribute_t *attr);
+static agent_dest_t *find_dest(const char *name);
+static agent_job_t *find_job(cups_array_t *jobs, int id);
+static void	free_dest(agent_dest_t *dest, void *data);
+static void	free_job(agent_job_t *job, void *data);
+static agent_dest_t *get_dest(ipp_t *request, bool *all);
+static ipp_t	*ipp_get_jobs(ipp_t *request, cups_array_t *ra);
+static ipp_t	*ipp_get_printers(ipp_t *request, cups_array_t *ra);
+static bool	load_all(http_t *http);
+static void	load_dest(http_t *http, const char *name);
+static void	load_job(http_t *http, int id);
+static const char *password_cb(const char *prompt, http_t *http, const char *method, const char *resource, agent_auth_t *auth);
+static void	*process_client(http_t *client);
+static ipp_t	*process_ipp(ipp_t *request);
+static ipp_t	*proxy_ipp(ipp_t *request);
+static size_t	queued_jobs(agent_dest_t *dest);
+static void	respond_http(http_t *client, http_status_t hstatus);
+static void	sigterm_handler(int sig);
+static int	subscribe(http_t *http);
+static void	usage(void) _CUPS_NORETURN;
+static void	*watch_events(http_t *http);
+
+
+//
+// 'main()' - Main entry.
+//
+
+int					// O - Exit status
+main(int  argc,				// I - Number of command-line arguments
+     char *argv[])			// I - Command-line arguments
+{
+  int		i,			// Looping var
+		sub_id;			// Subscription ID
+  const char	*opt;			// Option pointer
+  char		path[1024],		// Domain socket
+		*ptr;			// Pointer into path
+  http_t	*http,			// Connection to server
+		*client;		// Client connection
+  http_addrlist_t *addrlist;		// Listen address
+  struct pollfd	pfd;			// Listen socket
+  cups_thread_t	thread;			// Client or event thread
+
+
+  localize_init(argv);
+
+  // Parse the command-line...
+  for (i = 1; i < argc; i ++)
+  {
+    if (!strcmp(argv[i], "--help"))
+    {
+      usage();
+    }
+    else if (argv[i][0] == '-' && argv[i][1])
+    {
+      for (opt = argv[i] + 1; *opt; opt ++)
+      {
+        switch (*opt)
+        {
+	  case 'E' : // Encrypt
+#ifdef HAVE_TLS
+	      cupsSetEncryption(HTTP_ENCRYPTION_REQUIRED);
+#else
+	      cupsLangPrintf(stderr, _("%s: Sorry, no encryption support."), argv[0]);
+#endif // HAVE_TLS
+	      break;
+
+	  case 'U' : // Username
+	      if (opt[1] != '\0')
+	      {
+		cupsSetUser(opt + 1);
+		opt += strlen(opt) - 1;
+	      }
+	      else
+	      {
+		i ++;
+		if (i >= argc)
+		{
+		  cupsLangPrintf(stderr, _("%s: Error - expected username after \"-U\" option."), argv[0]);
+		  return (1);
+		}
+
+		cupsSetUser(argv[i]);
+	      }
+	      break;
+
+	  case 'h' : // Connect to host
+	      if (opt[1] != '\0')
+	      {
+		cupsSetServer(opt + 1);
+		opt += strlen(opt) - 1;
+	      }
+	      else
+	      {
+		i ++;
+
+		if (i >= argc)
+		{
+		  cupsLangPrintf(stderr, _("%s: Error - expected hostname after \"-h\" option."), argv[0]);
+		  return (1);
+		}
+
+		cupsSetServer(argv[i]);
+	      }
+	      break;
+
+	  default :
+	      cupsLangPrintf(stderr, _("%s: Error - unknown option \"%c\"."), argv[0], *opt);
+	      usage();
+	}
+      }
+    }
+    else
+    {
+      usage();
+    }
+  }
+
+  // The event and client threads use these rather than the per-thread
+  // settings of the main thread...
+  cupsCopyString(agent_server, cupsGetServer(), sizeof(agent_server));
+  cupsCopyString(agent_user, cupsGetUser(), sizeof(agent_user));
+  agent_port       = ippGetPort();
+  agent_encryption = cupsGetEncryption();
+
+  if (!conn_get_agent_path(agent_server, agent_port, path, sizeof(path)))
+  {
+    cupsLangPrintf(stderr, _("%s: Unable to get the agent socket name."), argv[0]);
+    return (1);
+  }
+
+  if (conn_get_agent(NULL))
+  {
+    cupsLangPrintf(stderr, _("%s: An agent is already running for \"%s\"."), argv[0], agent_server);
+    return (1);
+  }
+
+  // Subscribe to changes and load the printers and jobs...
+  if ((http = conn_acquire(agent_server, agent_port, agent_encryption)) == NULL)
+  {
+    cupsLangPrintf(stderr, _("%s: Unable to connect to server."), argv[0]);
+    return (1);
+  }
+
+  if ((agent_sub_id = subscribe(http)) == 0 || !load_all(http))
+  {
+    cupsLangPrintf(stderr, "%s: %s", argv[0], cupsLastErrorString());
+    return (1);
+  }
+
+  // Create the domain socket, which only the user can use...
+  if ((ptr = strrchr(path, '/')) != NULL)
+  {
+    *ptr = '\0';
+    mkdir(path, 0700);
+    *ptr = '/';
+  }
+
+  addrlist = httpAddrGetList(path, AF_LOCAL, "0");
+  pfd.fd   = addrlist ? httpAddrListen(&(addrlist->addr), 0) : -1;
+
+  httpAddrFreeList(addrlist);
+
+  if (pfd.fd < 0)
+  {
+    cupsLangPrintf(stderr, _("%s: Unable to listen on \"%s\": %s"), argv[0], path, strerror(errno));
+    return (1);
+  }
+
+  chmod(path, 0600);
+
+  pfd.events = POLLIN;
+
+  signal(SIGPIPE, SIG_IGN);
+  signal(SIGINT, sigterm_handler);
+  signal(SIGTERM, sigterm_handler);
+
+  // Start watching for changes...
+  if ((thread = cupsThreadCreate((cups_thread_func_t)watch_events, http)) == CUPS_THREAD_INVALID)
+  {
+    cupsLangPrintf(stderr, "%s: %s", argv[0], strerror(errno));
+    close(pfd.fd);
+    unlink(path);
+    return (1);
+  }
+
+  cupsThreadDetach(thread);
+
+  // Accept connections until we are stopped...
+  while (!agent_stop)
+  {
+    if (poll(&pfd, 1, 1000) <= 0 || !(pfd.revents & POLLIN))
+      continue;
+
+    if ((client = httpAcceptConnection(pfd.fd, /*blocking*/true)) == NULL)
+      continue;
+
+    if ((thread = cupsThreadCreate((cups_thread_func_t)process_client, client)) == CUPS_THREAD_INVALID)
+      httpClose(client);
+    else
+      cupsThreadDetach(thread);
+  }
+
+  close(pfd.fd);
+  unlink(path);
+
+  // Cancel the subscription rather than waiting for the lease to expire...
+  cupsMutexLock(&agent_mutex);
+  sub_id = agent_sub_id;
+  cupsMutexUnlock(&agent_mutex);
+
+  if (sub_id && (http = conn_acquire(agent_server, agent_port, agent_encryption)) != NULL)
+  {
+    ipp_t	*request;		// IPP request
+
+    request = ippNewRequest(IPP_OP_CANCEL_SUBSCRIPTION);
+
+    ippAddString(request, IPP_TAG_OPERATION, IPP_TAG_URI, "printer-uri", NULL, "ipp://localhost/");
+    ippAddInteger(request, IPP_TAG_OPERATION, IPP_TAG_INTEGER, "notify-subscription-id", sub_id);
+    ippAddString(request, IPP_TAG_OPERATION, IPP_TAG_NAME, "requesting-user-name", NULL, agent_user);
+
+    ippDelete(cupsDoRequest(http, request, "/"));
+  }
+
+  return (0);
+}
+
+
+//
+// 'add_groups()' - Add or update the printers and jobs in a response.
+//
+// Jobs that are no longer active are removed.
+//
+
+static void
+add_groups(cups_array_t *dests,		// I - Printers and classes
+           cups_array_t *jobs,		// I - Active jobs
+           ipp_t        *ipp)		// I - IPP response or group
+{
+  ipp_attribute_t *attr;		// Current attribute
+  ipp_tag_t	group_tag = IPP_TAG_ZERO;
+					// Current group
+  ipp_t		*attrs = NULL;		// Attributes of current group
+  const char	*name,			// Printer name
+		*uri;			// Job printer URI
+  agent_dest_t	*dest,			// Printer or class
+		dkey;			// Search key
+  agent_job_t	*job;			// Job
+  int		id;			// Job ID
+
+
+  for (attr = ippGetFirstAttribute(ipp);; attr = ippGetNextAttribute(ipp))
+  {
+    if (attr && ippGetName(attr) && ippGetGroupTag(attr) == group_tag)
+    {
+      ippCopyAttribute(attrs, attr, /*quickcopy*/false);
+      continue;
+    }
+
+    // End of group, add the printer or job...
+    if (group_tag == IPP_TAG_PRINTER && (name = ippGetString(ippFindAttribute(attrs, "printer-name", IPP_TAG_NAME), 0, NULL)) != NULL)
+    {
+      cupsCopyString(dkey.name, name, sizeof(dkey.name));
+
+      if ((dest = (agent_dest_t *)cupsArrayFind(dests, &dkey)) != NULL)
+      {
+        ippDelete(dest->attrs);
+        dest->attrs = attrs;
+        attrs       = NULL;
+      }
+      else if ((dest = (agent_dest_t *)calloc(1, sizeof(agent_dest_t))) != NULL)
+      {
+        cupsCopyString(dest->name, name, sizeof(dest->name));
+        dest->attrs = attrs;
+        attrs       = NULL;
+
+        cupsArrayAdd(dests, dest);
+      }
+    }
+    else if (group_tag == IPP_TAG_JOB && (id = ippGetInteger(ippFindAttribute(attrs, "job-id", IPP_TAG_INTEGER), 0)) > 0)
+    {
+      // Remove the old copy, since the priority can change the order...
+      if ((job = find_job(jobs, id)) != NULL)
+        cupsArrayRemove(jobs, job);
+
+      if (ippGetInteger(ippFindAttribute(attrs, "job-state", IPP_TAG_ENUM), 0) <= IPP_JSTATE_STOPPED && (job = (agent_job_t *)calloc(1, sizeof(agent_job_t))) != NULL)
+      {
+        job->id       = id;
+        job->priority = ippGetInteger(ippFindAttribute(attrs, "job-priority", IPP_TAG_INTEGER), 0);
+        job->attrs    = attrs;
+        attrs         = NULL;
+
+        if ((uri = ippGetString(ippFindAttribute(job->attrs, "job-printer-uri", IPP_TAG_URI), 0, NULL)) != NULL && (name = strrchr(uri, '/')) != NULL)
+          cupsCopyString(job->dest, name + 1, sizeof(job->dest));
+
+        if ((name = ippGetString(ippFindAttribute(job->attrs, "job-originating-user-name", IPP_TAG_NAME), 0, NULL)) != NULL)
+          cupsCopyString(job->user, name, sizeof(job->user));
+
+        cupsArrayAdd(jobs, job);
+      }
+    }
+
+    ippDelete(attrs);
+    attrs = NULL;
+
+    if (!attr)
+      break;
+
+    // Start a new group...
+    if (ippGetName(attr) && ((group_tag = ippGetGroupTag(attr)) == IPP_TAG_PRINTER || group_tag == IPP_TAG_JOB))
+    {
+      attrs = ippNew();
+      ippCopyAttribute(attrs, attr, /*quickcopy*/false);
+    }
+    else
+    {
+      group_tag = IPP_TAG_ZERO;
+    }
+  }
+}
+
+
+//
+// 'can_answer()' - Determine whether a request can be answered from memory.
+//
+
+static bool				// O - `true` if the agent has everything needed
+can_answer(ipp_t              *request,	// I - IPP request
+           cups_array_t       *ra,	// I - Requested attributes
+           const char * const *attrs,	// I - Attributes kept in memory (sorted)
+           size_t             num_attrs)// I - Number of attributes
+{
+  ipp_attribute_t *attr;		// Current attribute
+  const char	*name;			// Attribute name
+
+
+  // "all" and the default attributes are left to the server...
+  if (!agent_synced || !ra)
+    return (false);
+
+  for (name = (const char *)cupsArrayGetFirst(ra); name; name = (const char *)cupsArrayGetNext(ra))
+  {
+    if (!bsearch(&name, attrs, num_attrs, sizeof(char *), (int (*)(const void *, const void *))compare_names))
+      return (false);
+  }
+
+  // Filters like "first-index" and "printer-location" are left to the server...
+  for (attr = ippGetFirstAttribute(request); attr && ippGetGroupTag(attr) == IPP_TAG_OPERATION; attr = ippGetNextAttribute(request))
+  {
+    name = ippGetName(attr);
+
+    if (!bsearch(&name, agent_operation, sizeof(agent_operation) / sizeof(agent_operation[0]), sizeof(char *), (int (*)(const void *, const void *))compare_names))
+      return (false);
+  }
+
+  return (true);
+}
+
+
+//
+// 'compare_dests()' - Compare two destinations by name.
+//
+
+static int				// O - Result of comparison
+compare_dests(agent_dest_t *a,		// I - First destination
+              agent_dest_t *b,		// I - Second destination
+              void         *data)	// I - Callback data (unused)
+{
+  (void)data;
+
+  return (strcasecmp(a->name, b->name));
+}
+
+
+//
+// 'compare_jobs()' - Compare two jobs in scheduling order.
+//
+// Like the scheduler, jobs are ordered by priority and then by job ID.
+//
+
+static int				// O - Result of comparison
+compare_jobs(agent_job_t *a,		// I - First job
+             agent_job_t *b,		// I - Second job
+             void        *data)		// I - Callback data (unused)
+{
+  (void)data;
+
+  if (a->priority != b->priority)
+    return (b->priority - a->priority);
+  else
+    return (a->id - b->id);
+}
+
+
+//
+// 'compare_names()' - Compare two attribute names for `bsearch`.
+//
+
+static int				// O - Result of comparison
+compare_names(const char **a,		// I - First name
+              const char **b)		// I - Second name
+{
+  return (strcmp(*a, *b));
+}
+
+
+//
+// 'filter_attr()' - Filter attributes by the requested attributes.
+//
+
+static bool				// O - `true` to copy, `false` to skip
+filter_attr(cups_array_t    *ra,	// I - Requested attributes
+            ipp_t           *dst,	// I - Destination (unused)
+            ipp_attribute_t *attr)	// I - Attribute
+{
+  (void)dst;
+
+  return (cupsArrayFind(ra, (void *)ippGetName(attr)) != NULL);
+}
+
+
+//
+// 'find_dest()' - Find a destination by name.
+//
+
+static agent_dest_t *			// O - Destination or `NULL` if not found
+find_dest(const char *name)		// I - Name
+{
+  agent_dest_t	key;			// Search key
+
+
+  cupsCopyString(key.name, name, sizeof(key.name));
+
+  return ((agent_dest_t *)cupsArrayFind(agent_dests, &key));
+}
+
+
+//
+// 'find_job()' - Find a job by ID.
+//
+// The jobs are sorted by priority, so this is a linear search; the number of
+// active jobs is normally small.
+//
+
+static agent_job_t *			// O - Job or `NULL` if not found
+find_job(cups_array_t *jobs,		// I - Active jobs
+         int          id)		// I - Job ID
+{
+  agent_job_t	*job;			// Current job
+
+
+  for (job = (agent_job_t *)cupsArrayGetFirst(jobs); job; job = (agent_job_t *)cupsArrayGetNext(jobs))
+  {
+    if (job->id == id)
+      break;
+  }
+
+  return (job);
+}
+
+
+//
+// 'free_dest()' - Free a destination.
+//
+
+static void
+free_dest(agent_dest_t *dest,		// I - Destination
+          void         *data)		// I - Callback data (unused)
+{
+  (void)data;
+
+  ippDelete(dest->attrs);
+  free(dest);
+}
+
+
+//
+// 'free_job()' - Free a job.
+//
+
+static void
+free_job(agent_job_t *job,		// I - Job
+         void        *data)		// I - Callback data (unused)
+{
+  (void)data;
+
+  ippDelete(job->attrs);
+  free(job);
+}
+
+
+//
+// 'get_dest()' - Get the destination for a request.
+//
+// `all` is set to `true` when the "printer-uri" attribute names the server
+// rather than a printer or class.
+//
+
+static agent_dest_t *			// O - Destination or `NULL` if none
+get_dest(ipp_t *request,		// I - IPP request
+         bool  *all)			// O - `true` for all destinations
+{
+  const char	*uri;			// Printer URI
+  char		scheme[32],		// URI scheme
+		userpass[256],		// Username:password
+		host[256],		// Hostname
+		resource[256];		// Resource path
+  int		port;			// Port number
+
+
+  *all = false;
+
+  if ((uri = ippGetString(ippFindAttribute(request, "printer-uri", IPP_TAG_URI), 0, NULL)) == NULL)
+  {
+    *all = true;
+    return (NULL);
+  }
+
+  if (httpSeparateURI(HTTP_URI_CODING_ALL, uri, scheme, sizeof(scheme), userpass, sizeof(userpass), host, sizeof(host), &port, resource, sizeof(resource)) < HTTP_URI_STATUS_OK)
+    return (NULL);
+
+  if (!strncmp(resource, "/printers/", 10) && resource[10])
+    return (find_dest(resource + 10));
+  else if (!strncmp(resource, "/classes/", 9) && resource[9])
+    return (find_dest(resource + 9));
+
+  *all = !strcmp(resource, "/") || !strcmp(resource, "/jobs");
+
+  return (NULL);
+}
+
+
+//
+// 'ipp_get_jobs()' - Get the active jobs.
+//
+
+static ipp_t *				// O - IPP response or `NULL` to ask the server
+ipp_get_jobs(ipp_t        *request,	// I - IPP request
+             cups_array_t *ra)		// I - Requested attributes
+{
+  ipp_t		*response;		// IPP response
+  agent_dest_t	*dest;			// Destination
+  agent_job_t	*job;			// Current job
+  const char	*which,			// which-jobs value
+		*user = NULL;		// Only jobs for this user
+  int		limit,			// Maximum number of jobs
+		count = 0;		// Number of jobs returned
+  bool		all;			// All destinations?
+
+
+  if ((dest = get_dest(request, &all)) == NULL && !all)
+    return (NULL);
+
+  if ((which = ippGetString(ippFindAttribute(request, "which-jobs", IPP_TAG_KEYWORD), 0, NULL)) != NULL && strcmp(which, "not-completed"))
+    return (NULL);
+
+  if (ippGetBoolean(ippFindAttribute(request, "my-jobs", IPP_TAG_BOOLEAN), 0))
+    user = ippGetString(ippFindAttribute(request, "requesting-user-name", IPP_TAG_NAME), 0, NULL);
+
+  limit    = ippGetInteger(ippFindAttribute(request, "limit", IPP_TAG_INTEGER), 0);
+  response = ippNewResponse(request);
+
+  for (job = (agent_job_t *)cupsArrayGetFirst(agent_jobs); job && (limit <= 0 || count < limit); job = (agent_job_t *)cupsArrayGetNext(agent_jobs))
+  {
+    if (dest && strcasecmp(job->dest, dest->name))
+      continue;
+
+    if (user && strcmp(job->user, user))
+      continue;
+
+    if (count > 0)
+      ippAddSeparator(response);
+
+    ippCopyAttributes(response, job->attrs, /*quickcopy*/false, (ipp_copy_cb_t)filter_attr, ra);
+    count ++;
+  }
+
+  return (response);
+}
+
+
+//
+// 'ipp_get_printers()' - Get a list of printers or classes.
+//
+
+static ipp_t *				// O - IPP response
+ipp_get_printers(ipp_t        *request,	// I - IPP request
+                 cups_array_t *ra)	// I - Requested attributes
+{
+  ipp_t		*response;		// IPP response
+  bool		classes_only;		// Only return classes?
+  int		type,			// printer-type value
+		mask,			// printer-type-mask value
+		dtype,			// Destination printer-type
+		limit,			// Maximum number of destinations
+		count = 0;		// Number of destinations returned
+  agent_dest_t	*dest;			// Current destination
+
+
+  classes_only = ippGetOperation(request) == IPP_OP_CUPS_GET_CLASSES;
+  type         = ippGetInteger(ippFindAttribute(request, "printer-type", IPP_TAG_ENUM), 0);
+  mask         = ippGetInteger(ippFindAttribute(request, "printer-type-mask", IPP_TAG_ENUM), 0);
+  limit        = ippGetInteger(ippFindAttribute(request, "limit", IPP_TAG_INTEGER), 0);
+  response     = ippNewResponse(request);
+
+  for (dest = (agent_dest_t *)cupsArrayGetFirst(agent_dests); dest && (limit <= 0 || count < limit); dest = (agent_dest_t *)cupsArrayGetNext(agent_dests))
+  {
+    dtype = ippGetInteger(ippFindAttribute(dest->attrs, "printer-type", IPP_TAG_ENUM), 0);
+
+    if (classes_only && !(dtype & CUPS_PRINTER_CLASS))
+      continue;
+
+    if ((dtype & mask) != (type & mask))
+      continue;
+
+    if (count > 0)
+      ippAddSeparator(response);
+
+    ippCopyAttributes(response, dest->attrs, /*quickcopy*/false, (ipp_copy_cb_t)filter_attr, ra);
+
+    if (cupsArrayFind(ra, "queued-job-count"))
+      ippAddInteger(response, IPP_TAG_PRINTER, IPP_TAG_INTEGER, "queued-job-count", (int)queued_jobs(dest));
+
+    count ++;
+  }
+
+  if (count == 0)
+    ippSetStatusCode(response, IPP_STATUS_ERROR_NOT_FOUND);
+
+  return (response);
+}
+
+
+//
+// 'load_all()' - Load all printers and active jobs from the server.
+//
+
+static bool				// O - `true` on success, `false` on error
+load_all(http_t *http)			// I - Connection to server
+{
+  ipp_t		*request,		// IPP request
+		*group;			// Current group
+  stream_t	*stream;		// Streaming response
+  cups_array_t	*dests,			// Printers and classes
+		*jobs;			// Active jobs
+  int		i;			// Looping var
+  ipp_status_t	status;			// IPP status
+  static const ipp_op_t ops[] =		// Operations for loading
+  {
+    IPP_OP_CUPS_GET_PRINTERS,
+    IPP_OP_GET_JOBS
+  };
+
+
+  dests = cupsArrayNew((cups_array_cb_t)compare_dests, NULL, NULL, 0, NULL, (cups_afree_cb_t)free_dest);
+  jobs  = cupsArrayNew((cups_array_cb_t)compare_jobs, NULL, NULL, 0, NULL, (cups_afree_cb_t)free_job);
+
+  for (i = 0; i < (int)(sizeof(ops) / sizeof(ops[0])); i ++)
+  {
+    request = ippNewRequest(ops[i]);
+
+    ippAddString(request, IPP_TAG_OPERATION, IPP_TAG_URI, "printer-uri", NULL, "ipp://localhost/");
+    ippAddString(request, IPP_TAG_OPERATION, IPP_TAG_NAME, "requesting-user-name", NULL, agent_user);
+
+    if (ops[i] == IPP_OP_GET_JOBS)
+      ippAddStrings(request, IPP_TAG_OPERATION, IPP_TAG_KEYWORD, "requested-attributes", sizeof(agent_jattrs) / sizeof(agent_jattrs[0]), NULL, agent_jattrs);
+    else
+      ippAddStrings(request, IPP_TAG_OPERATION, IPP_TAG_KEYWORD, "requested-attributes", sizeof(agent_pattrs) / sizeof(agent_pattrs[0]), NULL, agent_pattrs);
+
+    stream = stream_open(http, request, "/");
+
+    while ((group = stream_next(stream)) != NULL)
+      add_groups(dests, jobs, group);
+
+    status = stream_get_status(stream);
+
+    stream_close(stream);
+
+    if (status > IPP_STATUS_OK_CONFLICTING && status != IPP_STATUS_ERROR_NOT_FOUND)
+    {
+      cupsArrayDelete(dests);
+      cupsArrayDelete(jobs);
+      return (false);
+    }
+  }
+
+  // Replace the old printers and jobs...
+  cupsMutexLock(&agent_mutex);
+
+  cupsArrayDelete(agent_dests);
+  cupsArrayDelete(agent_jobs);
+
+  agent_dests  = dests;
+  agent_jobs   = jobs;
+  agent_synced = true;
+
+  cupsMutexUnlock(&agent_mutex);
+
+  return (true);
+}
+
+
+//
+// 'load_dest()' - Load or remove a printer or class.
+//
+
+static void
+load_dest(http_t     *http,		// I - Connection to server
+          const char *name)		// I - Printer name
+{
+  ipp_t		*request,		// IPP request
+		*response;		// IPP response
+  agent_dest_t	*dest;			// Printer or class
+  char		uri[1024];		// Printer URI
+
+
+  // The scheduler finds classes by their "/printers/NAME" URI as well...
+  httpAssembleURIf(HTTP_URI_CODING_ALL, uri, sizeof(uri), "ipp", NULL, "localhost", 0, "/printers/%s", name);
+
+  request = ippNewRequest(IPP_OP_GET_PRINTER_ATTRIBUTES);
+
+  ippAddString(request, IPP_TAG_OPERATION, IPP_TAG_URI, "printer-uri", NULL, uri);
+  ippAddString(request, IPP_TAG_OPERATION, IPP_TAG_NAME, "requesting-user-name", NULL, agent_user);
+  ippAddStrings(request, IPP_TAG_OPERATION, IPP_TAG_KEYWORD, "requested-attributes", sizeof(agent_pattrs) / sizeof(agent_pattrs[0]), NULL, agent_pattrs);
+
+  response = cupsDoRequest(http, request, "/");
+
+  cupsMutexLock(&agent_mutex);
+
+  if (cupsLastError() == IPP_STATUS_ERROR_NOT_FOUND)
+  {
+    if ((dest = find_dest(name)) != NULL)
+      cupsArrayRemove(agent_dests, dest);
+  }
+  else if (cupsLastError() <= IPP_STATUS_OK_CONFLICTING)
+  {
+    add_groups(agent_dests, agent_jobs, response);
+  }
+
+  cupsMutexUnlock(&agent_mutex);
+
+  ippDelete(response);
+}
+
+
+//
+// 'load_job()' - Load or remove a job.
+//
+
+static void
+load_job(http_t *http,			// I - Connection to server
+         int    id)			// I - Job ID
+{
+  ipp_t		*request,		// IPP request
+		*response;		// IPP response
+  agent_job_t	*job;			// Job
+  char		uri[1024];		// Job URI
+
+
+  httpAssembleURIf(HTTP_URI_CODING_ALL, uri, sizeof(uri), "ipp", NULL, "localhost", 0, "/jobs/%d", id);
+
+  request = ippNewRequest(IPP_OP_GET_JOB_ATTRIBUTES);
+
+  ippAddString(request, IPP_TAG_OPERATION, IPP_TAG_URI, "job-uri", NULL, uri);
+  ippAddString(request, IPP_TAG_OPERATION, IPP_TAG_NAME, "requesting-user-name", NULL, agent_user);
+  ippAddStrings(request, IPP_TAG_OPERATION, IPP_TAG_KEYWORD, "requested-attributes", sizeof(agent_jattrs) / sizeof(agent_jattrs[0]), NULL, agent_jattrs);
+
+  response = cupsDoRequest(http, request, "/");
+
+  cupsMutexLock(&agent_mutex);
+
+  if (cupsLastError() == IPP_STATUS_ERROR_NOT_FOUND)
+  {
+    if ((job = find_job(agent_jobs, id)) != NULL)
+      cupsArrayRemove(agent_jobs, job);
+  }
+  else if (cupsLastError() <= IPP_STATUS_OK_CONFLICTING)
+  {
+    add_groups(agent_dests, agent_jobs, response);
+  }
+
+  cupsMutexUnlock(&agent_mutex);
+
+  ippDelete(response);
+}
+
+
+//
+// 'password_cb()' - Get a password for an event or client thread.
+//
+// The first thread to need a password asks for it using the default password
+// callback and the other threads reuse the answer.  A thread that needs a
+// password again (because the shared one was wrong) asks again.
+//
+
+static const char *			// O - Password or `NULL` to give up
+password_cb(const char   *prompt,	// I - Prompt
+            http_t       *http,		// I - HTTP connection
+            const char   *method,	// I - Request method
+            const char   *resource,	// I - Resource path
+            agent_auth_t *auth)		// I - Password state for thread
+{
+  const char	*password;		// Password from the user
+
+
+  cupsMutexLock(&agent_password_mutex);
+
+  if (auth->tries > 0 || !agent_password[0])
+  {
+    // Ask using the default callback, then restore ours...
+    cupsSetPasswordCB(NULL, NULL);
+    password = cupsGetPassword(prompt, http, method, resource);
+    cupsSetPasswordCB((cups_password_cb_t)password_cb, auth);
+
+    cupsCopyString(agent_password, password ? password : "", sizeof(agent_password));
+  }
+
+  cupsCopyString(auth->password, agent_password, sizeof(auth->password));
+  auth->tries ++;
+
+  cupsMutexUnlock(&agent_password_mutex);
+
+  return (auth->password[0] ? auth->password : NULL);
+}
+
+
+//
+// 'process_client()' - Answer IPP requests from a client.
+//
+
+static void *				// O - Thread exit status
+process_client(http_t *client)		// I - Client connection
+{
+  http_state_t	hstate;			// HTTP request state
+  http_status_t	hstatus;		// HTTP status
+  ipp_state_t	istate;			// IPP read/write state
+  char		resource[1024];		// Resource path
+  const char	*type;			// Content type
+  ipp_t		*request,		// IPP request
+		*response;		// IPP response
+  agent_auth_t	auth;			// Password state
+
+
+  // Send requests to the server as the agent's user...
+  memset(&auth, 0, sizeof(auth));
+  cupsSetUser(agent_user);
+  cupsSetPasswordCB((cups_password_cb_t)password_cb, &auth);
+
+  while (httpWait(client, 30000))
+  {
+    // Read the request line and header fields...
+    if ((hstate = httpReadRequest(client, resource, sizeof(resource))) == HTTP_STATE_WAITING)
+      continue;
+    else if (hstate == HTTP_STATE_ERROR || hstate == HTTP_STATE_UNKNOWN_METHOD || hstate == HTTP_STATE_UNKNOWN_VERSION)
+      break;
+
+    while ((hstatus = httpUpdate(client)) == HTTP_STATUS_CONTINUE);
+
+    if (hstatus != HTTP_STATUS_OK)
+      break;
+
+    if (hstate != HTTP_STATE_POST)
+    {
+      respond_http(client, HTTP_STATUS_METHOD_NOT_ALLOWED);
+      break;
+    }
+    else if ((type = httpGetField(client, HTTP_FIELD_CONTENT_TYPE)) == NULL || strcmp(type, "application/ipp"))
+    {
+      respond_http(client, HTTP_STATUS_BAD_REQUEST);
+      break;
+    }
+
+    if (httpGetExpect(client) == HTTP_STATUS_CONTINUE && !httpWriteResponse(client, HTTP_STATUS_CONTINUE))
+      break;
+
+    request = ippNew();
+
+    while ((istate = ippRead(client, request)) != IPP_STATE_DATA)
+    {
+      if (istate == IPP_STATE_ERROR)
+        break;
+    }
+
+    if (istate == IPP_STATE_ERROR)
+    {
+      ippDelete(request);
+      respond_http(client, HTTP_STATUS_BAD_REQUEST);
+      break;
+    }
+
+    response = process_ipp(request);
+
+    httpSetField(client, HTTP_FIELD_CONTENT_TYPE, "application/ipp");
+    httpSetLength(client, ippGetLength(response));
+
+    if (!httpWriteResponse(client, HTTP_STATUS_OK) || ippWrite(client, response) != IPP_STATE_DATA)
+    {
+      ippDelete(response);
+      break;
+    }
+
+    ippDelete(response);
+    httpFlushWrite(client);
+
+    if (!httpGetKeepAlive(client))
+      break;
+  }
+
+  httpClose(client);
+
+  return (NULL);
+}
+
+
+//
+// 'process_ipp()' - Process an IPP request.
+//
+// The request is freed.
+//
+
+static ipp_t *				// O - IPP response
+process_ipp(ipp_t *request)		// I - IPP request
+{
+  ipp_t		*response = NULL;	// IPP response
+  cups_array_t	*ra;			// Requested attributes
+  agent_dest_t	*dest;			// Destination
+  agent_job_t	*job;			// Job
+  ipp_attribute_t *attr;		// Job ID or URI
+  const char	*uri;			// Job URI
+  int		id = 0;			// Job ID
+  bool		all;			// All destinations?
+
+
+  ra = ippCreateRequestedArray(request);
+
+  cupsMutexLock(&agent_mutex);
+
+  switch (ippGetOperation(request))
+  {
+    case IPP_OP_CUPS_GET_CLASSES :
+    case IPP_OP_CUPS_GET_PRINTERS :
+        if (can_answer(request, ra, agent_pattrs, sizeof(agent_pattrs) / sizeof(agent_pattrs[0])))
+          response = ipp_get_printers(request, ra);
+        break;
+
+    case IPP_OP_GET_PRINTER_ATTRIBUTES :
+        if (can_answer(request, ra, agent_pattrs, sizeof(agent_pattrs) / sizeof(agent_pattrs[0])) && (dest = get_dest(request, &all)) != NULL)
+        {
+          response = ippNewResponse(request);
+
+          ippCopyAttributes(response, dest->attrs, /*quickcopy*/false, (ipp_copy_cb_t)filter_attr, ra);
+
+          if (cupsArrayFind(ra, "queued-job-count"))
+            ippAddInteger(response, IPP_TAG_PRINTER, IPP_TAG_INTEGER, "queued-job-count", (int)queued_jobs(dest));
+        }
+        break;
+
+    case IPP_OP_GET_JOBS :
+        if (can_answer(request, ra, agent_jattrs, sizeof(agent_jattrs) / sizeof(agent_jattrs[0])))
+          response = ipp_get_jobs(request, ra);
+        break;
+
+    case IPP_OP_GET_JOB_ATTRIBUTES :
+        if (!can_answer(request, ra, agent_jattrs, sizeof(agent_jattrs) / sizeof(agent_jattrs[0])))
+          break;
+
+        if ((attr = ippFindAttribute(request, "job-id", IPP_TAG_INTEGER)) != NULL)
+          id = ippGetInteger(attr, 0);
+        else if ((uri = ippGetString(ippFindAttribute(request, "job-uri", IPP_TAG_URI), 0, NULL)) != NULL && (uri = strrchr(uri, '/')) != NULL)
+          id = atoi(uri + 1);
+
+        // Completed jobs are not kept, so let the server report those...
+        if ((job = find_job(agent_jobs, id)) != NULL)
+        {
+          response = ippNewResponse(request);
+
+          ippCopyAttributes(response, job->attrs, /*quickcopy*/false, (ipp_copy_cb_t)filter_attr, ra);
+        }
+        break;
+
+    default :
+        break;
+  }
+
+  cupsMutexUnlock(&agent_mutex);
+
+  cupsArrayDelete(ra);
+
+  if (response)
+    ippDelete(request);
+  else
+    response = proxy_ipp(request);
+
+  return (response);
+}
+
+
+//
+// 'proxy_ipp()' - Send an IPP request to the server.
+//
+// The request is freed.
+//
+
+static ipp_t *				// O - IPP response
+proxy_ipp(ipp_t *request)		// I - IPP request
+{
+  http_t	*http;			// Connection to server
+  ipp_t		*error,			// Response if the server cannot be reached
+		*response;		// IPP response
+  int		request_id;		// Client's request ID
+
+
+  request_id = ippGetRequestId(request);
+  error      = ippNewResponse(request);
+
+  ippSetStatusCode(error, IPP_STATUS_ERROR_SERVICE_UNAVAILABLE);
+
+  if ((http = conn_acquire(agent_server, agent_port, agent_encryption)) == NULL)
+  {
+    ippDelete(request);
+    return (error);
+  }
+
+  response = cupsDoRequest(http, request, "/");
+
+  conn_release(http);
+
+  if (!response)
+    return (error);
+
+  ippDelete(error);
+  ippSetRequestId(response, request_id);
+
+  return (response);
+}
+
+
+//
+// 'queued_jobs()' - Count the active jobs for a destination.
+//
+
+static size_t				// O - Number of jobs
+queued_jobs(agent_dest_t *dest)		// I - Destination
+{
+  size_t	count = 0;		// Number of jobs
+  agent_job_t	*job;			// Current job
+
+
+  for (job = (agent_job_t *)cupsArrayGetFirst(agent_jobs); job; job = (agent_job_t *)cupsArrayGetNext(agent_jobs))
+  {
+    if (!strcasecmp(job->dest, dest->name))
+      count ++;
+  }
+
+  return (count);
+}
+
+
+//
+// 'respond_http()' - Send a HTTP error response.
+//
+
+static void
+respond_http(http_t        *client,	// I - Client connection
+             http_status_t hstatus)	// I - HTTP status
+{
+  const char	*data = httpStatusString(hstatus);
+					// Response data
+  size_t	length = strlen(data);	// Length of response data
+
+
+  httpSetField(client, HTTP_FIELD_CONTENT_TYPE, "text/plain");
+  httpSetLength(client, length);
+
+  if (httpWriteResponse(client, hstatus) && httpWrite(client, data, length) >= 0)
+    httpFlushWrite(client);
+}
+
+
+//
+// 'sigterm_handler()' - Stop the agent.
+//
+
+static void
+sigterm_handler(int sig)		// I - Signal number (unused)
+{
+  (void)sig;
+
+  agent_stop = 1;
+}
+
+
+//
+// 'subscribe()' - Subscribe to printer and job events.
+//
+
+static int				// O - Subscription ID or `0` on error
+subscribe(http_t *http)			// I - Connection to server
+{
+  ipp_t		*request,		// IPP request
+		*response;		// IPP response
+  int		id;			// Subscription ID
+
+
+  request = ippNewRequest(IPP_OP_CREATE_PRINTER_SUBSCRIPTIONS);
+
+  ippAddString(request, IPP_TAG_OPERATION, IPP_TAG_URI, "printer-uri", NULL, "ipp://localhost/");
+  ippAddString(request, IPP_TAG_OPERATION, IPP_TAG_NAME, "requesting-user-name", NULL, agent_user);
+  ippAddStrings(request, IPP_TAG_SUBSCRIPTION, IPP_TAG_KEYWORD, "notify-events", sizeof(agent_events) / sizeof(agent_events[0]), NULL, agent_events);
+  ippAddString(request, IPP_TAG_SUBSCRIPTION, IPP_TAG_KEYWORD, "notify-pull-method", NULL, "ippget");
+  ippAddInteger(request, IPP_TAG_SUBSCRIPTION, IPP_TAG_INTEGER, "notify-lease-duration", AGENT_LEASE);
+
+  response = cupsDoRequest(http, request, "/");
+  id       = ippGetInteger(ippFindAttribute(response, "notify-subscription-id", IPP_TAG_INTEGER), 0);
+
+  ippDelete(response);
+
+  return (id);
+}
+
+
+//
+// 'usage()' - Show program usage and exit.
+//
+
+static void
+usage(void)
+{
+  cupsLangPuts(stdout, _("Usage: cups-agent [options]"));
+  cupsLangPuts(stdout, _("Options:"));
+  cupsLangPuts(stdout, _("-E                      Encrypt the connection to the server"));
+  cupsLangPuts(stdout, _("-h server[:port]        Connect to the named server and port"));
+  cupsLangPuts(stdout, _("-U username             Specify the username to use for authentication"));
+
+  exit(1);
+}
+
+
+//
+// 'watch_events()' - Keep the printers and jobs up to date.
+//
+// Events are pulled with Get-Notifications, which the server holds until
+// there is an event or the suggested interval has passed.  Each event only
+// names the printer or job that changed, which is then loaded again.
+//
+
+static void *				// O - Thread exit status
+watch_events(http_t *http)		// I - Connection to server
+{
+  int		sub_id = agent_sub_id,	// Subscription ID
+		seq = 1,		// Next sequence number
+		num_changes,		// Number of changed printers and jobs
+		interval,		// Suggested polling interval
+		i;			// Looping var
+  struct
+  {
+    char	name[256];		// Printer name
+    int		id;			// Job ID or `0` for a printer
+    bool	deleted;		// Printer deleted?
+  }		changes[AGENT_MAX_CHANGES];
+					// Changed printers and jobs
+  ipp_t		*request,		// IPP request
+		*response;		// IPP response
+  ipp_attribute_t *attr;		// Current attribute
+  const char	*aname,			// Attribute name
+		*event = NULL,		// Event name
+		*name = NULL;		// Printer name
+  int		event_seq = 0,		// Event sequence number
+		id = 0;			// Job ID
+  bool		reload;			// Load everything again?
+  time_t	start;			// Start of request
+  agent_dest_t	*dest;			// Deleted printer
+  agent_auth_t	auth;			// Password state
+
+
+  // Send requests to the server as the agent's user...
+  memset(&auth, 0, sizeof(auth));
+  cupsSetUser(agent_user);
+  cupsSetPasswordCB((cups_password_cb_t)password_cb, &auth);
+
+  while (!agent_stop)
+  {
+    if (!sub_id)
+    {
+      // Subscribe before loading so that no changes are missed...
+      sub_id = subscribe(http);
+
+      cupsMutexLock(&agent_mutex);
+      agent_sub_id = sub_id;
+      cupsMutexUnlock(&agent_mutex);
+
+      if (!sub_id || !load_all(http))
+      {
+        sub_id = 0;
+        sleep(AGENT_RETRY);
+        continue;
+      }
+
+      seq = 1;
+    }
+
+    request = ippNewRequest(IPP_OP_GET_NOTIFICATIONS);
+
+    ippAddString(request, IPP_TAG_OPERATION, IPP_TAG_URI, "printer-uri", NULL, "ipp://localhost/");
+    ippAddString(request, IPP_TAG_OPERATION, IPP_TAG_NAME, "requesting-user-name", NULL, agent_user);
+    ippAddInteger(request, IPP_TAG_OPERATION, IPP_TAG_INTEGER, "notify-subscription-ids", sub_id);
+    ippAddInteger(request, IPP_TAG_OPERATION, IPP_TAG_INTEGER, "notify-sequence-numbers", seq);
+    ippAddBoolean(request, IPP_TAG_OPERATION, "notify-wait", true);
+
+    start    = time(NULL);
+    response = cupsDoRequest(http, request, "/");
+
+    if (cupsLastError() > IPP_STATUS_OK_CONFLICTING)
+    {
+      // The subscription or the connection is gone, so send requests to the
+      // server until everything has been loaded again...
+      ippDelete(response);
+
+      cupsMutexLock(&agent_mutex);
+      agent_synced = false;
+      agent_sub_id = 0;
+      cupsMutexUnlock(&agent_mutex);
+
+      if (cupsLastError() != IPP_STATUS_ERROR_NOT_FOUND)
+        sleep(AGENT_RETRY);
+
+      sub_id = 0;
+      continue;
+    }
+
+    // Collect the printers and jobs that changed...
+    num_changes = 0;
+    reload      = false;
+    interval    = ippGetInteger(ippFindAttribute(response, "notify-get-interval", IPP_TAG_INTEGER), 0);
+
+    for (attr = ippGetFirstAttribute(response);; attr = ippGetNextAttribute(response))
+    {
+      if (attr && ippGetGroupTag(attr) == IPP_TAG_EVENT_NOTIFICATION && (aname = ippGetName(attr)) != NULL)
+      {
+        if (!strcmp(aname, "notify-sequence-number"))
+          event_seq = ippGetInteger(attr, 0);
+        else if (!strcmp(aname, "notify-subscribed-event"))
+          event = ippGetString(attr, 0, NULL);
+        else if (!strcmp(aname, "notify-job-id"))
+          id = ippGetInteger(attr, 0);
+        else if (!strcmp(aname, "printer-name"))
+          name = ippGetString(attr, 0, NULL);
+        continue;
+      }
+
+      // End of an event, skipping any we have already seen...
+      if (event && event_seq >= seq)
+      {
+        // Events before this one were lost if there is a gap...
+        if (event_seq > seq || !strcmp(event, "server-restarted"))
+          reload = true;
+
+        seq = event_seq + 1;
+
+        if (!strncmp(event, "job-", 4))
+          name = NULL;
+        else
+          id = 0;
+
+        for (i = 0; i < num_changes; i ++)
+        {
+          if (id ? changes[i].id == id : (!changes[i].id && name && !strcasecmp(changes[i].name, name)))
+            break;
+        }
+
+        if (i == num_changes && (id > 0 || name))
+        {
+          if (num_changes < AGENT_MAX_CHANGES)
+          {
+            changes[i].name[0] = '\0';
+            changes[i].id      = id;
+            changes[i].deleted = false;
+
+            if (name)
+              cupsCopyString(changes[i].name, name, sizeof(changes[i].name));
+
+            num_changes ++;
+          }
+          else
+          {
+            reload = true;
+          }
+        }
+
+        if (i < num_changes && !id)
+          changes[i].deleted = !strcmp(event, "printer-deleted");
+      }
+
+      event     = NULL;
+      name      = NULL;
+      event_seq = 0;
+      id        = 0;
+
+      if (!attr)
+        break;
+    }
+
+    // Apply the changes...
+    if (reload)
+    {
+      if (!load_all(http))
+      {
+        // Start over with a new subscription...
+        cupsMutexLock(&agent_mutex);
+        agent_synced = false;
+        cupsMutexUnlock(&agent_mutex);
+
+        sub_id = 0;
+      }
+    }
+    else
+    {
+      for (i = 0; i < num_changes; i ++)
+      {
+        if (changes[i].id)
+        {
+          load_job(http, changes[i].id);
+        }
+        else if (changes[i].deleted)
+        {
+          cupsMutexLock(&agent_mutex);
+          if ((dest = find_dest(changes[i].name)) != NULL)
+            cupsArrayRemove(agent_dests, dest);
+          cupsMutexUnlock(&agent_mutex);
+        }
+        else
+        {
+          load_dest(http, changes[i].name);
+        }
+      }
+    }
+
+    ippDelete(response);
+
+    // Don't poll too quickly if the server does not hold requests...
+    if (num_changes == 0 && !reload && (time(NULL) - start) < 1)
+      sleep(interval > 0 && interval < AGENT_RETRY ? (unsigned)interval : 1);
+  }
+
+  return (NULL);
+}
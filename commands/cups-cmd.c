@@ -0,0 +1,416 @@
+//
+// Multi-call binary for the CUPS commands.
+//
+// Copyright © 2026 by OpenPrinting.
+//
+// Licensed under Apache License v2.0.  See the file "LICENSE" for more
+// information.
+//
+// Usage:
+//
+//   COMMAND [ARGS...]                  (cups-cmd linked as COMMAND)
+//   cups-cmd COMMAND [ARGS...]
+//   cups-cmd [-e] [-f FILENAME]
+//
+// The first two forms run a single command in this process.  The last form
+// reads commands, one per line, from the named file or the standard input.
+// Each command runs in a child process forked from this one, so the program
+// is only loaded and initialized once.
+//
+
+#include "localize.h"
+#include <fcntl.h>
+#include <sys/wait.h>
+
+
+//
+// Local types...
+//
+
+typedef struct cmd_s			// Command
+{
+  const char	*name;			// Command name
+  int		(*main)(int argc, char *argv[]);
+					// Main entry
+} cmd_t;
+
+
+//
+// Command entry points, compiled with "-Dmain=xxx_main"...
+//
+// cupsaccept, lpadmin, and lpc do not build against libcups3 yet and are left
+// out.
+//
+
+extern int	cancel_main(int argc, char *argv[]);
+extern int	lp_main(int argc, char *argv[]);
+extern int	lpmove_main(int argc, char *argv[]);
+extern int	lpoptions_main(int argc, char *argv[]);
+extern int	lpq_main(int argc, char *argv[]);
+extern int	lpr_main(int argc, char *argv[]);
+extern int	lprm_main(int argc, char *argv[]);
+extern int	lpstat_main(int argc, char *argv[]);
+
+
+//
+// Local globals...
+//
+
+static const cmd_t commands[] =		// Commands, sorted by name
+{
+  { "cancel",		cancel_main },
+  { "lp",		lp_main },
+  { "lpmove",		lpmove_main },
+  { "lpoptions",	lpoptions_main },
+  { "lpq",		lpq_main },
+  { "lpr",		lpr_main },
+  { "lprm",		lprm_main },
+  { "lpstat",		lpstat_main }
+};
+
+
+//
+// Local functions...
+//
+
+static int	compare_commands(const void *a, const void *b);
+static const cmd_t *find_command(const char *name);
+static int	run_batch(cups_file_t *fp, bool is_stdin, bool stop_on_error);
+static int	run_command(int argc, char *argv[], bool null_stdin);
+static int	split_line(char *line, char *argv[], int max_args);
+static void	usage(void) _CUPS_NORETURN;
+
+
+//
+// 'main()' - Main entry.
+//
+
+int					// O - Exit status
+main(int  argc,				// I - Number of command-line arguments
+     char *argv[])			// I - Command-line arguments
+{
+  int		i;			// Looping var
+  const char	*name;			// Program name
+  const cmd_t	*cmd;			// Command
+  const char	*filename = NULL;	// Batch file
+  bool		stop_on_error = false;	// Stop at the first failure?
+  cups_file_t	*fp;			// Batch file
+  int		status;			// Exit status
+
+
+  // Run the command we were linked as, if any...
+  if ((name = strrchr(argv[0], '/')) != NULL)
+    name ++;
+  else
+    name = argv[0];
+
+  if ((cmd = find_command(name)) != NULL)
+    return ((cmd->main)(argc, argv));
+
+  localize_init(argv);
+
+  // Parse the command-line...
+  for (i = 1; i < argc; i ++)
+  {
+    if (!strcmp(argv[i], "--help"))
+    {
+      usage();
+    }
+    else if (!strcmp(argv[i], "-e"))
+    {
+      stop_on_error = true;
+    }
+    else if (!strcmp(argv[i], "-f"))
+    {
+      i ++;
+      if (i >= argc)
+      {
+        cupsLangPrintf(stderr, _("%s: Error - expected filename after \"-f\" option."), "cups-cmd");
+        usage();
+      }
+
+      filename = argv[i];
+    }
+    else if (argv[i][0] == '-')
+    {
+      cupsLangPrintf(stderr, _("%s: Error - unknown option \"%s\"."), "cups-cmd", argv[i]);
+      usage();
+    }
+    else if ((cmd = find_command(argv[i])) != NULL)
+    {
+      // cups-cmd COMMAND [ARGS...]
+      return ((cmd->main)(argc - i, argv + i));
+    }
+    else
+    {
+      cupsLangPrintf(stderr, _("%s: Unknown command \"%s\"."), "cups-cmd", argv[i]);
+      return (1);
+    }
+  }
+
+  // Run commands from a file or the standard input...
+  if (filename)
+  {
+    if ((fp = cupsFileOpen(filename, "r")) == NULL)
+    {
+      cupsLangPrintf(stderr, _("%s: Unable to open \"%s\": %s"), "cups-cmd", filename, strerror(errno));
+      return (1);
+    }
+  }
+  else
+  {
+    fp = cupsFileStdin();
+  }
+
+  status = run_batch(fp, !filename, stop_on_error);
+
+  if (filename)
+    cupsFileClose(fp);
+
+  return (status);
+}
+
+
+//
+// 'compare_commands()' - Compare two commands by name.
+//
+
+static int				// O - Result of comparison
+compare_commands(const void *a,		// I - First command
+                 const void *b)		// I - Second command
+{
+  return (strcmp(((const cmd_t *)a)->name, ((const cmd_t *)b)->name));
+}
+
+
+//
+// 'find_command()' - Find a command by name.
+//
+
+static const cmd_t *			// O - Command or `NULL` if not found
+find_command(const char *name)		// I - Command name
+{
+  cmd_t	key;				// Search key
+
+
+  key.name = name;
+  key.main = NULL;
+
+  return ((const cmd_t *)bsearch(&key, commands, sizeof(commands) / sizeof(commands[0]), sizeof(commands[0]), compare_commands));
+}
+
+
+//
+// 'run_batch()' - Run commands from a file.
+//
+// Blank lines and lines starting with "#" are ignored.  The "exit" and "quit"
+// commands end the batch.  When the commands come from the standard input,
+// each command gets /dev/null as its standard input instead.
+//
+
+static int				// O - Exit status of last command
+run_batch(cups_file_t *fp,		// I - File to read
+          bool        is_stdin,		// I - Reading from the standard input?
+          bool        stop_on_error)	// I - Stop at the first failure?
+{
+  int		status = 0;		// Exit status
+  char		line[8192];		// Line from file
+  int		linenum = 0,		// Line number
+		ac;			// Number of arguments
+  char		*av[256],		// Arguments
+		*ptr;			// Pointer into line
+  size_t	i;			// Looping var
+  bool		interactive = is_stdin && isatty(0);
+					// Show a prompt?
+
+
+  for (;;)
+  {
+    if (interactive)
+    {
+      fputs("cups-cmd> ", stdout);
+      fflush(stdout);
+    }
+
+    if (!cupsFileGets(fp, line, sizeof(line)))
+      break;
+
+    linenum ++;
+
+    for (ptr = line; isspace(*ptr & 255); ptr ++);
+
+    if (!*ptr || *ptr == '#')
+      continue;
+
+    if ((ac = split_line(line, av, (int)(sizeof(av) / sizeof(av[0])))) < 0)
+    {
+      cupsLangPrintf(stderr, _("%s: Syntax error on line %d."), "cups-cmd", linenum);
+      status = 1;
+    }
+    else if (ac == 0)
+    {
+      continue;
+    }
+    else if (!strcmp(av[0], "exit") || !strcmp(av[0], "quit"))
+    {
+      break;
+    }
+    else if (!strcmp(av[0], "help"))
+    {
+      for (i = 0; i < (sizeof(commands) / sizeof(commands[0])); i ++)
+        puts(commands[i].name);
+
+      status = 0;
+    }
+    else
+    {
+      status = run_command(ac, av, is_stdin);
+    }
+
+    if (status && stop_on_error)
+      break;
+  }
+
+  return (status);
+}
+
+
+//
+// 'run_command()' - Run a command in a child process.
+//
+
+static int				// O - Exit status
+run_command(int  argc,			// I - Number of arguments
+            char *argv[],		// I - Arguments
+            bool null_stdin)		// I - Redirect standard input from /dev/null?
+{
+  const cmd_t	*cmd;			// Command
+  pid_t		pid;			// Child process ID
+  int		status,			// Child exit status
+		fd;			// /dev/null
+
+
+  if ((cmd = find_command(argv[0])) == NULL)
+  {
+    cupsLangPrintf(stderr, _("%s: Unknown command \"%s\"."), "cups-cmd", argv[0]);
+    return (1);
+  }
+
+  // Flush any pending output so the child doesn't write it too...
+  fflush(stdout);
+  fflush(stderr);
+
+  if ((pid = fork()) < 0)
+  {
+    cupsLangPrintf(stderr, _("%s: Unable to run \"%s\": %s"), "cups-cmd", argv[0], strerror(errno));
+    return (1);
+  }
+  else if (pid == 0)
+  {
+    // Child runs the command, flushing output via exit()...
+    if (null_stdin && (fd = open("/dev/null", O_RDONLY)) >= 0)
+    {
+      dup2(fd, 0);
+      close(fd);
+    }
+
+    exit((cmd->main)(argc, argv));
+  }
+
+  while (waitpid(pid, &status, 0) < 0)
+  {
+    if (errno != EINTR)
+      return (1);
+  }
+
+  if (WIFEXITED(status))
+    return (WEXITSTATUS(status));
+  else
+    return (128 + WTERMSIG(status));
+}
+
+
+//
+// 'split_line()' - Split a line into arguments.
+//
+// Arguments are separated by whitespace.  Single quotes, double quotes and
+// backslashes work as in the shell.  The line is modified in place.
+//
+
+static int				// O - Number of arguments or -1 on error
+split_line(char *line,			// I - Line
+           char *argv[],		// O - Arguments
+           int  max_args)		// I - Maximum number of arguments
+{
+  int	argc = 0;			// Number of arguments
+  char	*src = line,			// Source pointer
+	*dst,				// Destination pointer
+	quote;				// Current quote or nul
+
+
+  for (;;)
+  {
+    while (isspace(*src & 255))
+      src ++;
+
+    if (!*src)
+      break;
+
+    if (argc >= (max_args - 1))
+      return (-1);
+
+    argv[argc ++] = dst = src;
+    quote         = '\0';
+
+    while (*src && (quote || !isspace(*src & 255)))
+    {
+      if (*src == quote)
+      {
+        quote = '\0';
+        src ++;
+      }
+      else if (!quote && (*src == '\'' || *src == '\"'))
+      {
+        quote = *src++;
+      }
+      else if (*src == '\\' && quote != '\'' && src[1])
+      {
+        src ++;
+        *dst++ = *src++;
+      }
+      else
+      {
+        *dst++ = *src++;
+      }
+    }
+
+    if (quote)
+      return (-1);
+
+    if (*src)
+      src ++;
+
+    *dst = '\0';
+  }
+
+  argv[argc] = NULL;
+
+  return (argc);
+}
+
+
+//
+// 'usage()' - Show program usage and exit.
+//
+
+static void
+usage(void)
+{
+  cupsLangPuts(stdout, _("Usage: cups-cmd command [arguments]\n"
+                          "       cups-cmd [options]"));
+  cupsLangPuts(stdout, _("Options:"));
+  cupsLangPuts(stdout, _("-e                      Stop at the first command that fails"));
+  cupsLangPuts(stdout, _("-f filename             Read commands from the named file"));
+
+  exit(1);
+}
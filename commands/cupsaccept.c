@@ -10,13 +10,47 @@
 // information.
 //
 
-#include "localize.h"
+#include "conn.h"
+#include "pool.h"
+#include <fnmatch.h>
+#include <regex.h>
+
+
+//
+// Local types...
+//
+
+typedef enum accept_match_e		// How to match a destination argument
+{
+  ACCEPT_MATCH_NAME,			// Exact name
+  ACCEPT_MATCH_GLOB,			// Shell wildcard pattern
+  ACCEPT_MATCH_REGEX			// POSIX extended regular expression
+} accept_match_t;
+
+typedef struct accept_dest_s		// Destination argument
+{
+  const char	*name;			// Name or pattern
+  accept_match_t match;			// How to match
+} accept_dest_t;
+
+typedef struct accept_opts_s		// Operation options
+{
+  ipp_op_t	op;			// Operation
+  const char	*reason;		// Reason for reject/disable or `NULL`
+  int		cancel;			// Cancel jobs?
+  size_t	parallel;		// Number of concurrent requests
+  bool		stop_on_error,		// Stop after the first failure?
+		report;			// Report the result for each printer?
+} accept_opts_t;
 
 
 //
 // Local functions...
 //
 
+static int	compare_names(const char *a, const char *b, void *data);
+static bool	do_printers(const char *command, size_t num_dests, accept_dest_t *dests, accept_opts_t *opts);
+static cups_array_t *expand_dests(const char *command, size_t num_dests, accept_dest_t *dests);
 static void	usage(const char *command) _CUPS_NORETURN;
 
 
@@ -30,12 +64,11 @@ main(int  argc,				// I - Number of command-line arguments
 {
   int		i;			// Looping var
   char		*command,		// Command to do
-		*opt,			// Option pointer
-		uri[1024],		// Printer URI
-		*reason;		// Reason for reject/disable
-  ipp_t		*request;		// IPP request
-  ipp_op_t	op;			// Operation
-  int		cancel;			// Cancel jobs?
+		*opt;			// Option pointer
+  accept_opts_t	opts;			// Operation options
+  size_t	num_dests;		// Number of destination arguments
+  accept_dest_t	*dests;			// Destination arguments
+  int		status;			// Exit status
 
 
   localize_init(argv);
@@ -46,23 +79,23 @@ main(int  argc,				// I - Number of command-line arguments
   else
     command = argv[0];
 
-  cancel = 0;
+  memset(&opts, 0, sizeof(opts));
 
   if (!strcmp(command, "cupsaccept"))
   {
-    op = IPP_OP_CUPS_ACCEPT_JOBS;
+    opts.op = IPP_OP_CUPS_ACCEPT_JOBS;
   }
   else if (!strcmp(command, "cupsreject"))
   {
-    op = IPP_OP_CUPS_REJECT_JOBS;
+    opts.op = IPP_OP_CUPS_REJECT_JOBS;
   }
   else if (!strcmp(command, "cupsdisable"))
   {
-    op = IPP_OP_PAUSE_PRINTER;
+    opts.op = IPP_OP_PAUSE_PRINTER;
   }
   else if (!strcmp(command, "cupsenable"))
   {
-    op = IPP_OP_RESUME_PRINTER;
+    opts.op = IPP_OP_RESUME_PRINTER;
   }
   else
   {
@@ -70,7 +103,15 @@ main(int  argc,				// I - Number of command-line arguments
     return (1);
   }
 
-  reason = NULL;
+  opts.parallel = POOL_MAX_CONNECTIONS;
+  num_dests     = 0;
+  status        = 0;
+
+  if ((dests = calloc((size_t)argc, sizeof(accept_dest_t))) == NULL)
+  {
+    cupsLangPrintf(stderr, _("%s: Unable to allocate memory."), command);
+    return (1);
+  }
 
   // Process command-line arguments...
   for (i = 1; i < argc; i ++)
@@ -81,11 +122,47 @@ main(int  argc,				// I - Number of command-line arguments
     }
     else if (!strcmp(argv[i], "--hold"))
     {
-      op = IPP_OP_HOLD_NEW_JOBS;
+      opts.op = IPP_OP_HOLD_NEW_JOBS;
     }
     else if (!strcmp(argv[i], "--release"))
     {
-      op = IPP_OP_RELEASE_HELD_NEW_JOBS;
+      opts.op = IPP_OP_RELEASE_HELD_NEW_JOBS;
+    }
+    else if (!strcmp(argv[i], "--parallel"))
+    {
+      i ++;
+      if (i >= argc || atoi(argv[i]) < 1)
+      {
+	cupsLangPrintf(stderr, _("%s: Error - expected count after \"--parallel\" option."), command);
+	usage(command);
+      }
+
+      opts.parallel = (size_t)atoi(argv[i]);
+    }
+    else if (!strcmp(argv[i], "--keep-going"))
+    {
+      opts.stop_on_error = false;
+    }
+    else if (!strcmp(argv[i], "--stop-on-error"))
+    {
+      opts.stop_on_error = true;
+    }
+    else if (!strcmp(argv[i], "--regex"))
+    {
+      i ++;
+      if (i >= argc)
+      {
+	cupsLangPrintf(stderr, _("%s: Error - expected regular expression after \"--regex\" option."), command);
+	usage(command);
+      }
+
+      dests[num_dests].name  = argv[i];
+      dests[num_dests].match = ACCEPT_MATCH_REGEX;
+      num_dests ++;
+    }
+    else if (!strcmp(argv[i], "--report"))
+    {
+      opts.report = true;
     }
     else if (argv[i][0] == '-')
     {
@@ -117,10 +194,24 @@ main(int  argc,				// I - Number of command-line arguments
 	      break;
 
 	  case 'c' : // Cancel jobs
-	      cancel = 1;
+	      opts.cancel = 1;
 	      break;
 
 	  case 'h' : // Connect to host
+	      if (num_dests > 0)
+	      {
+	        // Finish the printers for the old server...
+	        if (!do_printers(command, num_dests, dests, &opts))
+	        {
+	          status = 1;
+
+	          if (opts.stop_on_error)
+	            goto done;
+	        }
+
+	        num_dests = 0;
+	      }
+
 	      if (opt[1] != '\0')
 	      {
 		cupsSetServer(opt + 1);
@@ -142,7 +233,7 @@ main(int  argc,				// I - Number of command-line arguments
 	  case 'r' : // Reason for cancellation
 	      if (opt[1] != '\0')
 	      {
-		reason = opt + 1;
+		opts.reason = opt + 1;
 		opt += strlen(opt) - 1;
 	      }
 	      else
@@ -154,7 +245,7 @@ main(int  argc,				// I - Number of command-line arguments
 		  usage(command);
 		}
 
-		reason = argv[i];
+		opts.reason = argv[i];
 	      }
 	      break;
 
@@ -166,52 +257,275 @@ main(int  argc,				// I - Number of command-line arguments
     }
     else
     {
-     /*
-      * Accept/disable/enable/reject a destination...
-      */
+      // Accept/disable/enable/reject a destination (or the destinations
+      // matching a pattern) once all of the arguments have been processed...
+      dests[num_dests].name  = argv[i];
+      dests[num_dests].match = strpbrk(argv[i], "*?[") ? ACCEPT_MATCH_GLOB : ACCEPT_MATCH_NAME;
+      num_dests ++;
+    }
+  }
+
+  if (num_dests > 0 && !do_printers(command, num_dests, dests, &opts))
+    status = 1;
+
+  done:
+
+  free(dests);
+
+  return (status);
+}
+
+
+//
+// 'compare_names()' - Compare two destination names.
+//
+
+static int				// O - Result of comparison
+compare_names(const char *a,		// I - First name
+              const char *b,		// I - Second name
+              void       *data)		// I - Callback data (unused)
+{
+  (void)data;
+
+  return (strcasecmp(a, b));
+}
+
+
+//
+// 'do_printers()' - Accept/disable/enable/reject a list of destinations.
+//
+// The destination arguments are expanded and the requests for each printer
+// are sent concurrently using up to "parallel" connections.  When canceling
+// jobs, the Cancel-Jobs request for a printer is sent on the same connection
+// right after its accept/disable/enable/reject request succeeds.  Unless
+// "stop_on_error" is set, every printer is processed even after a failure.
+// Results are reported in the order the destinations were named.
+//
+
+static bool				// O - `true` on success, `false` on error
+do_printers(const char    *command,	// I - Command name
+            size_t        num_dests,	// I - Number of destination arguments
+            accept_dest_t *dests,	// I - Destination arguments
+            accept_opts_t *opts)	// I - Operation options
+{
+  bool		ret;			// Return value
+  size_t	i,			// Looping var
+		count,			// Number of printers
+		sent;			// Number of printers sent
+  cups_array_t	*printers;		// Printers
+  const char	*printer;		// Current printer
+  pool_t	*pool;			// Request pool
+  ipp_t		*steps[2];		// IPP requests for printer
+  size_t	num_steps;		// Number of requests for printer
+  char		uri[1024];		// Printer URI
+
+
+  if ((printers = expand_dests(command, num_dests, dests)) == NULL)
+    return (false);
+
+  if ((pool = pool_new(opts->parallel)) == NULL)
+  {
+    cupsLangPrintf(stderr, _("%s: Unable to allocate memory."), command);
+    cupsArrayDelete(printers);
+    return (false);
+  }
+
+  pool_set_stop_on_error(pool, opts->stop_on_error);
+
+  // Queue the requests for each printer...
+  for (i = 0, count = (size_t)cupsArrayGetCount(printers); i < count; i ++)
+  {
+    printer = (const char *)cupsArrayGetElement(printers, i);
+
+    httpAssembleURIf(HTTP_URI_CODING_ALL, uri, sizeof(uri), "ipp", NULL, "localhost", 0, "/printers/%s", printer);
+
+    steps[0] = ippNewRequest(opts->op);
+
+    ippAddString(steps[0], IPP_TAG_OPERATION, IPP_TAG_URI,  "printer-uri", NULL, uri);
+    ippAddString(steps[0], IPP_TAG_OPERATION, IPP_TAG_NAME, "requesting-user-name", NULL, cupsGetUser());
+    if (opts->reason != NULL)
+      ippAddString(steps[0], IPP_TAG_OPERATION, IPP_TAG_TEXT, "printer-state-message", NULL, opts->reason);
+
+    num_steps = 1;
+
+    // Cancel all jobs if requested...
+    if (opts->cancel)
+    {
+      // Build an Cancel-Jobs request, which requires the following
+      // attributes:
+      //
+      //   attributes-charset
+      //   attributes-natural-language
+      //   printer-uri
+      steps[1] = ippNewRequest(IPP_OP_CANCEL_JOBS);
 
-      request = ippNewRequest(op);
+      ippAddString(steps[1], IPP_TAG_OPERATION, IPP_TAG_URI, "printer-uri", NULL, uri);
+
+      num_steps = 2;
+    }
+
+    pool_add_requests(pool, num_steps, steps, "/admin/");
+  }
+
+  // Do the requests and report the results...
+  ret  = pool_run(pool);
+  sent = pool_get_sent(pool);
+
+  for (i = 0; i < count; i ++)
+  {
+    printer = (const char *)cupsArrayGetElement(printers, i);
+
+    if (i >= sent)
+    {
+      // Not sent because of an earlier failure...
+      if (opts->report)
+        cupsLangPrintf(stdout, "%s\t%s", printer, "skipped");
+      continue;
+    }
 
-      httpAssembleURIf(HTTP_URI_CODING_ALL, uri, sizeof(uri), "ipp", NULL, "localhost", 0, "/printers/%s", argv[i]);
-      ippAddString(request, IPP_TAG_OPERATION, IPP_TAG_URI,  "printer-uri", NULL, uri);
-      ippAddString(request, IPP_TAG_OPERATION, IPP_TAG_NAME, "requesting-user-name", NULL, cupsGetUser());
-      if (reason != NULL)
-	ippAddString(request, IPP_TAG_OPERATION, IPP_TAG_TEXT, "printer-state-message", NULL, reason);
+    if (pool_get_status(pool, i) > IPP_STATUS_OK_CONFLICTING)
+      cupsLangPrintf(stderr, _("%s: Operation failed for \"%s\": %s"), command, printer, pool_get_status_message(pool, i));
+
+    if (opts->report)
+      cupsLangPrintf(stdout, "%s\t%s", printer, ippErrorString(pool_get_status(pool, i)));
+  }
+
+  pool_delete(pool);
+  cupsArrayDelete(printers);
+
+  return (ret);
+}
+
+
+//
+// 'expand_dests()' - Expand destination arguments to a list of printers.
+//
+// Patterns are matched against the names from a single CUPS-Get-Printers
+// request, which is only sent when a pattern is used.  Each printer is listed
+// once, in the order it was first named or matched.
+//
+
+static cups_array_t *			// O - Printer names or `NULL` on error
+expand_dests(const char    *command,	// I - Command name
+             size_t        num_dests,	// I - Number of destination arguments
+             accept_dest_t *dests)	// I - Destination arguments
+{
+  size_t	i,			// Looping var
+		num_res;		// Number of compiled expressions
+  cups_array_t	*printers,		// Printers, in order
+		*seen;			// Printers, sorted for lookups
+  bool		have_patterns = false,	// Any patterns?
+		ret = true;		// Return value
+  regex_t	*res;			// Compiled regular expressions
+  ipp_t		*request,		// IPP request
+		*response = NULL;	// IPP response
+  ipp_attribute_t *attr;		// printer-name attribute
+  const char	*name;			// Printer name
+  int		err;			// Error from regcomp
+  char		message[256];		// Error message
+
+
+  if ((res = calloc(num_dests, sizeof(regex_t))) == NULL)
+  {
+    cupsLangPrintf(stderr, _("%s: Unable to allocate memory."), command);
+    return (NULL);
+  }
+
+  // Compile regular expressions...
+  for (num_res = 0; num_res < num_dests; num_res ++)
+  {
+    if (dests[num_res].match == ACCEPT_MATCH_NAME)
+      continue;
 
-      // Do the request and get back a response...
-      ippDelete(cupsDoRequest(CUPS_HTTP_DEFAULT, request, "/admin/"));
+    have_patterns = true;
 
-      if (cupsLastError() > IPP_STATUS_OK_CONFLICTING)
+    if (dests[num_res].match == ACCEPT_MATCH_REGEX && (err = regcomp(res + num_res, dests[num_res].name, REG_EXTENDED | REG_ICASE | REG_NOSUB)) != 0)
+    {
+      regerror(err, res + num_res, message, sizeof(message));
+      cupsLangPrintf(stderr, _("%s: Bad regular expression \"%s\": %s"), command, dests[num_res].name, message);
+      ret = false;
+      break;
+    }
+  }
+
+  if (ret && have_patterns)
+  {
+    // Build a CUPS-Get-Printers request, which requires the following
+    // attributes:
+    //
+    //   attributes-charset
+    //   attributes-natural-language
+    //   requested-attributes
+    request = ippNewRequest(IPP_OP_CUPS_GET_PRINTERS);
+
+    ippAddString(request, IPP_TAG_OPERATION, IPP_TAG_KEYWORD, "requested-attributes", NULL, "printer-name");
+
+    response = cupsDoRequest(conn_get_default(), request, "/");
+
+    if (cupsLastError() > IPP_STATUS_OK_CONFLICTING)
+    {
+      cupsLangPrintf(stderr, "%s: %s", command, cupsLastErrorString());
+      ret = false;
+    }
+  }
+
+  printers = cupsArrayNew(NULL, NULL, NULL, 0, (cups_acopy_cb_t)strdup, (cups_afree_cb_t)free);
+  seen     = cupsArrayNew((cups_array_cb_t)compare_names, NULL, NULL, 0, NULL, NULL);
+
+  for (i = 0; ret && i < num_dests; i ++)
+  {
+    bool	matched = false;	// Did the pattern match anything?
+
+    if (dests[i].match == ACCEPT_MATCH_NAME)
+    {
+      if (!cupsArrayFind(seen, (void *)dests[i].name))
       {
-	cupsLangPrintf(stderr, _("%s: Operation failed: %s"), command, ippErrorString(cupsLastError()));
-	return (1);
+        cupsArrayAdd(printers, (void *)dests[i].name);
+        cupsArrayAdd(seen, cupsArrayGetElement(printers, (size_t)cupsArrayGetCount(printers) - 1));
       }
+      continue;
+    }
 
-      // Cancel all jobs if requested...
-      if (cancel)
-      {
-        // Build an Cancel-Jobs request, which requires the following
-	// attributes:
-	//
-	//   attributes-charset
-	//   attributes-natural-language
-	//   printer-uri
-	request = ippNewRequest(IPP_OP_CANCEL_JOBS);
+    for (attr = ippFindAttribute(response, "printer-name", IPP_TAG_NAME); attr; attr = ippFindNextAttribute(response, "printer-name", IPP_TAG_NAME))
+    {
+      name = ippGetString(attr, 0, NULL);
 
-	ippAddString(request, IPP_TAG_OPERATION, IPP_TAG_URI, "printer-uri", NULL, uri);
+      if (dests[i].match == ACCEPT_MATCH_GLOB ? fnmatch(dests[i].name, name, FNM_CASEFOLD) : regexec(res + i, name, 0, NULL, 0))
+        continue;
 
-	ippDelete(cupsDoRequest(CUPS_HTTP_DEFAULT, request, "/admin/"));
+      matched = true;
 
-        if (cupsLastError() > IPP_STATUS_OK_CONFLICTING)
-	{
-	  cupsLangPrintf(stderr, "%s: %s", command, cupsLastErrorString());
-	  return (1);
-	}
+      if (!cupsArrayFind(seen, (void *)name))
+      {
+        cupsArrayAdd(printers, (void *)name);
+        cupsArrayAdd(seen, cupsArrayGetElement(printers, (size_t)cupsArrayGetCount(printers) - 1));
       }
     }
+
+    if (!matched)
+    {
+      cupsLangPrintf(stderr, _("%s: No destinations match \"%s\"."), command, dests[i].name);
+      ret = false;
+    }
+  }
+
+  for (i = 0; i < num_res; i ++)
+  {
+    if (dests[i].match == ACCEPT_MATCH_REGEX)
+      regfree(res + i);
+  }
+
+  free(res);
+  ippDelete(response);
+  cupsArrayDelete(seen);
+
+  if (!ret)
+  {
+    cupsArrayDelete(printers);
+    printers = NULL;
   }
 
-  return (0);
+  return (printers);
 }
 
 
@@ -222,12 +536,17 @@ main(int  argc,				// I - Number of command-line arguments
 static void
 usage(const char *command)		// I - Command name
 {
-  cupsLangPrintf(stdout, _("Usage: %s [options] destination(s)"), command);
+  cupsLangPrintf(stdout, _("Usage: %s [options] destination(s)/pattern(s)"), command);
   cupsLangPuts(stdout, _("Options:"));
   cupsLangPuts(stdout, _("-E                      Encrypt the connection to the server"));
   cupsLangPuts(stdout, _("-h server[:port]        Connect to the named server and port"));
   cupsLangPuts(stdout, _("-r reason               Specify a reason message that others can see"));
   cupsLangPuts(stdout, _("-U username             Specify the username to use for authentication"));
+  cupsLangPuts(stdout, _("--keep-going            Keep going after a printer fails (default)"));
+  cupsLangPuts(stdout, _("--parallel count        Send up to count requests at the same time"));
+  cupsLangPuts(stdout, _("--regex expression      Select printers matching a regular expression"));
+  cupsLangPuts(stdout, _("--report                Show the result for each printer"));
+  cupsLangPuts(stdout, _("--stop-on-error         Stop after the first printer that fails"));
   if (!strcmp(command, "cupsdisable"))
     cupsLangPuts(stdout, _("--hold                  Hold new jobs"));
   if (!strcmp(command, "cupsenable"))
@@ -0,0 +1,695 @@
+//
+// Multiple server support for the CUPS commands.
+//
+// Copyright © 2026 by OpenPrinting.
+//
+// Licensed under Apache License v2.0.  See the file "LICENSE" for more
+// information.
+//
+// `fanout_servers` lets a status command query several servers at once.  The
+// servers are named with more than one "-h SERVER" option and/or with
+// "--servers FILE", a file with one server per line.  Each server is queried
+// by a child process that runs the command's own `main` with "-h SERVER"
+// instead of the server options, so every option works the same as with a
+// single server.
+//
+// The output of all children is read at the same time, and a child that has
+// not finished within the time limit ("--timeout SECONDS", default 10) is
+// stopped and reported without holding up the others.  When all children are
+// done, their output is merged:
+//
+// - `FANOUT_MERGE_RECORDS` sorts the records of all servers, where a record is
+//   a line plus any following indented lines, and tags each record with the
+//   server it came from.
+// - `FANOUT_MERGE_SECTIONS` shows the output of each server under its name.
+//
+// Either way servers are shown in name order, and any error messages are
+// written to the standard error, tagged with the server.
+//
+// With a single server the command runs normally and skips the "--servers"
+// and "--timeout" options with `fanout_skip_option`.
+//
+
+#include "fanout.h"
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <sys/wait.h>
+
+
+//
+// Local types...
+//
+
+typedef struct fanout_buffer_s		// Output of a child
+{
+  int		fd;			// Pipe from child or -1 when closed
+  char		*data;			// Output data
+  size_t	used,			// Bytes of output
+		alloc;			// Allocated bytes
+} fanout_buffer_t;
+
+typedef struct fanout_child_s		// Child process for a server
+{
+  const char	*server;		// Server name
+  pid_t		pid;			// Process ID or 0 when done
+  time_t	deadline;		// Time limit
+  bool		timed_out;		// Was the child stopped?
+  int		error,			// Error starting child, if any
+		status;			// Exit status
+  fanout_buffer_t out,			// Standard output
+		err;			// Standard error
+} fanout_child_t;
+
+typedef struct fanout_record_s		// Record in the merged output
+{
+  const char	*server;		// Server name
+  const char	*text;			// Record text
+  size_t	length;			// Length of record
+} fanout_record_t;
+
+
+//
+// Local functions...
+//
+
+static int	fanout_compare_children(fanout_child_t *a, fanout_child_t *b);
+static int	fanout_compare_records(fanout_record_t *a, fanout_record_t *b);
+static void	fanout_finish(fanout_child_t *child, bool timed_out);
+static void	fanout_merge(const char *command, size_t num_children, fanout_child_t *children, fanout_merge_t merge);
+static bool	fanout_read(fanout_buffer_t *buffer);
+static bool	fanout_start(fanout_child_t *child, size_t num_children, fanout_child_t *children, int argc, char *argv[], fanout_main_cb_t main_cb);
+
+
+//
+// 'fanout_requested()' - Determine whether the command-line names several servers.
+//
+
+bool					// O - `true` if `fanout_servers` will run the command, `false` otherwise
+fanout_requested(int  argc,		// I - Number of command-line arguments
+                 char *argv[])		// I - Command-line arguments
+{
+  int		i,			// Looping var
+		num_servers = 0;	// Number of "-h" servers
+
+
+  for (i = 1; i < argc; i ++)
+  {
+    if (!strcmp(argv[i], "--servers") && (i + 1) < argc)
+      return (true);
+    else if (!strcmp(argv[i], "--timeout") && (i + 1) < argc)
+      i ++;
+    else if (!strcmp(argv[i], "-h") && (i + 1) < argc)
+    {
+      i ++;
+      num_servers ++;
+    }
+    else if (!strncmp(argv[i], "-h", 2) && argv[i][2])
+      num_servers ++;
+  }
+
+  return (num_servers > 1);
+}
+
+
+//
+// 'fanout_servers()' - Run a command on several servers at once.
+//
+// Returns `false`, leaving the arguments alone, when fewer than two servers
+// are named on the command-line.  Otherwise the command is run on each server
+// and the merged output is shown.
+//
+
+bool					// O - `true` if the command was run, `false` otherwise
+fanout_servers(
+    int              argc,		// I - Number of command-line arguments
+    char             *argv[],		// I - Command-line arguments
+    fanout_main_cb_t main_cb,		// I - Command entry point
+    fanout_merge_t   merge,		// I - How to merge the output
+    int              *status)		// O - Exit status
+{
+  int		i,			// Looping var
+		cargc = 3,		// Number of arguments for children
+		timeout = FANOUT_TIMEOUT;
+					// Time limit for each server
+  char		**cargv,		// Arguments for children
+		line[1024],		// Line from server list
+		*ptr;			// Pointer into line
+  bool		have_list = false;	// Was a server list given?
+  cups_array_t	*servers;		// Server names
+  const char	*server;		// Current server
+  cups_file_t	*fp;			// Server list
+  size_t	num_children,		// Number of children
+		num_active = 0,		// Number of running children
+		num_fds,		// Number of pipes to poll
+		next = 0,		// Next child to start
+		j;			// Looping var
+  fanout_child_t *children,		// Children
+		*child;			// Current child
+  struct pollfd	*pfds;			// Pipes to poll
+  fanout_buffer_t **pbufs;		// Buffers for pipes
+  time_t	now,			// Current time
+		wait_time;		// Time to wait for output
+
+
+  // Find the servers and copy the other arguments for the children...
+  *status = 0;
+  servers = cupsArrayNew(NULL, NULL, NULL, 0, (cups_acopy_cb_t)strdup, (cups_afree_cb_t)free);
+
+  if ((cargv = calloc((size_t)argc + 3, sizeof(char *))) == NULL)
+  {
+    cupsArrayDelete(servers);
+    return (false);
+  }
+
+  cargv[0] = argv[0];
+  cargv[1] = "-h";
+
+  for (i = 1; i < argc; i ++)
+  {
+    if (!strcmp(argv[i], "--servers") && (i + 1) < argc)
+    {
+      i ++;
+      have_list = true;
+
+      if ((fp = cupsFileOpen(argv[i], "r")) == NULL)
+      {
+        cupsLangPrintf(stderr, _("%s: Unable to open \"%s\": %s"), argv[0], argv[i], strerror(errno));
+        *status = 1;
+        break;
+      }
+
+      while (cupsFileGets(fp, line, sizeof(line)))
+      {
+        // Skip comments and blank lines...
+        if ((ptr = strchr(line, '#')) != NULL)
+          *ptr = '\0';
+
+        for (ptr = line + strlen(line); ptr > line && isspace(ptr[-1] & 255); ptr --);
+        *ptr = '\0';
+
+        for (ptr = line; isspace(*ptr & 255); ptr ++);
+
+        if (*ptr)
+          cupsArrayAdd(servers, ptr);
+      }
+
+      cupsFileClose(fp);
+    }
+    else if (!strcmp(argv[i], "--timeout") && (i + 1) < argc)
+    {
+      if ((timeout = atoi(argv[++ i])) < 1)
+      {
+        cupsLangPrintf(stderr, _("%s: Error - bad timeout \"%s\"."), argv[0], argv[i]);
+        *status = 1;
+        break;
+      }
+    }
+    else if (!strcmp(argv[i], "-h") && (i + 1) < argc)
+    {
+      cupsArrayAdd(servers, argv[++ i]);
+    }
+    else if (!strncmp(argv[i], "-h", 2) && argv[i][2])
+    {
+      cupsArrayAdd(servers, argv[i] + 2);
+    }
+    else
+    {
+      cargv[cargc ++] = argv[i];
+    }
+  }
+
+  if (*status)
+  {
+    free(cargv);
+    cupsArrayDelete(servers);
+    return (true);
+  }
+  else if (cupsArrayGetCount(servers) < 2 && !have_list)
+  {
+    free(cargv);
+    cupsArrayDelete(servers);
+    return (false);
+  }
+  else if ((num_children = cupsArrayGetCount(servers)) == 0)
+  {
+    cupsLangPrintf(stderr, _("%s: Error - no servers in list."), argv[0]);
+    free(cargv);
+    cupsArrayDelete(servers);
+    *status = 1;
+    return (true);
+  }
+
+  children = calloc(num_children, sizeof(fanout_child_t));
+  pfds     = calloc(2 * num_children, sizeof(struct pollfd));
+  pbufs    = calloc(2 * num_children, sizeof(fanout_buffer_t *));
+
+  if (!children || !pfds || !pbufs)
+  {
+    cupsLangPrintf(stderr, _("%s: Unable to allocate memory."), argv[0]);
+    free(children);
+    free(pfds);
+    free(pbufs);
+    free(cargv);
+    cupsArrayDelete(servers);
+    *status = 1;
+    return (true);
+  }
+
+  for (server = (const char *)cupsArrayGetFirst(servers), child = children; server; server = (const char *)cupsArrayGetNext(servers), child ++)
+  {
+    child->server = server;
+    child->out.fd = -1;
+    child->err.fd = -1;
+  }
+
+  // Run the children, reading their output as it arrives...
+  while (next < num_children || num_active > 0)
+  {
+    while (next < num_children && num_active < FANOUT_MAX_ACTIVE)
+    {
+      child = children + next ++;
+
+      if (fanout_start(child, num_children, children, cargc, cargv, main_cb))
+      {
+        child->deadline = time(NULL) + timeout;
+        num_active ++;
+      }
+      else
+      {
+        child->error  = errno;
+        child->status = 1;
+      }
+    }
+
+    // Wait for output until the next deadline...
+    now       = time(NULL);
+    wait_time = timeout;
+
+    for (j = 0, num_fds = 0, child = children; j < num_children; j ++, child ++)
+    {
+      if (!child->pid)
+        continue;
+
+      if (child->deadline <= now)
+      {
+        // Out of time...
+        fanout_finish(child, true);
+        num_active --;
+        continue;
+      }
+      else if ((child->deadline - now) < wait_time)
+      {
+        wait_time = child->deadline - now;
+      }
+
+      if (child->out.fd >= 0)
+      {
+        pfds[num_fds].fd     = child->out.fd;
+        pfds[num_fds].events = POLLIN;
+        pbufs[num_fds ++]    = &child->out;
+      }
+
+      if (child->err.fd >= 0)
+      {
+        pfds[num_fds].fd     = child->err.fd;
+        pfds[num_fds].events = POLLIN;
+        pbufs[num_fds ++]    = &child->err;
+      }
+    }
+
+    if (num_fds > 0 && poll(pfds, (nfds_t)num_fds, (int)wait_time * 1000) > 0)
+    {
+      for (j = 0; j < num_fds; j ++)
+      {
+        if (pfds[j].revents && !fanout_read(pbufs[j]))
+        {
+          close(pbufs[j]->fd);
+          pbufs[j]->fd = -1;
+        }
+      }
+    }
+
+    // Collect children that have closed their output...
+    for (j = 0, child = children; j < num_children; j ++, child ++)
+    {
+      if (child->pid && child->out.fd < 0 && child->err.fd < 0)
+      {
+        fanout_finish(child, false);
+        num_active --;
+      }
+    }
+  }
+
+  // Show the merged output...
+  fanout_merge(argv[0], num_children, children, merge);
+
+  for (j = 0, child = children; j < num_children; j ++, child ++)
+  {
+    if (child->status)
+      *status = 1;
+
+    free(child->out.data);
+    free(child->err.data);
+  }
+
+  free(children);
+  free(pfds);
+  free(pbufs);
+  free(cargv);
+  cupsArrayDelete(servers);
+
+  return (true);
+}
+
+
+//
+// 'fanout_skip_option()' - Skip a multiple server option.
+//
+// Commands call this from their option parsing so that "--servers FILE" and
+// "--timeout SECONDS" are accepted when only one server is used.
+//
+
+bool					// O - `true` if the option was skipped, `false` otherwise
+fanout_skip_option(int  argc,		// I - Number of command-line arguments
+                   char *argv[],	// I - Command-line arguments
+                   int  *i)		// IO - Current argument
+{
+  if ((strcmp(argv[*i], "--servers") && strcmp(argv[*i], "--timeout")) || (*i + 1) >= argc)
+    return (false);
+
+  (*i) ++;
+
+  return (true);
+}
+
+
+//
+// 'fanout_compare_children()' - Compare two children by server name.
+//
+
+static int				// O - Result of comparison
+fanout_compare_children(
+    fanout_child_t *a,			// I - First child
+    fanout_child_t *b)			// I - Second child
+{
+  return (strcasecmp(a->server, b->server));
+}
+
+
+//
+// 'fanout_compare_records()' - Compare two records by text and then by server.
+//
+
+static int				// O - Result of comparison
+fanout_compare_records(
+    fanout_record_t *a,			// I - First record
+    fanout_record_t *b)			// I - Second record
+{
+  int		result;			// Result of comparison
+
+
+  if ((result = memcmp(a->text, b->text, a->length < b->length ? a->length : b->length)) != 0)
+    return (result);
+  else if (a->length != b->length)
+    return (a->length < b->length ? -1 : 1);
+  else
+    return (strcasecmp(a->server, b->server));
+}
+
+
+//
+// 'fanout_finish()' - Collect a child, stopping it if needed.
+//
+
+static void
+fanout_finish(fanout_child_t *child,	// I - Child
+              bool           timed_out)	// I - Out of time?
+{
+  pid_t		pid;			// Process ID from waitpid
+  int		status = 0;		// Wait status
+
+
+  if (timed_out)
+    kill(child->pid, SIGKILL);
+
+  while ((pid = waitpid(child->pid, &status, 0)) < 0 && errno == EINTR);
+
+  if (child->out.fd >= 0)
+    close(child->out.fd);
+  if (child->err.fd >= 0)
+    close(child->err.fd);
+
+  child->out.fd    = -1;
+  child->err.fd    = -1;
+  child->pid       = 0;
+  child->timed_out = timed_out;
+
+  if (timed_out || pid < 0 || !WIFEXITED(status))
+    child->status = 1;
+  else
+    child->status = WEXITSTATUS(status);
+}
+
+
+//
+// 'fanout_merge()' - Show the output of all children.
+//
+
+static void
+fanout_merge(const char     *command,	// I - Command name
+             size_t         num_children,
+					// I - Number of children
+             fanout_child_t *children,	// I - Children
+             fanout_merge_t merge)	// I - How to merge the output
+{
+  size_t	i,			// Looping var
+		num_records = 0,	// Number of records
+		alloc_records = 0;	// Allocated records
+  int		width = 0;		// Width of server names
+  fanout_child_t *child;		// Current child
+  fanout_record_t *records = NULL,	// Records
+		*record;		// Current record
+  const char	*start,			// Start of line
+		*end,			// End of output
+		*eol;			// End of line
+
+
+  qsort(children, num_children, sizeof(fanout_child_t), (int (*)(const void *, const void *))fanout_compare_children);
+
+  for (i = num_children, child = children; i > 0; i --, child ++)
+  {
+    if ((int)strlen(child->server) > width)
+      width = (int)strlen(child->server);
+  }
+
+  if (merge == FANOUT_MERGE_SECTIONS)
+  {
+    for (i = num_children, child = children; i > 0; i --, child ++)
+    {
+      if (!child->out.used)
+        continue;
+
+      printf("%s:\n", child->server);
+      fwrite(child->out.data, 1, child->out.used, stdout);
+
+      if (child->out.data[child->out.used - 1] != '\n')
+        putchar('\n');
+
+      if (i > 1)
+        putchar('\n');
+    }
+  }
+  else
+  {
+    // Split the output into records...
+    for (i = num_children, child = children; i > 0; i --, child ++)
+    {
+      for (start = child->out.data, end = start + child->out.used; start < end; start = eol)
+      {
+        // A record continues with any indented lines...
+        for (eol = start; eol < end;)
+        {
+          if ((eol = memchr(eol, '\n', (size_t)(end - eol))) == NULL)
+            eol = end;
+          else
+            eol ++;
+
+          if (eol >= end || !isspace(*eol & 255) || *eol == '\n')
+            break;
+        }
+
+        // Skip blank lines...
+        if (*start == '\n')
+          continue;
+
+        if (num_records >= alloc_records)
+        {
+          if ((record = realloc(records, (alloc_records + 256) * sizeof(fanout_record_t))) == NULL)
+            break;
+
+          records       = record;
+          alloc_records += 256;
+        }
+
+        record         = records + num_records ++;
+        record->server = child->server;
+        record->text   = start;
+        record->length = (size_t)(eol - start);
+      }
+    }
+
+    qsort(records, num_records, sizeof(fanout_record_t), (int (*)(const void *, const void *))fanout_compare_records);
+
+    for (i = num_records, record = records; i > 0; i --, record ++)
+    {
+      printf("%-*s ", width + 1, record->server);
+      fwrite(record->text, 1, record->length, stdout);
+
+      if (record->text[record->length - 1] != '\n')
+        putchar('\n');
+    }
+
+    free(records);
+  }
+
+  fflush(stdout);
+
+  // Then any errors...
+  for (i = num_children, child = children; i > 0; i --, child ++)
+  {
+    for (start = child->err.data, end = start + child->err.used; start < end; start = eol)
+    {
+      if ((eol = memchr(start, '\n', (size_t)(end - start))) == NULL)
+        eol = end;
+      else
+        eol ++;
+
+      fprintf(stderr, "%s: %.*s", child->server, (int)(eol - start), start);
+
+      if (eol[-1] != '\n')
+        putc('\n', stderr);
+    }
+
+    if (child->timed_out)
+      cupsLangPrintf(stderr, _("%s: %s: Timed out."), command, child->server);
+    else if (child->error)
+      cupsLangPrintf(stderr, _("%s: %s: Unable to start: %s"), command, child->server, strerror(child->error));
+  }
+}
+
+
+//
+// 'fanout_read()' - Read output from a child.
+//
+
+static bool				// O - `true` if more output may follow, `false` at the end
+fanout_read(fanout_buffer_t *buffer)	// I - Buffer
+{
+  ssize_t	bytes;			// Bytes read
+  char		*data;			// New buffer
+
+
+  if ((buffer->alloc - buffer->used) < 4096)
+  {
+    if ((data = realloc(buffer->data, buffer->alloc + 16384)) == NULL)
+      return (false);
+
+    buffer->data  = data;
+    buffer->alloc += 16384;
+  }
+
+  while ((bytes = read(buffer->fd, buffer->data + buffer->used, buffer->alloc - buffer->used)) < 0)
+  {
+    if (errno != EINTR && errno != EAGAIN)
+      return (false);
+    else if (errno == EAGAIN)
+      return (true);
+  }
+
+  buffer->used += (size_t)bytes;
+
+  return (bytes > 0);
+}
+
+
+//
+// 'fanout_start()' - Start a child for a server.
+//
+
+static bool				// O - `true` on success, `false` on error
+fanout_start(fanout_child_t   *child,	// I - Child
+             size_t           num_children,
+					// I - Number of children
+             fanout_child_t   *children,// I - All children
+             int              argc,	// I - Number of arguments
+             char             *argv[],	// I - Arguments
+             fanout_main_cb_t main_cb)	// I - Command entry point
+{
+  int		outpipe[2],		// Pipe for standard output
+		errpipe[2],		// Pipe for standard error
+		fd;			// /dev/null
+  size_t	i;			// Looping var
+
+
+  if (pipe(outpipe))
+    return (false);
+
+  if (pipe(errpipe))
+  {
+    close(outpipe[0]);
+    close(outpipe[1]);
+    return (false);
+  }
+
+  // Don't let the child repeat any buffered output...
+  fflush(stdout);
+  fflush(stderr);
+
+  if ((child->pid = fork()) < 0)
+  {
+    child->pid = 0;
+    close(outpipe[0]);
+    close(outpipe[1]);
+    close(errpipe[0]);
+    close(errpipe[1]);
+    return (false);
+  }
+  else if (child->pid == 0)
+  {
+    // Child: run the command for this server...
+    for (i = 0; i < num_children; i ++)
+    {
+      if (children[i].out.fd >= 0)
+        close(children[i].out.fd);
+      if (children[i].err.fd >= 0)
+        close(children[i].err.fd);
+    }
+
+    if ((fd = open("/dev/null", O_RDONLY)) >= 0)
+    {
+      dup2(fd, 0);
+      close(fd);
+    }
+
+    dup2(outpipe[1], 1);
+    dup2(errpipe[1], 2);
+    close(outpipe[0]);
+    close(outpipe[1]);
+    close(errpipe[0]);
+    close(errpipe[1]);
+
+    argv[2] = (char *)child->server;
+
+    exit((main_cb)(argc, argv));
+  }
+
+  // Parent: read the output of the child...
+  close(outpipe[1]);
+  close(errpipe[1]);
+
+  child->out.fd = outpipe[0];
+  child->err.fd = errpipe[0];
+
+  return (true);
+}
@@ -0,0 +1,46 @@
+//
+// Multiple server definitions for the CUPS commands.
+//
+// Copyright © 2026 by OpenPrinting.
+//
+// Licensed under Apache License v2.0.  See the file "LICENSE" for more
+// information.
+//
+
+#ifndef FANOUT_H
+#  define FANOUT_H
+#  include "localize.h"
+
+
+//
+// Constants...
+//
+
+#  define FANOUT_MAX_ACTIVE	64	// Maximum number of servers at once
+#  define FANOUT_TIMEOUT	10	// Default time limit for each server in seconds
+
+
+//
+// Types...
+//
+
+typedef enum fanout_merge_e		// How to merge the output
+{
+  FANOUT_MERGE_RECORDS,			// Sort records, tagged with the server
+  FANOUT_MERGE_SECTIONS			// One section for each server
+} fanout_merge_t;
+
+typedef int (*fanout_main_cb_t)(int argc, char *argv[]);
+					// Command entry point
+
+
+//
+// Functions...
+//
+
+extern bool		fanout_requested(int argc, char *argv[]);
+extern bool		fanout_servers(int argc, char *argv[], fanout_main_cb_t main_cb, fanout_merge_t merge, int *status);
+extern bool		fanout_skip_option(int argc, char *argv[], int *i);
+
+
+#endif // !FANOUT_H
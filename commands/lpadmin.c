@@ -9,23 +9,116 @@
 // information.
 //
 
-#include "localize.h"
+#include "conn.h"
+#include "pool.h"
+#include <sys/stat.h>
+
+
+//
+// Local constants...
+//
+
+#define LPADMIN_DEFAULT_HASH	256	// Size of PPD default hash table
+#define LPADMIN_NAME_HASH	256	// Size of printer name hash table
+#define LPADMIN_PAGE_SIZE	500	// Number of destinations per export request
+
+
+//
+// Local types...
+//
+
+typedef struct lpadmin_class_s		// Pending class membership changes
+{
+  char		*name;			// Class name
+  cups_array_t	*add,			// Printers to add
+		*remove;		// Printers to remove
+} lpadmin_class_t;
+
+typedef struct lpadmin_default_s	// New PPD default choice
+{
+  char		keyword[PPD_MAX_NAME];	// Option keyword
+  const char	*value;			// New default choice
+} lpadmin_default_t;
+
+typedef enum lpadmin_status_e		// Manifest destination status
+{
+  LPADMIN_STATUS_PENDING,		// Not yet applied
+  LPADMIN_STATUS_QUEUED,		// Request queued
+  LPADMIN_STATUS_DONE,			// Applied or unchanged
+  LPADMIN_STATUS_FAILED			// Failed or skipped
+} lpadmin_status_t;
+
+typedef struct lpadmin_dest_s		// Printer or class
+{
+  char		*name;			// Name
+  cups_ptype_t	type;			// printer-type value
+  size_t	num_options;		// Number of attributes
+  cups_option_t	*options;		// Attributes
+  cups_array_t	*members;		// Member names (classes)
+  lpadmin_status_t status;		// Manifest status
+  size_t	request;		// Request number in pool
+} lpadmin_dest_t;
+
+typedef struct lpadmin_type_s		// Printer type memo entry
+{
+  char		server[256],		// Server name
+		name[128];		// Printer or class name
+  cups_ptype_t	type;			// printer-type value
+  time_t	config_time;		// printer-config-change-time value
+} lpadmin_type_t;
+
+
+//
+// Local globals...
+//
+
+static cups_array_t	*printer_types = NULL;
+					// Printer types, by server and name
+static cups_array_t	*type_cache_checked = NULL;
+					// Servers checked against the cache
+static char		type_cache[1024] = "";
+					// On-disk printer type cache, if any
+static bool		type_cache_changed = false;
+					// Printer types changed since loaded?
 
 
 //
 // Local functions...
 //
 
-static int		add_printer_to_class(http_t *http, char *printer, char *pclass);
+static lpadmin_default_t *add_default(cups_array_t *defaults, ppd_file_t *ppd, const char *keyword, size_t num_options, cups_option_t *options);
+static size_t		add_dests(cups_array_t *dests, ipp_t *response);
+static int		apply_manifest(const char *filename, size_t parallel, bool dry_run);
+static void		check_type_cache(http_t *http);
+static int		compare_classes(lpadmin_class_t *a, lpadmin_class_t *b, void *data);
+static int		compare_defaults(lpadmin_default_t *a, lpadmin_default_t *b, void *data);
+static int		compare_dests(lpadmin_dest_t *a, lpadmin_dest_t *b, void *data);
+static int		compare_names(const char *a, const char *b, void *data);
+static int		compare_types(lpadmin_type_t *a, lpadmin_type_t *b, void *data);
 static int		default_printer(http_t *http, char *printer);
 static int		delete_printer(http_t *http, char *printer);
-static int		delete_printer_from_class(http_t *http, char *printer, char *pclass);
 static int		delete_printer_option(http_t *http, char *printer, char *option);
 static int		enable_printer(http_t *http, char *printer);
+static void		free_class(lpadmin_class_t *cls, void *data);
+static void		free_dest(lpadmin_dest_t *dest, void *data);
+static int		export_manifest(http_t *http, const char *filename);
+static void		forget_printer_type(const char *printer);
+static cups_array_t	*get_current_dests(pool_t *pool, cups_array_t *desired);
 static cups_ptype_t	get_printer_type(http_t *http, char *printer, char *uri, size_t urisize);
+static size_t		hash_default(lpadmin_default_t *def, void *data);
+static size_t		hash_name(const char *name, void *data);
+static ipp_t		*new_apply_request(lpadmin_dest_t *dest, lpadmin_dest_t *cur);
+static void		load_type_cache(void);
+static cups_array_t	*new_names(void);
+static int		queue_class_change(cups_array_t **classes, const char *pclass, const char *printers, bool add);
+static cups_array_t	*read_manifest(const char *filename, char **defname);
+static void		save_type_cache(void);
 static int		set_printer_options(http_t *http, char *printer, size_t num_options, cups_option_t *options, char *file, int enable);
+static int		update_classes(http_t *http, cups_array_t **classes);
 static void		usage(void) _CUPS_NORETURN;
 static int		validate_name(const char *name);
+static void		write_manifest_line(cups_file_t *fp, const char *directive, const char *value);
+static http_status_t	write_ppd_line(http_t *http, const char *format, ...) _CUPS_FORMAT(2,3);
 
 
 //
@@ -43,12 +136,18 @@ main(int  argc,				// I - Number of command-line arguments
 		*opt,			// Option pointer
 		*val;			// Pointer to allow/deny value
   int		enable = 0;		// Enable/resume printer?
+  cups_array_t	*classes = NULL;	// Pending class membership changes
   size_t	num_options;		// Number of options
   cups_option_t	*options;		// Options
   char		*file,			// New PPD file
 		evefile[1024] = "";	// IPP Everywhere PPD
   const char	*ppd_name,		// ppd-name value
-		*device_uri;		// device-uri value
+		*device_uri,		// device-uri value
+		*manifest = NULL,	// Manifest to apply
+		*snapshot = NULL;	// Manifest to export
+  size_t	parallel = POOL_MAX_CONNECTIONS;
+					// Number of concurrent requests
+  bool		dry_run = false;	// Show manifest changes only?
 
 
   localize_init(argv);
@@ -62,7 +161,53 @@ main(int  argc,				// I - Number of command-line arguments
   for (i = 1; i < argc; i ++)
   {
     if (!strcmp(argv[i], "--help"))
+    {
       usage();
+    }
+    else if (!strcmp(argv[i], "--apply") || !strcmp(argv[i], "--import"))
+    {
+      i ++;
+
+      if (i >= argc)
+      {
+	cupsLangPrintf(stderr, _("lpadmin: Expected manifest after \"%s\" option."), argv[i - 1]);
+	usage();
+      }
+
+      manifest = argv[i];
+    }
+    else if (!strcmp(argv[i], "--export"))
+    {
+      i ++;
+
+      if (i >= argc)
+      {
+	cupsLangPuts(stderr, _("lpadmin: Expected filename after \"--export\" option."));
+	usage();
+      }
+
+      snapshot = argv[i];
+    }
+    else if (!strcmp(argv[i], "--dry-run"))
+    {
+      dry_run = true;
+    }
+    else if (!strcmp(argv[i], "--parallel"))
+    {
+      i ++;
+
+      if (i >= argc || atoi(argv[i]) < 1)
+      {
+	cupsLangPuts(stderr, _("lpadmin: Expected count after \"--parallel\" option."));
+	usage();
+      }
+
+      parallel = (size_t)atoi(argv[i]);
+    }
+    else if (!strcmp(argv[i], "--type-cache"))
+    {
+      load_type_cache();
+    }
     else if (argv[i][0] == '-')
     {
       for (opt = argv[i] + 1; *opt; opt ++)
@@ -72,9 +217,7 @@ main(int  argc,				// I - Number of command-line arguments
 	  case 'c' : // Add printer to class
 	      if (!http)
 	      {
-		http = httpConnect(cupsGetServer(), ippGetPort(), /*addrlist*/NULL, AF_UNSPEC, cupsGetEncryption(), /*blocking*/true, /*msec*/30000, /*cancel*/NULL);
-
-		if (http == NULL)
+		if ((http = conn_get_default()) == NULL)
 		{
 		  cupsLangPrintf(stderr, _("lpadmin: Unable to connect to server: %s"), strerror(errno));
 		  return (1);
@@ -115,16 +258,14 @@ main(int  argc,				// I - Number of command-line arguments
 		return (1);
 	      }
 
-	      if (add_printer_to_class(http, printer, pclass))
+	      if (queue_class_change(&classes, pclass, printer, true))
 		return (1);
 	      break;
 
 	  case 'd' : // Set as default destination
 	      if (!http)
 	      {
-		http = httpConnect(cupsGetServer(), ippGetPort(), /*addrlist*/NULL, AF_UNSPEC, cupsGetEncryption(), /*blocking*/true, /*msec*/30000, /*cancel*/NULL);
-
-		if (http == NULL)
+		if ((http = conn_get_default()) == NULL)
 		{
 		  cupsLangPrintf(stderr, _("lpadmin: Unable to connect to server: %s"), strerror(errno));
 		  return (1);
@@ -162,11 +303,10 @@ main(int  argc,				// I - Number of command-line arguments
 	      break;
 
 	  case 'h' : // Connect to host
-	      if (http)
-	      {
-		httpClose(http);
-		http = NULL;
-	      }
+	      if (classes && update_classes(http, &classes))
+		return (1);
+
+	      http = NULL;
 
 	      if (opt[1] != '\0')
 	      {
@@ -243,9 +383,7 @@ main(int  argc,				// I - Number of command-line arguments
 
 	      if (!http)
 	      {
-		http = httpConnect(cupsGetServer(), ippGetPort(), /*addrlist*/NULL, AF_UNSPEC, cupsGetEncryption(), /*blocking*/true, /*msec*/30000, /*cancel*/NULL);
-
-		if (http == NULL)
+		if ((http = conn_get_default()) == NULL)
 		{
 		  cupsLangPrintf(stderr,
 				  _("lpadmin: Unable to connect to server: %s"),
@@ -326,9 +464,7 @@ main(int  argc,				// I - Number of command-line arguments
 	  case 'r' : // Remove printer from class
 	      if (!http)
 	      {
-		http = httpConnect(cupsGetServer(), ippGetPort(), /*addrlist*/NULL, AF_UNSPEC, cupsGetEncryption(), /*blocking*/true, /*msec*/30000, /*cancel*/NULL);
-
-		if (http == NULL)
+		if ((http = conn_get_default()) == NULL)
 		{
 		  cupsLangPrintf(stderr,
 				  _("lpadmin: Unable to connect to server: %s"),
@@ -369,16 +505,14 @@ main(int  argc,				// I - Number of command-line arguments
 		return (1);
 	      }
 
-	      if (delete_printer_from_class(http, printer, pclass))
+	      if (queue_class_change(&classes, pclass, printer, false))
 		return (1);
 	      break;
 
 	  case 'R' : // Remove option
 	      if (!http)
 	      {
-		http = httpConnect(cupsGetServer(), ippGetPort(), /*addrlist*/NULL, AF_UNSPEC, cupsGetEncryption(), /*blocking*/true, /*msec*/30000, /*cancel*/NULL);
-
-		if (http == NULL)
+		if ((http = conn_get_default()) == NULL)
 		{
 		  cupsLangPrintf(stderr, _("lpadmin: Unable to connect to server: %s"), strerror(errno));
 		  return (1);
@@ -411,6 +545,12 @@ main(int  argc,				// I - Number of command-line arguments
 		val = argv[i];
 	      }
 
+	      if (strchr(printer, ','))
+	      {
+		cupsLangPuts(stderr, _("lpadmin: A list of printers can only be used with the \"-c\" and \"-r\" options."));
+		return (1);
+	      }
+
 	      if (delete_printer_option(http, printer, val))
 		return (1);
 	      break;
@@ -487,9 +627,7 @@ main(int  argc,				// I - Number of command-line arguments
 	  case 'x' : // Delete a printer
 	      if (!http)
 	      {
-		http = httpConnect(cupsGetServer(), ippGetPort(), /*addrlist*/NULL, AF_UNSPEC, cupsGetEncryption(), /*blocking*/true, /*msec*/30000, /*cancel*/NULL);
-
-		if (http == NULL)
+		if ((http = conn_get_default()) == NULL)
 		{
 		  cupsLangPrintf(stderr,
 				  _("lpadmin: Unable to connect to server: %s"),
@@ -522,6 +660,9 @@ main(int  argc,				// I - Number of command-line arguments
 		return (1);
 	      }
 
+	      if (classes && update_classes(http, &classes))
+		return (1);
+
 	      if (delete_printer(http, printer))
 		return (1);
 
@@ -593,6 +734,23 @@ main(int  argc,				// I - Number of command-line arguments
     }
   }
 
+  if (snapshot)
+  {
+    // Export the current configuration...
+    if (!http && (http = conn_get_default()) == NULL)
+    {
+      cupsLangPrintf(stderr, _("lpadmin: Unable to connect to server: %s"), strerror(errno));
+      return (1);
+    }
+
+    return (export_manifest(http, snapshot));
+  }
+  else if (manifest)
+  {
+    // Apply the manifest using the request pool...
+    return (apply_manifest(manifest, parallel, dry_run));
+  }
+
  /*
   * Set options as needed...
   */
@@ -620,6 +778,12 @@ main(int  argc,				// I - Number of command-line arguments
     cupsLangPuts(stderr, _("lpadmin: Printer drivers are deprecated and will stop working in a future version of CUPS."));
   }
 
+  if ((num_options || file || enable) && printer && strchr(printer, ','))
+  {
+    cupsLangPuts(stderr, _("lpadmin: A list of printers can only be used with the \"-c\" and \"-r\" options."));
+    return (1);
+  }
+
   if (num_options || file)
   {
     if (printer == NULL)
@@ -632,9 +796,7 @@ main(int  argc,				// I - Number of command-line arguments
 
     if (!http)
     {
-      http = httpConnect(cupsGetServer(), ippGetPort(), /*addrlist*/NULL, AF_UNSPEC, cupsGetEncryption(), /*blocking*/true, /*msec*/30000, /*cancel*/NULL);
-
-      if (http == NULL)
+      if ((http = conn_get_default()) == NULL)
       {
         cupsLangPrintf(stderr, _("lpadmin: Unable to connect to server: %s"),
                         strerror(errno));
@@ -648,259 +810,584 @@ main(int  argc,				// I - Number of command-line arguments
   else if (enable && enable_printer(http, printer))
     return (1);
 
+  if (classes && update_classes(http, &classes))
+    return (1);
+
   if (evefile[0])
     unlink(evefile);
 
   if (printer == NULL)
     usage();
 
-  if (http)
-    httpClose(http);
-
   return (0);
 }
 
 
 //
-// 'add_printer_to_class()' - Add a printer to a class.
+// 'add_default()' - Add the new default choice for a PPD keyword.
+//
+// The page size keywords all use the marked PageSize or PageRegion choice.
+// Custom choices use the value from the options, if any.
 //
 
-static int				// O - 0 on success, 1 on fail
-add_printer_to_class(http_t *http,	// I - Server connection
-                     char   *printer,	// I - Printer to add
-		     char   *pclass)	// I - Class to add to
+static lpadmin_default_t *		// O - New default or `NULL` if none
+add_default(cups_array_t  *defaults,	// I - New default choices
+            ppd_file_t    *ppd,		// I - PPD file
+            const char    *keyword,	// I - Option keyword
+            size_t        num_options,	// I - Number of options
+            cups_option_t *options)	// I - Options
 {
-  int		i;			// Looping var
-  ipp_t		*request,		// IPP Request
-		*response;		// IPP Response
-  ipp_attribute_t *attr,		// Current attribute
-		*members;		// Members in class
-  char		uri[HTTP_MAX_URI];	// URI for printer/class
+  ppd_choice_t		*choice;	// Marked choice
+  const char		*value;		// New default choice
+  lpadmin_default_t	*def;		// New default
 
 
- /*
-  * Build an IPP_OP_GET_PRINTER_ATTRIBUTES request, which requires the following
-  * attributes:
-  *
-  *    attributes-charset
-  *    attributes-natural-language
-  *    printer-uri
-  *    requesting-user-name
-  */
+  if (!strcmp(keyword, "PageRegion") || !strcmp(keyword, "PageSize") || !strcmp(keyword, "PaperDimension") || !strcmp(keyword, "ImageableArea"))
+  {
+    if ((choice = ppdFindMarkedChoice(ppd, "PageSize")) == NULL)
+      choice = ppdFindMarkedChoice(ppd, "PageRegion");
+  }
+  else
+  {
+    choice = ppdFindMarkedChoice(ppd, keyword);
+  }
 
-  request = ippNewRequest(IPP_OP_GET_PRINTER_ATTRIBUTES);
+  if (!choice)
+    return (NULL);
+  else if (strcmp(choice->choice, "Custom"))
+    value = choice->choice;
+  else if ((value = cupsGetOption(keyword, num_options, options)) == NULL)
+    return (NULL);
 
-  httpAssembleURIf(HTTP_URI_CODING_ALL, uri, sizeof(uri), "ipp", NULL,
-                   "localhost", 0, "/classes/%s", pclass);
-  ippAddString(request, IPP_TAG_OPERATION, IPP_TAG_URI,
-               "printer-uri", NULL, uri);
-  ippAddString(request, IPP_TAG_OPERATION, IPP_TAG_NAME, "requesting-user-name",
-               NULL, cupsGetUser());
+  if ((def = (lpadmin_default_t *)calloc(1, sizeof(lpadmin_default_t))) == NULL)
+    return (NULL);
 
- /*
-  * Do the request and get back a response...
-  */
+  cupsCopyString(def->keyword, keyword, sizeof(def->keyword));
+  def->value = value;
 
-  response = cupsDoRequest(http, request, "/");
+  cupsArrayAdd(defaults, def);
 
- /*
-  * Build a CUPS-Add-Modify-Class request, which requires the following
-  * attributes:
-  *
-  *    attributes-charset
-  *    attributes-natural-language
-  *    printer-uri
-  *    requesting-user-name
-  *    member-uris
-  */
+  return (def);
+}
 
-  request = ippNewRequest(IPP_OP_CUPS_ADD_MODIFY_CLASS);
 
-  ippAddString(request, IPP_TAG_OPERATION, IPP_TAG_URI,
-               "printer-uri", NULL, uri);
-  ippAddString(request, IPP_TAG_OPERATION, IPP_TAG_NAME, "requesting-user-name",
-               NULL, cupsGetUser());
+//
+// 'add_dests()' - Add the printers and classes from a response.
+//
+// Destinations that are already in the array are skipped.
+//
 
- /*
-  * See if the printer is already in the class...
-  */
+static size_t				// O - Number of destinations in response
+add_dests(cups_array_t *dests,		// I - Destinations
+          ipp_t        *response)	// I - IPP response
+{
+  size_t	count = 0;		// Number of destinations in response
+  lpadmin_dest_t *dest = NULL;		// Current destination
+  ipp_attribute_t *attr;		// Current attribute
+  const char	*name;			// Attribute name
+  char		value[2048];		// Attribute value
 
-  if (response != NULL &&
-      (members = ippFindAttribute(response, "member-names",
-                                  IPP_TAG_NAME)) != NULL)
-    for (i = 0; i < members->num_values; i ++)
-      if (strcasecmp(printer, members->values[i].string.text) == 0)
-      {
-        cupsLangPrintf(stderr,
-	                _("lpadmin: Printer %s is already a member of class "
-			  "%s."), printer, pclass);
-        ippDelete(request);
-	ippDelete(response);
-	return (0);
-      }
 
- /*
-  * OK, the printer isn't part of the class, so add it...
-  */
+  for (attr = ippGetFirstAttribute(response);; attr = ippGetNextAttribute(response))
+  {
+    if (!attr || !ippGetName(attr))
+    {
+      // End of a printer/class group...
+      if (dest && dest->name)
+        count ++;
 
-  httpAssembleURIf(HTTP_URI_CODING_ALL, uri, sizeof(uri), "ipp", NULL,
-                   "localhost", 0, "/printers/%s", printer);
+      if (dest && dest->name && !cupsArrayFind(dests, dest))
+        cupsArrayAdd(dests, dest);
+      else if (dest)
+        free_dest(dest, NULL);
 
-  if (response != NULL &&
-      (members = ippFindAttribute(response, "member-uris",
-                                  IPP_TAG_URI)) != NULL)
-  {
-   /*
-    * Add the printer to the existing list...
-    */
+      dest = NULL;
 
-    attr = ippAddStrings(request, IPP_TAG_PRINTER, IPP_TAG_URI,
-                         "member-uris", members->num_values + 1, NULL, NULL);
-    for (i = 0; i < members->num_values; i ++)
-      attr->values[i].string.text =
-          _cupsStrAlloc(members->values[i].string.text);
+      if (!attr)
+        break;
+      else
+        continue;
+    }
 
-    attr->values[i].string.text = _cupsStrAlloc(uri);
-  }
-  else
-    ippAddString(request, IPP_TAG_PRINTER, IPP_TAG_URI, "member-uris", NULL,
-                 uri);
+    if (ippGetGroupTag(attr) != IPP_TAG_PRINTER)
+      continue;
 
- /*
-  * Then send the request...
-  */
+    if (!dest && (dest = (lpadmin_dest_t *)calloc(1, sizeof(lpadmin_dest_t))) == NULL)
+      break;
 
-  ippDelete(response);
+    name = ippGetName(attr);
 
-  ippDelete(cupsDoRequest(http, request, "/admin/"));
-  if (cupsLastError() > IPP_STATUS_OK_CONFLICTING)
-  {
-    cupsLangPrintf(stderr, _("%s: %s"), "lpadmin", cupsLastErrorString());
+    if (!strcmp(name, "printer-name"))
+    {
+      free(dest->name);
+      dest->name = strdup(ippGetString(attr, 0, NULL));
+    }
+    else if (!strcmp(name, "printer-type"))
+    {
+      dest->type = (cups_ptype_t)ippGetInteger(attr, 0);
+    }
+    else if (!strcmp(name, "member-names"))
+    {
+      size_t	i;			// Looping var
 
-    return (1);
+      cupsArrayDelete(dest->members);
+      dest->members = new_names();
+
+      for (i = 0; i < ippGetCount(attr); i ++)
+        cupsArrayAdd(dest->members, (void *)ippGetString(attr, i, NULL));
+    }
+    else
+    {
+      ippAttributeString(attr, value, sizeof(value));
+      dest->num_options = cupsAddOption(name, value, dest->num_options, &dest->options);
+    }
   }
-  else
-    return (0);
+
+  return (count);
 }
 
 
 //
-// 'default_printer()' - Set the default printing destination.
+// 'apply_manifest()' - Apply a printer and class manifest.
+//
+// The current printers and classes are loaded with one CUPS-Get-Printers and
+// one CUPS-Get-Classes request, and only the attributes that differ from the
+// manifest are sent.  Changes are sent concurrently in rounds - a class is
+// only changed once all of its members from the manifest have been applied.
 //
 
 static int				// O - 0 on success, 1 on fail
-default_printer(http_t *http,		// I - Server connection
-                char   *printer)	// I - Printer name
+apply_manifest(const char *filename,	// I - Manifest file
+               size_t     parallel,	// I - Number of concurrent requests
+               bool       dry_run)	// I - Show the changes without applying them?
 {
-  ipp_t		*request;		// IPP Request
+  int		ret = 0;		// Return value
+  cups_array_t	*desired,		// Destinations from manifest
+		*current = NULL;	// Current destinations
+  char		*defname = NULL;	// Default destination from manifest
+  lpadmin_dest_t *dest,			// Current destination
+		*cur,			// Current state of destination
+		*member;		// Member destination
+  const char	*name;			// Member name
+  pool_t	*pool;			// Request pool
+  size_t	i,			// Looping var
+		num_desired,		// Number of destinations in manifest
+		queued,			// Number of requests in this round
+		changed,		// Number of destinations changed in this round
+		pending;		// Number of destinations not yet applied
+  ipp_t		*request;		// IPP request
   char		uri[HTTP_MAX_URI];	// URI for printer/class
 
 
- /*
-  * Build a CUPS-Set-Default request, which requires the following
-  * attributes:
-  *
-  *    attributes-charset
-  *    attributes-natural-language
-  *    printer-uri
-  *    requesting-user-name
-  */
-
-  httpAssembleURIf(HTTP_URI_CODING_ALL, uri, sizeof(uri), "ipp", NULL,
-                   "localhost", 0, "/printers/%s", printer);
-
-  request = ippNewRequest(IPP_OP_CUPS_SET_DEFAULT);
+  if ((desired = read_manifest(filename, &defname)) == NULL)
+    return (1);
 
-  ippAddString(request, IPP_TAG_OPERATION, IPP_TAG_URI,
-               "printer-uri", NULL, uri);
-  ippAddString(request, IPP_TAG_OPERATION, IPP_TAG_NAME, "requesting-user-name",
-               NULL, cupsGetUser());
+  if ((pool = pool_new(parallel)) == NULL)
+  {
+    cupsLangPuts(stderr, _("lpadmin: Unable to allocate memory."));
+    ret = 1;
+    goto done;
+  }
 
- /*
-  * Do the request and get back a response...
-  */
+  if ((current = get_current_dests(pool, desired)) == NULL)
+  {
+    ret = 1;
+    goto done;
+  }
 
-  ippDelete(cupsDoRequest(http, request, "/admin/"));
+  num_desired = (size_t)cupsArrayGetCount(desired);
 
-  if (cupsLastError() > IPP_STATUS_OK_CONFLICTING)
+  do
   {
-    cupsLangPrintf(stderr, _("%s: %s"), "lpadmin", cupsLastErrorString());
+    // Queue the changes for every destination whose members are ready.  The
+    // manifest is walked by index since looking up members changes the
+    // array's current element...
+    for (i = 0, queued = 0, changed = 0, pending = 0; i < num_desired; i ++)
+    {
+      dest = (lpadmin_dest_t *)cupsArrayGetElement(desired, i);
 
-    return (1);
-  }
-  else
-    return (0);
-}
+      if (dest->status != LPADMIN_STATUS_PENDING)
+        continue;
 
+      for (name = (const char *)cupsArrayGetFirst(dest->members); name; name = (const char *)cupsArrayGetNext(dest->members))
+      {
+        lpadmin_dest_t	key;		// Search key
 
-//
-// 'delete_printer()' - Delete a printer from the system...
-//
+        key.name = (char *)name;
 
-static int				// O - 0 on success, 1 on fail
-delete_printer(http_t *http,		// I - Server connection
-               char   *printer)		// I - Printer to delete
-{
-  ipp_t		*request;		// IPP Request
-  char		uri[HTTP_MAX_URI];	// URI for printer/class
+        if ((member = (lpadmin_dest_t *)cupsArrayFind(desired, &key)) == NULL || member->status == LPADMIN_STATUS_DONE)
+          continue;
 
+        if (member->status == LPADMIN_STATUS_FAILED)
+        {
+	  cupsLangPrintf(stderr, _("lpadmin: Skipping class %s since member %s failed."), dest->name, member->name);
+	  dest->status = LPADMIN_STATUS_FAILED;
+	  ret          = 1;
+	  changed ++;
+	}
+        break;
+      }
 
- /*
-  * Build a CUPS-Delete-Printer request, which requires the following
-  * attributes:
-  *
-  *    attributes-charset
-  *    attributes-natural-language
-  *    printer-uri
-  *    requesting-user-name
-  */
+      if (name)
+      {
+        if (dest->status == LPADMIN_STATUS_PENDING)
+          pending ++;
+        continue;
+      }
 
-  request = ippNewRequest(IPP_OP_CUPS_DELETE_PRINTER);
+      cur = (lpadmin_dest_t *)cupsArrayFind(current, dest);
 
-  httpAssembleURIf(HTTP_URI_CODING_ALL, uri, sizeof(uri), "ipp", NULL,
-                   "localhost", 0, "/printers/%s", printer);
-  ippAddString(request, IPP_TAG_OPERATION, IPP_TAG_URI,
-               "printer-uri", NULL, uri);
-  ippAddString(request, IPP_TAG_OPERATION, IPP_TAG_NAME, "requesting-user-name",
-               NULL, cupsGetUser());
+      changed ++;
 
- /*
-  * Do the request and get back a response...
-  */
+      if (cur && (cur->type & CUPS_PRINTER_CLASS) != (dest->type & CUPS_PRINTER_CLASS))
+      {
+        if (dest->type & CUPS_PRINTER_CLASS)
+	  cupsLangPrintf(stderr, _("lpadmin: %s is a printer, not a class."), dest->name);
+	else
+	  cupsLangPrintf(stderr, _("lpadmin: %s is a class, not a printer."), dest->name);
 
-  ippDelete(cupsDoRequest(http, request, "/admin/"));
+        dest->status = LPADMIN_STATUS_FAILED;
+        ret          = 1;
+      }
+      else if ((request = new_apply_request(dest, cur)) == NULL)
+      {
+        // Nothing to change...
+        dest->status = LPADMIN_STATUS_DONE;
+      }
+      else if (dry_run)
+      {
+        char		value[2048];	// Attribute value
+        ipp_attribute_t	*attr;		// Current attribute
 
-  if (cupsLastError() > IPP_STATUS_OK_CONFLICTING)
-  {
-    cupsLangPrintf(stderr, _("%s: %s"), "lpadmin", cupsLastErrorString());
+        cupsLangPrintf(stdout, cur ? _("Modify %s:") : _("Add %s:"), dest->name);
 
-    return (1);
-  }
-  else
-    return (0);
-}
+        for (attr = ippGetFirstAttribute(request); attr; attr = ippGetNextAttribute(request))
+        {
+          if (ippGetGroupTag(attr) != IPP_TAG_PRINTER)
+            continue;
 
+          ippAttributeString(attr, value, sizeof(value));
+          cupsLangPrintf(stdout, "    %s=%s", ippGetName(attr), value);
+        }
 
-//
-// 'delete_printer_from_class()' - Delete a printer from a class.
-//
+        ippDelete(request);
+        dest->status = LPADMIN_STATUS_DONE;
+      }
+      else
+      {
+        dest->request = pool_add_request(pool, request, "/admin/");
+        dest->status  = LPADMIN_STATUS_QUEUED;
+        queued ++;
+      }
+    }
+
+    if (queued > 0)
+    {
+      // Send the changes for this round...
+      pool_run(pool);
+
+      for (dest = (lpadmin_dest_t *)cupsArrayGetFirst(desired); dest; dest = (lpadmin_dest_t *)cupsArrayGetNext(desired))
+      {
+        if (dest->status != LPADMIN_STATUS_QUEUED)
+          continue;
+
+        if (pool_get_status(pool, dest->request) > IPP_STATUS_OK_CONFLICTING)
+        {
+	  cupsLangPrintf(stderr, "lpadmin: %s: %s", dest->name, pool_get_status_message(pool, dest->request));
+	  dest->status = LPADMIN_STATUS_FAILED;
+	  ret          = 1;
+        }
+        else
+        {
+	  dest->status = LPADMIN_STATUS_DONE;
+        }
+      }
+    }
+    else if (changed == 0 && pending > 0)
+    {
+      // No progress, so the remaining classes are members of each other...
+      for (dest = (lpadmin_dest_t *)cupsArrayGetFirst(desired); dest; dest = (lpadmin_dest_t *)cupsArrayGetNext(desired))
+      {
+        if (dest->status != LPADMIN_STATUS_PENDING)
+          continue;
+
+	cupsLangPrintf(stderr, _("lpadmin: Class %s is a member of itself."), dest->name);
+	dest->status = LPADMIN_STATUS_FAILED;
+	ret          = 1;
+      }
+    }
+  }
+  while (changed > 0);
+
+  if (defname)
+  {
+    // Set the default destination as needed...
+    lpadmin_dest_t	key;		// Search key
+
+    key.name = defname;
+
+    if ((cur = (lpadmin_dest_t *)cupsArrayFind(current, &key)) != NULL && (cur->type & CUPS_PRINTER_DEFAULT))
+    {
+      // Already the default...
+    }
+    else if (dry_run)
+    {
+      cupsLangPrintf(stdout, _("Set default to %s."), defname);
+    }
+    else
+    {
+      size_t	n;			// Request number
+
+      // Build a CUPS-Set-Default request, which requires the following
+      // attributes:
+      //
+      //   attributes-charset
+      //   attributes-natural-language
+      //   printer-uri
+      //   requesting-user-name
+      request = ippNewRequest(IPP_OP_CUPS_SET_DEFAULT);
+
+      httpAssembleURIf(HTTP_URI_CODING_ALL, uri, sizeof(uri), "ipp", NULL, "localhost", 0, "/printers/%s", defname);
+      ippAddString(request, IPP_TAG_OPERATION, IPP_TAG_URI, "printer-uri", NULL, uri);
+      ippAddString(request, IPP_TAG_OPERATION, IPP_TAG_NAME, "requesting-user-name", NULL, cupsGetUser());
+
+      n = pool_add_request(pool, request, "/admin/");
+
+      if (!pool_run(pool))
+      {
+	cupsLangPrintf(stderr, "lpadmin: %s: %s", defname, pool_get_status_message(pool, n));
+	ret = 1;
+      }
+    }
+  }
+
+  done:
+
+  pool_delete(pool);
+  cupsArrayDelete(current);
+  cupsArrayDelete(desired);
+  free(defname);
+
+  return (ret);
+}
+
+
+//
+// 'check_type_cache()' - Check cached printer types against the server.
+//
+// One CUPS-Get-Printers request is sent for each server per run.  Entries
+// for printers that no longer exist are dropped and entries whose type or
+// configuration has changed are updated.
+//
+
+static void
+check_type_cache(http_t *http)		// I - Server connection
+{
+  ipp_t			*request,	// IPP request
+			*response;	// IPP response
+  ipp_attribute_t	*attr;		// Current attribute
+  const char		*name;		// Attribute name
+  lpadmin_type_t	key,		// Current printer or class
+			*ptype;		// Memo table entry
+  cups_array_t		*names;		// Printers and classes on the server
+  static const char * const pattrs[] =	// Requested attributes
+  {
+    "printer-config-change-time",
+    "printer-name",
+    "printer-type"
+  };
+
+
+  if (!type_cache_checked)
+    type_cache_checked = new_names();
+
+  if (cupsArrayFind(type_cache_checked, (void *)cupsGetServer()))
+    return;
+
+  cupsArrayAdd(type_cache_checked, (void *)cupsGetServer());
+
+  // Build a CUPS-Get-Printers request, which requires the following
+  // attributes:
+  //
+  //   attributes-charset
+  //   attributes-natural-language
+  //   requested-attributes
+  //   requesting-user-name
+  request = ippNewRequest(IPP_OP_CUPS_GET_PRINTERS);
+
+  ippAddStrings(request, IPP_TAG_OPERATION, IPP_TAG_KEYWORD, "requested-attributes", sizeof(pattrs) / sizeof(pattrs[0]), NULL, pattrs);
+  ippAddString(request, IPP_TAG_OPERATION, IPP_TAG_NAME, "requesting-user-name", NULL, cupsGetUser());
+
+  response = cupsDoRequest(http, request, "/");
+  names    = new_names();
+
+  memset(&key, 0, sizeof(key));
+  cupsCopyString(key.server, cupsGetServer(), sizeof(key.server));
+
+  for (attr = ippGetFirstAttribute(response);; attr = ippGetNextAttribute(response))
+  {
+    if (!attr || !ippGetName(attr))
+    {
+      // End of a printer/class group...
+      if (key.name[0])
+      {
+        cupsArrayAdd(names, key.name);
+
+        if ((ptype = (lpadmin_type_t *)cupsArrayFind(printer_types, &key)) == NULL)
+        {
+          if ((ptype = (lpadmin_type_t *)calloc(1, sizeof(lpadmin_type_t))) != NULL)
+          {
+            *ptype = key;
+            cupsArrayAdd(printer_types, ptype);
+            type_cache_changed = true;
+          }
+        }
+        else if (ptype->type != key.type || ptype->config_time != key.config_time)
+        {
+          ptype->type        = key.type;
+          ptype->config_time = key.config_time;
+          type_cache_changed = true;
+        }
+      }
+
+      key.name[0]     = '\0';
+      key.type        = CUPS_PRINTER_LOCAL;
+      key.config_time = 0;
+
+      if (!attr)
+        break;
+      else
+        continue;
+    }
+
+    if (ippGetGroupTag(attr) != IPP_TAG_PRINTER)
+      continue;
+
+    name = ippGetName(attr);
+
+    if (!strcmp(name, "printer-name"))
+      cupsCopyString(key.name, ippGetString(attr, 0, NULL), sizeof(key.name));
+    else if (!strcmp(name, "printer-type"))
+      key.type = (cups_ptype_t)ippGetInteger(attr, 0);
+    else if (!strcmp(name, "printer-config-change-time"))
+      key.config_time = (time_t)ippGetInteger(attr, 0);
+  }
+
+  // Forget printers and classes the server no longer has, unless the server
+  // could not be asked...
+  if (cupsLastError() <= IPP_STATUS_OK_CONFLICTING || cupsLastError() == IPP_STATUS_ERROR_NOT_FOUND)
+  {
+    for (ptype = (lpadmin_type_t *)cupsArrayGetFirst(printer_types); ptype; ptype = (lpadmin_type_t *)cupsArrayGetNext(printer_types))
+    {
+      if (!strcasecmp(ptype->server, key.server) && !cupsArrayFind(names, ptype->name))
+      {
+        cupsArrayRemove(printer_types, ptype);
+        type_cache_changed = true;
+      }
+    }
+  }
+
+  cupsArrayDelete(names);
+  ippDelete(response);
+}
+
+
+//
+// 'compare_classes()' - Compare two pending class changes by name.
+//
+
+static int				// O - Result of comparison
+compare_classes(lpadmin_class_t *a,	// I - First class
+                lpadmin_class_t *b,	// I - Second class
+                void            *data)	// I - Callback data (unused)
+{
+  (void)data;
+
+  return (strcasecmp(a->name, b->name));
+}
+
+
+//
+// 'compare_defaults()' - Compare two PPD defaults by keyword.
+//
+
+static int				// O - Result of comparison
+compare_defaults(lpadmin_default_t *a,	// I - First default
+                 lpadmin_default_t *b,	// I - Second default
+                 void              *data)
+					// I - Callback data (unused)
+{
+  (void)data;
+
+  return (strcmp(a->keyword, b->keyword));
+}
+
+
+//
+// 'compare_dests()' - Compare two destinations by name.
+//
+
+static int				// O - Result of comparison
+compare_dests(lpadmin_dest_t *a,	// I - First destination
+              lpadmin_dest_t *b,	// I - Second destination
+              void           *data)	// I - Callback data (unused)
+{
+  (void)data;
+
+  return (strcasecmp(a->name, b->name));
+}
+
+
+//
+// 'compare_names()' - Compare two printer or class names.
+//
+
+static int				// O - Result of comparison
+compare_names(const char *a,		// I - First name
+              const char *b,		// I - Second name
+              void       *data)		// I - Callback data (unused)
+{
+  (void)data;
+
+  return (strcasecmp(a, b));
+}
+
+
+//
+// 'compare_types()' - Compare two printer type entries.
+//
+
+static int				// O - Result of comparison
+compare_types(lpadmin_type_t *a,	// I - First entry
+              lpadmin_type_t *b,	// I - Second entry
+              void           *data)	// I - Callback data (unused)
+{
+  int	result;				// Result of comparison
+
+
+  (void)data;
+
+  if ((result = strcasecmp(a->server, b->server)) == 0)
+    result = strcasecmp(a->name, b->name);
+
+  return (result);
+}
+
+
+//
+// 'default_printer()' - Set the default printing destination.
+//
 
 static int				// O - 0 on success, 1 on fail
-delete_printer_from_class(
-    http_t *http,			// I - Server connection
-    char   *printer,			// I - Printer to remove
-    char   *pclass)	  		// I - Class to remove from
+default_printer(http_t *http,		// I - Server connection
+                char   *printer)	// I - Printer name
 {
-  int		i, j, k;		// Looping vars
-  ipp_t		*request,		// IPP Request
-		*response;		// IPP Response
-  ipp_attribute_t *attr,		// Current attribute
-		*members;		// Members in class
+  ipp_t		*request;		// IPP Request
   char		uri[HTTP_MAX_URI];	// URI for printer/class
 
 
  /*
-  * Build an IPP_OP_GET_PRINTER_ATTRIBUTES request, which requires the following
+  * Build a CUPS-Set-Default request, which requires the following
   * attributes:
   *
   *    attributes-charset
@@ -909,10 +1396,11 @@ delete_printer_from_class(
   *    requesting-user-name
   */
 
-  request = ippNewRequest(IPP_OP_GET_PRINTER_ATTRIBUTES);
-
   httpAssembleURIf(HTTP_URI_CODING_ALL, uri, sizeof(uri), "ipp", NULL,
-                   "localhost", 0, "/classes/%s", pclass);
+                   "localhost", 0, "/printers/%s", printer);
+
+  request = ippNewRequest(IPP_OP_CUPS_SET_DEFAULT);
+
   ippAddString(request, IPP_TAG_OPERATION, IPP_TAG_URI,
                "printer-uri", NULL, uri);
   ippAddString(request, IPP_TAG_OPERATION, IPP_TAG_NAME, "requesting-user-name",
@@ -922,103 +1410,54 @@ delete_printer_from_class(
   * Do the request and get back a response...
   */
 
-  if ((response = cupsDoRequest(http, request, "/classes/")) == NULL ||
-      ippGetStatusCode(response) == IPP_STATUS_ERROR_NOT_FOUND)
-  {
-    cupsLangPrintf(stderr, _("%s: %s"), "lpadmin", cupsLastErrorString());
-
-    ippDelete(response);
-
-    return (1);
-  }
-
- /*
-  * See if the printer is already in the class...
-  */
-
-  if ((members = ippFindAttribute(response, "member-names", IPP_TAG_NAME)) == NULL)
-  {
-    cupsLangPuts(stderr, _("lpadmin: No member names were seen."));
-
-    ippDelete(response);
-
-    return (1);
-  }
-
-  for (i = 0; i < members->num_values; i ++)
-    if (!strcasecmp(printer, members->values[i].string.text))
-      break;
+  ippDelete(cupsDoRequest(http, request, "/admin/"));
 
-  if (i >= members->num_values)
+  if (cupsLastError() > IPP_STATUS_OK_CONFLICTING)
   {
-    cupsLangPrintf(stderr,
-                    _("lpadmin: Printer %s is not a member of class %s."),
-	            printer, pclass);
-
-    ippDelete(response);
+    cupsLangPrintf(stderr, _("%s: %s"), "lpadmin", cupsLastErrorString());
 
     return (1);
   }
+  else
+    return (0);
+}
 
-  if (members->num_values == 1)
-  {
-   /*
-    * Build a CUPS-Delete-Class request, which requires the following
-    * attributes:
-    *
-    *    attributes-charset
-    *    attributes-natural-language
-    *    printer-uri
-    *    requesting-user-name
-    */
-
-    request = ippNewRequest(IPP_OP_CUPS_DELETE_CLASS);
 
-    ippAddString(request, IPP_TAG_OPERATION, IPP_TAG_URI,
-        	 "printer-uri", NULL, uri);
-    ippAddString(request, IPP_TAG_OPERATION, IPP_TAG_NAME,
-                 "requesting-user-name", NULL, cupsGetUser());
-  }
-  else
-  {
-   /*
-    * Build a IPP_OP_CUPS_ADD_MODIFY_CLASS request, which requires the following
-    * attributes:
-    *
-    *    attributes-charset
-    *    attributes-natural-language
-    *    printer-uri
-    *    requesting-user-name
-    *    member-uris
-    */
+//
+// 'delete_printer()' - Delete a printer from the system...
+//
 
-    request = ippNewRequest(IPP_OP_CUPS_ADD_MODIFY_CLASS);
+static int				// O - 0 on success, 1 on fail
+delete_printer(http_t *http,		// I - Server connection
+               char   *printer)		// I - Printer to delete
+{
+  ipp_t		*request;		// IPP Request
+  char		uri[HTTP_MAX_URI];	// URI for printer/class
 
-    ippAddString(request, IPP_TAG_OPERATION, IPP_TAG_URI,
-        	 "printer-uri", NULL, uri);
-    ippAddString(request, IPP_TAG_OPERATION, IPP_TAG_NAME,
-                 "requesting-user-name", NULL, cupsGetUser());
 
-   /*
-    * Delete the printer from the class...
-    */
+ /*
+  * Build a CUPS-Delete-Printer request, which requires the following
+  * attributes:
+  *
+  *    attributes-charset
+  *    attributes-natural-language
+  *    printer-uri
+  *    requesting-user-name
+  */
 
-    members = ippFindAttribute(response, "member-uris", IPP_TAG_URI);
-    attr = ippAddStrings(request, IPP_TAG_PRINTER, IPP_TAG_URI,
-                         "member-uris", members->num_values - 1, NULL, NULL);
+  request = ippNewRequest(IPP_OP_CUPS_DELETE_PRINTER);
 
-    for (j = 0, k = 0; j < members->num_values; j ++)
-      if (j != i)
-        attr->values[k ++].string.text =
-	    _cupsStrAlloc(members->values[j].string.text);
-  }
+  httpAssembleURIf(HTTP_URI_CODING_ALL, uri, sizeof(uri), "ipp", NULL,
+                   "localhost", 0, "/printers/%s", printer);
+  ippAddString(request, IPP_TAG_OPERATION, IPP_TAG_URI,
+               "printer-uri", NULL, uri);
+  ippAddString(request, IPP_TAG_OPERATION, IPP_TAG_NAME, "requesting-user-name",
+               NULL, cupsGetUser());
 
  /*
-  * Then send the request...
+  * Do the request and get back a response...
   */
 
-  ippDelete(response);
-
   ippDelete(cupsDoRequest(http, request, "/admin/"));
 
   if (cupsLastError() > IPP_STATUS_OK_CONFLICTING)
@@ -1027,8 +1466,10 @@ delete_printer_from_class(
 
     return (1);
   }
-  else
-    return (0);
+
+  forget_printer_type(printer);
+
+  return (0);
 }
 
 
@@ -1076,6 +1517,7 @@ delete_printer_option(http_t *http,	// I - Server connection
   if (cupsLastError() > IPP_STATUS_OK_CONFLICTING)
   {
     cupsLangPrintf(stderr, _("%s: %s"), "lpadmin", cupsLastErrorString());
+    forget_printer_type(printer);
 
     return (1);
   }
@@ -1084,117 +1526,1004 @@ delete_printer_option(http_t *http,	// I - Server connection
 }
 
 
-//
-// 'enable_printer()' - Enable a printer...
-//
+//
+// 'enable_printer()' - Enable a printer...
+//
+
+static int				// O - 0 on success, 1 on fail
+enable_printer(http_t *http,		// I - Server connection
+               char   *printer)		// I - Printer to enable
+{
+  ipp_t		*request;		// IPP Request
+  char		uri[HTTP_MAX_URI];	// URI for printer/class
+
+
+ /*
+  * Send IPP_OP_ENABLE_PRINTER and IPP_OP_RESUME_PRINTER requests, which
+  * require the following attributes:
+  *
+  *    attributes-charset
+  *    attributes-natural-language
+  *    printer-uri
+  *    requesting-user-name
+  */
+
+  request = ippNewRequest(IPP_OP_ENABLE_PRINTER);
+
+  httpAssembleURIf(HTTP_URI_CODING_ALL, uri, sizeof(uri), "ipp", NULL, "localhost", ippGetPort(), "/printers/%s", printer);
+  ippAddString(request, IPP_TAG_OPERATION, IPP_TAG_URI, "printer-uri", NULL, uri);
+  ippAddString(request, IPP_TAG_OPERATION, IPP_TAG_NAME, "requesting-user-name", NULL, cupsGetUser());
+
+  ippDelete(cupsDoRequest(http, request, "/admin/"));
+
+  if (cupsLastError() > IPP_STATUS_OK_CONFLICTING)
+  {
+    cupsLangPrintf(stderr, _("%s: %s"), "lpadmin", cupsLastErrorString());
+
+    return (1);
+  }
+
+  request = ippNewRequest(IPP_OP_RESUME_PRINTER);
+
+  ippAddString(request, IPP_TAG_OPERATION, IPP_TAG_URI, "printer-uri", NULL, uri);
+  ippAddString(request, IPP_TAG_OPERATION, IPP_TAG_NAME, "requesting-user-name", NULL, cupsGetUser());
+
+  ippDelete(cupsDoRequest(http, request, "/admin/"));
+
+  if (cupsLastError() > IPP_STATUS_OK_CONFLICTING)
+  {
+    cupsLangPrintf(stderr, _("%s: %s"), "lpadmin", cupsLastErrorString());
+
+    return (1);
+  }
+
+  return (0);
+}
+
+
+//
+// 'free_class()' - Free a pending class change.
+//
+
+static void
+free_class(lpadmin_class_t *cls,	// I - Class change
+           void            *data)	// I - Callback data (unused)
+{
+  (void)data;
+
+  free(cls->name);
+  cupsArrayDelete(cls->add);
+  cupsArrayDelete(cls->remove);
+  free(cls);
+}
+
+
+//
+// 'free_dest()' - Free a destination.
+//
+
+static void
+free_dest(lpadmin_dest_t *dest,		// I - Destination
+          void           *data)		// I - Callback data (unused)
+{
+  (void)data;
+
+  free(dest->name);
+  cupsFreeOptions(dest->num_options, dest->options);
+  cupsArrayDelete(dest->members);
+  free(dest);
+}
+
+
+//
+// 'get_current_dests()' - Get the current printers and classes.
+//
+// Only the attributes named in the manifest are requested.
+//
+
+static cups_array_t *			// O - Current destinations or `NULL` on error
+get_current_dests(pool_t       *pool,	// I - Request pool
+                  cups_array_t *desired)// I - Destinations from manifest
+{
+  cups_array_t	*current,		// Current destinations
+		*names;			// Requested attribute names
+  lpadmin_dest_t *dest;			// Current destination
+  size_t	i,			// Looping var
+		num_attrs,		// Number of requested attributes
+		reqs[2];		// Request numbers
+  const char	**attrs,		// Requested attributes
+		*name;			// Attribute name
+  ipp_t		*request;		// IPP request
+
+
+  // Build the list of attributes to compare...
+  names = cupsArrayNewStrings("member-names,printer-name,printer-type", ',');
+
+  for (dest = (lpadmin_dest_t *)cupsArrayGetFirst(desired); dest; dest = (lpadmin_dest_t *)cupsArrayGetNext(desired))
+  {
+    for (i = 0; i < dest->num_options; i ++)
+    {
+      if (!cupsArrayFind(names, dest->options[i].name))
+        cupsArrayAdd(names, dest->options[i].name);
+    }
+  }
+
+  num_attrs = (size_t)cupsArrayGetCount(names);
+
+  if ((attrs = calloc(num_attrs, sizeof(char *))) == NULL)
+  {
+    cupsLangPuts(stderr, _("lpadmin: Unable to allocate memory."));
+    cupsArrayDelete(names);
+    return (NULL);
+  }
+
+  for (name = (const char *)cupsArrayGetFirst(names), i = 0; name; name = (const char *)cupsArrayGetNext(names), i ++)
+    attrs[i] = name;
+
+  // Build CUPS-Get-Printers and CUPS-Get-Classes requests, which require the
+  // following attributes:
+  //
+  //   attributes-charset
+  //   attributes-natural-language
+  //   requested-attributes
+  //   printer-type + printer-type-mask (CUPS-Get-Printers, to skip classes)
+  for (i = 0; i < 2; i ++)
+  {
+    request = ippNewRequest(i ? IPP_OP_CUPS_GET_CLASSES : IPP_OP_CUPS_GET_PRINTERS);
+
+    ippAddStrings(request, IPP_TAG_OPERATION, IPP_TAG_KEYWORD, "requested-attributes", num_attrs, NULL, attrs);
+
+    if (i == 0)
+    {
+      ippAddInteger(request, IPP_TAG_OPERATION, IPP_TAG_ENUM, "printer-type", CUPS_PRINTER_LOCAL);
+      ippAddInteger(request, IPP_TAG_OPERATION, IPP_TAG_ENUM, "printer-type-mask", CUPS_PRINTER_CLASS);
+    }
+
+    reqs[i] = pool_add_request(pool, request, "/");
+  }
+
+  free(attrs);
+  cupsArrayDelete(names);
+
+  // Send both requests at the same time...
+  pool_run(pool);
+
+  current = cupsArrayNew((cups_array_cb_t)compare_dests, NULL, NULL, 0, NULL, (cups_afree_cb_t)free_dest);
+
+  for (i = 0; i < 2; i ++)
+  {
+    // An empty list of printers or classes is returned as not-found...
+    if (pool_get_status(pool, reqs[i]) > IPP_STATUS_OK_CONFLICTING && pool_get_status(pool, reqs[i]) != IPP_STATUS_ERROR_NOT_FOUND)
+    {
+      cupsLangPrintf(stderr, _("%s: %s"), "lpadmin", pool_get_status_message(pool, reqs[i]));
+      cupsArrayDelete(current);
+      return (NULL);
+    }
+
+    add_dests(current, pool_get_response(pool, reqs[i]));
+  }
+
+  return (current);
+}
+
+
+//
+// 'export_manifest()' - Export the printers and classes to a manifest.
+//
+// The destinations are read with paginated CUPS-Get-Printers requests and
+// written in the format read by `read_manifest`, so the manifest can be
+// applied to another server with "--import" or "--apply".  All attributes are
+// requested so that every "*-default" job option is exported along with the
+// options in `options`.  Discovered (remote) destinations and classes without
+// members are not exported.
+//
+
+static int				// O - 0 on success, 1 on fail
+export_manifest(http_t     *http,	// I - Server connection
+                const char *filename)	// I - Manifest file or "-" for stdout
+{
+  cups_array_t	*dests;			// Destinations
+  lpadmin_dest_t *dest,			// Current destination
+		*last;			// Last destination in page
+  size_t	i, j,			// Looping vars
+		count,			// Number of destinations in page
+		num_dests;		// Number of destinations before page
+  int		pass;			// Printers, then classes
+  ipp_t		*request,		// IPP request
+		*response;		// IPP response
+  cups_file_t	*fp;			// Manifest file
+  const char	*name;			// Member name
+  cups_option_t	*option;		// Current option
+  size_t	namelen;		// Length of option name
+  static const char * const options[] =	// Exported "Option" attributes
+  {
+    "job-k-limit",
+    "job-page-limit",
+    "job-quota-period",
+    "port-monitor",
+    "printer-error-policy",
+    "printer-op-policy",
+    "requesting-user-name-allowed",
+    "requesting-user-name-denied"
+  };
+
+
+  dests = cupsArrayNew((cups_array_cb_t)compare_dests, NULL, NULL, 0, NULL, (cups_afree_cb_t)free_dest);
+  last  = NULL;
+
+  do
+  {
+    // Build a CUPS-Get-Printers request, which requires the following
+    // attributes:
+    //
+    //   attributes-charset
+    //   attributes-natural-language
+    //   requested-attributes
+    //   limit
+    //   first-printer-name (after the first page)
+    request = ippNewRequest(IPP_OP_CUPS_GET_PRINTERS);
+
+    ippAddString(request, IPP_TAG_OPERATION, IPP_TAG_KEYWORD, "requested-attributes", NULL, "all");
+    ippAddInteger(request, IPP_TAG_OPERATION, IPP_TAG_INTEGER, "limit", LPADMIN_PAGE_SIZE);
+    if (last)
+      ippAddString(request, IPP_TAG_OPERATION, IPP_TAG_NAME, "first-printer-name", NULL, last->name);
+
+    response = cupsDoRequest(http, request, "/");
+
+    if (cupsLastError() > IPP_STATUS_OK_CONFLICTING && cupsLastError() != IPP_STATUS_ERROR_NOT_FOUND)
+    {
+      cupsLangPrintf(stderr, _("%s: %s"), "lpadmin", cupsLastErrorString());
+      ippDelete(response);
+      cupsArrayDelete(dests);
+      return (1);
+    }
+
+    // The first printer of each page after the first one repeats the last
+    // printer of the previous page...
+    num_dests = (size_t)cupsArrayGetCount(dests);
+    count     = add_dests(dests, response);
+    last      = (lpadmin_dest_t *)cupsArrayGetLast(dests);
+
+    ippDelete(response);
+  }
+  while (count >= LPADMIN_PAGE_SIZE && (size_t)cupsArrayGetCount(dests) > num_dests);
+
+  // Write the manifest...
+  if (!strcmp(filename, "-"))
+    fp = cupsFileStdout();
+  else if ((fp = cupsFileOpen(filename, "w")) == NULL)
+  {
+    cupsLangPrintf(stderr, _("lpadmin: Unable to create \"%s\": %s"), filename, strerror(errno));
+    cupsArrayDelete(dests);
+    return (1);
+  }
+
+  for (pass = 0; pass < 2; pass ++)
+  {
+    for (dest = (lpadmin_dest_t *)cupsArrayGetFirst(dests); dest; dest = (lpadmin_dest_t *)cupsArrayGetNext(dests))
+    {
+      if ((dest->type & CUPS_PRINTER_REMOTE) || (pass == 0) != !(dest->type & CUPS_PRINTER_CLASS))
+        continue;
+
+      if (pass && cupsArrayGetCount(dest->members) == 0)
+      {
+        cupsLangPrintf(stderr, _("lpadmin: Warning - class %s has no members and was not exported."), dest->name);
+        continue;
+      }
+
+      cupsFilePrintf(fp, "<%s %s>\n", pass ? "Class" : "Printer", dest->name);
+
+      for (i = dest->num_options, option = dest->options; i > 0; i --, option ++)
+      {
+        if (!option->value[0])
+          continue;
+        else if (!strcmp(option->name, "device-uri"))
+        {
+          if (!pass)
+            write_manifest_line(fp, "DeviceURI", option->value);
+        }
+        else if (!strcmp(option->name, "printer-info"))
+          write_manifest_line(fp, "Info", option->value);
+        else if (!strcmp(option->name, "printer-location"))
+          write_manifest_line(fp, "Location", option->value);
+        else if (!strcmp(option->name, "printer-is-accepting-jobs"))
+          write_manifest_line(fp, "Accepting", strcmp(option->value, "true") ? "no" : "yes");
+        else if (!strcmp(option->name, "printer-is-shared"))
+          write_manifest_line(fp, "Shared", strcmp(option->value, "true") ? "no" : "yes");
+        else if (!strcmp(option->name, "printer-state"))
+          write_manifest_line(fp, "Enabled", strcmp(option->value, "stopped") ? "yes" : "no");
+        else
+        {
+          // Only export the "*-default" job options and the policy/quota
+          // options, not the status and capability attributes...
+          namelen = strlen(option->name);
+
+          if (namelen <= 8 || strcmp(option->name + namelen - 8, "-default"))
+          {
+            for (j = 0; j < (sizeof(options) / sizeof(options[0])); j ++)
+            {
+              if (!strcmp(option->name, options[j]))
+                break;
+            }
+
+            if (j >= (sizeof(options) / sizeof(options[0])))
+              continue;
+          }
+
+          cupsFilePrintf(fp, "Option %s ", option->name);
+          write_manifest_line(fp, NULL, option->value);
+        }
+      }
+
+      for (name = (const char *)cupsArrayGetFirst(dest->members); name; name = (const char *)cupsArrayGetNext(dest->members))
+        write_manifest_line(fp, "Member", name);
+
+      cupsFilePrintf(fp, "</%s>\n", pass ? "Class" : "Printer");
+    }
+  }
+
+  for (dest = (lpadmin_dest_t *)cupsArrayGetFirst(dests); dest; dest = (lpadmin_dest_t *)cupsArrayGetNext(dests))
+  {
+    if ((dest->type & CUPS_PRINTER_DEFAULT) && !(dest->type & CUPS_PRINTER_REMOTE))
+    {
+      write_manifest_line(fp, "Default", dest->name);
+      break;
+    }
+  }
+
+  cupsArrayDelete(dests);
+
+  if (fp != cupsFileStdout() && cupsFileClose(fp))
+  {
+    cupsLangPrintf(stderr, _("lpadmin: Unable to write \"%s\": %s"), filename, strerror(errno));
+    return (1);
+  }
+  else if (fp == cupsFileStdout())
+    cupsFileFlush(fp);
+
+  return (0);
+}
+
+
+//
+// 'forget_printer_type()' - Remove a printer from the type memo table.
+//
+// This is used when a printer is deleted or when a request that used the
+// remembered type fails, so that the next lookup asks the server again.
+//
+
+static void
+forget_printer_type(const char *printer)// I - Printer name
+{
+  lpadmin_type_t	key,		// Search key
+			*ptype;		// Matching entry
+
+
+  cupsCopyString(key.server, cupsGetServer(), sizeof(key.server));
+  cupsCopyString(key.name, printer, sizeof(key.name));
+
+  if ((ptype = (lpadmin_type_t *)cupsArrayFind(printer_types, &key)) != NULL)
+  {
+    cupsArrayRemove(printer_types, ptype);
+    type_cache_changed = true;
+  }
+}
+
+
+//
+// 'get_printer_type()' - Determine the printer type and URI.
+//
+// Types are remembered for the rest of the run and, with "--type-cache",
+// across runs.  Types loaded from the on-disk cache are checked against the
+// server once per run.  The remembered type is used until a request that
+// depends on it fails.
+//
+
+static cups_ptype_t			// O - printer-type value
+get_printer_type(http_t *http,		// I - Server connection
+                 char   *printer,	// I - Printer name
+		 char   *uri,		// I - URI buffer
+                 size_t urisize)	// I - Size of URI buffer
+{
+  ipp_t			*request,	// IPP request
+			*response;	// IPP response
+  ipp_attribute_t	*attr;		// printer-type attribute
+  cups_ptype_t		type;		// printer-type value
+  lpadmin_type_t	key,		// Search key
+			*ptype;		// Memo table entry
+
+
+  if (!printer_types)
+    printer_types = cupsArrayNew((cups_array_cb_t)compare_types, NULL, NULL, 0, NULL, (cups_afree_cb_t)free);
+
+  if (type_cache[0])
+    check_type_cache(http);
+
+  memset(&key, 0, sizeof(key));
+  cupsCopyString(key.server, cupsGetServer(), sizeof(key.server));
+  cupsCopyString(key.name, printer, sizeof(key.name));
+
+  if ((ptype = (lpadmin_type_t *)cupsArrayFind(printer_types, &key)) != NULL)
+  {
+    // Use the remembered type...
+    httpAssembleURIf(HTTP_URI_CODING_ALL, uri, (int)urisize, "ipp", NULL, "localhost", ippGetPort(), (ptype->type & CUPS_PRINTER_CLASS) ? "/classes/%s" : "/printers/%s", printer);
+
+    return (ptype->type);
+  }
+
+ /*
+  * Build a GET_PRINTER_ATTRIBUTES request, which requires the following
+  * attributes:
+  *
+  *    attributes-charset
+  *    attributes-natural-language
+  *    printer-uri
+  *    requested-attributes
+  *    requesting-user-name
+  */
+
+  httpAssembleURIf(HTTP_URI_CODING_ALL, uri, (int)urisize, "ipp", NULL, "localhost", ippGetPort(), "/printers/%s", printer);
+
+  request = ippNewRequest(IPP_OP_GET_PRINTER_ATTRIBUTES);
+  ippAddString(request, IPP_TAG_OPERATION, IPP_TAG_URI,
+               "printer-uri", NULL, uri);
+  ippAddString(request, IPP_TAG_OPERATION, IPP_TAG_KEYWORD,
+               "requested-attributes", NULL, "printer-type");
+  ippAddString(request, IPP_TAG_OPERATION, IPP_TAG_NAME,
+               "requesting-user-name", NULL, cupsGetUser());
+
+ /*
+  * Do the request...
+  */
+
+  response = cupsDoRequest(http, request, "/");
+  if ((attr = ippFindAttribute(response, "printer-type",
+                               IPP_TAG_ENUM)) != NULL)
+  {
+    type = (cups_ptype_t)ippGetInteger(attr, 0);
+
+    if (type & CUPS_PRINTER_CLASS)
+      httpAssembleURIf(HTTP_URI_CODING_ALL, uri, (int)urisize, "ipp", NULL, "localhost", ippGetPort(), "/classes/%s", printer);
+
+   /*
+    * Remember the type of existing printers and classes...
+    */
+
+    if ((ptype = (lpadmin_type_t *)calloc(1, sizeof(lpadmin_type_t))) != NULL)
+    {
+      *ptype      = key;
+      ptype->type = type;
+
+      cupsArrayAdd(printer_types, ptype);
+      type_cache_changed = true;
+    }
+  }
+  else
+    type = CUPS_PRINTER_LOCAL;
+
+  ippDelete(response);
+
+  return (type);
+}
+
+
+//
+// 'hash_default()' - Compute the hash of a PPD default keyword.
+//
+
+static size_t				// O - Hash value
+hash_default(lpadmin_default_t *def,	// I - Default
+             void              *data)	// I - Callback data (unused)
+{
+  size_t	hash = 0;		// Hash value
+  const char	*ptr;			// Pointer into keyword
+
+
+  (void)data;
+
+  for (ptr = def->keyword; *ptr; ptr ++)
+    hash = 31 * hash + (size_t)(*ptr & 255);
+
+  return (hash % LPADMIN_DEFAULT_HASH);
+}
+
+
+//
+// 'hash_name()' - Compute the case-insensitive hash of a printer name.
+//
+
+static size_t				// O - Hash value
+hash_name(const char *name,		// I - Name
+          void       *data)		// I - Callback data (unused)
+{
+  size_t	hash = 0;		// Hash value
+
+
+  (void)data;
+
+  while (*name)
+    hash = 31 * hash + (size_t)tolower(*name++ & 255);
+
+  return (hash % LPADMIN_NAME_HASH);
+}
+
+
+//
+// 'load_type_cache()' - Load the on-disk printer type cache.
+//
+// The cache is saved when lpadmin exits.
+//
+
+static void
+load_type_cache(void)
+{
+  const char		*home;		// Home directory
+  cups_file_t		*fp;		// Cache file
+  char			line[1024],	// Line from file
+			*name,		// Printer name
+			*type,		// printer-type value
+			*config;	// printer-config-change-time value
+  lpadmin_type_t	*ptype;		// Memo table entry
+
+
+  if (type_cache[0] || (home = getenv("HOME")) == NULL)
+    return;
+
+  snprintf(type_cache, sizeof(type_cache), "%s/.cups/lpadmin-types", home);
+
+  if (!printer_types)
+    printer_types = cupsArrayNew((cups_array_cb_t)compare_types, NULL, NULL, 0, NULL, (cups_afree_cb_t)free);
+
+  atexit(save_type_cache);
+
+  if ((fp = cupsFileOpen(type_cache, "r")) == NULL)
+    return;
+
+  // Each line is "server<TAB>name<TAB>printer-type<TAB>config-time"
+  while (cupsFileGets(fp, line, sizeof(line)))
+  {
+    if ((name = strchr(line, '\t')) == NULL)
+      continue;
+    *name++ = '\0';
+
+    if ((type = strchr(name, '\t')) == NULL)
+      continue;
+    *type++ = '\0';
+
+    if ((config = strchr(type, '\t')) != NULL)
+      *config++ = '\0';
+
+    if ((ptype = (lpadmin_type_t *)calloc(1, sizeof(lpadmin_type_t))) == NULL)
+      break;
+
+    cupsCopyString(ptype->server, line, sizeof(ptype->server));
+    cupsCopyString(ptype->name, name, sizeof(ptype->name));
+    ptype->type        = (cups_ptype_t)strtol(type, NULL, 10);
+    ptype->config_time = config ? (time_t)strtol(config, NULL, 10) : 0;
+
+    if (cupsArrayFind(printer_types, ptype))
+      free(ptype);
+    else
+      cupsArrayAdd(printer_types, ptype);
+  }
+
+  cupsFileClose(fp);
+
+  type_cache_changed = false;
+}
+
+
+//
+// 'new_apply_request()' - Create a request for the changes to a destination.
+//
+// The "ppd-name" attribute is only used when adding a printer since the
+// scheduler does not report it.
+//
+
+static ipp_t *				// O - IPP request or `NULL` if unchanged
+new_apply_request(lpadmin_dest_t *dest,	// I - Destination from manifest
+                  lpadmin_dest_t *cur)	// I - Current destination or `NULL` to add
+{
+  size_t	i,			// Looping var
+		num_changes = 0;	// Number of changed attributes
+  cups_option_t	*changes = NULL,	// Changed attributes
+		*option;		// Current attribute
+  const char	*value,			// Current value
+		*name;			// Member name
+  bool		members_changed = false;// Class members changed?
+  ipp_t		*request;		// IPP request
+  ipp_attribute_t *attr;		// member-uris attribute
+  char		uri[HTTP_MAX_URI];	// URI for printer/class
+
+
+  for (i = dest->num_options, option = dest->options; i > 0; i --, option ++)
+  {
+    if (cur)
+    {
+      if (!strcmp(option->name, "ppd-name"))
+        continue;
+
+      // A processing printer is also enabled...
+      if ((value = cupsGetOption(option->name, cur->num_options, cur->options)) != NULL && (!strcmp(value, option->value) || (!strcmp(option->name, "printer-state") && !strcmp(option->value, "idle") && !strcmp(value, "processing"))))
+        continue;
+    }
+
+    num_changes = cupsAddOption(option->name, option->value, num_changes, &changes);
+  }
+
+  if (dest->type & CUPS_PRINTER_CLASS)
+  {
+    if (!cur || cupsArrayGetCount(dest->members) != cupsArrayGetCount(cur->members))
+    {
+      members_changed = true;
+    }
+    else
+    {
+      for (name = (const char *)cupsArrayGetFirst(dest->members); name; name = (const char *)cupsArrayGetNext(dest->members))
+      {
+        if (!cupsArrayFind(cur->members, (void *)name))
+        {
+          members_changed = true;
+          break;
+        }
+      }
+    }
+  }
+
+  if (num_changes == 0 && !members_changed)
+    return (NULL);
+
+  // Build a CUPS-Add-Modify-Printer or CUPS-Add-Modify-Class request, which
+  // requires the following attributes:
+  //
+  //   attributes-charset
+  //   attributes-natural-language
+  //   printer-uri
+  //   requesting-user-name
+  //   changed attributes
+  if (dest->type & CUPS_PRINTER_CLASS)
+  {
+    request = ippNewRequest(IPP_OP_CUPS_ADD_MODIFY_CLASS);
+    httpAssembleURIf(HTTP_URI_CODING_ALL, uri, sizeof(uri), "ipp", NULL, "localhost", 0, "/classes/%s", dest->name);
+  }
+  else
+  {
+    request = ippNewRequest(IPP_OP_CUPS_ADD_MODIFY_PRINTER);
+    httpAssembleURIf(HTTP_URI_CODING_ALL, uri, sizeof(uri), "ipp", NULL, "localhost", 0, "/printers/%s", dest->name);
+  }
+
+  ippAddString(request, IPP_TAG_OPERATION, IPP_TAG_URI, "printer-uri", NULL, uri);
+  ippAddString(request, IPP_TAG_OPERATION, IPP_TAG_NAME, "requesting-user-name", NULL, cupsGetUser());
+
+  if ((value = cupsGetOption("printer-state", num_changes, changes)) != NULL)
+  {
+    ippAddInteger(request, IPP_TAG_PRINTER, IPP_TAG_ENUM, "printer-state", strcmp(value, "stopped") ? IPP_PSTATE_IDLE : IPP_PSTATE_STOPPED);
+    num_changes = cupsRemoveOption("printer-state", num_changes, &changes);
+  }
+
+  if ((value = cupsGetOption("printer-is-accepting-jobs", num_changes, changes)) != NULL)
+  {
+    ippAddBoolean(request, IPP_TAG_PRINTER, "printer-is-accepting-jobs", !strcmp(value, "true"));
+    num_changes = cupsRemoveOption("printer-is-accepting-jobs", num_changes, &changes);
+  }
+
+  cupsEncodeOptions(request, num_changes, changes, IPP_TAG_OPERATION);
+  cupsEncodeOptions(request, num_changes, changes, IPP_TAG_PRINTER);
+  cupsFreeOptions(num_changes, changes);
+
+  if (members_changed)
+  {
+    attr = ippAddStrings(request, IPP_TAG_PRINTER, IPP_TAG_URI, "member-uris", (size_t)cupsArrayGetCount(dest->members), NULL, NULL);
+
+    for (name = (const char *)cupsArrayGetFirst(dest->members), i = 0; name; name = (const char *)cupsArrayGetNext(dest->members), i ++)
+    {
+      httpAssembleURIf(HTTP_URI_CODING_ALL, uri, sizeof(uri), "ipp", NULL, "localhost", 0, "/printers/%s", name);
+      ippSetString(request, &attr, i, uri);
+    }
+  }
+
+  return (request);
+}
+
+
+//
+// 'new_names()' - Create an array of printer and class names.
+//
+
+static cups_array_t *			// O - Array of names
+new_names(void)
+{
+  return (cupsArrayNew((cups_array_cb_t)compare_names, NULL, (cups_ahash_cb_t)hash_name, LPADMIN_NAME_HASH, (cups_acopy_cb_t)strdup, (cups_afree_cb_t)free));
+}
+
+
+//
+// 'queue_class_change()' - Queue adding or removing printers for a class.
+//
+// The printers are a comma-delimited list.  Changes for the same class are
+// combined so that only one request is sent per class by `update_classes`,
+// with the last change for a printer winning.
+//
+
+static int				// O - 0 on success, 1 on fail
+queue_class_change(
+    cups_array_t **classes,		// IO - Pending class changes
+    const char   *pclass,		// I  - Class name
+    const char   *printers,		// I  - Printers
+    bool         add)			// I  - Add printers (`false` to remove)
+{
+  lpadmin_class_t	key,		// Search key
+			*cls;		// Class changes
+  cups_array_t		*names;		// Printer names
+  const char		*name;		// Current printer name
+
+
+  if (!*classes)
+    *classes = cupsArrayNew((cups_array_cb_t)compare_classes, NULL, NULL, 0, NULL, (cups_afree_cb_t)free_class);
+
+  key.name = (char *)pclass;
+
+  if ((cls = (lpadmin_class_t *)cupsArrayFind(*classes, &key)) == NULL)
+  {
+    if ((cls = (lpadmin_class_t *)calloc(1, sizeof(lpadmin_class_t))) == NULL || (cls->name = strdup(pclass)) == NULL)
+    {
+      cupsLangPuts(stderr, _("lpadmin: Unable to allocate memory."));
+      free(cls);
+      return (1);
+    }
+
+    cls->add    = new_names();
+    cls->remove = new_names();
+
+    cupsArrayAdd(*classes, cls);
+  }
+
+  names = cupsArrayNewStrings(printers, ',');
+
+  for (name = (const char *)cupsArrayGetFirst(names); name; name = (const char *)cupsArrayGetNext(names))
+  {
+    if (add)
+    {
+      cupsArrayRemove(cls->remove, (void *)name);
+      if (!cupsArrayFind(cls->add, (void *)name))
+        cupsArrayAdd(cls->add, (void *)name);
+    }
+    else
+    {
+      cupsArrayRemove(cls->add, (void *)name);
+      if (!cupsArrayFind(cls->remove, (void *)name))
+        cupsArrayAdd(cls->remove, (void *)name);
+    }
+  }
+
+  cupsArrayDelete(names);
+
+  return (0);
+}
+
+
+//
+// 'read_manifest()' - Read a printer and class manifest.
+//
+
+static cups_array_t *			// O - Destinations or `NULL` on error
+read_manifest(const char *filename,	// I - Manifest file
+              char       **defname)	// O - Default destination or `NULL`
+{
+  cups_file_t	*fp;			// Manifest file
+  cups_array_t	*dests;			// Destinations
+  lpadmin_dest_t *dest = NULL;		// Current destination
+  char		line[2048],		// Directive
+		*value,			// Value
+		*ptr;			// Pointer into value
+  const char	*attr;			// Attribute name
+  int		linenum = 0;		// Line number
+  bool		ok = true,		// Manifest OK?
+		b;			// Boolean value
+
+
+  *defname = NULL;
+
+  if ((fp = cupsFileOpen(filename, "r")) == NULL)
+  {
+    cupsLangPrintf(stderr, _("lpadmin: Unable to open manifest \"%s\": %s"), filename, strerror(errno));
+    return (NULL);
+  }
+
+  dests = cupsArrayNew((cups_array_cb_t)compare_dests, NULL, NULL, 0, NULL, (cups_afree_cb_t)free_dest);
+
+  while (ok && cupsFileGetConf(fp, line, sizeof(line), &value, &linenum))
+  {
+    if (!strcasecmp(line, "<Printer") || !strcasecmp(line, "<Class"))
+    {
+      // <Printer name> or <Class name>
+      if (dest || !value || !validate_name(value))
+        goto syntax_error;
+
+      if ((dest = (lpadmin_dest_t *)calloc(1, sizeof(lpadmin_dest_t))) == NULL || (dest->name = strdup(value)) == NULL)
+      {
+        cupsLangPuts(stderr, _("lpadmin: Unable to allocate memory."));
+        free(dest);
+        dest = NULL;
+        ok   = false;
+        break;
+      }
+
+      if (!strcasecmp(line, "<Class"))
+      {
+        dest->type    = CUPS_PRINTER_CLASS;
+        dest->members = new_names();
+      }
+
+      if (cupsArrayFind(dests, dest))
+      {
+        cupsLangPrintf(stderr, _("lpadmin: Duplicate destination %s on line %d of \"%s\"."), dest->name, linenum, filename);
+        free_dest(dest, NULL);
+        dest = NULL;
+        ok   = false;
+        break;
+      }
+
+      cupsArrayAdd(dests, dest);
+    }
+    else if (!strcasecmp(line, "</Printer>") || !strcasecmp(line, "</Class>"))
+    {
+      // End of printer or class...
+      if (!dest || (dest->type & CUPS_PRINTER_CLASS) != (strcasecmp(line, "</Class>") ? 0 : CUPS_PRINTER_CLASS))
+        goto syntax_error;
+
+      if ((dest->type & CUPS_PRINTER_CLASS) && cupsArrayGetCount(dest->members) == 0)
+      {
+        cupsLangPrintf(stderr, _("lpadmin: Class %s has no members on line %d of \"%s\"."), dest->name, linenum, filename);
+        ok = false;
+        break;
+      }
+
+      dest = NULL;
+    }
+    else if (!value)
+    {
+      goto syntax_error;
+    }
+    else if (!strcasecmp(line, "Default") && !dest)
+    {
+      // Default name
+      free(*defname);
+      *defname = strdup(value);
+    }
+    else if (!dest)
+    {
+      goto syntax_error;
+    }
+    else if (!strcasecmp(line, "Accepting") || !strcasecmp(line, "Enabled") || !strcasecmp(line, "Shared"))
+    {
+      // Accepting/Enabled/Shared yes/no
+      if (!strcasecmp(value, "yes") || !strcasecmp(value, "on") || !strcasecmp(value, "true"))
+      {
+        b = true;
+      }
+      else if (!strcasecmp(value, "no") || !strcasecmp(value, "off") || !strcasecmp(value, "false"))
+      {
+        b = false;
+      }
+      else
+      {
+        goto syntax_error;
+      }
 
-static int				// O - 0 on success, 1 on fail
-enable_printer(http_t *http,		// I - Server connection
-               char   *printer)		// I - Printer to enable
-{
-  ipp_t		*request;		// IPP Request
-  char		uri[HTTP_MAX_URI];	// URI for printer/class
+      if (!strcasecmp(line, "Accepting"))
+        dest->num_options = cupsAddOption("printer-is-accepting-jobs", b ? "true" : "false", dest->num_options, &dest->options);
+      else if (!strcasecmp(line, "Enabled"))
+        dest->num_options = cupsAddOption("printer-state", b ? "idle" : "stopped", dest->num_options, &dest->options);
+      else
+        dest->num_options = cupsAddOption("printer-is-shared", b ? "true" : "false", dest->num_options, &dest->options);
+    }
+    else if (!strcasecmp(line, "Member") && (dest->type & CUPS_PRINTER_CLASS))
+    {
+      // Member name
+      if (!validate_name(value))
+        goto syntax_error;
 
+      if (!cupsArrayFind(dest->members, value))
+        cupsArrayAdd(dest->members, value);
+    }
+    else if (!strcasecmp(line, "Option"))
+    {
+      // Option name value
+      for (ptr = value; *ptr && !isspace(*ptr & 255); ptr ++);
 
- /*
-  * Send IPP_OP_ENABLE_PRINTER and IPP_OP_RESUME_PRINTER requests, which
-  * require the following attributes:
-  *
-  *    attributes-charset
-  *    attributes-natural-language
-  *    printer-uri
-  *    requesting-user-name
-  */
+      if (!*ptr)
+        goto syntax_error;
 
-  request = ippNewRequest(IPP_OP_ENABLE_PRINTER);
+      for (*ptr++ = '\0'; isspace(*ptr & 255); ptr ++);
 
-  httpAssembleURIf(HTTP_URI_CODING_ALL, uri, sizeof(uri), "ipp", NULL, "localhost", ippGetPort(), "/printers/%s", printer);
-  ippAddString(request, IPP_TAG_OPERATION, IPP_TAG_URI, "printer-uri", NULL, uri);
-  ippAddString(request, IPP_TAG_OPERATION, IPP_TAG_NAME, "requesting-user-name", NULL, cupsGetUser());
+      dest->num_options = cupsAddOption(value, ptr, dest->num_options, &dest->options);
+    }
+    else
+    {
+      // DeviceURI/Info/Location/Model value
+      if (!strcasecmp(line, "DeviceURI") && !(dest->type & CUPS_PRINTER_CLASS))
+        attr = "device-uri";
+      else if (!strcasecmp(line, "Info"))
+        attr = "printer-info";
+      else if (!strcasecmp(line, "Location"))
+        attr = "printer-location";
+      else if (!strcasecmp(line, "Model") && !(dest->type & CUPS_PRINTER_CLASS))
+        attr = "ppd-name";
+      else
+        goto syntax_error;
 
-  ippDelete(cupsDoRequest(http, request, "/admin/"));
+      dest->num_options = cupsAddOption(attr, value, dest->num_options, &dest->options);
+    }
+  }
 
-  if (cupsLastError() > IPP_STATUS_OK_CONFLICTING)
-  {
-    cupsLangPrintf(stderr, _("%s: %s"), "lpadmin", cupsLastErrorString());
+  cupsFileClose(fp);
 
-    return (1);
+  if (ok && dest)
+  {
+    cupsLangPrintf(stderr, _("lpadmin: Missing </%s> at end of \"%s\"."), (dest->type & CUPS_PRINTER_CLASS) ? "Class" : "Printer", filename);
+    ok = false;
   }
 
-  request = ippNewRequest(IPP_OP_RESUME_PRINTER);
+  if (!ok)
+    goto error;
 
-  ippAddString(request, IPP_TAG_OPERATION, IPP_TAG_URI, "printer-uri", NULL, uri);
-  ippAddString(request, IPP_TAG_OPERATION, IPP_TAG_NAME, "requesting-user-name", NULL, cupsGetUser());
+  return (dests);
 
-  ippDelete(cupsDoRequest(http, request, "/admin/"));
+  // Error handling...
 
-  if (cupsLastError() > IPP_STATUS_OK_CONFLICTING)
-  {
-    cupsLangPrintf(stderr, _("%s: %s"), "lpadmin", cupsLastErrorString());
+  syntax_error:
 
-    return (1);
-  }
+  cupsLangPrintf(stderr, _("lpadmin: Syntax error on line %d of \"%s\"."), linenum, filename);
+  cupsFileClose(fp);
 
-  return (0);
+  error:
+
+  cupsArrayDelete(dests);
+  free(*defname);
+  *defname = NULL;
+
+  return (NULL);
 }
 
 
 //
-// 'get_printer_type()' - Determine the printer type and URI.
+// 'save_type_cache()' - Save the on-disk printer type cache.
 //
 
-static cups_ptype_t			// O - printer-type value
-get_printer_type(http_t *http,		// I - Server connection
-                 char   *printer,	// I - Printer name
-		 char   *uri,		// I - URI buffer
-                 size_t urisize)	// I - Size of URI buffer
+static void
+save_type_cache(void)
 {
-  ipp_t			*request,	// IPP request
-			*response;	// IPP response
-  ipp_attribute_t	*attr;		// printer-type attribute
-  cups_ptype_t		type;		// printer-type value
+  cups_file_t		*fp;		// Cache file
+  char			temp[1024];	// Temporary file
+  lpadmin_type_t	*ptype;		// Memo table entry
 
 
- /*
-  * Build a GET_PRINTER_ATTRIBUTES request, which requires the following
-  * attributes:
-  *
-  *    attributes-charset
-  *    attributes-natural-language
-  *    printer-uri
-  *    requested-attributes
-  *    requesting-user-name
-  */
-
-  httpAssembleURIf(HTTP_URI_CODING_ALL, uri, (int)urisize, "ipp", NULL, "localhost", ippGetPort(), "/printers/%s", printer);
-
-  request = ippNewRequest(IPP_OP_GET_PRINTER_ATTRIBUTES);
-  ippAddString(request, IPP_TAG_OPERATION, IPP_TAG_URI,
-               "printer-uri", NULL, uri);
-  ippAddString(request, IPP_TAG_OPERATION, IPP_TAG_KEYWORD,
-               "requested-attributes", NULL, "printer-type");
-  ippAddString(request, IPP_TAG_OPERATION, IPP_TAG_NAME,
-               "requesting-user-name", NULL, cupsGetUser());
+  if (!type_cache[0] || !type_cache_changed)
+    return;
 
- /*
-  * Do the request...
-  */
+  // Write to a temporary file and then replace the cache...
+  snprintf(temp, sizeof(temp), "%s.%d", type_cache, (int)getpid());
 
-  response = cupsDoRequest(http, request, "/");
-  if ((attr = ippFindAttribute(response, "printer-type",
-                               IPP_TAG_ENUM)) != NULL)
+  if ((fp = cupsFileOpen(temp, "w")) == NULL)
   {
-    type = (cups_ptype_t)ippGetInteger(attr, 0);
+    // Try creating the ~/.cups directory first...
+    char	dir[1024],		// Cache directory
+		*ptr;			// Pointer into directory
 
-    if (type & CUPS_PRINTER_CLASS)
-      httpAssembleURIf(HTTP_URI_CODING_ALL, uri, (int)urisize, "ipp", NULL, "localhost", ippGetPort(), "/classes/%s", printer);
+    cupsCopyString(dir, type_cache, sizeof(dir));
+    if ((ptr = strrchr(dir, '/')) != NULL)
+      *ptr = '\0';
+
+    if (mkdir(dir, 0700) || (fp = cupsFileOpen(temp, "w")) == NULL)
+      return;
   }
-  else
-    type = CUPS_PRINTER_LOCAL;
 
-  ippDelete(response);
+  for (ptype = (lpadmin_type_t *)cupsArrayGetFirst(printer_types); ptype; ptype = (lpadmin_type_t *)cupsArrayGetNext(printer_types))
+    cupsFilePrintf(fp, "%s\t%s\t%d\t%ld\n", ptype->server, ptype->name, (int)ptype->type, (long)ptype->config_time);
 
-  return (type);
+  if (cupsFileClose(fp) || rename(temp, type_cache))
+    unlink(temp);
 }
 
 
@@ -1215,21 +2544,21 @@ set_printer_options(
   const char	*ppdfile;		// PPD filename
   int		ppdchanged = 0;		// PPD changed?
   ppd_file_t	*ppd;			// PPD file
-  ppd_choice_t	*choice;		// Marked choice
+  ppd_option_t	*option;		// Current option
+  cups_array_t	*defaults;		// New default choices
+  lpadmin_default_t key,		// Search key
+		*def;			// New default choice
+  http_status_t	status;			// Status of write
   char		uri[HTTP_MAX_URI],	// URI for printer/class
 		line[1024],		// Line from PPD file
 		keyword[1024],		// Keyword from Default line
-		*keyptr,		// Pointer into keyword...
-		tempfile[1024];		// Temporary filename
-  cups_file_t	*in,			// PPD file
-		*out;			// Temporary file
+		*keyptr;		// Pointer into keyword...
+  cups_file_t	*in;			// PPD file
   const char	*ppdname,		// ppd-name value
 		*protocol,		// Old protocol option
-		*customval,		// Custom option value
-		*boolval;		// Boolean value
-  int		wrote_ipp_supplies = 0,	// Wrote cupsIPPSupplies keyword?
-		wrote_snmp_supplies = 0,// Wrote cupsSNMPSupplies keyword?
-		copied_options = 0;	// Copied options?
+		*ippsupplies,		// cupsIPPSupplies value
+		*snmpsupplies;		// cupsSNMPSupplies value
+  int		copied_options = 0;	// Copied options?
 
 
  /*
@@ -1321,136 +2650,131 @@ set_printer_options(
     ppdMarkDefaults(ppd);
     cupsMarkOptions(ppd, num_options, options);
 
-    if ((out = cupsTempFile2(tempfile, sizeof(tempfile))) == NULL)
+   /*
+    * Build a table of the new default choices so that the PPD file only needs
+    * to be read once more, and only if something changed...
+    */
+
+    defaults = cupsArrayNew((cups_array_cb_t)compare_defaults, NULL, (cups_ahash_cb_t)hash_default, LPADMIN_DEFAULT_HASH, NULL, (cups_afree_cb_t)free);
+
+    for (option = ppdFirstOption(ppd); option; option = ppdNextOption(ppd))
     {
-      cupsLangPrintError(NULL, _("lpadmin: Unable to create temporary file"));
-      goto error;
+      if ((def = add_default(defaults, ppd, option->keyword, num_options, options)) != NULL && strcmp(def->value, option->defchoice))
+        ppdchanged = 1;
     }
 
-    if ((in = cupsFileOpen(ppdfile, "r")) == NULL)
+    add_default(defaults, ppd, "ImageableArea", num_options, options);
+    add_default(defaults, ppd, "PaperDimension", num_options, options);
+
+    if ((ippsupplies = cupsGetOption("cupsIPPSupplies", num_options, options)) != NULL)
     {
-      cupsLangPrintf(stderr, _("lpadmin: Unable to open PPD \"%s\": %s"), ppdfile, strerror(errno));
-      cupsFileClose(out);
-      unlink(tempfile);
-      goto error;
+      ppdchanged  = 1;
+      ippsupplies = (!strcasecmp(ippsupplies, "true") || !strcasecmp(ippsupplies, "yes") || !strcasecmp(ippsupplies, "on")) ? "True" : "False";
     }
 
-    while (cupsFileGets(in, line, sizeof(line)))
+    if ((snmpsupplies = cupsGetOption("cupsSNMPSupplies", num_options, options)) != NULL)
     {
-      if (!strncmp(line, "*cupsIPPSupplies:", 17) &&
-	  (boolval = cupsGetOption("cupsIPPSupplies", num_options,
-	                           options)) != NULL)
-      {
-        ppdchanged         = 1;
-        wrote_ipp_supplies = 1;
-        cupsFilePrintf(out, "*cupsIPPSupplies: %s\n",
-	               (!strcasecmp(boolval, "true") ||
-		        !strcasecmp(boolval, "yes") ||
-		        !strcasecmp(boolval, "on")) ? "True" : "False");
-      }
-      else if (!strncmp(line, "*cupsSNMPSupplies:", 18) &&
-	       (boolval = cupsGetOption("cupsSNMPSupplies", num_options,
-	                                options)) != NULL)
-      {
-        ppdchanged          = 1;
-        wrote_snmp_supplies = 1;
-        cupsFilePrintf(out, "*cupsSNMPSupplies: %s\n",
-	               (!strcasecmp(boolval, "true") ||
-		        !strcasecmp(boolval, "yes") ||
-		        !strcasecmp(boolval, "on")) ? "True" : "False");
-      }
-      else if (strncmp(line, "*Default", 8))
-        cupsFilePrintf(out, "%s\n", line);
-      else
-      {
-       /*
-        * Get default option name...
-	*/
+      ppdchanged   = 1;
+      snmpsupplies = (!strcasecmp(snmpsupplies, "true") || !strcasecmp(snmpsupplies, "yes") || !strcasecmp(snmpsupplies, "on")) ? "True" : "False";
+    }
 
-        cupsCopyString(keyword, line + 8, sizeof(keyword));
+    if (!ppdchanged)
+    {
+     /*
+      * Send the original PPD file, if any...
+      */
 
-	for (keyptr = keyword; *keyptr; keyptr ++)
-	  if (*keyptr == ':' || isspace(*keyptr & 255))
-	    break;
+      ippDelete(cupsDoFileRequest(http, request, "/admin/", file));
+    }
+    else if ((in = cupsFileOpen(ppdfile, "r")) == NULL)
+    {
+      cupsLangPrintf(stderr, _("lpadmin: Unable to open PPD \"%s\": %s"), ppdfile, strerror(errno));
+      cupsArrayDelete(defaults);
+      ppdClose(ppd);
+      goto error;
+    }
+    else
+    {
+     /*
+      * Rewrite the PPD file straight into the request...
+      */
 
-        *keyptr++ = '\0';
-        while (isspace(*keyptr & 255))
-	  keyptr ++;
+      status = cupsSendRequest(http, request, "/admin/", CUPS_LENGTH_VARIABLE);
 
-        if (!strcmp(keyword, "PageRegion") ||
-	    !strcmp(keyword, "PageSize") ||
-	    !strcmp(keyword, "PaperDimension") ||
-	    !strcmp(keyword, "ImageableArea"))
+      while (status == HTTP_STATUS_CONTINUE && cupsFileGets(in, line, sizeof(line)))
+      {
+	if (ippsupplies && !strncmp(line, "*cupsIPPSupplies:", 17))
 	{
-	  if ((choice = ppdFindMarkedChoice(ppd, "PageSize")) == NULL)
-	    choice = ppdFindMarkedChoice(ppd, "PageRegion");
-        }
+	  status      = write_ppd_line(http, "*cupsIPPSupplies: %s", ippsupplies);
+	  ippsupplies = NULL;
+	}
+	else if (snmpsupplies && !strncmp(line, "*cupsSNMPSupplies:", 18))
+	{
+	  status       = write_ppd_line(http, "*cupsSNMPSupplies: %s", snmpsupplies);
+	  snmpsupplies = NULL;
+	}
+	else if (strncmp(line, "*Default", 8))
+	{
+	  status = write_ppd_line(http, "%s", line);
+	}
 	else
-	  choice = ppdFindMarkedChoice(ppd, keyword);
-
-        if (choice && strcmp(choice->choice, keyptr))
 	{
-	  if (strcmp(choice->choice, "Custom"))
-	  {
-	    cupsFilePrintf(out, "*Default%s: %s\n", keyword, choice->choice);
-	    ppdchanged = 1;
-	  }
-	  else if ((customval = cupsGetOption(keyword, num_options,
-	                                      options)) != NULL)
-	  {
-	    cupsFilePrintf(out, "*Default%s: %s\n", keyword, customval);
-	    ppdchanged = 1;
-	  }
+	 /*
+	  * Get default option name...
+	  */
+
+	  cupsCopyString(keyword, line + 8, sizeof(keyword));
+
+	  for (keyptr = keyword; *keyptr; keyptr ++)
+	    if (*keyptr == ':' || isspace(*keyptr & 255))
+	      break;
+
+	  *keyptr++ = '\0';
+	  while (isspace(*keyptr & 255))
+	    keyptr ++;
+
+	  cupsCopyString(key.keyword, keyword, sizeof(key.keyword));
+
+	  if ((def = (lpadmin_default_t *)cupsArrayFind(defaults, &key)) != NULL && strcmp(def->value, keyptr))
+	    status = write_ppd_line(http, "*Default%s: %s", keyword, def->value);
 	  else
-	    cupsFilePrintf(out, "%s\n", line);
+	    status = write_ppd_line(http, "%s", line);
 	}
-	else
-	  cupsFilePrintf(out, "%s\n", line);
       }
-    }
 
-    if (!wrote_ipp_supplies &&
-	(boolval = cupsGetOption("cupsIPPSupplies", num_options,
-				 options)) != NULL)
-    {
-      ppdchanged = 1;
+      if (status == HTTP_STATUS_CONTINUE && ippsupplies)
+        status = write_ppd_line(http, "*cupsIPPSupplies: %s", ippsupplies);
 
-      cupsFilePrintf(out, "*cupsIPPSupplies: %s\n",
-		     (!strcasecmp(boolval, "true") ||
-		      !strcasecmp(boolval, "yes") ||
-		      !strcasecmp(boolval, "on")) ? "True" : "False");
-    }
+      if (status == HTTP_STATUS_CONTINUE && snmpsupplies)
+        status = write_ppd_line(http, "*cupsSNMPSupplies: %s", snmpsupplies);
 
-    if (!wrote_snmp_supplies &&
-        (boolval = cupsGetOption("cupsSNMPSupplies", num_options,
-			         options)) != NULL)
-    {
-      ppdchanged = 1;
+      cupsFileClose(in);
 
-      cupsFilePrintf(out, "*cupsSNMPSupplies: %s\n",
-		     (!strcasecmp(boolval, "true") ||
-		      !strcasecmp(boolval, "yes") ||
-		      !strcasecmp(boolval, "on")) ? "True" : "False");
-    }
+     /*
+      * Get the response...
+      */
 
-    cupsFileClose(in);
-    cupsFileClose(out);
-    ppdClose(ppd);
+      if (status != HTTP_STATUS_CONTINUE)
+      {
+        cupsLangPrintf(stderr, _("lpadmin: Unable to send PPD file: %s"), httpStatusString(status));
+	cupsArrayDelete(defaults);
+	ppdClose(ppd);
+	goto error;
+      }
 
-   /*
-    * Do the request...
-    */
+      ippDelete(cupsGetResponse(http, "/admin/"));
+      ippDelete(request);
+    }
 
-    ippDelete(cupsDoFileRequest(http, request, "/admin/", ppdchanged ? tempfile : file));
+    cupsArrayDelete(defaults);
+    ppdClose(ppd);
 
    /*
-    * Clean up temp files... (TODO: catch signals in case we CTRL-C during
-    * lpadmin)
+    * Clean up the PPD file from the server...
     */
 
     if (ppdfile != file)
       unlink(ppdfile);
-    unlink(tempfile);
   }
   else
   {
@@ -1471,6 +2795,7 @@ set_printer_options(
   if (cupsLastError() > IPP_STATUS_OK_CONFLICTING)
   {
     cupsLangPrintf(stderr, _("%s: %s"), "lpadmin", cupsLastErrorString());
+    forget_printer_type(printer);
 
     return (1);
   }
@@ -1495,6 +2820,190 @@ set_printer_options(
 }
 
 
+//
+// 'update_classes()' - Send the pending class membership changes.
+//
+// Each class is read once and, if its members change, updated with a single
+// CUPS-Add-Modify-Class request (or deleted with CUPS-Delete-Class when no
+// members are left).  Adding a member that is already in the class or
+// removing one that is not is not an error, so the same changes can safely
+// be applied again.
+//
+
+static int				// O  - 0 on success, 1 on fail
+update_classes(http_t       *http,	// I  - Server connection
+               cups_array_t **classes)	// IO - Pending class changes
+{
+  int			ret = 0;	// Return value
+  lpadmin_class_t	*cls;		// Current class
+  cups_array_t		*current;	// Current members
+  size_t		i,		// Looping var
+			j,		// Looping var
+			count,		// Number of current members
+			added,		// Number of members added
+			removed;	// Number of members removed
+  const char		*name;		// Member name
+  ipp_t			*request,	// IPP request
+			*response;	// IPP response
+  ipp_attribute_t	*names,		// member-names attribute
+			*uris,		// member-uris attribute
+			*attr;		// New member-uris attribute
+  char			uri[HTTP_MAX_URI],
+					// URI for printer/class
+			member_uri[HTTP_MAX_URI];
+					// URI for member printer
+  static const char * const pattrs[] =	// Requested attributes
+  {
+    "member-names",
+    "member-uris"
+  };
+
+
+  for (cls = (lpadmin_class_t *)cupsArrayGetFirst(*classes); cls; cls = (lpadmin_class_t *)cupsArrayGetNext(*classes))
+  {
+    // Build a Get-Printer-Attributes request, which requires the following
+    // attributes:
+    //
+    //   attributes-charset
+    //   attributes-natural-language
+    //   printer-uri
+    //   requested-attributes
+    //   requesting-user-name
+    httpAssembleURIf(HTTP_URI_CODING_ALL, uri, sizeof(uri), "ipp", NULL, "localhost", 0, "/classes/%s", cls->name);
+
+    request = ippNewRequest(IPP_OP_GET_PRINTER_ATTRIBUTES);
+
+    ippAddString(request, IPP_TAG_OPERATION, IPP_TAG_URI, "printer-uri", NULL, uri);
+    ippAddStrings(request, IPP_TAG_OPERATION, IPP_TAG_KEYWORD, "requested-attributes", sizeof(pattrs) / sizeof(pattrs[0]), NULL, pattrs);
+    ippAddString(request, IPP_TAG_OPERATION, IPP_TAG_NAME, "requesting-user-name", NULL, cupsGetUser());
+
+    response = cupsDoRequest(http, request, "/");
+
+    if (cupsLastError() > IPP_STATUS_OK_CONFLICTING && cupsLastError() != IPP_STATUS_ERROR_NOT_FOUND)
+    {
+      cupsLangPrintf(stderr, _("%s: %s"), "lpadmin", cupsLastErrorString());
+      ippDelete(response);
+      ret = 1;
+      continue;
+    }
+
+    names = ippFindAttribute(response, "member-names", IPP_TAG_NAME);
+    uris  = ippFindAttribute(response, "member-uris", IPP_TAG_URI);
+    count = ippGetCount(names);
+
+    if (ippGetCount(uris) != count)
+      uris = NULL;
+
+    // Compute the new set of members...
+    current = new_names();
+
+    for (i = 0; i < count; i ++)
+      cupsArrayAdd(current, (void *)ippGetString(names, i, NULL));
+
+    for (name = (const char *)cupsArrayGetFirst(cls->remove), removed = 0; name; name = (const char *)cupsArrayGetNext(cls->remove))
+    {
+      if (cupsArrayFind(current, (void *)name))
+        removed ++;
+      else
+	cupsLangPrintf(stderr, _("lpadmin: Printer %s is not a member of class %s."), name, cls->name);
+    }
+
+    for (name = (const char *)cupsArrayGetFirst(cls->add), added = 0; name; name = (const char *)cupsArrayGetNext(cls->add))
+    {
+      if (cupsArrayFind(current, (void *)name))
+	cupsLangPrintf(stderr, _("lpadmin: Printer %s is already a member of class %s."), name, cls->name);
+      else
+        added ++;
+    }
+
+    if (added == 0 && removed == 0)
+    {
+      // Nothing to do...
+      cupsArrayDelete(current);
+      ippDelete(response);
+      continue;
+    }
+
+    if (count + added == removed)
+    {
+      // Build a CUPS-Delete-Class request, which requires the following
+      // attributes:
+      //
+      //   attributes-charset
+      //   attributes-natural-language
+      //   printer-uri
+      //   requesting-user-name
+      request = ippNewRequest(IPP_OP_CUPS_DELETE_CLASS);
+
+      ippAddString(request, IPP_TAG_OPERATION, IPP_TAG_URI, "printer-uri", NULL, uri);
+      ippAddString(request, IPP_TAG_OPERATION, IPP_TAG_NAME, "requesting-user-name", NULL, cupsGetUser());
+    }
+    else
+    {
+      // Build a CUPS-Add-Modify-Class request, which requires the following
+      // attributes:
+      //
+      //   attributes-charset
+      //   attributes-natural-language
+      //   printer-uri
+      //   requesting-user-name
+      //   member-uris
+      request = ippNewRequest(IPP_OP_CUPS_ADD_MODIFY_CLASS);
+
+      ippAddString(request, IPP_TAG_OPERATION, IPP_TAG_URI, "printer-uri", NULL, uri);
+      ippAddString(request, IPP_TAG_OPERATION, IPP_TAG_NAME, "requesting-user-name", NULL, cupsGetUser());
+
+      // Keep the remaining members in order, followed by the new ones...
+      attr = ippAddStrings(request, IPP_TAG_PRINTER, IPP_TAG_URI, "member-uris", count + added - removed, NULL, NULL);
+
+      for (i = 0, j = 0; i < count; i ++)
+      {
+        name = ippGetString(names, i, NULL);
+
+        if (cupsArrayFind(cls->remove, (void *)name))
+          continue;
+
+        if (uris)
+        {
+          ippSetString(request, &attr, j ++, ippGetString(uris, i, NULL));
+        }
+        else
+        {
+	  httpAssembleURIf(HTTP_URI_CODING_ALL, member_uri, sizeof(member_uri), "ipp", NULL, "localhost", 0, "/printers/%s", name);
+          ippSetString(request, &attr, j ++, member_uri);
+        }
+      }
+
+      for (name = (const char *)cupsArrayGetFirst(cls->add); name; name = (const char *)cupsArrayGetNext(cls->add))
+      {
+        if (cupsArrayFind(current, (void *)name))
+          continue;
+
+	httpAssembleURIf(HTTP_URI_CODING_ALL, member_uri, sizeof(member_uri), "ipp", NULL, "localhost", 0, "/printers/%s", name);
+	ippSetString(request, &attr, j ++, member_uri);
+      }
+    }
+
+    cupsArrayDelete(current);
+    ippDelete(response);
+
+    // Then send the request...
+    ippDelete(cupsDoRequest(http, request, "/admin/"));
+
+    if (cupsLastError() > IPP_STATUS_OK_CONFLICTING)
+    {
+      cupsLangPrintf(stderr, _("%s: %s"), "lpadmin", cupsLastErrorString());
+      ret = 1;
+    }
+  }
+
+  cupsArrayDelete(*classes);
+  *classes = NULL;
+
+  return (ret);
+}
+
+
 //
 // 'usage()' - Show program usage and exit.
 //
@@ -1506,7 +3015,9 @@ usage(void)
                           "       lpadmin [options] -p destination\n"
                           "       lpadmin [options] -p destination -c class\n"
                           "       lpadmin [options] -p destination -r class\n"
-                          "       lpadmin [options] -x destination"));
+                          "       lpadmin [options] -x destination\n"
+                          "       lpadmin [options] --apply manifest\n"
+                          "       lpadmin [options] --export filename"));
   cupsLangPuts(stdout, _("Options:"));
   cupsLangPuts(stdout, _("-c class                Add the named destination to a class"));
   cupsLangPuts(stdout, _("-d destination          Set the named destination as the server default"));
@@ -1542,6 +3053,12 @@ usage(void)
   cupsLangPuts(stdout, _("-U username             Specify the username to use for authentication"));
   cupsLangPuts(stdout, _("-v device-uri           Specify the device URI for the printer"));
   cupsLangPuts(stdout, _("-x destination          Remove the named destination"));
+  cupsLangPuts(stdout, _("--apply manifest        Add or modify the printers and classes in a manifest"));
+  cupsLangPuts(stdout, _("--dry-run               Show the changes --apply would make"));
+  cupsLangPuts(stdout, _("--export filename       Save the printers and classes to a manifest"));
+  cupsLangPuts(stdout, _("--import manifest       Same as --apply"));
+  cupsLangPuts(stdout, _("--parallel count        Send up to count requests at the same time"));
+  cupsLangPuts(stdout, _("--type-cache            Remember printer types between runs"));
 
   exit(1);
 }
@@ -1573,3 +3090,58 @@ validate_name(const char *name)		// I - Name to check
 
   return ((ptr - name) < 128);
 }
+
+
+//
+// 'write_ppd_line()' - Write a line of the PPD file to the request.
+//
+
+static http_status_t			// O - HTTP status
+write_ppd_line(http_t     *http,	// I - Server connection
+               const char *format,	// I - Printf-style format string
+               ...)			// I - Additional arguments as needed
+{
+  va_list	ap;			// Argument pointer
+  char		buffer[2048];		// Line buffer
+  int		bytes;			// Length of line
+
+
+  va_start(ap, format);
+  bytes = vsnprintf(buffer, sizeof(buffer) - 1, format, ap);
+  va_end(ap);
+
+  if (bytes < 0)
+    return (HTTP_STATUS_ERROR);
+  else if ((size_t)bytes > (sizeof(buffer) - 2))
+    bytes = (int)sizeof(buffer) - 2;
+
+  buffer[bytes ++] = '\n';
+
+  return (cupsWriteRequestData(http, buffer, (size_t)bytes));
+}
+
+
+//
+// 'write_manifest_line()' - Write a manifest directive.
+//
+// Comment characters in the value are escaped.
+//
+
+static void
+write_manifest_line(
+    cups_file_t *fp,			// I - Manifest file
+    const char  *directive,		// I - Directive or `NULL` for value only
+    const char  *value)			// I - Value
+{
+  if (directive)
+    cupsFilePrintf(fp, "%s ", directive);
+
+  for (; *value; value ++)
+  {
+    if (*value == '#')
+      cupsFilePutChar(fp, '\\');
+    cupsFilePutChar(fp, *value);
+  }
+
+  cupsFilePutChar(fp, '\n');
+}
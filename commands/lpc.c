@@ -7,7 +7,43 @@
 // Licensed under Apache License v2.0.  See the file "LICENSE" for more information.
 //
 
-#include "localize.h"
+#include "conn.h"
+#include "fanout.h"
+#include "stream.h"
+
+
+//
+// Local types...
+//
+
+typedef struct lpc_command_s		// Batch command
+{
+  char		*command,		// Command name
+		*params;		// Parameters or `NULL`
+} lpc_command_t;
+
+typedef struct lpc_printer_s		// Printer information
+{
+  char		*name,			// printer-name
+		*device;		// device-uri
+  ipp_pstate_t	state;			// printer-state
+  int		accepting,		// printer-is-accepting-jobs
+		jobcount;		// queued-job-count
+} lpc_printer_t;
+
+
+//
+// Local globals...
+//
+
+static const char * const requested[] =	// Requested printer attributes
+{
+  "device-uri",
+  "printer-is-accepting-jobs",
+  "printer-name",
+  "printer-state",
+  "queued-job-count"
+};
 
 
 //
@@ -15,10 +51,18 @@
 //
 
 static int	compare_strings(const char *, const char *, size_t);
-static void	do_command(http_t *, const char *, const char *);
+static lpc_printer_t *copy_printer(lpc_printer_t *printer, void *data);
+static int	do_command(http_t *, const char *, const char *, cups_array_t *printers);
+static void	free_printer(lpc_printer_t *printer, void *data);
+static ipp_attribute_t *get_printer(ipp_t *response, ipp_attribute_t *attr, lpc_printer_t *printer);
+static cups_array_t *get_printers(http_t *http);
+static bool	match_dests(const char *dests, const char *printer);
+static bool	parse_line(char *line, char **params);
+static int	run_batch(http_t *http, const char *filename);
 static void	show_help(const char *);
+static void	show_printer(lpc_printer_t *printer);
 static void	show_prompt(const char *message);
-static void	show_status(http_t *, const char *);
+static int	show_status(http_t *, const char *, cups_array_t *printers);
 
 
 //
@@ -29,26 +73,100 @@ int
 main(int  argc,				// I - Number of command-line arguments
      char *argv[])			// I - Command-line arguments
 {
+  int		i,			// Looping var
+		status;			// Exit status
   http_t	*http;			// Connection to server
   char		line[1024],		// Input line from user
 		*params;		// Pointer to parameters
+  const char	*filename = NULL;	// Batch file
 
 
   localize_init(argv);
 
+  // Run the command on each server when more than one is named.  The servers
+  // cannot read commands from the terminal or standard input, so a command or
+  // batch file is required...
+  if (fanout_requested(argc, argv))
+  {
+    for (i = 1; i < argc; i ++)
+    {
+      if (fanout_skip_option(argc, argv, &i))
+        continue;
+      else if (!strcmp(argv[i], "-h"))
+        i ++;
+      else if (strncmp(argv[i], "-h", 2))
+        break;
+    }
+
+    if (i >= argc)
+    {
+      cupsLangPrintf(stderr, _("%s: Error - a command or \"-f\" option is required with more than one server."), argv[0]);
+      return (1);
+    }
+  }
+
+  if (fanout_servers(argc, argv, main, FANOUT_MERGE_RECORDS, &status))
+    return (status);
+
+  // Use the named server and batch file...
+  for (i = 1; i < argc; i ++)
+  {
+    if (fanout_skip_option(argc, argv, &i))
+    {
+      continue;
+    }
+    else if (!strcmp(argv[i], "-f"))
+    {
+      i ++;
+
+      if (i >= argc)
+      {
+        cupsLangPrintf(stderr, _("%s: Error - expected filename after \"-f\" option."), argv[0]);
+        return (1);
+      }
+
+      filename = argv[i];
+    }
+    else if (strncmp(argv[i], "-h", 2))
+    {
+      break;
+    }
+    else if (argv[i][2])
+    {
+      cupsSetServer(argv[i] + 2);
+    }
+    else if ((i + 1) < argc)
+    {
+      cupsSetServer(argv[++ i]);
+    }
+    else
+    {
+      cupsLangPrintf(stderr, _("%s: Error - expected hostname after \"-h\" option."), argv[0]);
+      return (1);
+    }
+  }
+
  /*
   * Connect to the scheduler...
   */
 
-  http = httpConnect(cupsGetServer(), ippGetPort(), /*addrlist*/NULL, AF_UNSPEC, cupsGetEncryption(), /*blocking*/true, /*msec*/30000, /*cancel*/NULL);
+  http = conn_get_default();
 
-  if (argc > 1)
+  if (i < argc)
   {
    /*
     * Process a single command on the command-line...
     */
 
-    do_command(http, argv[1], argv[2]);
+    return (do_command(http, argv[i], argv[i + 1], NULL));
+  }
+  else if (filename || !isatty(0))
+  {
+   /*
+    * Run a script of commands...
+    */
+
+    return (run_batch(http, filename));
   }
   else
   {
@@ -59,26 +177,7 @@ main(int  argc,				// I - Number of command-line arguments
     show_prompt(_("lpc> "));
     while (fgets(line, sizeof(line), stdin) != NULL)
     {
-     /*
-      * Strip trailing whitespace...
-      */
-
-      for (params = line + strlen(line) - 1; params >= line;)
-        if (!isspace(*params & 255))
-	  break;
-	else
-	  *params-- = '\0';
-
-     /*
-      * Strip leading whitespace...
-      */
-
-      for (params = line; isspace(*params & 255); params ++);
-
-      if (params > line)
-        cupsCopyString(line, params, sizeof(line));
-
-      if (!line[0])
+      if (!parse_line(line, &params))
       {
        /*
         * Nothing left, just show a prompt...
@@ -88,21 +187,6 @@ main(int  argc,				// I - Number of command-line arguments
 	continue;
       }
 
-     /*
-      * Find any options in the string...
-      */
-
-      for (params = line; *params != '\0'; params ++)
-        if (isspace(*params & 255))
-	  break;
-
-     /*
-      * Remove whitespace between the command and parameters...
-      */
-
-      while (isspace(*params & 255))
-        *params++ = '\0';
-
      /*
       * The "quit" and "exit" commands exit; otherwise, process as needed...
       */
@@ -111,10 +195,7 @@ main(int  argc,				// I - Number of command-line arguments
           !compare_strings(line, "exit", 2))
         break;
 
-      if (*params == '\0')
-        do_command(http, line, NULL);
-      else
-        do_command(http, line, params);
+      do_command(http, line, params, NULL);
 
      /*
       * Put another prompt out to the user...
@@ -124,12 +205,6 @@ main(int  argc,				// I - Number of command-line arguments
     }
   }
 
- /*
-  * Close the connection to the server and return...
-  */
-
-  httpClose(http);
-
   return (0);
 }
 
@@ -154,23 +229,379 @@ compare_strings(const char *s,		// I - Command-line string
 }
 
 
+//
+// 'copy_printer()' - Copy printer information for the printer list.
+//
+
+static lpc_printer_t *			// O - New printer or `NULL` on error
+copy_printer(lpc_printer_t *printer,	// I - Printer information
+             void          *data)	// I - Callback data (unused)
+{
+  lpc_printer_t	*copy;			// New printer
+
+
+  (void)data;
+
+  if ((copy = (lpc_printer_t *)calloc(1, sizeof(lpc_printer_t))) == NULL)
+    return (NULL);
+
+  *copy        = *printer;
+  copy->name   = strdup(printer->name);
+  copy->device = strdup(printer->device);
+
+  if (!copy->name || !copy->device)
+  {
+    free_printer(copy, NULL);
+    return (NULL);
+  }
+
+  return (copy);
+}
+
+
 //
 // 'do_command()' - Do an lpc command...
 //
 
-static void
-do_command(http_t     *http,		// I - HTTP connection to server
-           const char *command,		// I - Command string
-	   const char *params)		// I - Parameters for command
+static int				// O - 0 on success, 1 on error
+do_command(http_t       *http,		// I - HTTP connection to server
+           const char   *command,	// I - Command string
+	   const char   *params,	// I - Parameters for command
+	   cups_array_t *printers)	// I - Printer list or `NULL` to ask the server
 {
   if (!compare_strings(command, "status", 4))
-    show_status(http, params);
+    return (show_status(http, params, printers));
   else if (!compare_strings(command, "help", 1) || !strcmp(command, "?"))
     show_help(params);
   else
     cupsLangPrintf(stdout,
                     _("%s is not implemented by the CUPS version of lpc."),
 		    command);
+
+  return (0);
+}
+
+
+//
+// 'free_printer()' - Free printer information.
+//
+
+static void
+free_printer(lpc_printer_t *printer,	// I - Printer information
+             void          *data)	// I - Callback data (unused)
+{
+  (void)data;
+
+  free(printer->name);
+  free(printer->device);
+  free(printer);
+}
+
+
+//
+// 'get_printer()' - Get the attributes of a printer.
+//
+
+static ipp_attribute_t *		// O - Attribute after the printer
+get_printer(ipp_t           *response,	// I - IPP response
+            ipp_attribute_t *attr,	// I - First attribute of printer
+            lpc_printer_t   *printer)	// O - Printer information
+{
+  printer->name      = NULL;
+  printer->device    = "file:/dev/null";
+  printer->state     = IPP_PSTATE_IDLE;
+  printer->accepting = 1;
+  printer->jobcount  = 0;
+
+  while (attr != NULL && ippGetGroupTag(attr) == IPP_TAG_PRINTER)
+  {
+    const char *name = ippGetName(attr);
+    ipp_tag_t value_tag = ippGetValueTag(attr);
+
+    if (!strcmp(name, "device-uri") && value_tag == IPP_TAG_URI)
+      printer->device = (char *)ippGetString(attr, 0, NULL);
+    else if (!strcmp(name, "printer-is-accepting-jobs") && value_tag == IPP_TAG_BOOLEAN)
+      printer->accepting = ippGetBoolean(attr, 0);
+    else if (!strcmp(name, "printer-name") && value_tag == IPP_TAG_NAME)
+      printer->name = (char *)ippGetString(attr, 0, NULL);
+    else if (!strcmp(name, "printer-state") && value_tag == IPP_TAG_ENUM)
+      printer->state = (ipp_pstate_t)ippGetInteger(attr, 0);
+    else if (!strcmp(name, "queued-job-count") && value_tag == IPP_TAG_INTEGER)
+      printer->jobcount = ippGetInteger(attr, 0);
+
+    attr = ippGetNextAttribute(response);
+  }
+
+  return (attr);
+}
+
+
+//
+// 'get_printers()' - Get the list of printers.
+//
+// The printers are returned in the order the server lists them.
+//
+
+static cups_array_t *			// O - Printers or `NULL` on error
+get_printers(http_t *http)		// I - HTTP connection to server
+{
+  cups_array_t	*printers;		// Printers
+  ipp_t		*request,		// IPP Request
+		*response;		// IPP Response
+  stream_t	*stream;		// Streaming response
+  ipp_attribute_t *attr;		// Current attribute
+  lpc_printer_t	printer;		// Current printer
+
+
+  if (http == NULL)
+    return (NULL);
+
+  if ((printers = cupsArrayNew(NULL, NULL, NULL, 0, (cups_acopy_cb_t)copy_printer, (cups_afree_cb_t)free_printer)) == NULL)
+    return (NULL);
+
+  // Build a CUPS-Get-Printers request, which requires the following attributes:
+  //
+  //   attributes-charset
+  //   attributes-natural-language
+  request = ippNewRequest(IPP_OP_CUPS_GET_PRINTERS);
+
+  ippAddStrings(request, IPP_TAG_OPERATION, IPP_TAG_KEYWORD, "requested-attributes", sizeof(requested) / sizeof(requested[0]), NULL, requested);
+
+  // Do the request and copy printers as they are received...
+  stream = stream_open(conn_get_agent(http), request, "/");
+
+  while ((response = stream_next(stream)) != NULL)
+  {
+    for (attr = ippGetFirstAttribute(response); attr != NULL; attr = ippGetNextAttribute(response))
+    {
+      // Skip leading attributes until we hit a printer...
+      while (attr != NULL && ippGetGroupTag(attr) != IPP_TAG_PRINTER)
+        attr = ippGetNextAttribute(response);
+
+      if (attr == NULL)
+        break;
+
+      attr = get_printer(response, attr, &printer);
+
+      if (printer.name != NULL && !cupsArrayAdd(printers, &printer))
+      {
+        stream_close(stream);
+        cupsArrayDelete(printers);
+        return (NULL);
+      }
+
+      if (attr == NULL)
+        break;
+    }
+  }
+
+  // Don't keep a partial list if the stream failed...
+  if (stream_get_status(stream) > IPP_STATUS_OK_CONFLICTING)
+  {
+    cupsLangPrintf(stderr, "%s: %s", "lpc", stream_get_status_message(stream));
+    stream_close(stream);
+    cupsArrayDelete(printers);
+    return (NULL);
+  }
+
+  stream_close(stream);
+
+  return (printers);
+}
+
+
+//
+// 'match_dests()' - See if a printer is in a list of destinations.
+//
+
+static bool				// O - `true` on match, `false` otherwise
+match_dests(const char *dests,		// I - Destinations or `NULL` for all
+            const char *printer)	// I - Printer name
+{
+  const char	*dptr,			// Pointer into destination list
+		*ptr;			// Pointer into printer name
+
+
+  // A single 'all' printer name is special, meaning all printers.
+  if (dests == NULL || !strcmp(dests, "all"))
+    return (true);
+
+  for (dptr = dests; *dptr != '\0';)
+  {
+    // Skip leading whitespace and commas...
+    while (isspace(*dptr & 255) || *dptr == ',')
+      dptr ++;
+
+    if (*dptr == '\0')
+      break;
+
+    // Compare names...
+    for (ptr = printer; *ptr != '\0' && *dptr != '\0' && *ptr == *dptr; ptr ++, dptr ++)
+    {
+      // do nothing
+    }
+
+    if (*ptr == '\0' && (*dptr == '\0' || *dptr == ',' || isspace(*dptr & 255)))
+      return (true);
+
+    // Skip trailing junk...
+    while (!isspace(*dptr & 255) && *dptr != '\0')
+      dptr ++;
+    while (isspace(*dptr & 255) || *dptr == ',')
+      dptr ++;
+  }
+
+  return (false);
+}
+
+
+//
+// 'parse_line()' - Split a command line into the command and parameters.
+//
+
+static bool				// O - `true` if there is a command, `false` if blank
+parse_line(char *line,			// I - Input line, becomes the command
+           char **params)		// O - Parameters or `NULL` for none
+{
+  char	*ptr;				// Pointer into line
+
+
+  // Strip trailing whitespace...
+  for (ptr = line + strlen(line) - 1; ptr >= line;)
+  {
+    if (!isspace(*ptr & 255))
+      break;
+    else
+      *ptr-- = '\0';
+  }
+
+  // Strip leading whitespace...
+  for (ptr = line; isspace(*ptr & 255); ptr ++);
+
+  if (ptr > line)
+    memmove(line, ptr, strlen(ptr) + 1);
+
+  if (!line[0])
+    return (false);
+
+  // Find any options in the string...
+  for (ptr = line; *ptr != '\0'; ptr ++)
+  {
+    if (isspace(*ptr & 255))
+      break;
+  }
+
+  // Remove whitespace between the command and parameters...
+  while (isspace(*ptr & 255))
+    *ptr++ = '\0';
+
+  *params = *ptr ? ptr : NULL;
+
+  return (true);
+}
+
+
+//
+// 'run_batch()' - Run commands from a file or the standard input.
+//
+// All of the commands are read before any are run, so that the printer list
+// can be fetched once and shared by every "status" command in the batch.
+// Blank lines and lines starting with "#" are ignored, and the "exit" and
+// "quit" commands end the batch.
+//
+
+static int				// O - Exit status
+run_batch(http_t     *http,		// I - HTTP connection to server
+          const char *filename)		// I - Batch file or `NULL` for the standard input
+{
+  cups_file_t	*fp;			// Batch file
+  char		line[1024],		// Line from file
+		*params;		// Pointer to parameters
+  lpc_command_t	*commands = NULL,	// Commands
+		*temp;			// New commands
+  size_t	i,			// Looping var
+		num_commands = 0,	// Number of commands
+		alloc_commands = 0;	// Allocated commands
+  bool		need_printers = false;	// Any "status" commands?
+  cups_array_t	*printers = NULL;	// Printer list
+  int		status = 0;		// Exit status
+  bool		failed = false;		// Did a command fail?
+
+
+  // Read the commands...
+  if (filename)
+  {
+    if ((fp = cupsFileOpen(filename, "r")) == NULL)
+    {
+      cupsLangPrintf(stderr, _("%s: Unable to open \"%s\": %s"), "lpc", filename, strerror(errno));
+      return (1);
+    }
+  }
+  else
+  {
+    fp = cupsFileStdin();
+  }
+
+  while (cupsFileGets(fp, line, sizeof(line)))
+  {
+    if (!parse_line(line, &params) || line[0] == '#')
+      continue;
+
+    if (!compare_strings(line, "quit", 1) || !compare_strings(line, "exit", 2))
+      break;
+
+    if (num_commands >= alloc_commands)
+    {
+      if ((temp = (lpc_command_t *)realloc(commands, (alloc_commands + 32) * sizeof(lpc_command_t))) == NULL)
+      {
+        cupsLangPrintf(stderr, _("%s: Unable to allocate memory."), "lpc");
+        status = 1;
+        break;
+      }
+
+      commands       = temp;
+      alloc_commands += 32;
+    }
+
+    commands[num_commands].command = strdup(line);
+    commands[num_commands].params  = params ? strdup(params) : NULL;
+
+    if (!commands[num_commands].command || (params && !commands[num_commands].params))
+    {
+      free(commands[num_commands].command);
+      cupsLangPrintf(stderr, _("%s: Unable to allocate memory."), "lpc");
+      status = 1;
+      break;
+    }
+
+    if (!compare_strings(line, "status", 4))
+      need_printers = true;
+
+    num_commands ++;
+  }
+
+  if (filename)
+    cupsFileClose(fp);
+
+  // Get the printer list once for all of the "status" commands.  If that
+  // fails, each "status" command asks the server again...
+  if (!status && need_printers && (printers = get_printers(http)) == NULL)
+    failed = true;
+
+  // Then run the commands in order...
+  for (i = 0; i < num_commands; i ++)
+  {
+    if (!status && do_command(http, commands[i].command, commands[i].params, printers))
+      failed = true;
+
+    free(commands[i].command);
+    free(commands[i].params);
+  }
+
+  free(commands);
+  cupsArrayDelete(printers);
+
+  return (failed ? 1 : status);
 }
 
 
@@ -222,36 +653,79 @@ show_prompt(const char *message)	// I - Message string to use
 
 
 //
-// 'show_status()' - Show printers.
+// 'show_printer()' - Show the status of a printer.
 //
 
 static void
-show_status(http_t     *http,		// I - HTTP connection to server
-            const char *dests)		// I - Destinations
+show_printer(lpc_printer_t *printer)	// I - Printer information
+{
+  printf("%s:\n", printer->name);
+  if (!strncmp(printer->device, "file:", 5))
+  {
+    cupsLangPrintf(stdout, _("\tprinter is on device \'%s\' speed -1"), printer->device + 5);
+  }
+  else
+  {
+    // Just show the scheme...
+    char scheme[32], *sptr;		// Scheme
+
+    cupsCopyString(scheme, printer->device, sizeof(scheme));
+    if ((sptr = strchr(scheme, ':')) != NULL)
+      *sptr = '\0';
+
+    cupsLangPrintf(stdout, _("\tprinter is on device \'%s\' speed -1"), scheme);
+  }
+
+  if (printer->accepting)
+    cupsLangPuts(stdout, _("\tqueuing is enabled"));
+  else
+    cupsLangPuts(stdout, _("\tqueuing is disabled"));
+
+  if (printer->state != IPP_PSTATE_STOPPED)
+    cupsLangPuts(stdout, _("\tprinting is enabled"));
+  else
+    cupsLangPuts(stdout, _("\tprinting is disabled"));
+
+  if (printer->jobcount == 0)
+    cupsLangPuts(stdout, _("\tno entries"));
+  else
+    cupsLangPrintf(stdout, _("\t%d entries"), printer->jobcount);
+
+  cupsLangPuts(stdout, _("\tdaemon present"));
+}
+
+
+//
+// 'show_status()' - Show printers.
+//
+
+static int				// O - 0 on success, 1 on error
+show_status(http_t       *http,		// I - HTTP connection to server
+            const char   *dests,	// I - Destinations
+            cups_array_t *printers)	// I - Printer list or `NULL` to ask the server
 {
   ipp_t		*request,		// IPP Request
 		*response;		// IPP Response
+  stream_t	*stream;		// Streaming response
   ipp_attribute_t *attr;		// Current attribute
-  const char	*printer,		// Printer name
-		*device;		// Device URI
-  ipp_pstate_t	pstate;			// Printer state
-  int		accepting;		// Is printer accepting jobs?
-  int		jobcount;		// Count of current jobs
-  const char	*dptr,			// Pointer into destination list
-		*ptr;			// Pointer into printer name
-  int		match;			// Non-zero if this job matches
-  static const char *requested[] =	// Requested attributes
-		{
-		  "device-uri",
-		  "printer-is-accepting-jobs",
-		  "printer-name",
-		  "printer-state",
-		  "queued-job-count"
-		};
+  lpc_printer_t	printer,		// Current printer
+		*cached;		// Printer from list
+
+
+  // Use the printer list from a batch, if any...
+  if (printers)
+  {
+    for (cached = (lpc_printer_t *)cupsArrayGetFirst(printers); cached; cached = (lpc_printer_t *)cupsArrayGetNext(printers))
+    {
+      if (match_dests(dests, cached->name))
+        show_printer(cached);
+    }
 
+    return (0);
+  }
 
   if (http == NULL)
-    return;
+    return (1);
 
   //
   // Build a CUPS-Get-Printers request, which requires the following attributes:
@@ -262,10 +736,11 @@ show_status(http_t     *http,		// I - HTTP connection to server
 
   ippAddStrings(request, IPP_TAG_OPERATION, IPP_TAG_KEYWORD, "requested-attributes", sizeof(requested) / sizeof(requested[0]), NULL, requested);
 
-  // Do the request and get back a response...
-  if ((response = cupsDoRequest(http, request, "/")) != NULL)
+  // Do the request and display printers as they are received...
+  stream = stream_open(conn_get_agent(http), request, "/");
+
+  while ((response = stream_next(stream)) != NULL)
   {
-    // Loop through the printers returned in the list and display their status...
     for (attr = ippGetFirstAttribute(response); attr != NULL; attr = ippGetNextAttribute(response))
     {
       // Skip leading attributes until we hit a job...
@@ -276,33 +751,10 @@ show_status(http_t     *http,		// I - HTTP connection to server
         break;
 
       // Pull the needed attributes from this job...
-      printer   = NULL;
-      device    = "file:/dev/null";
-      pstate    = IPP_PSTATE_IDLE;
-      jobcount  = 0;
-      accepting = 1;
-
-      while (attr != NULL && ippGetGroupTag(attr) == IPP_TAG_PRINTER)
-      {
-        const char *name = ippGetName(attr);
-        ipp_tag_t value_tag = ippGetValueTag(attr);
-
-        if (!strcmp(name, "device-uri") && value_tag == IPP_TAG_URI)
-	  device = ippGetString(attr, 0, NULL);
-        else if (!strcmp(name, "printer-is-accepting-jobs") && value_tag == IPP_TAG_BOOLEAN)
-	  accepting = ippGetBoolean(attr, 0);
-        else if (!strcmp(name, "printer-name") && value_tag == IPP_TAG_NAME)
-	  printer = ippGetString(attr, 0, NULL);
-        else if (!strcmp(name, "printer-state") && value_tag == IPP_TAG_ENUM)
-	  pstate = (ipp_pstate_t)ippGetInteger(attr, 0);
-        else if (!strcmp(name, "queued-job-count") && value_tag == IPP_TAG_INTEGER)
-	  jobcount = ippGetInteger(attr, 0);
-
-        attr = ippGetNextAttribute(response);
-      }
+      attr = get_printer(response, attr, &printer);
 
       // See if we have everything needed...
-      if (printer == NULL)
+      if (printer.name == NULL)
       {
         if (attr == NULL)
 	  break;
@@ -310,90 +762,23 @@ show_status(http_t     *http,		// I - HTTP connection to server
           continue;
       }
 
-      // A single 'all' printer name is special, meaning all printers.
-      if (dests != NULL && !strcmp(dests, "all"))
-        dests = NULL;
-
-      // See if this is a printer we're interested in...
-      match = dests == NULL;
-
-      if (dests != NULL)
-      {
-        for (dptr = dests; *dptr != '\0';)
-	{
-	  // Skip leading whitespace and commas...
-	  while (isspace(*dptr & 255) || *dptr == ',')
-	    dptr ++;
-
-	  if (*dptr == '\0')
-	    break;
-
-          // Compare names...
-	  for (ptr = printer; *ptr != '\0' && *dptr != '\0' && *ptr == *dptr; ptr ++, dptr ++)
-	  {
-	    // do nothing
-	  }
-
-          if (*ptr == '\0' && (*dptr == '\0' || *dptr == ',' || isspace(*dptr & 255)))
-	  {
-	    match = 1;
-	    break;
-	  }
-
-          // Skip trailing junk...
-          while (!isspace(*dptr & 255) && *dptr != '\0')
-	    dptr ++;
-	  while (isspace(*dptr & 255) || *dptr == ',')
-	    dptr ++;
-
-	  if (*dptr == '\0')
-	    break;
-        }
-      }
-
       // Display the printer entry if needed...
-      if (match)
-      {
-        // Display it...
-        printf("%s:\n", printer);
-	if (!strncmp(device, "file:", 5))
-	{
-	  cupsLangPrintf(stdout, _("\tprinter is on device \'%s\' speed -1"), device + 5);
-	}
-	else
-	{
-	  // Just show the scheme...
-	  char scheme[32], *sptr;	// Scheme
-
-          cupsCopyString(scheme, device, sizeof(scheme));
-	  if ((sptr = strchr(scheme, ':')) != NULL)
-	    *sptr = '\0';
-
-	  cupsLangPrintf(stdout, _("\tprinter is on device \'%s\' speed -1"), scheme);
-	}
-
-        if (accepting)
-	  cupsLangPuts(stdout, _("\tqueuing is enabled"));
-	else
-	  cupsLangPuts(stdout, _("\tqueuing is disabled"));
-
-        if (pstate != IPP_PSTATE_STOPPED)
-	  cupsLangPuts(stdout, _("\tprinting is enabled"));
-	else
-	  cupsLangPuts(stdout, _("\tprinting is disabled"));
-
-	if (jobcount == 0)
-	  cupsLangPuts(stdout, _("\tno entries"));
-	else
-	  cupsLangPrintf(stdout, _("\t%d entries"), jobcount);
-
-	cupsLangPuts(stdout, _("\tdaemon present"));
-      }
+      if (match_dests(dests, printer.name))
+        show_printer(&printer);
 
       if (attr == NULL)
         break;
     }
+  }
 
-    ippDelete(response);
+  if (stream_get_status(stream) > IPP_STATUS_OK_CONFLICTING)
+  {
+    cupsLangPrintf(stderr, "%s: %s", "lpc", stream_get_status_message(stream));
+    stream_close(stream);
+    return (1);
   }
+
+  stream_close(stream);
+
+  return (0);
 }
@@ -9,14 +9,46 @@
 // information.
 //
 
-#include "localize.h"
+#include "conn.h"
+#include "pool.h"
+
+
+//
+// Local types...
+//
+
+typedef struct lpmove_job_s		// Job to rebalance
+{
+  int		id;			// job-id
+  int		k_octets;		// job-k-octets
+} lpmove_job_t;
+
+typedef struct lpmove_name_s		// Name cache entry
+{
+  char		*name;			// Name
+  bool		is_dest;		// Is this a destination?
+} lpmove_name_t;
+
+typedef struct lpmove_target_s		// Rebalance target
+{
+  const char	*name;			// Destination name
+  int		num_jobs;		// Number of queued jobs
+  long		k_octets;		// Total k-octets of queued jobs
+} lpmove_target_t;
 
 
 //
 // Local functions...
 //
 
+static int	compare_jobs(const void *a, const void *b);
+static int	compare_names(lpmove_name_t *a, lpmove_name_t *b, void *data);
+static void	free_name(lpmove_name_t *n, void *data);
+static bool	is_dest(http_t *http, cups_array_t *names, const char *name);
 static int	move_job(http_t *http, const char *src, int jobid, const char *dest);
+static ipp_t	*new_get_jobs(const char *printer);
+static ipp_t	*new_move_job(const char *src, int jobid, const char *dest);
+static int	rebalance_jobs(const char *src, char *targets, bool by_size, size_t parallel);
 static void	usage(void) _CUPS_NORETURN;
 
 
@@ -33,20 +65,33 @@ main(int  argc,				// I - Number of command-line arguments
   const char	*opt,			// Option pointer
 		*job;			// Job name
   int		jobid;			// Job ID
-  size_t	num_dests;		// Number of destinations
-  cups_dest_t	*dests;			// Destinations
+  size_t	j,			// Looping var
+		num_args;		// Number of job/queue arguments
+  char		**args;			// Job/queue arguments
+  cups_array_t	*names;			// Name cache
   const char	*src,			// Original queue
 		*dest;			// New destination
+  int		status;			// Exit status
+  char		*targets;		// Rebalance targets
+  bool		by_size;		// Rebalance by size?
+  size_t	parallel;		// Number of concurrent requests
 
 
   localize_init(argv);
 
   dest      = NULL;
-  dests     = NULL;
-  job       = NULL;
-  jobid     = 0;
-  num_dests = 0;
+  num_args  = 0;
   src       = NULL;
+  status    = 0;
+  targets   = NULL;
+  by_size   = false;
+  parallel  = POOL_MAX_CONNECTIONS;
+
+  if ((args = calloc((size_t)argc, sizeof(char *))) == NULL)
+  {
+    cupsLangPuts(stderr, _("lpmove: Unable to allocate memory."));
+    return (1);
+  }
 
   for (i = 1; i < argc; i ++)
   {
@@ -54,6 +99,39 @@ main(int  argc,				// I - Number of command-line arguments
     {
       usage();
     }
+    else if (!strcmp(argv[i], "--parallel"))
+    {
+      i ++;
+      if (i >= argc || atoi(argv[i]) < 1)
+      {
+	cupsLangPrintf(stderr, _("%s: Error - expected count after \"--parallel\" option."), "lpmove");
+	usage();
+      }
+
+      parallel = (size_t)atoi(argv[i]);
+    }
+    else if (!strcmp(argv[i], "--policy"))
+    {
+      i ++;
+      if (i >= argc || (strcmp(argv[i], "least-loaded") && strcmp(argv[i], "size")))
+      {
+	cupsLangPrintf(stderr, _("%s: Error - expected \"least-loaded\" or \"size\" after \"--policy\" option."), "lpmove");
+	usage();
+      }
+
+      by_size = !strcmp(argv[i], "size");
+    }
+    else if (!strcmp(argv[i], "--rebalance"))
+    {
+      if ((i + 2) >= argc || num_args > 0 || src)
+      {
+	cupsLangPrintf(stderr, _("%s: Error - expected source and destinations after \"--rebalance\" option."), "lpmove");
+	usage();
+      }
+
+      src     = argv[++ i];
+      targets = argv[++ i];
+    }
     else if (argv[i][0] == '-')
     {
       for (opt = argv[i] + 1; *opt; opt ++)
@@ -90,41 +168,168 @@ main(int  argc,				// I - Number of command-line arguments
 	}
       }
     }
-    else if (!jobid && !src)
+    else if (targets)
     {
-      if (num_dests == 0)
-        num_dests = cupsGetDests(CUPS_HTTP_DEFAULT, &dests);
-
-      if ((job = strrchr(argv[i], '-')) != NULL && cupsGetDest(argv[i], NULL, num_dests, dests) == NULL)
-        jobid = atoi(job + 1);
-      else if (isdigit(argv[i][0] & 255) && !cupsGetDest(argv[i], NULL, num_dests, dests))
-        jobid = atoi(argv[i]);
-      else
-        src = argv[i];
-    }
-    else if (dest == NULL)
-    {
-      dest = argv[i];
+      cupsLangPrintf(stderr, _("lpmove: Unknown argument \"%s\"."), argv[i]);
+      usage();
     }
     else
     {
-      cupsLangPrintf(stderr, _("lpmove: Unknown argument \"%s\"."), argv[i]);
-      usage();
+      // Jobs/sources and the destination, which comes last...
+      args[num_args ++] = argv[i];
     }
   }
 
-  if ((!jobid && !src) || !dest)
+  if (targets)
+  {
+    free(args);
+
+    return (rebalance_jobs(src, targets, by_size, parallel));
+  }
+
+  if (num_args < 2)
     usage();
 
-  http = httpConnect(cupsGetServer(), ippGetPort(), /*addrlist*/NULL, AF_UNSPEC, cupsGetEncryption(), /*blocking*/true, /*msec*/30000, /*cancel*/NULL);
+  dest = args[-- num_args];
 
-  if (http == NULL)
+  if ((http = conn_get_default()) == NULL)
   {
     cupsLangPrintf(stderr, _("lpmove: Unable to connect to server: %s"), strerror(errno));
     return (1);
   }
 
-  return (move_job(http, src, jobid, dest));
+  // Move each job or queue in turn.  Arguments that look like job IDs
+  // ("123" or "queue-123") are checked against the server with a single
+  // Get-Printer-Attributes request, and the answers are cached...
+  names = cupsArrayNew((cups_array_cb_t)compare_names, NULL, NULL, 0, NULL, (cups_afree_cb_t)free_name);
+
+  for (j = 0; j < num_args; j ++)
+  {
+    src   = NULL;
+    jobid = 0;
+
+    if ((job = strrchr(args[j], '-')) != NULL && isdigit(job[1] & 255) && job[1 + strspn(job + 1, "0123456789")] == '\0' && !is_dest(http, names, args[j]))
+      jobid = atoi(job + 1);
+    else if (args[j][strspn(args[j], "0123456789")] == '\0' && !is_dest(http, names, args[j]))
+      jobid = atoi(args[j]);
+    else
+      src = args[j];
+
+    if (move_job(http, src, jobid, dest))
+      status = 1;
+  }
+
+  cupsArrayDelete(names);
+  free(args);
+
+  return (status);
+}
+
+
+//
+// 'compare_jobs()' - Compare two jobs by size, largest first.
+//
+
+static int				// O - Result of comparison
+compare_jobs(const void *a,		// I - First job
+             const void *b)		// I - Second job
+{
+  const lpmove_job_t	*ja = (const lpmove_job_t *)a,
+					// First job
+			*jb = (const lpmove_job_t *)b;
+					// Second job
+
+
+  if (ja->k_octets != jb->k_octets)
+    return (jb->k_octets - ja->k_octets);
+  else
+    return (ja->id - jb->id);
+}
+
+
+//
+// 'compare_names()' - Compare two name cache entries.
+//
+
+static int				// O - Result of comparison
+compare_names(lpmove_name_t *a,		// I - First entry
+              lpmove_name_t *b,		// I - Second entry
+              void          *data)	// I - Callback data (unused)
+{
+  (void)data;
+
+  return (strcasecmp(a->name, b->name));
+}
+
+
+//
+// 'free_name()' - Free a name cache entry.
+//
+
+static void
+free_name(lpmove_name_t *n,		// I - Entry
+          void          *data)		// I - Callback data (unused)
+{
+  (void)data;
+
+  free(n->name);
+  free(n);
+}
+
+
+//
+// 'is_dest()' - Determine whether a name is a destination on the server.
+//
+
+static bool				// O - `true` if a destination, `false` otherwise
+is_dest(http_t       *http,		// I - HTTP connection to server
+        cups_array_t *names,		// I - Name cache
+        const char   *name)		// I - Name
+{
+  lpmove_name_t	key,			// Search key
+		*n;			// Cache entry
+  ipp_t		*request;		// IPP request
+  char		uri[HTTP_MAX_URI];	// printer-uri
+
+
+  key.name = (char *)name;
+
+  if ((n = (lpmove_name_t *)cupsArrayFind(names, &key)) != NULL)
+    return (n->is_dest);
+
+  // Build a Get-Printer-Attributes request, which requires the following
+  // attributes:
+  //
+  //   attributes-charset
+  //   attributes-natural-language
+  //   printer-uri
+  //   requested-attributes
+  //   requesting-user-name
+  request = ippNewRequest(IPP_OP_GET_PRINTER_ATTRIBUTES);
+
+  httpAssembleURIf(HTTP_URI_CODING_ALL, uri, sizeof(uri), "ipp", NULL, "localhost", 0, "/printers/%s", name);
+  ippAddString(request, IPP_TAG_OPERATION, IPP_TAG_URI, "printer-uri", NULL, uri);
+  ippAddString(request, IPP_TAG_OPERATION, IPP_TAG_KEYWORD, "requested-attributes", NULL, "printer-name");
+  ippAddString(request, IPP_TAG_OPERATION, IPP_TAG_NAME, "requesting-user-name", NULL, cupsGetUser());
+
+  ippDelete(cupsDoRequest(http, request, "/"));
+
+  if ((n = (lpmove_name_t *)calloc(1, sizeof(lpmove_name_t))) != NULL)
+  {
+    if ((n->name = strdup(name)) == NULL)
+    {
+      free(n);
+      return (cupsLastError() <= IPP_STATUS_OK_CONFLICTING);
+    }
+
+    n->is_dest = cupsLastError() <= IPP_STATUS_OK_CONFLICTING;
+
+    cupsArrayAdd(names, n);
+
+    return (n->is_dest);
+  }
+
+  return (cupsLastError() <= IPP_STATUS_OK_CONFLICTING);
 }
 
 
@@ -137,15 +342,79 @@ move_job(http_t     *http,		// I - HTTP connection to server
          const char *src,		// I - Source queue
          int        jobid,		// I - Job ID
 	 const char *dest)		// I - Destination queue
+{
+  if (!http)
+    return (1);
+
+  // Do the request and get back a response...
+  ippDelete(cupsDoRequest(http, new_move_job(src, jobid, dest), "/jobs"));
+
+  if (cupsLastError() > IPP_STATUS_OK_CONFLICTING)
+  {
+    if (jobid)
+      cupsLangPrintf(stderr, _("lpmove: Unable to move job %d: %s"), jobid, cupsLastErrorString());
+    else
+      cupsLangPrintf(stderr, "lpmove: %s", cupsLastErrorString());
+    return (1);
+  }
+  else
+  {
+    return (0);
+  }
+}
+
+
+//
+// 'new_get_jobs()' - Create a Get-Jobs request for the active jobs on a queue.
+//
+
+static ipp_t *				// O - IPP request
+new_get_jobs(const char *printer)	// I - Printer name
+{
+  ipp_t		*request;		// IPP request
+  char		uri[HTTP_MAX_URI];	// printer-uri
+  static const char * const jattrs[] =	// Attributes we need for jobs...
+  {
+    "job-id",
+    "job-k-octets",
+    "job-state"
+  };
+
+
+  // Build a Get-Jobs request, which requires the following attributes:
+  //
+  //   attributes-charset
+  //   attributes-natural-language
+  //   printer-uri
+  //   requested-attributes
+  //   requesting-user-name
+  //   which-jobs
+  request = ippNewRequest(IPP_OP_GET_JOBS);
+
+  httpAssembleURIf(HTTP_URI_CODING_ALL, uri, sizeof(uri), "ipp", NULL, "localhost", 0, "/printers/%s", printer);
+  ippAddString(request, IPP_TAG_OPERATION, IPP_TAG_URI, "printer-uri", NULL, uri);
+  ippAddStrings(request, IPP_TAG_OPERATION, IPP_TAG_KEYWORD, "requested-attributes", sizeof(jattrs) / sizeof(jattrs[0]), NULL, jattrs);
+  ippAddString(request, IPP_TAG_OPERATION, IPP_TAG_NAME, "requesting-user-name", NULL, cupsGetUser());
+  ippAddString(request, IPP_TAG_OPERATION, IPP_TAG_KEYWORD, "which-jobs", NULL, "not-completed");
+
+  return (request);
+}
+
+
+//
+// 'new_move_job()' - Create a CUPS-Move-Job request.
+//
+
+static ipp_t *				// O - IPP request
+new_move_job(const char *src,		// I - Source queue
+             int        jobid,		// I - Job ID
+	     const char *dest)		// I - Destination queue
 {
   ipp_t	*request;			// IPP Request
   char	job_uri[HTTP_MAX_URI],		// job-uri
 	printer_uri[HTTP_MAX_URI];	// job-printer-uri
 
 
-  if (!http)
-    return (1);
-
   // Build a CUPS-Move-Job request, which requires the following
   // attributes:
   //
@@ -172,18 +441,265 @@ move_job(http_t     *http,		// I - HTTP connection to server
   httpAssembleURIf(HTTP_URI_CODING_ALL, printer_uri, sizeof(printer_uri), "ipp", NULL, "localhost", 0, "/printers/%s", dest);
   ippAddString(request, IPP_TAG_JOB, IPP_TAG_URI, "job-printer-uri", NULL, printer_uri);
 
-  // Do the request and get back a response...
-  ippDelete(cupsDoRequest(http, request, "/jobs"));
+  return (request);
+}
 
-  if (cupsLastError() > IPP_STATUS_OK_CONFLICTING)
+
+//
+// 'rebalance_jobs()' - Spread the jobs on a queue over several destinations.
+//
+// The source queue's jobs and each target's current load ("queued-job-count"
+// and the total "job-k-octets" of its jobs) are fetched concurrently.  Jobs
+// are then assigned greedily: with the "least-loaded" policy each job goes to
+// the target with the fewest queued jobs, and with the "size" policy the
+// largest jobs are placed first on the target with the fewest queued
+// k-octets.  The moves are sent concurrently.
+//
+
+static int				// O - Exit status
+rebalance_jobs(const char *src,		// I - Source queue
+               char       *targets,	// I - Comma-delimited destinations
+               bool       by_size,	// I - Balance by size?
+               size_t     parallel)	// I - Maximum concurrent requests
+{
+  int		status = 0;		// Exit status
+  size_t	i, j,			// Looping vars
+		first,			// First move request
+		num_targets = 0,	// Number of targets
+		num_jobs = 0,		// Number of jobs
+		alloc_jobs = 0;		// Allocated jobs
+  lpmove_target_t *tlist,		// Targets
+		*t,			// Current target
+		*best;			// Least loaded target
+  lpmove_job_t	*jobs = NULL,		// Jobs to move
+		*job;			// Current job
+  size_t	*assigned;		// Target for each job
+  char		*name,			// Current target name
+		*next,			// Next target name
+		uri[HTTP_MAX_URI];	// printer-uri
+  pool_t	*pool;			// Request pool
+  ipp_t		*request,		// IPP request
+		*response;		// IPP response
+  ipp_attribute_t *attr;		// Current attribute
+  static const char * const pattrs[] =	// Attributes we need for targets...
   {
-    cupsLangPrintf(stderr, "lpmove: %s", cupsLastErrorString());
+    "queued-job-count"
+  };
+
+
+  // Split the target list...
+  if ((tlist = calloc(strlen(targets) / 2 + 1, sizeof(lpmove_target_t))) == NULL || (pool = pool_new(parallel)) == NULL)
+  {
+    cupsLangPuts(stderr, _("lpmove: Unable to allocate memory."));
+    free(tlist);
     return (1);
   }
-  else
+
+  for (name = targets; name && *name; name = next)
+  {
+    if ((next = strchr(name, ',')) != NULL)
+      *next++ = '\0';
+
+    if (*name)
+      tlist[num_targets ++].name = name;
+  }
+
+  if (num_targets == 0)
+  {
+    free(tlist);
+    pool_delete(pool);
+    usage();
+  }
+
+  // Get the source jobs and the load on each target...
+  pool_add_request(pool, new_get_jobs(src), "/");
+
+  for (i = 0, t = tlist; i < num_targets; i ++, t ++)
+  {
+    // Build a Get-Printer-Attributes request, which requires the following
+    // attributes:
+    //
+    //   attributes-charset
+    //   attributes-natural-language
+    //   printer-uri
+    //   requested-attributes
+    //   requesting-user-name
+    request = ippNewRequest(IPP_OP_GET_PRINTER_ATTRIBUTES);
+
+    httpAssembleURIf(HTTP_URI_CODING_ALL, uri, sizeof(uri), "ipp", NULL, "localhost", 0, "/printers/%s", t->name);
+    ippAddString(request, IPP_TAG_OPERATION, IPP_TAG_URI, "printer-uri", NULL, uri);
+    ippAddStrings(request, IPP_TAG_OPERATION, IPP_TAG_KEYWORD, "requested-attributes", sizeof(pattrs) / sizeof(pattrs[0]), NULL, pattrs);
+    ippAddString(request, IPP_TAG_OPERATION, IPP_TAG_NAME, "requesting-user-name", NULL, cupsGetUser());
+
+    pool_add_request(pool, request, "/");
+
+    if (by_size)
+      pool_add_request(pool, new_get_jobs(t->name), "/");
+  }
+
+  if (!pool_run(pool))
+  {
+    for (i = 0; i < pool_get_count(pool); i ++)
+    {
+      if (pool_get_status(pool, i) > IPP_STATUS_OK_CONFLICTING)
+      {
+        const char *qname = i == 0 ? src : tlist[(i - 1) / (by_size ? 2 : 1)].name;
+					// Queue name
+
+        cupsLangPrintf(stderr, "lpmove: %s: %s", qname, pool_get_status_message(pool, i));
+      }
+    }
+
+    pool_delete(pool);
+    free(tlist);
+    return (1);
+  }
+
+  // Collect the source jobs...
+  response = pool_get_response(pool, 0);
+
+  for (attr = ippGetFirstAttribute(response); attr; attr = ippGetNextAttribute(response))
+  {
+    int		jobid = 0,		// job-id
+		k_octets = 0;		// job-k-octets
+    ipp_jstate_t jstate = IPP_JSTATE_PENDING;
+					// job-state
+
+    // Skip leading attributes until we hit a job...
+    while (attr && ippGetGroupTag(attr) != IPP_TAG_JOB)
+      attr = ippGetNextAttribute(response);
+
+    if (!attr)
+      break;
+
+    // Pull the needed attributes from this job...
+    while (attr && ippGetGroupTag(attr) == IPP_TAG_JOB)
+    {
+      if (!strcmp(ippGetName(attr), "job-id") && ippGetValueTag(attr) == IPP_TAG_INTEGER)
+	jobid = ippGetInteger(attr, 0);
+      else if (!strcmp(ippGetName(attr), "job-k-octets") && ippGetValueTag(attr) == IPP_TAG_INTEGER)
+	k_octets = ippGetInteger(attr, 0);
+      else if (!strcmp(ippGetName(attr), "job-state") && ippGetValueTag(attr) == IPP_TAG_ENUM)
+	jstate = (ipp_jstate_t)ippGetInteger(attr, 0);
+
+      attr = ippGetNextAttribute(response);
+    }
+
+    // Jobs that are printing (or stopped while printing) cannot be moved...
+    if (jobid <= 0 || jstate == IPP_JSTATE_PROCESSING || jstate == IPP_JSTATE_STOPPED)
+    {
+      if (!attr)
+        break;
+      else
+        continue;
+    }
+
+    if (num_jobs >= alloc_jobs)
+    {
+      lpmove_job_t	*temp;		// New jobs
+
+      alloc_jobs += 256;
+
+      if ((temp = realloc(jobs, alloc_jobs * sizeof(lpmove_job_t))) == NULL)
+      {
+	cupsLangPuts(stderr, _("lpmove: Unable to allocate memory."));
+	free(jobs);
+	free(tlist);
+	pool_delete(pool);
+	return (1);
+      }
+
+      jobs = temp;
+    }
+
+    job           = jobs + num_jobs ++;
+    job->id       = jobid;
+    job->k_octets = k_octets;
+
+    if (!attr)
+      break;
+  }
+
+  // Get the current load on each target...
+  for (i = 0, t = tlist; i < num_targets; i ++, t ++)
   {
+    if (by_size)
+    {
+      response = pool_get_response(pool, 2 * i + 1);
+
+      if ((attr = ippFindAttribute(response, "queued-job-count", IPP_TAG_INTEGER)) != NULL)
+        t->num_jobs = ippGetInteger(attr, 0);
+
+      response = pool_get_response(pool, 2 * i + 2);
+
+      for (attr = ippFindAttribute(response, "job-k-octets", IPP_TAG_INTEGER); attr; attr = ippFindNextAttribute(response, "job-k-octets", IPP_TAG_INTEGER))
+        t->k_octets += ippGetInteger(attr, 0);
+    }
+    else
+    {
+      response = pool_get_response(pool, i + 1);
+
+      if ((attr = ippFindAttribute(response, "queued-job-count", IPP_TAG_INTEGER)) != NULL)
+        t->num_jobs = ippGetInteger(attr, 0);
+    }
+  }
+
+  if (num_jobs == 0)
+  {
+    free(tlist);
+    pool_delete(pool);
     return (0);
   }
+
+  if ((assigned = calloc(num_jobs, sizeof(size_t))) == NULL)
+  {
+    cupsLangPuts(stderr, _("lpmove: Unable to allocate memory."));
+    free(jobs);
+    free(tlist);
+    pool_delete(pool);
+    return (1);
+  }
+
+  // Assign the jobs, largest first when balancing by size...
+  if (by_size)
+    qsort(jobs, num_jobs, sizeof(lpmove_job_t), compare_jobs);
+
+  first = pool_get_count(pool);
+
+  for (i = 0, job = jobs; i < num_jobs; i ++, job ++)
+  {
+    for (j = 1, best = tlist, t = tlist + 1; j < num_targets; j ++, t ++)
+    {
+      if (by_size ? (t->k_octets < best->k_octets || (t->k_octets == best->k_octets && t->num_jobs < best->num_jobs)) : t->num_jobs < best->num_jobs)
+        best = t;
+    }
+
+    best->num_jobs ++;
+    best->k_octets += job->k_octets;
+    assigned[i] = (size_t)(best - tlist);
+
+    pool_add_request(pool, new_move_job(src, job->id, best->name), "/jobs");
+  }
+
+  // Move the jobs and report any failures...
+  if (!pool_run(pool))
+  {
+    for (i = 0; i < num_jobs; i ++)
+    {
+      if (pool_get_status(pool, first + i) > IPP_STATUS_OK_CONFLICTING)
+      {
+        cupsLangPrintf(stderr, _("lpmove: Unable to move job %d to \"%s\": %s"), jobs[i].id, tlist[assigned[i]].name, pool_get_status_message(pool, first + i));
+        status = 1;
+      }
+    }
+  }
+
+  free(assigned);
+  free(jobs);
+  free(tlist);
+  pool_delete(pool);
+
+  return (status);
 }
 
 
@@ -194,12 +710,16 @@ move_job(http_t     *http,		// I - HTTP connection to server
 static void
 usage(void)
 {
-  cupsLangPuts(stdout, _("Usage: lpmove [options] job destination\n"
-                         "       lpmove [options] source-destination destination"));
+  cupsLangPuts(stdout, _("Usage: lpmove [options] job(s) destination\n"
+                         "       lpmove [options] source-destination destination\n"
+                         "       lpmove [options] --rebalance source-destination destination,...,destination"));
   cupsLangPuts(stdout, _("Options:"));
   cupsLangPuts(stdout, _("-E                      Encrypt the connection to the server"));
   cupsLangPuts(stdout, _("-h server[:port]        Connect to the named server and port"));
   cupsLangPuts(stdout, _("-U username             Specify the username to use for authentication"));
+  cupsLangPuts(stdout, _("--parallel count        Send up to count requests at the same time"));
+  cupsLangPuts(stdout, _("--policy least-loaded   Rebalance jobs by number of queued jobs"));
+  cupsLangPuts(stdout, _("--policy size           Rebalance jobs by size of queued jobs"));
 
   exit(1);
 }
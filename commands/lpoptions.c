@@ -8,21 +8,97 @@
 // information.
 //
 
-#include "localize.h"
+#include "conn.h"
+#include <sys/stat.h>
+
+
+//
+// Local constants...
+//
+
+#define LPOPT_MAX_THREADS	4	// Maximum number of capability requests at once
+
+#ifndef CUPS_SERVERROOT
+#  define CUPS_SERVERROOT	"/etc/cups"
+					// Default server configuration directory
+#endif // !CUPS_SERVERROOT
+
+
+//
+// Local types...
+//
+
+typedef struct lpopt_caps_s		// Cached printer capabilities
+{
+  char		server[256],		// Server name
+		printer[128],		// Printer name
+		uri[1024];		// printer-uri-supported value
+  int		config_time,		// Cached printer-config-change-time
+		new_time;		// Current printer-config-change-time
+  size_t	num_defaults;		// Number of default values
+  cups_option_t	*defaults;		// Default values
+  size_t	num_supported;		// Number of supported values
+  cups_option_t	*supported;		// Supported values
+  bool		queued;			// Queued for fetch?
+  char		*error;			// Error message, if any
+} lpopt_caps_t;
+
+typedef struct lpopt_fetch_s		// Capability fetch state
+{
+  cups_mutex_t	mutex;			// Mutex for next
+  const char	*server;		// Server name
+  int		port;			// Port number
+  http_encryption_t encryption;		// Type of encryption
+  size_t	num_caps,		// Number of printers to fetch
+		next;			// Next printer to fetch
+  lpopt_caps_t	**caps;			// Printers to fetch
+} lpopt_fetch_t;
+
+typedef struct lpopt_file_s		// lpoptions file
+{
+  char		filename[1024];		// Filename
+  size_t	num_lines,		// Number of lines
+		alloc_lines;		// Allocated lines
+  char		**lines;		// Lines from file
+  bool		changed;		// Has the file been changed?
+} lpopt_file_t;
 
 
 //
 // Local functions...
 //
 
-//static void	list_group(ppd_file_t *ppd, ppd_group_t *group);
-static void	list_options(cups_dest_t *dest);
+static bool	add_line(lpopt_file_t *lf, char *line);
+static int	compare_caps(lpopt_caps_t *a, lpopt_caps_t *b, void *data);
+static void	*fetch_caps(lpopt_fetch_t *fetch);
+static size_t	find_record(lpopt_file_t *lf, const char *name, const char *instance);
+static char	*format_record(const char *keyword, const char *name, const char *instance, size_t num_options, cups_option_t *options);
+static void	free_caps(lpopt_caps_t *caps, void *data);
+static void	free_file(lpopt_file_t *lf);
+static bool	get_default(lpopt_file_t *lf, lpopt_file_t *sysf, char *name, size_t namesize);
+static const char *get_userconfig(char *buffer, size_t bufsize);
+static size_t	get_record(lpopt_file_t *lf, lpopt_file_t *sysf, const char *name, const char *instance, cups_option_t **options);
+static int	list_options(lpopt_file_t *lf, lpopt_file_t *sysf, cups_array_t *names, const char *cachefile);
+static cups_array_t *load_caps(const char *cachefile);
+static bool	read_file(lpopt_file_t *lf, const char *filename);
+static bool	remove_record(lpopt_file_t *lf, const char *name, const char *instance);
+static void	save_caps(const char *cachefile, cups_array_t *cache);
+static bool	set_default(lpopt_file_t *lf, const char *name, const char *instance);
+static void	set_file_mode(cups_file_t *fp, const char *filename, mode_t mode);
+static bool	set_record(lpopt_file_t *lf, const char *name, const char *instance, size_t num_options, cups_option_t *options);
+static const char *skip_keyword(const char *line, bool *is_default);
 static void	usage(void) _CUPS_NORETURN;
+static bool	value_string(ipp_attribute_t *attr, size_t element, char *buffer, size_t bufsize);
+static bool	write_file(lpopt_file_t *lf);
 
 
 //
 // 'main()' - Main entry.
 //
+// Changes are made to the matching "Dest" or "Default" line of the lpoptions
+// file only - the rest of the file is copied as-is and the destinations are
+// not enumerated on the server.
+//
 
 int					// O - Exit status
 main(int  argc,				// I - Number of command-line arguments
@@ -33,10 +109,19 @@ main(int  argc,				// I - Number of command-line arguments
   int		changes;		// Did we make changes?
   size_t	num_options;		// Number of options
   cups_option_t	*options;		// Options
-  size_t	num_dests;		// Number of destinations
-  cups_dest_t	*dests;			// Destinations
   cups_dest_t	*dest;			// Current destination
-  char		*opt,			// Option pointer
+  lpopt_file_t	lpfile,			// lpoptions file to update
+		sysfile;		// System lpoptions file
+  bool		list_opts = false,	// List supported options?
+		list_all = false;	// List options for all destinations?
+  cups_array_t	*list_dests;		// Destinations to list
+  const char	*userconfig,		// User configuration directory
+		*serverroot;		// Server configuration directory
+  char		filename[1024],		// lpoptions filename
+		userdir[1024],		// User configuration directory buffer
+		cachefile[1024],	// Capability cache filename
+		defname[256],		// Default destination
+		*opt,			// Option pointer
 		*printer,		// Printer name
 		*instance,		// Instance name
  		*option;		// Current option
@@ -44,10 +129,40 @@ main(int  argc,				// I - Number of command-line arguments
 
   localize_init(argv);
 
+  // Load the lpoptions file(s) - root updates the system file, everyone else
+  // updates their own file which inherits from the system file...
+  if ((serverroot = getenv("CUPS_SERVERROOT")) == NULL)
+    serverroot = CUPS_SERVERROOT;
+
+  snprintf(filename, sizeof(filename), "%s/lpoptions", serverroot);
+
+  memset(&lpfile, 0, sizeof(lpfile));
+  memset(&sysfile, 0, sizeof(sysfile));
+
+  if ((userconfig = get_userconfig(userdir, sizeof(userdir))) != NULL)
+    snprintf(cachefile, sizeof(cachefile), "%s/lpoptions-cache", userconfig);
+  else
+    cachefile[0] = '\0';
+
+  if (getuid())
+  {
+    read_file(&sysfile, filename);
+
+    if (userconfig)
+    {
+      snprintf(filename, sizeof(filename), "%s/lpoptions", userconfig);
+      read_file(&lpfile, filename);
+    }
+  }
+  else
+  {
+    read_file(&lpfile, filename);
+  }
+
   // Loop through the command-line arguments...
-  dest        = NULL;
-  num_dests   = 0;
-  dests       = NULL;
+  list_dests  = cupsArrayNew(NULL, NULL, NULL, 0, (cups_acopy_cb_t)strdup, (cups_afree_cb_t)free);
+  printer     = NULL;
+  instance    = NULL;
   num_options = 0;
   options     = NULL;
   changes     = 0;
@@ -64,7 +179,19 @@ main(int  argc,				// I - Number of command-line arguments
       {
 	switch (*opt)
 	{
+	  case 'a' : // -a (all destinations)
+	      list_all = true;
+	      break;
+
 	  case 'd' : // -d printer
+	      // Save any changes for the current destination...
+	      if (changes > 0 && printer)
+	        set_record(&lpfile, printer, instance, num_options, options);
+
+	      cupsFreeOptions(num_options, options);
+	      num_options = 0;
+	      options     = NULL;
+
 	      if (opt[1] != '\0')
 	      {
 		printer = opt + 1;
@@ -79,34 +206,62 @@ main(int  argc,				// I - Number of command-line arguments
 		printer = argv[i];
 	      }
 
+	      cupsArrayAdd(list_dests, printer);
+
 	      if ((instance = strrchr(printer, '/')) != NULL)
 		*instance++ = '\0';
 
-	      if (num_dests == 0)
-		num_dests = cupsGetDests(CUPS_HTTP_DEFAULT, &dests);
+	      // Only ask the server about destinations we haven't seen...
+	      if (find_record(&lpfile, printer, instance) == SIZE_MAX && find_record(&lpfile, printer, NULL) == SIZE_MAX && find_record(&sysfile, printer, instance) == SIZE_MAX && find_record(&sysfile, printer, NULL) == SIZE_MAX)
+	      {
+		if ((dest = cupsGetNamedDest(conn_get_default(), printer, NULL)) == NULL)
+		{
+		  cupsLangPuts(stderr, _("lpoptions: Unknown printer or class."));
+		  return (1);
+		}
 
-	      if (num_dests == 0 || !dests || (dest = cupsGetDest(printer, instance, num_dests, dests)) == NULL)
+		cupsFreeDests(1, dest);
+	      }
+
+	      // Set the default destination...
+	      if (!set_default(&lpfile, printer, instance))
 	      {
-		cupsLangPuts(stderr, _("lpoptions: Unknown printer or class."));
+		cupsLangPrintf(stderr, _("lpoptions: Unable to add printer or instance: %s"), strerror(errno));
 		return (1);
 	      }
 
-	     /*
-	      * Set the default destination...
-	      */
-
-	      for (j = 0; j < num_dests; j ++)
-		dests[j].is_default = 0;
+	      num_options = get_record(&lpfile, &sysfile, printer, instance, &options);
+	      break;
 
-	      dest->is_default = 1;
+	  case 'p' : // -p printer
+	      // Save any changes for the current destination...
+	      if (changes > 0 && printer)
+	        set_record(&lpfile, printer, instance, num_options, options);
 
-	      cupsSetDests(CUPS_HTTP_DEFAULT, num_dests, dests);
+	      cupsFreeOptions(num_options, options);
+	      num_options = 0;
+	      options     = NULL;
 
-	      for (j = 0; j < dest->num_options; j ++)
+	      if (opt[1] != '\0')
+	      {
+		printer = opt + 1;
+		opt += strlen(opt) - 1;
+	      }
+	      else
 	      {
-		if (cupsGetOption(dest->options[j].name, num_options, options) == NULL)
-		  num_options = cupsAddOption(dest->options[j].name, dest->options[j].value, num_options, &options);
+		i ++;
+		if (i >= argc)
+		  usage();
+
+		printer = argv[i];
 	      }
+
+	      cupsArrayAdd(list_dests, printer);
+
+	      if ((instance = strrchr(printer, '/')) != NULL)
+		*instance++ = '\0';
+
+	      num_options = get_record(&lpfile, &sysfile, printer, instance, &options);
 	      break;
 
 	  case 'h' : // -h server
@@ -130,66 +285,30 @@ main(int  argc,				// I - Number of command-line arguments
 	      break;
 
 	  case 'l' : // -l (list options)
-	      if (dest == NULL)
-	      {
-		if (num_dests == 0)
-		  num_dests = cupsGetDests(CUPS_HTTP_DEFAULT, &dests);
-
-		if ((dest = cupsGetDest(NULL, NULL, num_dests, dests)) == NULL)
-		  dest = dests;
-	      }
-
-	      if (dest == NULL)
-		cupsLangPuts(stderr, _("lpoptions: No printers."));
-	      else
-		list_options(dest);
-
-	      changes = -1;
+	      list_opts = true;
+	      changes   = -1;
 	      break;
 
 	  case 'o' : // -o option[=value]
-	      if (dest == NULL)
+	      if (!printer)
 	      {
-		if (num_dests == 0)
-		  num_dests = cupsGetDests(CUPS_HTTP_DEFAULT, &dests);
-
-		if ((dest = cupsGetDest(NULL, NULL, num_dests, dests)) == NULL)
-		  dest = dests;
-
-		if (dest == NULL)
+		if (!get_default(&lpfile, &sysfile, defname, sizeof(defname)))
 		{
 		  cupsLangPuts(stderr, _("lpoptions: No printers."));
 		  return (1);
 		}
 
-		for (j = 0; j < dest->num_options; j ++)
-		{
-		  if (cupsGetOption(dest->options[j].name, num_options, options) == NULL)
-		    num_options = cupsAddOption(dest->options[j].name, dest->options[j].value, num_options, &options);
-		}
-	      }
+	        printer = defname;
 
-	      if (opt[1] != '\0')
-	      {
-		num_options = cupsParseOptions(opt + 1, num_options, &options);
-		opt += strlen(opt) - 1;
-	      }
-	      else
-	      {
-		i ++;
-		if (i >= argc)
-		  usage();
+		if ((instance = strrchr(printer, '/')) != NULL)
+		  *instance++ = '\0';
 
-		num_options = cupsParseOptions(argv[i], num_options, &options);
+		num_options = get_record(&lpfile, &sysfile, printer, instance, &options);
 	      }
 
-	      changes = 1;
-	      break;
-
-	  case 'p' : // -p printer
 	      if (opt[1] != '\0')
 	      {
-		printer = opt + 1;
+		option = opt + 1;
 		opt += strlen(opt) - 1;
 	      }
 	      else
@@ -198,54 +317,29 @@ main(int  argc,				// I - Number of command-line arguments
 		if (i >= argc)
 		  usage();
 
-		printer = argv[i];
+		option = argv[i];
 	      }
 
-	      if ((instance = strrchr(printer, '/')) != NULL)
-		*instance++ = '\0';
-
-	      if (num_dests == 0)
-		num_dests = cupsGetDests(CUPS_HTTP_DEFAULT, &dests);
-
-	      if ((dest = cupsGetDest(printer, instance, num_dests, dests)) == NULL)
-	      {
-		num_dests = cupsAddDest(printer, instance, num_dests, &dests);
-		dest      = cupsGetDest(printer, instance, num_dests, dests);
-
-		if (dest == NULL)
-		{
-		  cupsLangPrintf(stderr, _("lpoptions: Unable to add printer or instance: %s"), strerror(errno));
-		  return (1);
-		}
-	      }
+	      num_options = cupsParseOptions(option, num_options, &options);
 
-	      for (j = 0; j < dest->num_options; j ++)
-	      {
-		if (cupsGetOption(dest->options[j].name, num_options, options) == NULL)
-		  num_options = cupsAddOption(dest->options[j].name, dest->options[j].value, num_options, &options);
-	      }
+	      changes = 1;
 	      break;
 
 	  case 'r' : // -r option (remove)
-	      if (dest == NULL)
+	      if (!printer)
 	      {
-		if (num_dests == 0)
-		  num_dests = cupsGetDests(CUPS_HTTP_DEFAULT, &dests);
-
-		if ((dest = cupsGetDest(NULL, NULL, num_dests, dests)) == NULL)
-		  dest = dests;
-
-		if (dest == NULL)
+		if (!get_default(&lpfile, &sysfile, defname, sizeof(defname)))
 		{
 		  cupsLangPuts(stderr, _("lpoptions: No printers."));
 		  return (1);
 		}
 
-		for (j = 0; j < dest->num_options; j ++)
-		{
-		  if (cupsGetOption(dest->options[j].name, num_options, options) == NULL)
-		    num_options = cupsAddOption(dest->options[j].name, dest->options[j].value, num_options, &options);
-		}
+	        printer = defname;
+
+		if ((instance = strrchr(printer, '/')) != NULL)
+		  *instance++ = '\0';
+
+		num_options = get_record(&lpfile, &sysfile, printer, instance, &options);
 	      }
 
 	      if (opt[1] != '\0')
@@ -268,6 +362,13 @@ main(int  argc,				// I - Number of command-line arguments
 	      break;
 
 	  case 'x' : // -x printer
+	      if (changes > 0 && printer)
+	        set_record(&lpfile, printer, instance, num_options, options);
+
+	      cupsFreeOptions(num_options, options);
+	      num_options = 0;
+	      options     = NULL;
+
 	      if (opt[1] != '\0')
 	      {
 		printer = opt + 1;
@@ -285,13 +386,9 @@ main(int  argc,				// I - Number of command-line arguments
 	      if ((instance = strrchr(printer, '/')) != NULL)
 		*instance++ = '\0';
 
-	      if (num_dests == 0)
-		num_dests = cupsGetDests(CUPS_HTTP_DEFAULT, &dests);
-
-              num_dests = cupsRemoveDest(printer, instance, num_dests, &dests);
+              remove_record(&lpfile, printer, instance);
 
-	      cupsSetDests(CUPS_HTTP_DEFAULT, num_dests, dests);
-	      dest    = NULL;
+	      printer = NULL;
 	      changes = -1;
 	      break;
 
@@ -306,41 +403,60 @@ main(int  argc,				// I - Number of command-line arguments
     }
   }
 
-  if (num_dests == 0)
-    num_dests = cupsGetDests(CUPS_HTTP_DEFAULT, &dests);
+  // Save any changes...
+  if (changes > 0 && printer)
+    set_record(&lpfile, printer, instance, num_options, options);
 
-  if (dest == NULL)
+  if (lpfile.changed && !write_file(&lpfile))
   {
-    if ((dest = cupsGetDest(NULL, NULL, num_dests, dests)) != NULL)
-    {
-      for (j = 0; j < dest->num_options; j ++)
-      {
-	if (cupsGetOption(dest->options[j].name, num_options, options) == NULL)
-	  num_options = cupsAddOption(dest->options[j].name, dest->options[j].value, num_options, &options);
-      }
-    }
+    cupsLangPrintf(stderr, _("lpoptions: Unable to save options: %s"), strerror(errno));
+    return (1);
   }
 
-  if (dest == NULL)
-    return (0);
-
-  if (changes > 0)
+  if (list_opts)
   {
-    // Set printer options...
-    cupsFreeOptions(dest->num_options, dest->options);
+    // List the supported options...
+    if (!list_all && cupsArrayGetCount(list_dests) == 0)
+    {
+      if (!get_default(&lpfile, &sysfile, defname, sizeof(defname)))
+      {
+	cupsLangPuts(stderr, _("lpoptions: No printers."));
+	return (1);
+      }
 
-    dest->num_options = num_options;
-    dest->options     = options;
+      cupsArrayAdd(list_dests, defname);
+    }
 
-    cupsSetDests(CUPS_HTTP_DEFAULT, num_dests, dests);
+    return (list_options(&lpfile, &sysfile, list_all ? NULL : list_dests, cachefile[0] ? cachefile : NULL));
   }
   else if (changes == 0)
   {
+    // Show the current options...
     char	buffer[10240],		// String for options
 		*ptr;			// Pointer into string
 
-    num_options = dest->num_options;
-    options     = dest->options;
+    if (!printer)
+    {
+      if (!get_default(&lpfile, &sysfile, defname, sizeof(defname)))
+        return (0);
+
+      printer = defname;
+
+      if ((instance = strrchr(printer, '/')) != NULL)
+	*instance++ = '\0';
+    }
+
+    cupsFreeOptions(num_options, options);
+
+    if ((dest = cupsGetNamedDest(conn_get_default(), printer, instance)) != NULL)
+    {
+      num_options = dest->num_options;
+      options     = dest->options;
+    }
+    else
+    {
+      num_options = get_record(&lpfile, &sysfile, printer, instance, &options);
+    }
 
     for (j = 0, ptr = buffer; ptr < (buffer + sizeof(buffer) - 1) && j < num_options; j ++)
     {
@@ -349,7 +465,7 @@ main(int  argc,				// I - Number of command-line arguments
 
       if (!options[j].value[0])
         cupsCopyString(ptr, options[j].name, sizeof(buffer) - (size_t)(ptr - buffer));
-      else if (strchr(options[i].value, ' ') != NULL || strchr(options[i].value, '\t') != NULL)
+      else if (strchr(options[j].value, ' ') != NULL || strchr(options[j].value, '\t') != NULL)
 	snprintf(ptr, sizeof(buffer) - (size_t)(ptr - buffer), "%s=\'%s\'", options[j].name, options[j].value);
       else
 	snprintf(ptr, sizeof(buffer) - (size_t)(ptr - buffer), "%s=%s", options[j].name, options[j].value);
@@ -358,184 +474,1300 @@ main(int  argc,				// I - Number of command-line arguments
     }
 
     cupsLangPuts(stdout, buffer);
+
+    cupsFreeDests(1, dest);
   }
 
+  cupsArrayDelete(list_dests);
+  free_file(&lpfile);
+  free_file(&sysfile);
+
   return (0);
 }
 
 
-#if 0 // TODO: Convert to reporting IPP attributes and values
 //
-// 'list_group()' - List printer-specific options from the PPD group.
+// 'add_line()' - Add a line to the end of an lpoptions file.
 //
 
-static void
-list_group(ppd_file_t  *ppd,		// I - PPD file
-           ppd_group_t *group)		// I - Group to show
+static bool				// O - `true` on success, `false` on error
+add_line(lpopt_file_t *lf,		// I - lpoptions file
+         char         *line)		// I - Line (allocated string)
+{
+  if (!line)
+    return (false);
+
+  if (lf->num_lines >= lf->alloc_lines)
+  {
+    size_t	alloc = lf->alloc_lines + 32;
+					// New allocation size
+    char	**lines;		// New lines
+
+    if ((lines = realloc(lf->lines, alloc * sizeof(char *))) == NULL)
+    {
+      free(line);
+      return (false);
+    }
+
+    lf->lines       = lines;
+    lf->alloc_lines = alloc;
+  }
+
+  lf->lines[lf->num_lines ++] = line;
+
+  return (true);
+}
+
+
+//
+// 'compare_caps()' - Compare two cached printers.
+//
+
+static int				// O - Result of comparison
+compare_caps(lpopt_caps_t *a,		// I - First printer
+             lpopt_caps_t *b,		// I - Second printer
+             void         *data)	// I - Callback data (unused)
 {
-  int		i, j;			// Looping vars
-  ppd_option_t	*option;		// Current option
-  ppd_choice_t	*choice;		// Current choice
-  ppd_group_t	*subgroup;		// Current subgroup
-  char		buffer[10240],		// Option string buffer
-		*ptr;			// Pointer into option string
+  int	result;				// Result of comparison
+
+
+  (void)data;
+
+  if ((result = strcmp(a->server, b->server)) == 0)
+    result = strcasecmp(a->printer, b->printer);
+
+  return (result);
+}
+
 
+//
+// 'fetch_caps()' - Fetch printer capabilities on a single connection.
+//
 
-  for (i = group->num_options, option = group->options; i > 0; i --, option ++)
+static void *				// O - Thread exit status
+fetch_caps(lpopt_fetch_t *fetch)	// I - Fetch state
+{
+  http_t	*http = NULL;		// Connection to server
+  lpopt_caps_t	*caps;			// Current printer
+  cups_dest_t	dest;			// Destination for printer
+  cups_dinfo_t	*dinfo;			// Destination information
+  ipp_attribute_t *creation,		// job-creation-attributes-supported
+		*supported,		// xxx-supported
+		*defattr;		// xxx-default
+  size_t	i,			// Looping var
+		count;			// Number of attributes
+  const char	*name;			// Attribute name
+  char		value[256],		// Value string
+		values[16384],		// Supported values
+		*ptr;			// Pointer into supported values
+  size_t	j;			// Looping var
+  static const char * const names[] =	// Attributes for older servers
   {
-    if (!strcasecmp(option->keyword, "PageRegion"))
+    "copies",
+    "finishings",
+    "media",
+    "media-source",
+    "media-type",
+    "number-up",
+    "orientation-requested",
+    "output-bin",
+    "print-color-mode",
+    "print-quality",
+    "printer-resolution",
+    "sides"
+  };
+
+
+  for (;;)
+  {
+    // Get the next printer...
+    cupsMutexLock(&fetch->mutex);
+    if (fetch->next < fetch->num_caps)
+      caps = fetch->caps[fetch->next ++];
+    else
+      caps = NULL;
+    cupsMutexUnlock(&fetch->mutex);
+
+    if (!caps)
+      break;
+
+    // Open the connection as needed and get the capabilities...
+    if (!http && (http = conn_acquire(fetch->server, fetch->port, fetch->encryption)) == NULL)
+    {
+      caps->error = strdup(strerror(errno));
+      continue;
+    }
+
+    memset(&dest, 0, sizeof(dest));
+    dest.name        = caps->printer;
+    dest.num_options = cupsAddOption("printer-uri-supported", caps->uri, 0, &dest.options);
+
+    if ((dinfo = cupsCopyDestInfo(http, &dest)) == NULL)
+    {
+      caps->error = strdup(cupsLastErrorString());
+      cupsFreeOptions(dest.num_options, dest.options);
       continue;
+    }
+
+    cupsFreeOptions(caps->num_defaults, caps->defaults);
+    cupsFreeOptions(caps->num_supported, caps->supported);
 
-    snprintf(buffer, sizeof(buffer), "%s/%s:", option->keyword, option->text);
+    caps->num_defaults  = 0;
+    caps->defaults      = NULL;
+    caps->num_supported = 0;
+    caps->supported     = NULL;
 
-    for (j = option->num_choices, choice = option->choices,
-             ptr = buffer + strlen(buffer);
-         j > 0 && ptr < (buffer + sizeof(buffer) - 1);
-	 j --, choice ++)
+    // Use the attributes the printer accepts for new jobs, if listed...
+    creation = cupsFindDestSupported(http, &dest, dinfo, "job-creation-attributes");
+    count    = creation ? ippGetCount(creation) : sizeof(names) / sizeof(names[0]);
+
+    for (i = 0; i < count; i ++)
     {
-      if (!strcasecmp(choice->choice, "Custom"))
+      name = creation ? ippGetString(creation, i, NULL) : names[i];
+
+      if ((supported = cupsFindDestSupported(http, &dest, dinfo, name)) == NULL || ippGetValueTag(supported) == IPP_TAG_BEGIN_COLLECTION)
+        continue;
+
+      if ((defattr = cupsFindDestDefault(http, &dest, dinfo, name)) != NULL && ippGetValueTag(defattr) == IPP_TAG_BEGIN_COLLECTION)
+        continue;
+
+      for (j = 0, ptr = values, *ptr = '\0'; j < ippGetCount(supported) && ptr < (values + sizeof(values) - 1); j ++)
       {
-        ppd_coption_t	*coption;	// Custom option
-        ppd_cparam_t	*cparam;	// Custom parameter
-	static const char * const types[] =
-	{				// Parameter types
-	  "CURVE",
-	  "INTEGER",
-	  "INVCURVE",
-	  "PASSCODE",
-	  "PASSWORD",
-	  "POINTS",
-	  "REAL",
-	  "STRING"
-	};
-
-
-        if ((coption = ppdFindCustomOption(ppd, option->keyword)) == NULL ||
-	    cupsArrayCount(coption->params) == 0)
-	  snprintf(ptr, sizeof(buffer) - (size_t)(ptr - buffer), " %sCustom", choice->marked ? "*" : "");
-        else if (!strcasecmp(option->keyword, "PageSize") ||
-	         !strcasecmp(option->keyword, "PageRegion"))
-	  snprintf(ptr, sizeof(buffer) - (size_t)(ptr - buffer), " %sCustom.WIDTHxHEIGHT", choice->marked ? "*" : "");
-        else
-	{
-	  cparam = (ppd_cparam_t *)cupsArrayFirst(coption->params);
-
-	  if (cupsArrayCount(coption->params) == 1)
-	    snprintf(ptr, sizeof(buffer) - (size_t)(ptr - buffer), " %sCustom.%s", choice->marked ? "*" : "", types[cparam->type]);
-	  else
-	  {
-	    const char	*prefix;	// Prefix string
-
-
-            if (choice->marked)
-	      prefix = " *{";
-	    else
-	      prefix = " {";
-
-	    while (cparam)
-	    {
-	      snprintf(ptr, sizeof(buffer) - (size_t)(ptr - buffer), "%s%s=%s", prefix, cparam->name, types[cparam->type]);
-	      cparam = (ppd_cparam_t *)cupsArrayNext(coption->params);
-	      prefix = " ";
-	      ptr += strlen(ptr);
-	    }
-
-            if (ptr < (buffer + sizeof(buffer) - 1))
-	      cupsCopyString(ptr, "}", sizeof(buffer) - (size_t)(ptr - buffer));
-	  }
-	}
+        if (!value_string(supported, j, value, sizeof(value)))
+          continue;
+
+        snprintf(ptr, sizeof(values) - (size_t)(ptr - values), "%s%s", ptr > values ? " " : "", value);
+        ptr += strlen(ptr);
       }
-      else if (choice->marked)
-        snprintf(ptr, sizeof(buffer) - (size_t)(ptr - buffer), " *%s", choice->choice);
-      else
-        snprintf(ptr, sizeof(buffer) - (size_t)(ptr - buffer), " %s", choice->choice);
 
-      ptr += strlen(ptr);
+      if (!values[0])
+        continue;
+
+      if (!defattr || !value_string(defattr, 0, value, sizeof(value)))
+        value[0] = '\0';
+
+      caps->num_supported = cupsAddOption(name, values, caps->num_supported, &caps->supported);
+      caps->num_defaults  = cupsAddOption(name, value, caps->num_defaults, &caps->defaults);
     }
 
-    cupsLangPuts(stdout, buffer);
+    caps->config_time = caps->new_time;
+
+    cupsFreeDestInfo(dinfo);
+    cupsFreeOptions(dest.num_options, dest.options);
   }
 
-  for (i = group->num_subgroups, subgroup = group->subgroups; i > 0; i --, subgroup ++)
-    list_group(ppd, subgroup);
+  conn_release(http);
+
+  return (NULL);
 }
-#endif // 0
 
 
 //
-// 'list_options()' - List printer-specific options from the PPD file.
+// 'find_record()' - Find the "Dest" or "Default" line for a destination.
 //
 
-static void
-list_options(cups_dest_t *dest)		// I - Destination to list
+static size_t				// O - Line number or `SIZE_MAX` if not found
+find_record(lpopt_file_t *lf,		// I - lpoptions file
+            const char   *name,		// I - Destination name
+            const char   *instance)	// I - Instance name or `NULL`
 {
-#if 0 // TODO: List supported attributes
-  http_t	*http;			// Connection to destination
-  char		resource[1024];		// Resource path
-  int		i;			// Looping var
-  const char	*filename;		// PPD filename
-  ppd_file_t	*ppd;			// PPD data
-  ppd_group_t	*group;			// Current group
+  size_t	i,			// Looping var
+		namelen,		// Length of name
+		instlen;		// Length of instance
+  const char	*ptr;			// Pointer into line
 
 
-  if ((http = cupsConnectDest(dest, CUPS_DEST_FLAGS_NONE, 30000, NULL, resource, sizeof(resource), NULL, NULL)) == NULL)
-  {
-    cupsLangPrintf(stderr, _("lpoptions: Unable to get PPD file for %s: %s"),
-		    dest->name, cupsLastErrorString());
-    return;
-  }
+  namelen = strlen(name);
+  instlen = instance ? strlen(instance) : 0;
 
-  if ((filename = cupsGetPPD2(http, dest->name)) == NULL)
+  for (i = 0; i < lf->num_lines; i ++)
   {
-    httpClose(http);
+    if ((ptr = skip_keyword(lf->lines[i], NULL)) == NULL)
+      continue;
 
-    cupsLangPrintf(stderr, _("lpoptions: Unable to get PPD file for %s: %s"),
-		    dest->name, cupsLastErrorString());
-    return;
+    if (strncasecmp(ptr, name, namelen))
+      continue;
+
+    ptr += namelen;
+
+    if (instance)
+    {
+      if (*ptr != '/' || strncasecmp(ptr + 1, instance, instlen))
+        continue;
+
+      ptr += instlen + 1;
+    }
+
+    if (!*ptr || isspace(*ptr & 255))
+      return (i);
   }
 
-  httpClose(http);
+  return (SIZE_MAX);
+}
+
+
+//
+// 'format_record()' - Format a "Dest" or "Default" line.
+//
+// Values are quoted the same way as `cupsSetDests` does so that the file
+// can still be read by libcups.
+//
+
+static char *				// O - Line (allocated string) or `NULL` on error
+format_record(
+    const char    *keyword,		// I - "Dest" or "Default"
+    const char    *name,		// I - Destination name
+    const char    *instance,		// I - Instance name or `NULL`
+    size_t        num_options,		// I - Number of options
+    cups_option_t *options)		// I - Options
+{
+  size_t	i,			// Looping var
+		linesize;		// Size of line
+  char		*line,			// Line
+		*ptr;			// Pointer into line
+  const char	*val;			// Pointer into value
+
 
-  if ((ppd = ppdOpenFile(filename)) == NULL)
+  // Figure out how much space is needed...
+  linesize = strlen(keyword) + strlen(name) + (instance ? strlen(instance) : 0) + 3;
+
+  for (i = 0; i < num_options; i ++)
+    linesize += strlen(options[i].name) + 2 * strlen(options[i].value) + 4;
+
+  if ((line = malloc(linesize)) == NULL)
+    return (NULL);
+
+  // Then format the line...
+  if (instance)
+    snprintf(line, linesize, "%s %s/%s", keyword, name, instance);
+  else
+    snprintf(line, linesize, "%s %s", keyword, name);
+
+  for (i = 0, ptr = line + strlen(line); i < num_options; i ++)
   {
-    unlink(filename);
-    cupsLangPrintf(stderr, _("lpoptions: Unable to open PPD file for %s."),
-		    dest->name);
-    return;
+    *ptr++ = ' ';
+    cupsCopyString(ptr, options[i].name, linesize - (size_t)(ptr - line));
+    ptr += strlen(ptr);
+
+    if (!options[i].value[0])
+      continue;
+
+    *ptr++ = '=';
+
+    if (strpbrk(options[i].value, " \t\\\'\""))
+    {
+      *ptr++ = '\"';
+
+      for (val = options[i].value; *val; val ++)
+      {
+        if (*val == '\\' || *val == '\"')
+          *ptr++ = '\\';
+
+        *ptr++ = *val;
+      }
+
+      *ptr++ = '\"';
+    }
+    else
+    {
+      for (val = options[i].value; *val; val ++)
+        *ptr++ = *val;
+    }
   }
 
-  ppdMarkDefaults(ppd);
-  cupsMarkOptions(ppd, dest->num_options, dest->options);
+  *ptr = '\0';
+
+  return (line);
+}
+
+
+//
+// 'free_caps()' - Free cached printer capabilities.
+//
 
-  for (i = ppd->num_groups, group = ppd->groups; i > 0; i --, group ++)
-    list_group(ppd, group);
+static void
+free_caps(lpopt_caps_t *caps,		// I - Printer
+          void         *data)		// I - Callback data (unused)
+{
+  (void)data;
 
-  ppdClose(ppd);
-  unlink(filename);
-#endif // 0
+  cupsFreeOptions(caps->num_defaults, caps->defaults);
+  cupsFreeOptions(caps->num_supported, caps->supported);
+  free(caps->error);
+  free(caps);
 }
 
 
 //
-// 'usage()' - Show program usage and exit.
+// 'free_file()' - Free the lines of an lpoptions file.
 //
 
 static void
-usage(void)
+free_file(lpopt_file_t *lf)		// I - lpoptions file
 {
-  cupsLangPuts(stdout, _("Usage: lpoptions [options] -d destination\n"
-                          "       lpoptions [options] [-p destination] [-l]\n"
-                          "       lpoptions [options] [-p destination] -o option[=value]\n"
-                          "       lpoptions [options] -x destination"));
-  cupsLangPuts(stdout, _("Options:"));
-  cupsLangPuts(stdout, _("-d destination          Set default destination"));
-  cupsLangPuts(stdout, _("-E                      Encrypt the connection to the server"));
-  cupsLangPuts(stdout, _("-h server[:port]        Connect to the named server and port"));
-  cupsLangPuts(stdout, _("-l                      Show supported options and values"));
-  cupsLangPuts(stdout, _("-o name[=value]         Set default option and value"));
-  cupsLangPuts(stdout, _("-p destination          Specify a destination"));
-  cupsLangPuts(stdout, _("-U username             Specify the username to use for authentication"));
-  cupsLangPuts(stdout, _("-x destination          Remove default options for destination"));
+  size_t	i;			// Looping var
 
-  exit(1);
+
+  for (i = 0; i < lf->num_lines; i ++)
+    free(lf->lines[i]);
+
+  free(lf->lines);
+
+  lf->num_lines   = 0;
+  lf->alloc_lines = 0;
+  lf->lines       = NULL;
+}
+
+
+//
+// 'get_default()' - Get the default destination.
+//
+// The default comes from the LPDEST and PRINTER environment variables, then
+// the lpoptions files, and only then from the server.
+//
+
+static bool				// O - `true` if there is a default
+get_default(lpopt_file_t *lf,		// I - lpoptions file
+            lpopt_file_t *sysf,		// I - System lpoptions file
+            char         *name,		// I - Name buffer
+            size_t       namesize)	// I - Size of name buffer
+{
+  const char	*env;			// Environment variable
+  lpopt_file_t	*f;			// Current file
+  size_t	i;			// Looping var
+  const char	*ptr;			// Pointer into line
+  bool		is_default;		// "Default" line?
+  char		*nameptr;		// Pointer into name
+  cups_dest_t	*dest;			// Default destination
+
+
+  if ((env = getenv("LPDEST")) != NULL || ((env = getenv("PRINTER")) != NULL && strcmp(env, "lp")))
+  {
+    cupsCopyString(name, env, namesize);
+    return (true);
+  }
+
+  for (f = lf; f; f = (f == lf ? sysf : NULL))
+  {
+    for (i = 0; i < f->num_lines; i ++)
+    {
+      if ((ptr = skip_keyword(f->lines[i], &is_default)) == NULL || !is_default)
+        continue;
+
+      for (nameptr = name; *ptr && !isspace(*ptr & 255) && nameptr < (name + namesize - 1); ptr ++)
+        *nameptr++ = *ptr;
+
+      *nameptr = '\0';
+
+      return (name[0] != '\0');
+    }
+  }
+
+  if ((dest = cupsGetNamedDest(conn_get_default(), /*name*/NULL, /*instance*/NULL)) == NULL)
+    return (false);
+
+  if (dest->instance)
+    snprintf(name, namesize, "%s/%s", dest->name, dest->instance);
+  else
+    cupsCopyString(name, dest->name, namesize);
+
+  cupsFreeDests(1, dest);
+
+  return (true);
+}
+
+
+//
+// 'get_record()' - Get the options for a destination.
+//
+// Options come from the lpoptions file, or the system lpoptions file if the
+// destination has no line of its own.
+//
+
+static size_t				// O - Number of options
+get_record(lpopt_file_t  *lf,		// I - lpoptions file
+           lpopt_file_t  *sysf,		// I - System lpoptions file
+           const char    *name,		// I - Destination name
+           const char    *instance,	// I - Instance name or `NULL`
+           cups_option_t **options)	// O - Options
+{
+  size_t	line;			// Line number
+  const char	*ptr;			// Pointer into line
+
+
+  *options = NULL;
+
+  if ((line = find_record(lf, name, instance)) != SIZE_MAX)
+    ptr = lf->lines[line];
+  else if ((line = find_record(sysf, name, instance)) != SIZE_MAX)
+    ptr = sysf->lines[line];
+  else
+    return (0);
+
+  // Skip the keyword and name...
+  ptr = skip_keyword(ptr, NULL);
+
+  while (*ptr && !isspace(*ptr & 255))
+    ptr ++;
+
+  return (cupsParseOptions(ptr, 0, options));
+}
+
+
+//
+// 'get_userconfig()' - Get the user configuration directory.
+//
+// This matches libcups: "CUPS_USERCONFIG" if set, otherwise "~/.cups" if it
+// exists, otherwise "$XDG_CONFIG_HOME/cups" or "~/.config/cups".
+//
+
+static const char *			// O - Directory or `NULL` if none
+get_userconfig(char   *buffer,		// I - Buffer
+               size_t bufsize)		// I - Size of buffer
+{
+  const char	*home,			// Home directory
+		*xdg;			// XDG_CONFIG_HOME value
+  struct stat	info;			// Directory information
+
+
+  if ((home = getenv("CUPS_USERCONFIG")) != NULL)
+  {
+    cupsCopyString(buffer, home, bufsize);
+    return (buffer);
+  }
+
+  if ((home = getenv("HOME")) == NULL)
+    return (NULL);
+
+  snprintf(buffer, bufsize, "%s/.cups", home);
+  if (!stat(buffer, &info) && S_ISDIR(info.st_mode))
+    return (buffer);
+
+  if ((xdg = getenv("XDG_CONFIG_HOME")) != NULL)
+    snprintf(buffer, bufsize, "%s/cups", xdg);
+  else
+    snprintf(buffer, bufsize, "%s/.config/cups", home);
+
+  return (buffer);
+}
+
+
+//
+// 'list_options()' - List the supported options for destinations.
+//
+// Capabilities are read from the cache file and validated against the
+// "printer-config-change-time" values from a single request - only printers
+// that have changed or are not yet cached are queried, several at a time.
+// If the server cannot be reached the cached capabilities are used as-is.
+//
+
+static int				// O - Exit status
+list_options(lpopt_file_t *lf,		// I - lpoptions file
+             lpopt_file_t *sysf,	// I - System lpoptions file
+             cups_array_t *names,	// I - Destinations to list or `NULL` for all
+             const char   *cachefile)	// I - Capability cache file or `NULL`
+{
+  int		status = 0;		// Exit status
+  cups_array_t	*cache;			// Cached printers
+  lpopt_caps_t	key,			// Search key
+		*caps;			// Current printer
+  lpopt_fetch_t	fetch;			// Fetch state
+  ipp_t		*request,		// IPP request
+		*response;		// IPP response
+  ipp_attribute_t *attr;		// Current attribute
+  const char	*name,			// printer-name value
+		*uri;			// printer-uri-supported value
+  int		config_time;		// printer-config-change-time value
+  char		dname[256],		// Destination name
+		*instance,		// Instance name
+		resource[1024],		// Printer URI
+		buffer[16384],		// Option string
+		*ptr,			// Pointer into option string
+		*value,			// Current supported value
+		*next;			// Next supported value
+  size_t	i,			// Looping var
+		num_threads,		// Number of fetch threads
+		num_options;		// Number of user options
+  cups_option_t	*options;		// User options
+  const char	*current;		// Current value
+  bool		marked,			// Was the current value listed?
+		all = names == NULL,	// List all destinations?
+		validated = false;	// Were the printers checked with the server?
+  cups_thread_t	threads[LPOPT_MAX_THREADS];
+					// Fetch threads
+  static const char * const pattrs[] =	// Printer attributes we want
+  {
+    "printer-config-change-time",
+    "printer-name",
+    "printer-uri-supported"
+  };
+
+
+  cache = load_caps(cachefile);
+
+  memset(&key, 0, sizeof(key));
+  cupsCopyString(key.server, cupsGetServer(), sizeof(key.server));
+
+ /*
+  * Build a CUPS-Get-Printers request, or a Get-Printer-Attributes request for
+  * a single destination, which requires the following attributes:
+  *
+  *    attributes-charset
+  *    attributes-natural-language
+  *    requested-attributes
+  *    printer-uri (Get-Printer-Attributes only)
+  */
+
+  if (all || cupsArrayGetCount(names) > 1)
+  {
+    request = ippNewRequest(IPP_OP_CUPS_GET_PRINTERS);
+  }
+  else
+  {
+    cupsCopyString(dname, (char *)cupsArrayGetFirst(names), sizeof(dname));
+    if ((instance = strchr(dname, '/')) != NULL)
+      *instance = '\0';
+
+    request = ippNewRequest(IPP_OP_GET_PRINTER_ATTRIBUTES);
+
+    httpAssembleURIf(HTTP_URI_CODING_ALL, resource, sizeof(resource), "ipp", NULL, "localhost", 0, "/printers/%s", dname);
+    ippAddString(request, IPP_TAG_OPERATION, IPP_TAG_URI, "printer-uri", NULL, resource);
+  }
+
+  ippAddStrings(request, IPP_TAG_OPERATION, IPP_TAG_KEYWORD, "requested-attributes", sizeof(pattrs) / sizeof(pattrs[0]), NULL, pattrs);
+  ippAddString(request, IPP_TAG_OPERATION, IPP_TAG_NAME, "requesting-user-name", NULL, cupsGetUser());
+
+  if (all)
+    names = cupsArrayNew(NULL, NULL, NULL, 0, (cups_acopy_cb_t)strdup, (cups_afree_cb_t)free);
+
+  memset(&fetch, 0, sizeof(fetch));
+
+  response = cupsDoRequest(conn_get_default(), request, "/");
+
+  if (cupsLastError() == IPP_STATUS_ERROR_NOT_FOUND)
+  {
+    cupsLangPuts(stderr, _("lpoptions: Unknown printer or class."));
+    ippDelete(response);
+    cupsArrayDelete(cache);
+    return (1);
+  }
+  else if (response && cupsLastError() <= IPP_STATUS_OK_CONFLICTING)
+  {
+    validated = true;
+
+    // Check the configuration times against the cache...
+    for (attr = ippGetFirstAttribute(response); attr; attr = ippGetNextAttribute(response))
+    {
+      // Skip leading attributes until we hit a printer...
+      while (attr && ippGetGroupTag(attr) != IPP_TAG_PRINTER)
+        attr = ippGetNextAttribute(response);
+
+      if (!attr)
+        break;
+
+      // Pull the needed attributes from this printer...
+      name        = NULL;
+      uri         = NULL;
+      config_time = 0;
+
+      for (; attr && ippGetGroupTag(attr) == IPP_TAG_PRINTER; attr = ippGetNextAttribute(response))
+      {
+        if (!strcmp(ippGetName(attr), "printer-name") && ippGetValueTag(attr) == IPP_TAG_NAME)
+          name = ippGetString(attr, 0, NULL);
+        else if (!strcmp(ippGetName(attr), "printer-uri-supported") && ippGetValueTag(attr) == IPP_TAG_URI)
+          uri = ippGetString(attr, 0, NULL);
+        else if (!strcmp(ippGetName(attr), "printer-config-change-time") && ippGetValueTag(attr) == IPP_TAG_INTEGER)
+          config_time = ippGetInteger(attr, 0);
+      }
+
+      if (name && uri)
+      {
+	cupsCopyString(key.printer, name, sizeof(key.printer));
+
+	if ((caps = (lpopt_caps_t *)cupsArrayFind(cache, &key)) == NULL)
+	{
+	  if ((caps = (lpopt_caps_t *)calloc(1, sizeof(lpopt_caps_t))) == NULL)
+	    break;
+
+	  cupsCopyString(caps->server, key.server, sizeof(caps->server));
+	  cupsCopyString(caps->printer, name, sizeof(caps->printer));
+	  caps->config_time = -1;
+
+	  cupsArrayAdd(cache, caps);
+	}
+
+	cupsCopyString(caps->uri, uri, sizeof(caps->uri));
+	caps->new_time = config_time;
+
+	if (all)
+	  cupsArrayAdd(names, (void *)name);
+      }
+
+      if (!attr)
+        break;
+    }
+
+    // Then collect the new and changed printers we are listing...
+    if ((fetch.caps = calloc((size_t)cupsArrayGetCount(names) + 1, sizeof(lpopt_caps_t *))) != NULL)
+    {
+      for (name = (const char *)cupsArrayGetFirst(names); name; name = (const char *)cupsArrayGetNext(names))
+      {
+	cupsCopyString(key.printer, name, sizeof(key.printer));
+	if ((instance = strchr(key.printer, '/')) != NULL)
+	  *instance = '\0';
+
+        if ((caps = (lpopt_caps_t *)cupsArrayFind(cache, &key)) != NULL && caps->uri[0] && caps->config_time != caps->new_time && !caps->queued)
+        {
+          caps->queued = true;
+          fetch.caps[fetch.num_caps ++] = caps;
+        }
+      }
+    }
+  }
+  else if (all)
+  {
+    // Use the cached printers for this server...
+    for (caps = (lpopt_caps_t *)cupsArrayGetFirst(cache); caps; caps = (lpopt_caps_t *)cupsArrayGetNext(cache))
+    {
+      if (!strcmp(caps->server, key.server))
+        cupsArrayAdd(names, caps->printer);
+    }
+  }
+
+  ippDelete(response);
+
+  if (fetch.num_caps > 0)
+  {
+    // Get the capabilities of new and changed printers - the server settings
+    // are per-thread so pass them to the fetch threads...
+    fetch.server     = cupsGetServer();
+    fetch.port       = ippGetPort();
+    fetch.encryption = cupsGetEncryption();
+
+    cupsMutexInit(&fetch.mutex);
+
+    if ((num_threads = fetch.num_caps) > LPOPT_MAX_THREADS)
+      num_threads = LPOPT_MAX_THREADS;
+
+    for (i = 0; i < num_threads; i ++)
+    {
+      if (num_threads == 1 || (threads[i] = cupsThreadCreate((cups_thread_func_t)fetch_caps, &fetch)) == CUPS_THREAD_INVALID)
+        break;
+    }
+
+    if (i == 0)
+    {
+      // No threads, fetch everything from this thread...
+      fetch_caps(&fetch);
+    }
+    else
+    {
+      while (i > 0)
+        cupsThreadWait(threads[-- i]);
+    }
+
+    cupsMutexDestroy(&fetch.mutex);
+
+    save_caps(cachefile, cache);
+  }
+
+  free(fetch.caps);
+
+  // List the options for each destination...
+  for (name = (const char *)cupsArrayGetFirst(names); name; name = (const char *)cupsArrayGetNext(names))
+  {
+    cupsCopyString(dname, name, sizeof(dname));
+    if ((instance = strchr(dname, '/')) != NULL)
+      *instance++ = '\0';
+
+    cupsCopyString(key.printer, dname, sizeof(key.printer));
+
+    caps = (lpopt_caps_t *)cupsArrayFind(cache, &key);
+
+    if (validated && (!caps || !caps->uri[0]))
+    {
+      cupsLangPrintf(stderr, _("lpoptions: Unknown printer or class %s."), name);
+      status = 1;
+      continue;
+    }
+    else if (!caps || caps->config_time < 0 || caps->error)
+    {
+      cupsLangPrintf(stderr, _("lpoptions: Unable to get printer capabilities for %s: %s"), name, caps && caps->error ? caps->error : cupsLastErrorString());
+      status = 1;
+      continue;
+    }
+
+    if (cupsArrayGetCount(names) > 1)
+      cupsLangPrintf(stdout, "%s:", name);
+
+    num_options = get_record(lf, sysf, dname, instance, &options);
+
+    for (i = 0; i < caps->num_supported; i ++)
+    {
+      // Mark the current value with an asterisk...
+      if ((current = cupsGetOption(caps->supported[i].name, num_options, options)) == NULL)
+        current = cupsGetOption(caps->supported[i].name, caps->num_defaults, caps->defaults);
+
+      snprintf(buffer, sizeof(buffer), "%s%s:", cupsArrayGetCount(names) > 1 ? "  " : "", caps->supported[i].name);
+      ptr    = buffer + strlen(buffer);
+      marked = false;
+
+      for (value = caps->supported[i].value; *value && ptr < (buffer + sizeof(buffer) - 1); value = next)
+      {
+        if ((next = strchr(value, ' ')) != NULL)
+          *next = '\0';
+
+        if (current && !strcmp(value, current))
+        {
+          snprintf(ptr, sizeof(buffer) - (size_t)(ptr - buffer), " *%s", value);
+          marked = true;
+        }
+        else
+        {
+          snprintf(ptr, sizeof(buffer) - (size_t)(ptr - buffer), " %s", value);
+        }
+
+        ptr += strlen(ptr);
+
+        if (next)
+          *next++ = ' ';
+        else
+          next = value + strlen(value);
+      }
+
+      if (current && *current && !marked && ptr < (buffer + sizeof(buffer) - 1))
+        snprintf(ptr, sizeof(buffer) - (size_t)(ptr - buffer), " *%s", current);
+
+      cupsLangPuts(stdout, buffer);
+    }
+
+    cupsFreeOptions(num_options, options);
+  }
+
+  if (all)
+    cupsArrayDelete(names);
+
+  cupsArrayDelete(cache);
+
+  return (status);
+}
+
+
+//
+// 'load_caps()' - Load the capability cache.
+//
+// Each printer starts with a "server<TAB>printer<TAB>config-change-time" line
+// followed by "<TAB>name<TAB>default<TAB>supported values" lines.
+//
+
+static cups_array_t *			// O - Cached printers
+load_caps(const char *cachefile)	// I - Capability cache file or `NULL`
+{
+  cups_array_t	*cache;			// Cached printers
+  cups_file_t	*fp;			// Cache file
+  char		line[16384],		// Line from file
+		*name,			// Printer or option name
+		*value,			// Config time or default value
+		*supported;		// Supported values
+  lpopt_caps_t	*caps = NULL;		// Current printer
+
+
+  cache = cupsArrayNew((cups_array_cb_t)compare_caps, NULL, NULL, 0, NULL, (cups_afree_cb_t)free_caps);
+
+  if (!cachefile || (fp = cupsFileOpen(cachefile, "r")) == NULL)
+    return (cache);
+
+  while (cupsFileGets(fp, line, sizeof(line)))
+  {
+    if (line[0] == '\t')
+    {
+      // Option line...
+      name = line + 1;
+
+      if (!caps || (value = strchr(name, '\t')) == NULL)
+        continue;
+      *value++ = '\0';
+
+      if ((supported = strchr(value, '\t')) == NULL)
+        continue;
+      *supported++ = '\0';
+
+      caps->num_supported = cupsAddOption(name, supported, caps->num_supported, &caps->supported);
+      caps->num_defaults  = cupsAddOption(name, value, caps->num_defaults, &caps->defaults);
+    }
+    else
+    {
+      // Printer line...
+      caps = NULL;
+
+      if ((name = strchr(line, '\t')) == NULL)
+        continue;
+      *name++ = '\0';
+
+      if ((value = strchr(name, '\t')) == NULL)
+        continue;
+      *value++ = '\0';
+
+      if ((caps = (lpopt_caps_t *)calloc(1, sizeof(lpopt_caps_t))) == NULL)
+        break;
+
+      cupsCopyString(caps->server, line, sizeof(caps->server));
+      cupsCopyString(caps->printer, name, sizeof(caps->printer));
+      caps->config_time = (int)strtol(value, NULL, 10);
+
+      if (cupsArrayFind(cache, caps))
+      {
+        free(caps);
+        caps = NULL;
+      }
+      else
+      {
+        cupsArrayAdd(cache, caps);
+      }
+    }
+  }
+
+  cupsFileClose(fp);
+
+  return (cache);
+}
+
+
+//
+// 'read_file()' - Read an lpoptions file.
+//
+
+static bool				// O - `true` on success, `false` on error
+read_file(lpopt_file_t *lf,		// I - lpoptions file
+          const char   *filename)	// I - Filename
+{
+  cups_file_t	*fp;			// File
+  char		line[65536];		// Line from file
+
+
+  cupsCopyString(lf->filename, filename, sizeof(lf->filename));
+
+  if ((fp = cupsFileOpen(filename, "r")) == NULL)
+    return (false);
+
+  while (cupsFileGets(fp, line, sizeof(line)))
+  {
+    if (!add_line(lf, strdup(line)))
+      break;
+  }
+
+  cupsFileClose(fp);
+
+  return (true);
+}
+
+
+//
+// 'remove_record()' - Remove the line for a destination.
+//
+
+static bool				// O - `true` if removed, `false` if not found
+remove_record(lpopt_file_t *lf,		// I - lpoptions file
+              const char   *name,	// I - Destination name
+              const char   *instance)	// I - Instance name or `NULL`
+{
+  size_t	line;			// Line number
+
+
+  if ((line = find_record(lf, name, instance)) == SIZE_MAX)
+    return (false);
+
+  free(lf->lines[line]);
+
+  lf->num_lines --;
+  if (line < lf->num_lines)
+    memmove(lf->lines + line, lf->lines + line + 1, (lf->num_lines - line) * sizeof(char *));
+
+  lf->changed = true;
+
+  return (true);
+}
+
+
+//
+// 'save_caps()' - Save the capability cache.
+//
+
+static void
+save_caps(const char   *cachefile,	// I - Capability cache file or `NULL`
+          cups_array_t *cache)		// I - Cached printers
+{
+  cups_file_t	*fp;			// Cache file
+  char		temp[1024];		// Temporary file
+  lpopt_caps_t	*caps;			// Current printer
+  size_t	i;			// Looping var
+
+
+  if (!cachefile)
+    return;
+
+  // Write to a temporary file and then replace the cache...
+  snprintf(temp, sizeof(temp), "%s.%d", cachefile, (int)getpid());
+
+  if ((fp = cupsFileOpen(temp, "w")) == NULL)
+  {
+    // Try creating the ~/.cups directory first...
+    char	dir[1024],		// Cache directory
+		*ptr;			// Pointer into directory
+
+    cupsCopyString(dir, cachefile, sizeof(dir));
+    if ((ptr = strrchr(dir, '/')) != NULL)
+      *ptr = '\0';
+
+    if (mkdir(dir, 0700) || (fp = cupsFileOpen(temp, "w")) == NULL)
+      return;
+  }
+
+  set_file_mode(fp, cachefile, 0644);
+
+  for (caps = (lpopt_caps_t *)cupsArrayGetFirst(cache); caps; caps = (lpopt_caps_t *)cupsArrayGetNext(cache))
+  {
+    // Don't cache printers we failed to get...
+    if (caps->config_time < 0 || caps->error)
+      continue;
+
+    cupsFilePrintf(fp, "%s\t%s\t%d\n", caps->server, caps->printer, caps->config_time);
+
+    for (i = 0; i < caps->num_supported; i ++)
+      cupsFilePrintf(fp, "\t%s\t%s\t%s\n", caps->supported[i].name, cupsGetOption(caps->supported[i].name, caps->num_defaults, caps->defaults), caps->supported[i].value);
+  }
+
+  if (cupsFileClose(fp) || rename(temp, cachefile))
+    unlink(temp);
+}
+
+
+//
+// 'set_default()' - Set the default destination.
+//
+// The current "Default" line (if any) becomes a "Dest" line, and the line
+// for the new default becomes the "Default" line.
+//
+
+static bool				// O - `true` on success, `false` on error
+set_default(lpopt_file_t *lf,		// I - lpoptions file
+            const char   *name,		// I - Destination name
+            const char   *instance)	// I - Instance name or `NULL`
+{
+  size_t	i,			// Looping var
+		line;			// Line number
+  const char	*ptr;			// Pointer into line
+  bool		is_default;		// "Default" line?
+  char		*newline;		// New line
+
+
+  for (i = 0; i < lf->num_lines; i ++)
+  {
+    if ((ptr = skip_keyword(lf->lines[i], &is_default)) == NULL || !is_default)
+      continue;
+
+    // Change "Default name..." to "Dest name..."...
+    if ((newline = malloc(strlen(ptr) + 6)) == NULL)
+      return (false);
+
+    snprintf(newline, strlen(ptr) + 6, "Dest %s", ptr);
+
+    free(lf->lines[i]);
+    lf->lines[i] = newline;
+    lf->changed  = true;
+  }
+
+  if ((line = find_record(lf, name, instance)) == SIZE_MAX)
+  {
+    if (!add_line(lf, format_record("Default", name, instance, 0, NULL)))
+      return (false);
+  }
+  else
+  {
+    // Change "Dest name..." to "Default name..."...
+    ptr = skip_keyword(lf->lines[line], NULL);
+
+    if ((newline = malloc(strlen(ptr) + 9)) == NULL)
+      return (false);
+
+    snprintf(newline, strlen(ptr) + 9, "Default %s", ptr);
+
+    free(lf->lines[line]);
+    lf->lines[line] = newline;
+  }
+
+  lf->changed = true;
+
+  return (true);
+}
+
+
+//
+// 'set_file_mode()' - Give a temporary file the original file's permissions.
+//
+// Without this the replacement file gets the umask permissions and the
+// ownership of the caller, which breaks the system file when root's umask
+// is restrictive.
+//
+
+static void
+set_file_mode(cups_file_t *fp,		// I - Temporary file
+              const char  *filename,	// I - Original file
+              mode_t      mode)		// I - Permissions for a new file
+{
+  struct stat	info;			// Original file information
+
+
+  if (stat(filename, &info))
+  {
+    fchmod(cupsFileNumber(fp), mode);
+    return;
+  }
+
+  if (!getuid() && fchown(cupsFileNumber(fp), info.st_uid, info.st_gid))
+    cupsLangPrintf(stderr, _("lpoptions: Unable to change ownership of \"%s\": %s"), filename, strerror(errno));
+
+  fchmod(cupsFileNumber(fp), info.st_mode & 07777);
+}
+
+
+//
+// 'set_record()' - Set the options for a destination.
+//
+// Only the line for the destination is replaced, keeping its "Dest" or
+// "Default" keyword.  A "Dest" line without options or an instance is
+// removed.
+//
+
+static bool				// O - `true` on success, `false` on error
+set_record(lpopt_file_t  *lf,		// I - lpoptions file
+           const char    *name,		// I - Destination name
+           const char    *instance,	// I - Instance name or `NULL`
+           size_t        num_options,	// I - Number of options
+           cups_option_t *options)	// I - Options
+{
+  size_t	line;			// Line number
+  bool		is_default = false;	// "Default" line?
+  char		*newline;		// New line
+
+
+  if ((line = find_record(lf, name, instance)) != SIZE_MAX)
+    skip_keyword(lf->lines[line], &is_default);
+
+  if (!num_options && !instance && !is_default)
+  {
+    remove_record(lf, name, instance);
+    return (true);
+  }
+
+  if ((newline = format_record(is_default ? "Default" : "Dest", name, instance, num_options, options)) == NULL)
+    return (false);
+
+  if (line == SIZE_MAX)
+  {
+    if (!add_line(lf, newline))
+      return (false);
+  }
+  else if (!strcmp(lf->lines[line], newline))
+  {
+    // No change...
+    free(newline);
+    return (true);
+  }
+  else
+  {
+    free(lf->lines[line]);
+    lf->lines[line] = newline;
+  }
+
+  lf->changed = true;
+
+  return (true);
+}
+
+
+//
+// 'skip_keyword()' - Skip the "Dest" or "Default" keyword in a line.
+//
+
+static const char *			// O - Pointer to destination name or `NULL` if not a destination line
+skip_keyword(const char *line,		// I - Line
+             bool       *is_default)	// O - `true` for a "Default" line or `NULL`
+{
+  bool	def;				// "Default" line?
+
+
+  if (!strncasecmp(line, "Dest", 4) && isspace(line[4] & 255))
+  {
+    def  = false;
+    line += 4;
+  }
+  else if (!strncasecmp(line, "Default", 7) && isspace(line[7] & 255))
+  {
+    def  = true;
+    line += 7;
+  }
+  else
+  {
+    return (NULL);
+  }
+
+  while (isspace(*line & 255))
+    line ++;
+
+  if (is_default)
+    *is_default = def;
+
+  return (*line ? line : NULL);
+}
+
+
+//
+// 'usage()' - Show program usage and exit.
+//
+
+static void
+usage(void)
+{
+  cupsLangPuts(stdout, _("Usage: lpoptions [options] -d destination\n"
+                          "       lpoptions [options] [-p destination] [-l]\n"
+                          "       lpoptions [options] -a -l\n"
+                          "       lpoptions [options] [-p destination] -o option[=value]\n"
+                          "       lpoptions [options] -x destination"));
+  cupsLangPuts(stdout, _("Options:"));
+  cupsLangPuts(stdout, _("-a                      Show supported options for all destinations"));
+  cupsLangPuts(stdout, _("-d destination          Set default destination"));
+  cupsLangPuts(stdout, _("-E                      Encrypt the connection to the server"));
+  cupsLangPuts(stdout, _("-h server[:port]        Connect to the named server and port"));
+  cupsLangPuts(stdout, _("-l                      Show supported options and values"));
+  cupsLangPuts(stdout, _("-o name[=value]         Set default option and value"));
+  cupsLangPuts(stdout, _("-p destination          Specify a destination"));
+  cupsLangPuts(stdout, _("-U username             Specify the username to use for authentication"));
+  cupsLangPuts(stdout, _("-x destination          Remove default options for destination"));
+
+  exit(1);
+}
+
+
+//
+// 'value_string()' - Convert an attribute value to a string.
+//
+// Values that cannot be given on the command line without quoting are
+// skipped.
+//
+
+static bool				// O - `true` on success, `false` to skip
+value_string(ipp_attribute_t *attr,	// I - Attribute
+             size_t          element,	// I - Value index
+             char            *buffer,	// I - String buffer
+             size_t          bufsize)	// I - Size of string buffer
+{
+  int		lower,			// Lower value
+		upper;			// Upper value
+  ipp_res_t	units;			// Resolution units
+  const char	*s;			// String value
+
+
+  switch (ippGetValueTag(attr))
+  {
+    case IPP_TAG_INTEGER :
+        snprintf(buffer, bufsize, "%d", ippGetInteger(attr, element));
+        break;
+
+    case IPP_TAG_ENUM :
+        cupsCopyString(buffer, ippEnumString(ippGetName(attr), ippGetInteger(attr, element)), bufsize);
+        break;
+
+    case IPP_TAG_BOOLEAN :
+        cupsCopyString(buffer, ippGetBoolean(attr, element) ? "true" : "false", bufsize);
+        break;
+
+    case IPP_TAG_RANGE :
+        lower = ippGetRange(attr, element, &upper);
+        snprintf(buffer, bufsize, "%d-%d", lower, upper);
+        break;
+
+    case IPP_TAG_RESOLUTION :
+        lower = ippGetResolution(attr, element, &upper, &units);
+        if (lower == upper)
+          snprintf(buffer, bufsize, "%d%s", lower, units == IPP_RES_PER_INCH ? "dpi" : "dpcm");
+        else
+          snprintf(buffer, bufsize, "%dx%d%s", lower, upper, units == IPP_RES_PER_INCH ? "dpi" : "dpcm");
+        break;
+
+    case IPP_TAG_KEYWORD :
+    case IPP_TAG_MIMETYPE :
+    case IPP_TAG_NAME :
+    case IPP_TAG_NAMELANG :
+    case IPP_TAG_URI :
+        if ((s = ippGetString(attr, element, NULL)) == NULL || strpbrk(s, " \t\n'\"\\"))
+          return (false);
+
+        cupsCopyString(buffer, s, bufsize);
+        break;
+
+    default :
+        return (false);
+  }
+
+  return (buffer[0] != '\0');
+}
+
+
+//
+// 'write_file()' - Write an lpoptions file.
+//
+// The file is written to a temporary file which then replaces the original
+// so that other programs never see a partially written file.  The temporary
+// file gets the permissions and ownership of the original.
+//
+
+static bool				// O - `true` on success, `false` on error
+write_file(lpopt_file_t *lf)		// I - lpoptions file
+{
+  cups_file_t	*fp;			// File
+  char		temp[1024];		// Temporary file
+  size_t	i;			// Looping var
+
+
+  if (!lf->filename[0])
+  {
+    errno = ENOENT;
+    return (false);
+  }
+
+  snprintf(temp, sizeof(temp), "%s.%d", lf->filename, (int)getpid());
+
+  if ((fp = cupsFileOpen(temp, "w")) == NULL)
+  {
+    // Try creating the ~/.cups directory first...
+    char	dir[1024],		// lpoptions directory
+		*ptr;			// Pointer into directory
+
+    cupsCopyString(dir, lf->filename, sizeof(dir));
+    if ((ptr = strrchr(dir, '/')) != NULL)
+      *ptr = '\0';
+
+    if (mkdir(dir, 0700) || (fp = cupsFileOpen(temp, "w")) == NULL)
+      return (false);
+  }
+
+  set_file_mode(fp, lf->filename, 0644);
+
+  for (i = 0; i < lf->num_lines; i ++)
+    cupsFilePrintf(fp, "%s\n", lf->lines[i]);
+
+  if (cupsFileClose(fp) || rename(temp, lf->filename))
+  {
+    int	err = errno;			// Saved error
+
+    unlink(temp);
+    errno = err;
+
+    return (false);
+  }
+
+  lf->changed = false;
+
+  return (true);
 }
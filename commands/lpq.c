@@ -9,7 +9,26 @@
 // information.
 //
 
-#include "localize.h"
+#include "conn.h"
+#include "fanout.h"
+#include "stream.h"
+#include "watch.h"
+
+
+//
+// Local types...
+//
+
+typedef struct lpq_job_s		// Job information
+{
+  int		id,			// job-id
+		size,			// job-k-octets
+		copies;			// copies
+  ipp_jstate_t	state;			// job-state
+  const char	*dest,			// Pointer into job-printer-uri
+		*name,			// job-name
+		*user;			// job-originating-user-name
+} lpq_job_t;
 
 
 //
@@ -17,9 +36,13 @@
 //
 
 static http_t	*connect_server(const char *command, http_t *http);
+static ipp_attribute_t *get_job(ipp_t *response, ipp_attribute_t *attr, lpq_job_t *job);
+static ipp_t	*jobs_request(const char *dest, const char *user, const int id, const int longstatus);
+static void	show_job(watch_t *watch, lpq_job_t *job, int *rank, const int longstatus);
 static int	show_jobs(const char *command, http_t *http, const char *dest, const char *user, const int id, const int longstatus);
-static void	show_printer(const char *command, http_t *http, const char *dest);
+static void	show_printer(const char *command, http_t *http, const char *dest, watch_t *watch);
 static void	usage(void) _CUPS_NORETURN;
+static int	watch_jobs(const char *command, http_t *http, const char *dest, const char *user, const int id, const int longstatus, int interval);
 
 
 //
@@ -30,7 +53,8 @@ int
 main(int  argc,				// I - Number of command-line arguments
      char *argv[])			// I - Command-line arguments
 {
-  int		i;			// Looping var
+  int		i,			// Looping var
+		status;			// Exit status
   http_t	*http;			// Connection to server
   const char	*opt,			// Option pointer
 		*dest,			// Desired printer
@@ -46,6 +70,10 @@ main(int  argc,				// I - Number of command-line arguments
 
   localize_init(argv);
 
+  // Run the command on each server when more than one is named...
+  if (fanout_servers(argc, argv, main, FANOUT_MERGE_SECTIONS, &status))
+    return (status);
+
  /*
   * Check for command-line options...
   */
@@ -66,6 +94,8 @@ main(int  argc,				// I - Number of command-line arguments
     }
     else if (!strcmp(argv[i], "--help"))
       usage();
+    else if (fanout_skip_option(argc, argv, &i))
+      continue;
     else if (argv[i][0] == '-')
     {
       for (opt = argv[i] + 1; *opt; opt ++)
@@ -113,11 +143,7 @@ main(int  argc,				// I - Number of command-line arguments
 		i ++;
 
 		if (i >= argc)
-		{
-		  httpClose(http);
-
 		  usage();
-		}
 
 		dest = argv[i];
 	      }
@@ -148,11 +174,7 @@ main(int  argc,				// I - Number of command-line arguments
 	      break;
 
 	  case 'h' : // Connect to host
-	      if (http)
-	      {
-		httpClose(http);
-		http = NULL;
-	      }
+	      http = NULL;
 
 	      if (opt[1] != '\0')
 	      {
@@ -178,8 +200,6 @@ main(int  argc,				// I - Number of command-line arguments
 	      break;
 
 	  default :
-	      httpClose(http);
-
 	      usage();
 	}
       }
@@ -233,7 +253,6 @@ main(int  argc,				// I - Number of command-line arguments
 	cupsLangPrintf(stderr,
 	                _("%s: Error - no default destination available."),
 			argv[0]);
-      httpClose(http);
       return (1);
     }
 
@@ -244,12 +263,16 @@ main(int  argc,				// I - Number of command-line arguments
   * Show the status in a loop...
   */
 
+  if (interval > 0 && isatty(1))
+    return (watch_jobs(argv[0], http, dest, user, id, longstatus, interval));
+
   for (;;)
   {
     if (dest)
-      show_printer(argv[0], http, dest);
+      show_printer(argv[0], http, dest, NULL);
 
-    i = show_jobs(argv[0], http, dest, user, id, longstatus);
+    if ((i = show_jobs(argv[0], http, dest, user, id, longstatus)) < 0)
+      return (1);
 
     if (i && interval)
     {
@@ -260,12 +283,6 @@ main(int  argc,				// I - Number of command-line arguments
       break;
   }
 
- /*
-  * Close the connection to the server and return...
-  */
-
-  httpClose(http);
-
   return (0);
 }
 
@@ -280,9 +297,7 @@ connect_server(const char *command,	// I - Command name
 {
   if (!http)
   {
-    http = httpConnect(cupsGetServer(), ippGetPort(), /*addrlist*/NULL, AF_UNSPEC,  cupsGetEncryption(), /*blocking*/true, /*msec*/30000, /*cancel*/NULL);
-
-    if (http == NULL)
+    if ((http = conn_get_default()) == NULL)
     {
       cupsLangPrintf(stderr, _("%s: Unable to connect to server."), command);
       exit(1);
@@ -294,60 +309,73 @@ connect_server(const char *command,	// I - Command name
 
 
 //
-// 'show_jobs()' - Show jobs.
+// 'get_job()' - Get the attributes of a job.
 //
 
-static int				// O - Number of jobs in queue
-show_jobs(const char *command,		// I - Command name
-          http_t     *http,		// I - HTTP connection to server
-          const char *dest,		// I - Destination
-	  const char *user,		// I - User
-	  const int  id,		// I - Job ID
-	  const int  longstatus)	// I - 1 if long report desired
+static ipp_attribute_t *		// O - Attribute after the job
+get_job(ipp_t           *response,	// I - IPP response
+        ipp_attribute_t *attr,		// I - First attribute of job
+        lpq_job_t       *job)		// O - Job information
 {
-  ipp_t		*request,		// IPP Request
-		*response;		// IPP Response
-  ipp_attribute_t *attr;		// Current attribute
-  const char	*jobdest,		// Pointer into job-printer-uri
-		*jobuser,		// Pointer to job-originating-user-name
-		*jobname;		// Pointer to job-name
-  ipp_jstate_t	jobstate;		// job-state
-  int		jobid,			// job-id
-		jobsize,		// job-k-octets
-		jobcount,		// Number of jobs
-		jobcopies,		// Number of copies
-		rank;			// Rank of job
-  char		resource[1024];		// Resource string
-  char		rankstr[255];		// Rank string
-  char		namestr[1024];		// Job name string
-  static const char * const jobattrs[] =// Job attributes we want to see
-		{
-		  "copies",
-		  "job-id",
-		  "job-k-octets",
-		  "job-name",
-		  "job-originating-user-name",
-		  "job-printer-uri",
-		  "job-priority",
-		  "job-state"
-		};
-  static const char * const ranks[10] =	// Ranking strings
-		{
-		  "th",
-		  "st",
-		  "nd",
-		  "rd",
-		  "th",
-		  "th",
-		  "th",
-		  "th",
-		  "th",
-		  "th"
-		};
+  job->id     = 0;
+  job->size   = 0;
+  job->copies = 1;
+  job->state  = IPP_JSTATE_PENDING;
+  job->dest   = NULL;
+  job->name   = "unknown";
+  job->user   = "unknown";
+
+  while (attr != NULL && ippGetGroupTag(attr) == IPP_TAG_JOB)
+  {
+    const char *name = ippGetName(attr);
+    ipp_tag_t value_tag = ippGetValueTag(attr);
 
+    if (!strcmp(name, "job-id") && value_tag == IPP_TAG_INTEGER)
+      job->id = ippGetInteger(attr, 0);
+
+    if (!strcmp(name, "job-k-octets") && value_tag == IPP_TAG_INTEGER)
+      job->size = ippGetInteger(attr, 0);
+
+    if (!strcmp(name, "job-state") && value_tag == IPP_TAG_ENUM)
+      job->state = (ipp_jstate_t)ippGetInteger(attr, 0);
+
+    if (!strcmp(name, "job-printer-uri") && value_tag == IPP_TAG_URI)
+    {
+      if ((job->dest = strrchr(ippGetString(attr, 0, NULL), '/')) != NULL)
+	job->dest ++;
+    }
+
+    if (!strcmp(name, "job-originating-user-name") && value_tag == IPP_TAG_NAME)
+      job->user = ippGetString(attr, 0, NULL);
+
+    if (!strcmp(name, "job-name") && value_tag == IPP_TAG_NAME)
+      job->name = ippGetString(attr, 0, NULL);
+
+    if (!strcmp(name, "copies") && value_tag == IPP_TAG_INTEGER)
+      job->copies = ippGetInteger(attr, 0);
+
+    attr = ippGetNextAttribute(response);
+  }
+
+  return (attr);
+}
+
+
+//
+// 'jobs_request()' - Make the request for the jobs to show.
+//
+
+static ipp_t *				// O - IPP request
+jobs_request(const char *dest,		// I - Destination
+	     const char *user,		// I - User
+	     const int  id,		// I - Job ID
+	     const int  longstatus)	// I - 1 if long report desired
+{
+  ipp_t		*request;		// IPP Request
+  char		resource[1024];		// Resource string
+  size_t	num_jobattrs = 0;	// Number of job attributes
+  const char	*jobattrs[7];		// Job attributes we want to see
 
-  if (http == NULL)
-    return (0);
 
   // Build an Get-Jobs or Get-Job-Attributes request, which requires the
   // following attributes:
@@ -385,78 +413,139 @@ show_jobs(const char *command,		// I - Command name
     ippAddString(request, IPP_TAG_OPERATION, IPP_TAG_NAME, "requesting-user-name", NULL, cupsGetUser());
   }
 
-  ippAddStrings(request, IPP_TAG_OPERATION, IPP_TAG_KEYWORD, "requested-attributes", sizeof(jobattrs) / sizeof(jobattrs[0]), NULL, jobattrs);
+  // Only ask for the attributes that will be shown...
+  jobattrs[num_jobattrs ++] = "job-id";
+  jobattrs[num_jobattrs ++] = "job-k-octets";
+  jobattrs[num_jobattrs ++] = "job-name";
+  jobattrs[num_jobattrs ++] = "job-originating-user-name";
+  jobattrs[num_jobattrs ++] = "job-printer-uri";
+  jobattrs[num_jobattrs ++] = "job-state";
+
+  if (longstatus)
+    jobattrs[num_jobattrs ++] = "copies";
+
+  ippAddStrings(request, IPP_TAG_OPERATION, IPP_TAG_KEYWORD, "requested-attributes", num_jobattrs, NULL, jobattrs);
+
+  return (request);
+}
+
+
+//
+// 'show_job()' - Show a job.
+//
+
+static void
+show_job(watch_t   *watch,		// I - Job list dashboard or `NULL` for the standard output
+         lpq_job_t *job,		// I - Job information
+         int       *rank,		// IO - Rank of next job
+         const int longstatus)		// I - 1 if long report desired
+{
+  char		rankstr[255];		// Rank string
+  char		namestr[1024];		// Job name string
+  static const char * const ranks[10] =	// Ranking strings
+		{
+		  "th",
+		  "st",
+		  "nd",
+		  "rd",
+		  "th",
+		  "th",
+		  "th",
+		  "th",
+		  "th",
+		  "th"
+		};
 
-  // Do the request and get back a response...
-  jobcount = 0;
 
-  if ((response = cupsDoRequest(http, request, "/")) != NULL)
+  if (job->state == IPP_JSTATE_PROCESSING)
   {
-    if (ippGetStatusCode(response) > IPP_STATUS_OK_CONFLICTING)
-    {
-      cupsLangPrintf(stderr, "%s: %s", command, cupsLastErrorString());
-      ippDelete(response);
-      return (0);
-    }
+    cupsCopyString(rankstr, "active", sizeof(rankstr));
+  }
+  else
+  {
+    // Make the rank show the "correct" suffix for each number (11-13 are
+    // the only special cases, for English anyways...)
+    if ((*rank % 100) >= 11 && (*rank % 100) <= 13)
+      snprintf(rankstr, sizeof(rankstr), "%dth", *rank);
+    else
+      snprintf(rankstr, sizeof(rankstr), "%d%s", *rank, ranks[*rank % 10]);
 
-    rank = 1;
+    (*rank) ++;
+  }
 
-    // Loop through the job list and display them...
-    for (attr = ippGetFirstAttribute(response); attr != NULL; attr = ippGetNextAttribute(response))
-    {
-      // Skip leading attributes until we hit a job...
-      while (attr != NULL && ippGetGroupTag(attr) != IPP_TAG_JOB)
-        attr = ippGetNextAttribute(response);
+  if (longstatus)
+  {
+    watch_printf(watch, "\n");
 
-      if (attr == NULL)
-        break;
+    if (job->copies > 1)
+      cupsLangFormatString(cupsLangDefault(), namestr, sizeof(namestr), _("%d copies of %s"), job->copies, job->name);
+    else
+      cupsCopyString(namestr, job->name, sizeof(namestr));
 
-     /*
-      * Pull the needed attributes from this job...
-      */
+    watch_printf(watch, _("%s: %-33.33s [job %d localhost]"), job->user, rankstr, job->id);
+    watch_printf(watch, _("        %-39.39s %.0f bytes"), namestr, 1024.0 * job->size);
+  }
+  else
+  {
+    watch_printf(watch, _("%-7s %-7.7s %-7d %-31.31s %.0f bytes"), rankstr, job->user, job->id, job->name, 1024.0 * job->size);
+  }
+}
 
-      jobid       = 0;
-      jobsize     = 0;
-      jobstate    = IPP_JSTATE_PENDING;
-      jobname     = "unknown";
-      jobuser     = "unknown";
-      jobdest     = NULL;
-      jobcopies   = 1;
 
-      while (attr != NULL && ippGetGroupTag(attr) == IPP_TAG_JOB)
-      {
-        const char *name = ippGetName(attr);
-        ipp_tag_t value_tag = ippGetValueTag(attr);
+//
+// 'show_jobs()' - Show jobs.
+//
 
-        if (!strcmp(name, "job-id") && value_tag == IPP_TAG_INTEGER)
-	  jobid = ippGetInteger(attr, 0);
+static int				// O - Number of jobs in queue or -1 on error
+show_jobs(const char *command,		// I - Command name
+          http_t     *http,		// I - HTTP connection to server
+          const char *dest,		// I - Destination
+	  const char *user,		// I - User
+	  const int  id,		// I - Job ID
+	  const int  longstatus)	// I - 1 if long report desired
+{
+  ipp_t		*response;		// IPP Response
+  stream_t	*stream;		// Streaming response
+  ipp_attribute_t *attr;		// Current attribute
+  lpq_job_t	job;			// Current job
+  int		jobcount,		// Number of jobs
+		rank;			// Rank of job
 
-        if (!strcmp(name, "job-k-octets") && value_tag == IPP_TAG_INTEGER)
-	  jobsize = ippGetInteger(attr, 0);
 
-        if (!strcmp(name, "job-state") && value_tag == IPP_TAG_ENUM)
-	  jobstate = (ipp_jstate_t)ippGetInteger(attr, 0);
+  if (http == NULL)
+    return (0);
 
-        if (!strcmp(name, "job-printer-uri") && value_tag == IPP_TAG_URI)
-        {
-	  if ((jobdest = strrchr(ippGetString(attr, 0, NULL), '/')) != NULL)
-	    jobdest ++;
-	}
+  // Do the request and get back a response...
+  jobcount = 0;
 
-        if (!strcmp(name, "job-originating-user-name") && value_tag == IPP_TAG_NAME)
-	  jobuser = ippGetString(attr, 0, NULL);
+  stream = stream_open(conn_get_agent(http), jobs_request(dest, user, id, longstatus), "/");
 
-        if (!strcmp(name, "job-name") && value_tag == IPP_TAG_NAME)
-	  jobname = ippGetString(attr, 0, NULL);
+  if (stream_get_status(stream) > IPP_STATUS_OK_CONFLICTING)
+  {
+    cupsLangPrintf(stderr, "%s: %s", command, stream_get_status_message(stream));
+    stream_close(stream);
+    return (-1);
+  }
 
-        if (!strcmp(name, "copies") && value_tag == IPP_TAG_INTEGER)
-	  jobcopies = ippGetInteger(attr, 0);
+  rank = 1;
 
+  // Loop through the job list and display jobs as they are received...
+  while ((response = stream_next(stream)) != NULL)
+  {
+    for (attr = ippGetFirstAttribute(response); attr != NULL; attr = ippGetNextAttribute(response))
+    {
+      // Skip leading attributes until we hit a job...
+      while (attr != NULL && ippGetGroupTag(attr) != IPP_TAG_JOB)
         attr = ippGetNextAttribute(response);
-      }
+
+      if (attr == NULL)
+        break;
+
+      // Pull the needed attributes from this job...
+      attr = get_job(response, attr, &job);
 
       // See if we have everything needed...
-      if (jobdest == NULL || jobid == 0)
+      if (job.dest == NULL || job.id == 0)
       {
         if (attr == NULL)
 	  break;
@@ -470,51 +559,22 @@ show_jobs(const char *command,		// I - Command name
       jobcount ++;
 
       // Display the job...
-      if (jobstate == IPP_JSTATE_PROCESSING)
-      {
-	cupsCopyString(rankstr, "active", sizeof(rankstr));
-      }
-      else
-      {
-        // Make the rank show the "correct" suffix for each number (11-13 are
-        // the only special cases, for English anyways...)
-	if ((rank % 100) >= 11 && (rank % 100) <= 13)
-	  snprintf(rankstr, sizeof(rankstr), "%dth", rank);
-	else
-	  snprintf(rankstr, sizeof(rankstr), "%d%s", rank, ranks[rank % 10]);
-
-	rank ++;
-      }
-
-      if (longstatus)
-      {
-        cupsLangPuts(stdout, "\n");
-
-        if (jobcopies > 1)
-	  cupsLangFormatString(cupsLangDefault(), namestr, sizeof(namestr), _("%d copies of %s"), jobcopies, jobname);
-	else
-	  cupsCopyString(namestr, jobname, sizeof(namestr));
-
-        cupsLangPrintf(stdout, _("%s: %-33.33s [job %d localhost]"), jobuser, rankstr, jobid);
-        cupsLangPrintf(stdout, _("        %-39.39s %.0f bytes"), namestr, 1024.0 * jobsize);
-      }
-      else
-      {
-        cupsLangPrintf(stdout, _("%-7s %-7.7s %-7d %-31.31s %.0f bytes"), rankstr, jobuser, jobid, jobname, 1024.0 * jobsize);
-      }
+      show_job(NULL, &job, &rank, longstatus);
 
       if (attr == NULL)
         break;
     }
-
-    ippDelete(response);
   }
-  else
+
+  if (stream_get_status(stream) > IPP_STATUS_OK_CONFLICTING)
   {
-    cupsLangPrintf(stderr, "%s: %s", command, cupsLastErrorString());
-    return (0);
+    cupsLangPrintf(stderr, "%s: %s", command, stream_get_status_message(stream));
+    stream_close(stream);
+    return (-1);
   }
 
+  stream_close(stream);
+
   if (jobcount == 0)
     cupsLangPuts(stdout, _("no entries"));
 
@@ -529,7 +589,8 @@ show_jobs(const char *command,		// I - Command name
 static void
 show_printer(const char *command,	// I - Command name
              http_t     *http,		// I - HTTP connection to server
-             const char *dest)		// I - Destination
+             const char *dest,		// I - Destination
+             watch_t    *watch)		// I - Job list dashboard or `NULL` for the standard output
 {
   ipp_t		*request,		// IPP Request
 		*response;		// IPP Response
@@ -547,13 +608,15 @@ show_printer(const char *command,	// I - Command name
   //   attributes-charset
   //   attributes-natural-language
   //   printer-uri
+  //   requested-attributes
   request = ippNewRequest(IPP_OP_GET_PRINTER_ATTRIBUTES);
 
   httpAssembleURIf(HTTP_URI_CODING_ALL, uri, sizeof(uri), "ipp", NULL, "localhost", 0, "/printers/%s", dest);
   ippAddString(request, IPP_TAG_OPERATION, IPP_TAG_URI, "printer-uri", NULL, uri);
+  ippAddString(request, IPP_TAG_OPERATION, IPP_TAG_KEYWORD, "requested-attributes", NULL, "printer-state");
 
   // Do the request and get back a response...
-  if ((response = cupsDoRequest(http, request, "/")) != NULL)
+  if ((response = cupsDoRequest(conn_get_agent(http), request, "/")) != NULL)
   {
     if (ippGetStatusCode(response) > IPP_STATUS_OK_CONFLICTING)
     {
@@ -570,13 +633,13 @@ show_printer(const char *command,	// I - Command name
     switch (state)
     {
       case IPP_PSTATE_IDLE :
-          cupsLangPrintf(stdout, _("%s is ready"), dest);
+          watch_printf(watch, _("%s is ready"), dest);
 	  break;
       case IPP_PSTATE_PROCESSING :
-          cupsLangPrintf(stdout, _("%s is ready and printing"), dest);
+          watch_printf(watch, _("%s is ready and printing"), dest);
 	  break;
       case IPP_PSTATE_STOPPED :
-          cupsLangPrintf(stdout, _("%s is not ready"), dest);
+          watch_printf(watch, _("%s is not ready"), dest);
 	  break;
     }
 
@@ -604,6 +667,92 @@ usage(void)
   cupsLangPuts(stdout, _("-l                      Show verbose (long) output"));
   cupsLangPuts(stdout, _("-P destination          Show status for the specified destination"));
   cupsLangPuts(stdout, _("-U username             Specify the username to use for authentication"));
+  cupsLangPuts(stdout, _("--servers filename      Query each server listed in the file"));
+  cupsLangPuts(stdout, _("--timeout seconds       Set the time limit for each server"));
 
   exit(1);
 }
+
+
+//
+// 'watch_jobs()' - Show the jobs on the terminal until the queue is empty.
+//
+// Only the lines that change are drawn again after each interval.
+//
+
+static int				// O - Exit status
+watch_jobs(const char *command,		// I - Command name
+           http_t     *http,		// I - HTTP connection to server
+           const char *dest,		// I - Destination
+	   const char *user,		// I - User
+	   const int  id,		// I - Job ID
+	   const int  longstatus,	// I - 1 if long report desired
+	   int        interval)		// I - Reporting interval
+{
+  watch_t	*watch;			// Job list dashboard
+  watch_diff_t	diff;			// Changes to the job list
+  ipp_t		*attrs;			// Job attributes
+  lpq_job_t	job;			// Current job
+  size_t	i,			// Looping var
+		count;			// Number of jobs
+  int		jobcount,		// Number of jobs shown
+		rank;			// Rank of job
+  char		message[1024];		// Error message
+
+
+  if ((watch = watch_new(http, jobs_request(dest, user, id, longstatus))) == NULL)
+  {
+    cupsLangPrintf(stderr, _("%s: Unable to allocate memory."), command);
+    return (1);
+  }
+
+  // Draw the queue whenever it changes...
+  while (watch_update(watch, interval, &diff))
+  {
+    if (!diff.redraw)
+      continue;
+
+    if (dest)
+      show_printer(command, http, dest, watch);
+
+    for (i = 0, count = watch_get_count(watch), jobcount = 0, rank = 1; i < count; i ++)
+    {
+      attrs = watch_get_job(watch, i);
+
+      get_job(attrs, ippGetFirstAttribute(attrs), &job);
+
+      if (job.dest == NULL || job.id == 0)
+        continue;
+
+      if (!longstatus && jobcount == 0)
+	watch_printf(watch, _("Rank    Owner   Job     File(s)                         Total Size"));
+
+      jobcount ++;
+
+      show_job(watch, &job, &rank, longstatus);
+    }
+
+    if (jobcount == 0)
+      watch_printf(watch, _("no entries"));
+
+    watch_flush(watch);
+
+    if (jobcount == 0)
+      break;
+  }
+
+  if (watch_get_status(watch) > IPP_STATUS_OK_CONFLICTING)
+    cupsCopyString(message, watch_get_status_message(watch), sizeof(message));
+  else
+    message[0] = '\0';
+
+  watch_delete(watch);
+
+  if (message[0])
+  {
+    cupsLangPrintf(stderr, "%s: %s", command, message);
+    return (1);
+  }
+
+  return (0);
+}
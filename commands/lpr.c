@@ -9,7 +9,7 @@
 // information.
 //
 
-#include "localize.h"
+#include "conn.h"
 #include <unistd.h>
 #include <fcntl.h>
 #ifndef O_BINARY
@@ -43,6 +43,7 @@ main(int  argc,				// I - Number of command-line arguments
   int		num_files;		// Number of files to print
   const char	*files[1000];		// Files to print
   cups_dest_t	*dest = NULL;		// Selected destination
+  http_t	*http;			// Connection to the scheduler
   cups_dinfo_t	*dinfo;			// Destination information
   int		num_options;		// Number of options
   cups_option_t	*options;		// Options
@@ -224,7 +225,7 @@ main(int  argc,				// I - Number of command-line arguments
 	      if ((instance = strrchr(printer, '/')) != NULL)
 		*instance++ = '\0';
 
-	      if ((dest = cupsGetNamedDest(CUPS_HTTP_DEFAULT, printer, instance)) != NULL)
+	      if ((dest = cupsGetNamedDest(conn_get_default(), printer, instance)) != NULL)
 	      {
 		for (j = 0; j < dest->num_options; j ++)
 		{
@@ -327,7 +328,7 @@ main(int  argc,				// I - Number of command-line arguments
   // Get the destination...
   if (!dest)
   {
-    if ((dest = cupsGetNamedDest(CUPS_HTTP_DEFAULT, /*printer*/NULL, /*instance*/NULL)) != NULL)
+    if ((dest = cupsGetNamedDest(conn_get_default(), /*printer*/NULL, /*instance*/NULL)) != NULL)
     {
       for (j = 0; j < dest->num_options; j ++)
       {
@@ -352,7 +353,8 @@ main(int  argc,				// I - Number of command-line arguments
     }
   }
 
-  dinfo = cupsCopyDestInfo(CUPS_HTTP_DEFAULT, dest);
+  http  = conn_get_default();
+  dinfo = cupsCopyDestInfo(http, dest);
 
   // Title...
   if (!title)
@@ -369,7 +371,7 @@ main(int  argc,				// I - Number of command-line arguments
   }
 
   // Create the job...
-  if (cupsCreateDestJob(CUPS_HTTP_DEFAULT, dest, dinfo, &job_id, title, num_options, options) > IPP_STATUS_OK_EVENTS_COMPLETE)
+  if (cupsCreateDestJob(http, dest, dinfo, &job_id, title, num_options, options) > IPP_STATUS_OK_EVENTS_COMPLETE)
   {
     cupsLangPrintf(stderr, "%s: %s", argv[0], cupsLastErrorString());
     return (1);
@@ -392,7 +394,7 @@ main(int  argc,				// I - Number of command-line arguments
       if ((fd = open(files[i], O_RDONLY | O_BINARY)) < 0)
       {
         cupsLangPrintf(stderr, _("%s: Unable to open \"%s\" - %s"), argv[0], files[i], strerror(errno));
-	cupsCancelDestJob(CUPS_HTTP_DEFAULT, dest, job_id);
+	cupsCancelDestJob(http, dest, job_id);
 	return (1);
       }
 
@@ -401,25 +403,25 @@ main(int  argc,				// I - Number of command-line arguments
       else
         docname = files[i];
 
-      status = cupsStartDestDocument(CUPS_HTTP_DEFAULT, dest, dinfo, job_id, docname, format, /*num_options*/0, /*options*/NULL, (i + 1) == num_files);
+      status = cupsStartDestDocument(http, dest, dinfo, job_id, docname, format, /*num_options*/0, /*options*/NULL, (i + 1) == num_files);
 
       while (status == HTTP_STATUS_CONTINUE && (bytes = read(fd, buffer, sizeof(buffer))) > 0)
-	status = cupsWriteRequestData(CUPS_HTTP_DEFAULT, buffer, (size_t)bytes);
+	status = cupsWriteRequestData(http, buffer, (size_t)bytes);
 
       close(fd);
 
       if (status != HTTP_STATUS_CONTINUE)
       {
 	cupsLangPrintf(stderr, _("%s: Error - unable to queue %s - %s."), argv[0], files[i], httpStatusString(status));
-	cupsFinishDestDocument(CUPS_HTTP_DEFAULT, dest, dinfo);
-	cupsCancelDestJob(CUPS_HTTP_DEFAULT, dest, job_id);
+	cupsFinishDestDocument(http, dest, dinfo);
+	cupsCancelDestJob(http, dest, job_id);
 	return (1);
       }
 
-      if (cupsFinishDestDocument(CUPS_HTTP_DEFAULT, dest, dinfo) != IPP_STATUS_OK)
+      if (cupsFinishDestDocument(http, dest, dinfo) != IPP_STATUS_OK)
       {
 	cupsLangPrintf(stderr, "%s: %s", argv[0], cupsLastErrorString());
-	cupsCancelDestJob(CUPS_HTTP_DEFAULT, dest, job_id);
+	cupsCancelDestJob(http, dest, job_id);
 	return (1);
       }
     }
@@ -434,23 +436,23 @@ main(int  argc,				// I - Number of command-line arguments
   else
   {
     // Print stdin...
-    status = cupsStartDestDocument(CUPS_HTTP_DEFAULT, dest, dinfo, job_id, "(stdin)", format, /*num_options*/0, /*options*/NULL, true);
+    status = cupsStartDestDocument(http, dest, dinfo, job_id, "(stdin)", format, /*num_options*/0, /*options*/NULL, true);
 
     while (status == HTTP_STATUS_CONTINUE && (bytes = read(0, buffer, sizeof(buffer))) > 0)
-      status = cupsWriteRequestData(CUPS_HTTP_DEFAULT, buffer, (size_t)bytes);
+      status = cupsWriteRequestData(http, buffer, (size_t)bytes);
 
     if (status != HTTP_STATUS_CONTINUE)
     {
       cupsLangPrintf(stderr, _("%s: Error - unable to queue %s - %s."), argv[0], "(stdin)", httpStatusString(status));
-      cupsFinishDestDocument(CUPS_HTTP_DEFAULT, dest, dinfo);
-      cupsCancelDestJob(CUPS_HTTP_DEFAULT, dest, job_id);
+      cupsFinishDestDocument(http, dest, dinfo);
+      cupsCancelDestJob(http, dest, job_id);
       return (1);
     }
 
-    if (cupsFinishDestDocument(CUPS_HTTP_DEFAULT, dest, dinfo) != IPP_STATUS_OK)
+    if (cupsFinishDestDocument(http, dest, dinfo) != IPP_STATUS_OK)
     {
       cupsLangPrintf(stderr, "%s: %s", argv[0], cupsLastErrorString());
-      cupsCancelDestJob(CUPS_HTTP_DEFAULT, dest, job_id);
+      cupsCancelDestJob(http, dest, job_id);
       return (1);
     }
   }
@@ -9,13 +9,38 @@
 // information.
 //
 
-#include "localize.h"
+#include "conn.h"
+
+
+//
+// Local types...
+//
+
+typedef struct lprm_dests_s		// Destination snapshot
+{
+  bool		loaded;			// Have the destinations been loaded?
+  size_t	num_dests;		// Number of destinations
+  cups_dest_t	*dests;			// Destinations
+  cups_array_t	*index;			// Hash index by name
+} lprm_dests_t;
+
+typedef struct lprm_job_s		// Job to cancel
+{
+  cups_dest_t	*dest;			// Destination
+  int		job_id;			// Job ID, 0 for current, -1 for all
+} lprm_job_t;
 
 
 //
 // Local functions...
 //
 
+static bool	cancel_jobs(const char *command, cups_dest_t *dest, size_t num_jobs, lprm_job_t *jobs);
+static int	compare_dests(cups_dest_t *a, cups_dest_t *b, void *data);
+static cups_dest_t *find_dest(lprm_dests_t *snapshot, const char *name);
+static bool	flush_jobs(const char *command, size_t num_jobs, lprm_job_t *jobs);
+static void	free_dests(lprm_dests_t *snapshot);
+static size_t	hash_dest(cups_dest_t *dest, void *data);
 static void	usage(void) _CUPS_NORETURN;
 
 
@@ -33,7 +58,12 @@ main(int  argc,			// I - Number of command-line arguments
 		*instance,	// Pointer to instance name
 		*opt;		// Option pointer
   cups_dest_t	*dest = NULL,	// Destination
-		*defdest;	// Default destination
+		*jobdest;	// Destination for current argument
+  lprm_dests_t	snapshot;	// Destination snapshot
+  size_t	num_jobs,	// Number of jobs to cancel
+		alloc_jobs;	// Allocated jobs
+  lprm_job_t	*jobs;		// Jobs to cancel
+  int		status;		// Exit status
   bool		did_cancel;	// Did we cancel something?
 
 
@@ -41,10 +71,18 @@ main(int  argc,			// I - Number of command-line arguments
 
  /*
   * Setup to cancel individual print jobs...
+  *
+  * The destinations are only loaded when an argument needs them, and then
+  * only once...
   */
 
+  memset(&snapshot, 0, sizeof(snapshot));
+
+  num_jobs   = 0;
+  alloc_jobs = 0;
+  jobs       = NULL;
+  status     = 0;
   did_cancel = false;
-  defdest    = cupsGetNamedDest(CUPS_HTTP_DEFAULT, NULL, NULL);
 
  /*
   * Process command-line arguments...
@@ -58,6 +96,17 @@ main(int  argc,			// I - Number of command-line arguments
     }
     else if (argv[i][0] == '-' && argv[i][1] != '\0')
     {
+      // Options can change the server, user, or encryption, so cancel the
+      // jobs collected so far first...
+      if (num_jobs > 0)
+      {
+        if (!flush_jobs(argv[0], num_jobs, jobs))
+	  status = 1;
+
+	did_cancel = true;
+	num_jobs   = 0;
+      }
+
       for (opt = argv[i] + 1; *opt; opt ++)
       {
 	switch (*opt)
@@ -88,7 +137,7 @@ main(int  argc,			// I - Number of command-line arguments
 	      if ((instance = strchr(destname, '/')) != NULL)
 		*instance = '\0';
 
-	      if ((dest = cupsGetNamedDest(CUPS_HTTP_DEFAULT, destname, NULL)) == NULL)
+	      if ((dest = find_dest(&snapshot, destname)) == NULL)
 	      {
 		cupsLangPrintf(stderr, _("%s: Error - unknown destination \"%s\"."), argv[0], destname);
 		goto error;
@@ -135,10 +184,9 @@ main(int  argc,			// I - Number of command-line arguments
 		}
 	      }
 
-	      if (defdest)
-		cupsFreeDests(1, defdest);
-
-	      defdest = cupsGetNamedDest(CUPS_HTTP_DEFAULT, NULL, NULL);
+	      // Get destinations from the new server...
+	      free_dests(&snapshot);
+	      dest = NULL;
 	      break;
 
 	  default :
@@ -149,21 +197,22 @@ main(int  argc,			// I - Number of command-line arguments
     }
     else
     {
-      // Cancel a job or printer...
-      dest = cupsGetNamedDest(CUPS_HTTP_DEFAULT, argv[i], NULL);
-
-      if (dest)
-      {
-        job_id = 0;
-      }
-      else if (isdigit(argv[i][0] & 255))
+      // Cancel a job or printer.  Job IDs are all digits and don't need a
+      // destination lookup...
+      if (argv[i][strspn(argv[i], "0123456789")] == '\0')
       {
-        job_id = atoi(argv[i]);
+        jobdest = dest ? dest : find_dest(&snapshot, NULL);
+        job_id  = atoi(argv[i]);
       }
       else if (!strcmp(argv[i], "-"))
       {
         // Cancel all jobs
-        job_id = -1;
+        jobdest = dest ? dest : find_dest(&snapshot, NULL);
+        job_id  = -1;
+      }
+      else if ((jobdest = find_dest(&snapshot, argv[i])) != NULL)
+      {
+        job_id = 0;
       }
       else
       {
@@ -171,33 +220,299 @@ main(int  argc,			// I - Number of command-line arguments
 	goto error;
       }
 
-      if (cupsCancelDestJob(CUPS_HTTP_DEFAULT, dest, job_id) != IPP_STATUS_OK)
+      if (!jobdest)
       {
-        cupsLangPrintf(stderr, "%s: %s", argv[0], cupsLastErrorString());
+	cupsLangPrintf(stderr, _("%s: Error - no default destination available."), argv[0]);
 	goto error;
       }
 
-      did_cancel = true;
+      if (num_jobs >= alloc_jobs)
+      {
+        lprm_job_t	*temp;		// New jobs
+
+        alloc_jobs += 256;
+
+        if ((temp = realloc(jobs, alloc_jobs * sizeof(lprm_job_t))) == NULL)
+        {
+	  cupsLangPrintf(stderr, _("%s: Unable to allocate memory."), argv[0]);
+	  goto error;
+        }
+
+        jobs = temp;
+      }
+
+      jobs[num_jobs].dest   = jobdest;
+      jobs[num_jobs].job_id = job_id;
+      num_jobs ++;
     }
   }
 
-  // If nothing has been canceled yet, cancel the current job on the specified
-  // (or default) printer...
-  if (!did_cancel && cupsCancelDestJob(CUPS_HTTP_DEFAULT, defdest, 0) != IPP_STATUS_OK)
+  if (num_jobs == 0 && !did_cancel)
   {
-    cupsLangPrintf(stderr, "%s: %s", argv[0], cupsLastErrorString());
-    goto error;
+    // If nothing has been canceled, cancel the current job on the specified
+    // (or default) printer...
+    if (!dest && (dest = find_dest(&snapshot, NULL)) == NULL)
+    {
+      cupsLangPrintf(stderr, _("%s: Error - no default destination available."), argv[0]);
+      goto error;
+    }
+
+    if (cupsCancelDestJob(conn_get_default(), dest, 0) != IPP_STATUS_OK)
+    {
+      cupsLangPrintf(stderr, "%s: %s", argv[0], cupsLastErrorString());
+      goto error;
+    }
+  }
+  else if (num_jobs > 0 && !flush_jobs(argv[0], num_jobs, jobs))
+  {
+    status = 1;
   }
 
-  return (0);
+  free(jobs);
+  free_dests(&snapshot);
+
+  return (status);
 
   // If we get here there was an error, so clean up...
   error:
 
+  free(jobs);
+  free_dests(&snapshot);
+
   return (1);
 }
 
 
+//
+// 'cancel_jobs()' - Cancel jobs on a destination.
+//
+// Job IDs are canceled together with a single Cancel-My-Jobs request using
+// the "job-ids" attribute.  If the request fails (or the server does not
+// support "job-ids"), each job is canceled separately with
+// `cupsCancelDestJob` so that failures are reported for the right job.
+//
+
+static bool				// O - `true` on success, `false` on error
+cancel_jobs(const char  *command,	// I - Command name
+            cups_dest_t *dest,		// I - Destination
+            size_t      num_jobs,	// I - Number of jobs
+            lprm_job_t  *jobs)		// I - Jobs
+{
+  bool		ret = true;		// Return value
+  size_t	i,			// Looping var
+		num_job_ids = 0;	// Number of job IDs
+  int		*job_ids;		// Job IDs
+  http_t	*http;			// Connection to destination
+  char		resource[1024];		// Resource path
+  const char	*uri;			// Printer URI
+  ipp_t		*request;		// IPP request
+
+
+  // Collect the job IDs...
+  if ((job_ids = calloc(num_jobs, sizeof(int))) == NULL)
+    return (false);
+
+  for (i = 0; i < num_jobs; i ++)
+  {
+    if (jobs[i].job_id > 0)
+      job_ids[num_job_ids ++] = jobs[i].job_id;
+  }
+
+  if ((http = cupsConnectDest(dest, CUPS_DEST_FLAGS_NONE, 30000, NULL, resource, sizeof(resource), NULL, NULL)) == NULL)
+  {
+    cupsLangPrintf(stderr, "%s: %s", command, cupsLastErrorString());
+    free(job_ids);
+    return (false);
+  }
+
+  if (num_job_ids > 1 && (uri = cupsGetOption("printer-uri-supported", dest->num_options, dest->options)) != NULL)
+  {
+    // Build a Cancel-My-Jobs request, which requires the following
+    // attributes:
+    //
+    //   attributes-charset
+    //   attributes-natural-language
+    //   printer-uri
+    //   requesting-user-name
+    //   job-ids
+    request = ippNewRequest(IPP_OP_CANCEL_MY_JOBS);
+
+    ippAddString(request, IPP_TAG_OPERATION, IPP_TAG_URI, "printer-uri", NULL, uri);
+    ippAddString(request, IPP_TAG_OPERATION, IPP_TAG_NAME, "requesting-user-name", NULL, cupsGetUser());
+    ippAddIntegers(request, IPP_TAG_OPERATION, IPP_TAG_INTEGER, "job-ids", num_job_ids, job_ids);
+
+    ippDelete(cupsDoRequest(http, request, resource));
+
+    if (cupsLastError() <= IPP_STATUS_OK_CONFLICTING)
+      num_job_ids = 0;
+  }
+
+  // Cancel anything left one at a time...
+  for (i = 0; i < num_jobs; i ++)
+  {
+    if (jobs[i].job_id > 0 && num_job_ids == 0)
+      continue;
+
+    if (cupsCancelDestJob(http, dest, jobs[i].job_id) != IPP_STATUS_OK)
+    {
+      cupsLangPrintf(stderr, "%s: %s", command, cupsLastErrorString());
+      ret = false;
+    }
+  }
+
+  httpClose(http);
+  free(job_ids);
+
+  return (ret);
+}
+
+
+//
+// 'compare_dests()' - Compare two destination names.
+//
+
+static int				// O - Result of comparison
+compare_dests(cups_dest_t *a,		// I - First destination
+              cups_dest_t *b,		// I - Second destination
+              void        *data)	// I - Callback data (unused)
+{
+  (void)data;
+
+  return (strcasecmp(a->name, b->name));
+}
+
+
+//
+// 'find_dest()' - Find a destination in the snapshot, loading it as needed.
+//
+// A `NULL` name returns the default destination.
+//
+
+static cups_dest_t *			// O - Destination or `NULL` if not found
+find_dest(lprm_dests_t *snapshot,	// I - Destination snapshot
+          const char   *name)		// I - Destination name or `NULL` for default
+{
+  size_t	i;			// Looping var
+  cups_dest_t	*dest,			// Current destination
+		key;			// Search key
+
+
+  if (!snapshot->loaded)
+  {
+    // Get the destinations once and index them by name...
+    snapshot->loaded    = true;
+    snapshot->num_dests = cupsGetDests(conn_get_default(), &snapshot->dests);
+    snapshot->index     = cupsArrayNew((cups_array_cb_t)compare_dests, NULL, (cups_ahash_cb_t)hash_dest, 256, NULL, NULL);
+
+    for (i = snapshot->num_dests, dest = snapshot->dests; i > 0; i --, dest ++)
+    {
+      if (!dest->instance)
+        cupsArrayAdd(snapshot->index, dest);
+    }
+  }
+
+  if (!name)
+  {
+    for (i = snapshot->num_dests, dest = snapshot->dests; i > 0; i --, dest ++)
+    {
+      if (dest->is_default)
+        return (dest);
+    }
+
+    return (NULL);
+  }
+
+  memset(&key, 0, sizeof(key));
+  key.name = (char *)name;
+
+  return ((cups_dest_t *)cupsArrayFind(snapshot->index, &key));
+}
+
+
+//
+// 'flush_jobs()' - Cancel the collected jobs, one destination at a time.
+//
+// Destinations are processed in the order they were first named.
+//
+
+static bool				// O - `true` on success, `false` on error
+flush_jobs(const char *command,		// I - Command name
+           size_t     num_jobs,		// I - Number of jobs
+           lprm_job_t *jobs)		// I - Jobs
+{
+  bool		ret = true;		// Return value
+  size_t	i, j;			// Looping vars
+  cups_dest_t	*dest;			// Current destination
+  lprm_job_t	*batch;			// Jobs for the current destination
+
+
+  if ((batch = calloc(num_jobs, sizeof(lprm_job_t))) == NULL)
+  {
+    cupsLangPrintf(stderr, _("%s: Unable to allocate memory."), command);
+    return (false);
+  }
+
+  for (i = 0; i < num_jobs; i ++)
+  {
+    size_t	num_batch = 0;		// Number of jobs for destination
+
+    if ((dest = jobs[i].dest) == NULL)
+      continue;
+
+    for (j = i; j < num_jobs; j ++)
+    {
+      if (jobs[j].dest == dest)
+      {
+        batch[num_batch ++] = jobs[j];
+        jobs[j].dest        = NULL;
+      }
+    }
+
+    if (!cancel_jobs(command, dest, num_batch, batch))
+      ret = false;
+  }
+
+  free(batch);
+
+  return (ret);
+}
+
+
+//
+// 'free_dests()' - Free the destination snapshot.
+//
+
+static void
+free_dests(lprm_dests_t *snapshot)	// I - Destination snapshot
+{
+  cupsArrayDelete(snapshot->index);
+  cupsFreeDests(snapshot->num_dests, snapshot->dests);
+
+  memset(snapshot, 0, sizeof(lprm_dests_t));
+}
+
+
+//
+// 'hash_dest()' - Compute the hash of a destination name.
+//
+
+static size_t				// O - Hash value
+hash_dest(cups_dest_t *dest,		// I - Destination
+          void        *data)		// I - Callback data (unused)
+{
+  size_t	hash;			// Hash value
+  const char	*nameptr;		// Pointer into name
+
+
+  (void)data;
+
+  for (hash = 0, nameptr = dest->name; *nameptr; nameptr ++)
+    hash = 33 * hash + (size_t)tolower(*nameptr & 255);
+
+  return (hash % 256);
+}
+
+
 //
 // 'usage()' - Show program usage and exit.
 //
@@ -9,7 +9,85 @@
 // information.
 //
 
-#include "localize.h"
+#include "conn.h"
+#include "fanout.h"
+#include "stream.h"
+#include "watch.h"
+#include <poll.h>
+#include <signal.h>
+
+
+//
+// Constants...
+//
+
+#define METRICS_HASH_SIZE	1024	// Size of metrics hash tables
+#define METRICS_MAX_LISTEN	4	// Maximum number of listen sockets
+
+
+//
+// Local types...
+//
+
+typedef struct metrics_buffer_s		// Growable metrics output buffer
+{
+  char		*data;			// Buffer data
+  size_t	used,			// Bytes used
+		alloc;			// Bytes allocated
+} metrics_buffer_t;
+
+typedef struct metrics_queue_s		// Cached queue state
+{
+  char		name[256];		// printer-name
+  ipp_pstate_t	state;			// printer-state
+  bool		accepting;		// printer-is-accepting-jobs
+  int		queued;			// queued-job-count
+  char		reasons[1024];		// printer-state-reasons, space-delimited
+  bool		seen;			// Seen in the last refresh?
+  size_t	num_jobs;		// Number of cached jobs for this queue
+  size_t	buckets[7];		// Cumulative job age histogram buckets
+  double	age_sum;		// Sum of job ages in seconds
+} metrics_queue_t;
+
+typedef struct metrics_job_s		// Cached active job
+{
+  int		id;			// job-id
+  char		queue[256];		// Queue name from job-printer-uri
+  time_t	created;		// time-at-creation
+  bool		seen;			// Seen in the last queue resync?
+} metrics_job_t;
+
+typedef struct metrics_cache_s		// Metrics state cache
+{
+  http_t	*http;			// Persistent connection to the scheduler
+  cups_array_t	*queues;		// Queues, hashed by name
+  cups_array_t	*jobs;			// Active jobs, hashed by job-id
+  int		last_job_id;		// Highest job-id seen so far
+  bool		up;			// Did the last refresh succeed?
+  time_t	updated;		// Time of last refresh
+} metrics_cache_t;
+
+typedef struct lpstat_job_s		// Job information
+{
+  int		id,			// job-id
+		size;			// job-k-octets
+  time_t	time;			// time-at-creation or time-at-completed
+  const char	*dest,			// Pointer into job-printer-uri
+		*user,			// job-originating-user-name
+		*message;		// job-printer-state-message
+  ipp_attribute_t *reasons;		// job-state-reasons
+} lpstat_job_t;
+
+
+//
+// Local globals...
+//
+
+static const int metrics_ages[7] =	// Job age histogram bounds in seconds
+{
+  60, 300, 900, 3600, 14400, 86400, 604800
+};
+static int		watch_interval = 0;	// Job list refresh interval in seconds, 0 to not watch
 
 
 //
@@ -17,16 +95,33 @@
 //
 
 static void	check_dest(const char *command, const char *name, size_t *num_dests, cups_dest_t **dests);
+static ipp_attribute_t *get_job(ipp_t *response, ipp_attribute_t *attr, const char *time_at, lpstat_job_t *job);
 static bool	match_list(const char *list, const char *name);
+static int	metrics_compare_jobs(metrics_job_t *a, metrics_job_t *b, void *data);
+static int	metrics_compare_queues(metrics_queue_t *a, metrics_queue_t *b, void *data);
+static void	metrics_delete(metrics_cache_t *cache);
+static size_t	metrics_hash_job(metrics_job_t *job, void *data);
+static size_t	metrics_hash_queue(metrics_queue_t *queue, void *data);
+static metrics_cache_t *metrics_new(void);
+static void	metrics_printf(metrics_buffer_t *mb, const char *format, ...) _CUPS_FORMAT(2, 3);
+static void	metrics_puts_label(metrics_buffer_t *mb, const char *value);
+static bool	metrics_refresh(metrics_cache_t *cache);
+static size_t	metrics_refresh_jobs(metrics_cache_t *cache, const char *queue, int first_job_id);
+static void	metrics_render(metrics_cache_t *cache, metrics_buffer_t *mb);
+static int	metrics_serve(const char *listen, int interval);
+static void	metrics_serve_client(metrics_cache_t *cache, metrics_buffer_t *mb, http_t *client, int interval);
+static int	show_metrics(void);
 static int	show_accepting(const char *printers, size_t num_dests, cups_dest_t *dests);
 static int	show_classes(const char *dests);
 static void	show_default(cups_dest_t *dest);
 static int	show_devices(const char *printers, size_t num_dests, cups_dest_t *dests);
+static void	show_job(watch_t *watch, lpstat_job_t *job, int rank, int long_status, int ranking);
 static int	show_jobs(const char *dests, const char *users, int long_status, int ranking, const char *which);
 static int	show_printers(const char *printers, size_t num_dests, cups_dest_t *dests, int long_status);
 static int	show_scheduler(void);
 static char	*str_date(char *buffer, size_t bufsize, time_t timeval);
 static void	usage(void) _CUPS_NORETURN;
+static int	watch_jobs(ipp_t *request, const char *dests, const char *users, int long_status, int ranking, const char *time_at);
 
 
 //
@@ -46,10 +141,16 @@ main(int  argc,				// I - Number of command-line arguments
   int		ranking;		// Show job ranking?
   const char	*which;			// Which jobs to show?
   char		op;			// Last operation on command-line
+  const char	*metrics_listen;	// Metrics exporter listen address
+  int		metrics_interval;	// Metrics refresh interval in seconds
 
 
   localize_init(argv);
 
+  // Run the command on each server when more than one is named...
+  if (fanout_servers(argc, argv, main, FANOUT_MERGE_RECORDS, &status))
+    return (status);
+
   // Parse command-line options...
   num_dests   = 0;
   dests       = NULL;
@@ -59,12 +160,63 @@ main(int  argc,				// I - Number of command-line arguments
   which       = "not-completed";
   op          = 0;
 
+  metrics_listen   = NULL;
+  metrics_interval = 5;
+
   for (i = 1; i < argc; i ++)
   {
     if (!strcmp(argv[i], "--help"))
     {
       usage();
     }
+    else if (fanout_skip_option(argc, argv, &i))
+    {
+      continue;
+    }
+    else if (!strcmp(argv[i], "--metrics"))
+    {
+      op = 'm';
+
+      status |= show_metrics();
+    }
+    else if (!strcmp(argv[i], "--metrics-interval"))
+    {
+      i ++;
+
+      if (i >= argc || (metrics_interval = atoi(argv[i])) < 1)
+      {
+	cupsLangPrintf(stderr, _("%s: Error - expected interval in seconds after \"--metrics-interval\" option."), argv[0]);
+	usage();
+      }
+    }
+    else if (!strcmp(argv[i], "--metrics-listen"))
+    {
+      i ++;
+
+      if (i >= argc)
+      {
+	cupsLangPrintf(stderr, _("%s: Error - expected [address:]port after \"--metrics-listen\" option."), argv[0]);
+	usage();
+      }
+
+      op             = 'm';
+      metrics_listen = argv[i];
+    }
+    else if (!strcmp(argv[i], "--watch"))
+    {
+      if (watch_interval == 0)
+        watch_interval = 2;
+    }
+    else if (!strcmp(argv[i], "--watch-interval"))
+    {
+      i ++;
+
+      if (i >= argc || (watch_interval = atoi(argv[i])) < 1)
+      {
+	cupsLangPrintf(stderr, _("%s: Error - expected interval in seconds after \"--watch-interval\" option."), argv[0]);
+	usage();
+      }
+    }
     else if (argv[i][0] == '-')
     {
       for (opt = argv[i] + 1; *opt; opt ++)
@@ -169,7 +321,7 @@ main(int  argc,				// I - Number of command-line arguments
 		if (num_dests <= 1)
 		{
 		  cupsFreeDests(num_dests, dests);
-		  num_dests = cupsGetDests(CUPS_HTTP_DEFAULT, &dests);
+		  num_dests = cupsGetDests(conn_get_default(), &dests);
 
 		  if (num_dests == 0 && (cupsLastError() == IPP_STATUS_ERROR_BAD_REQUEST || cupsLastError() == IPP_STATUS_ERROR_VERSION_NOT_SUPPORTED))
 		  {
@@ -211,7 +363,7 @@ main(int  argc,				// I - Number of command-line arguments
 	      {
 		cupsFreeDests(num_dests, dests);
 
-		dests     = cupsGetNamedDest(CUPS_HTTP_DEFAULT, NULL, NULL);
+		dests     = cupsGetNamedDest(conn_get_default(), NULL, NULL);
 		num_dests = dests ? 1 : 0;
 
 		if (num_dests == 0 && (cupsLastError() == IPP_STATUS_ERROR_BAD_REQUEST || cupsLastError() == IPP_STATUS_ERROR_VERSION_NOT_SUPPORTED))
@@ -227,7 +379,7 @@ main(int  argc,				// I - Number of command-line arguments
 	  case 'e' : // List destinations
 	      {
                 cups_dest_t *temp = NULL, *dest;
-                int j, num_temp = cupsGetDests(CUPS_HTTP_DEFAULT, &temp);
+                int j, num_temp = cupsGetDests(conn_get_default(), &temp);
 
                 op = 'e';
 
@@ -345,7 +497,7 @@ main(int  argc,				// I - Number of command-line arguments
 		if (num_dests <= 1)
 		{
 		  cupsFreeDests(num_dests, dests);
-		  num_dests = cupsGetDests(CUPS_HTTP_DEFAULT, &dests);
+		  num_dests = cupsGetDests(conn_get_default(), &dests);
 
 		  if (num_dests == 0 &&
 		      (cupsLastError() == IPP_STATUS_ERROR_BAD_REQUEST ||
@@ -373,7 +525,7 @@ main(int  argc,				// I - Number of command-line arguments
 	      if (num_dests <= 1)
 	      {
 		cupsFreeDests(num_dests, dests);
-		num_dests = cupsGetDests(CUPS_HTTP_DEFAULT, &dests);
+		num_dests = cupsGetDests(conn_get_default(), &dests);
 
 		if (num_dests == 0 &&
 		    (cupsLastError() == IPP_STATUS_ERROR_BAD_REQUEST ||
@@ -395,7 +547,7 @@ main(int  argc,				// I - Number of command-line arguments
 	      if (num_dests <= 1)
 	      {
 		cupsFreeDests(num_dests, dests);
-		num_dests = cupsGetDests(CUPS_HTTP_DEFAULT, &dests);
+		num_dests = cupsGetDests(conn_get_default(), &dests);
 
 		if (num_dests == 0 &&
 		    (cupsLastError() == IPP_STATUS_ERROR_BAD_REQUEST ||
@@ -459,7 +611,7 @@ main(int  argc,				// I - Number of command-line arguments
 		if (num_dests <= 1)
 		{
 		  cupsFreeDests(num_dests, dests);
-		  num_dests = cupsGetDests(CUPS_HTTP_DEFAULT, &dests);
+		  num_dests = cupsGetDests(conn_get_default(), &dests);
 
 		  if (num_dests == 0 &&
 		      (cupsLastError() == IPP_STATUS_ERROR_BAD_REQUEST ||
@@ -487,6 +639,9 @@ main(int  argc,				// I - Number of command-line arguments
     }
   }
 
+  if (metrics_listen)
+    return (metrics_serve(metrics_listen, metrics_interval));
+
   if (!op)
     status |= show_jobs(NULL, cupsGetUser(), long_status, ranking, which);
 
@@ -517,7 +672,7 @@ check_dest(const char  *command,	// I  - Command name
 
     if (strchr(name, ','))
     {
-      *num_dests = cupsGetDests(CUPS_HTTP_DEFAULT, dests);
+      *num_dests = cupsGetDests(conn_get_default(), dests);
     }
     else
     {
@@ -525,7 +680,7 @@ check_dest(const char  *command,	// I  - Command name
       if ((pptr = strchr(printer, '/')) != NULL)
         *pptr++ = '\0';
 
-      if ((*dests = cupsGetNamedDest(CUPS_HTTP_DEFAULT, printer, pptr)) == NULL)
+      if ((*dests = cupsGetNamedDest(conn_get_default(), printer, pptr)) == NULL)
       {
 	if (cupsLastError() == IPP_STATUS_ERROR_BAD_REQUEST || cupsLastError() == IPP_STATUS_ERROR_VERSION_NOT_SUPPORTED)
 	  cupsLangPrintf(stderr, _("%s: Error - add '/version=1.1' to server name."), command);
@@ -585,6 +740,66 @@ check_dest(const char  *command,	// I  - Command name
 }
 
 
+//
+// 'get_job()' - Get the attributes of a job.
+//
+
+static ipp_attribute_t *		// O - Attribute after the job
+get_job(ipp_t           *response,	// I - IPP response
+        ipp_attribute_t *attr,		// I - First attribute of job
+        const char      *time_at,	// I - time-at-xxx attribute name to use
+        lpstat_job_t    *job)		// O - Job information
+{
+  job->id      = 0;
+  job->size    = 0;
+  job->time    = 0;
+  job->dest    = NULL;
+  job->user    = NULL;
+  job->message = NULL;
+  job->reasons = NULL;
+
+  while (attr != NULL && ippGetGroupTag(attr) == IPP_TAG_JOB)
+  {
+    const char	*name = ippGetName(attr);
+    ipp_tag_t	value_tag = ippGetValueTag(attr);
+
+    if (!strcmp(name, "job-id") && value_tag == IPP_TAG_INTEGER)
+    {
+      job->id = ippGetInteger(attr, 0);
+    }
+    else if (!strcmp(name, "job-k-octets") && value_tag == IPP_TAG_INTEGER)
+    {
+      job->size = ippGetInteger(attr, 0);
+    }
+    else if (!strcmp(name, time_at) && value_tag == IPP_TAG_INTEGER)
+    {
+      job->time = ippGetInteger(attr, 0);
+    }
+    else if (!strcmp(name, "job-printer-state-message") && value_tag == IPP_TAG_TEXT)
+    {
+      job->message = ippGetString(attr, 0, NULL);
+    }
+    else if (!strcmp(name, "job-printer-uri") && value_tag == IPP_TAG_URI)
+    {
+      if ((job->dest = strrchr(ippGetString(attr, 0, NULL), '/')) != NULL)
+	job->dest ++;
+    }
+    else if (!strcmp(name, "job-originating-user-name") && value_tag == IPP_TAG_NAME)
+    {
+      job->user = ippGetString(attr, 0, NULL);
+    }
+    else if (!strcmp(name, "job-state-reasons") && value_tag == IPP_TAG_KEYWORD)
+    {
+      job->reasons = attr;
+    }
+
+    attr = ippGetNextAttribute(response);
+  }
+
+  return (attr);
+}
+
+
 //
 // 'match_list()' - Match a name from a list of comma or space-separated names.
 //
@@ -596,36 +811,881 @@ match_list(const char *list,		// I - List of names
   const char	*nameptr;		// Pointer into name
 
 
-  // An empty list always matches...
-  if (!list || !*list)
-    return (true);
+  // An empty list always matches...
+  if (!list || !*list)
+    return (true);
+
+  if (!name)
+    return (false);
+
+  do
+  {
+    // Skip leading whitespace and commas...
+    while (isspace(*list & 255) || *list == ',')
+      list ++;
+
+    if (!*list)
+      break;
+
+    // Compare names...
+    for (nameptr = name;
+	 *nameptr && *list && tolower(*nameptr & 255) == tolower(*list & 255);
+	 nameptr ++, list ++);
+
+    if (!*nameptr && (!*list || *list == ',' || isspace(*list & 255)))
+      return (true);
+
+    while (*list && !isspace(*list & 255) && *list != ',')
+      list ++;
+  }
+  while (*list);
+
+  return (false);
+}
+
+
+//
+// 'metrics_compare_jobs()' - Compare two cached jobs.
+//
+
+static int				// O - Result of comparison
+metrics_compare_jobs(
+    metrics_job_t *a,			// I - First job
+    metrics_job_t *b,			// I - Second job
+    void          *data)		// I - Callback data (unused)
+{
+  (void)data;
+
+  return (a->id - b->id);
+}
+
+
+//
+// 'metrics_compare_queues()' - Compare two cached queues.
+//
+
+static int				// O - Result of comparison
+metrics_compare_queues(
+    metrics_queue_t *a,			// I - First queue
+    metrics_queue_t *b,			// I - Second queue
+    void            *data)		// I - Callback data (unused)
+{
+  (void)data;
+
+  return (strcasecmp(a->name, b->name));
+}
+
+
+//
+// 'metrics_delete()' - Free the metrics cache and release its connection.
+//
+
+static void
+metrics_delete(metrics_cache_t *cache)	// I - Metrics cache
+{
+  if (!cache)
+    return;
+
+  conn_release(cache->http);
+  cupsArrayDelete(cache->queues);
+  cupsArrayDelete(cache->jobs);
+  free(cache);
+}
+
+
+//
+// 'metrics_hash_job()' - Compute the hash of a cached job.
+//
+
+static size_t				// O - Hash value
+metrics_hash_job(metrics_job_t *job,	// I - Job
+                 void          *data)	// I - Callback data (unused)
+{
+  (void)data;
+
+  return ((size_t)job->id % METRICS_HASH_SIZE);
+}
+
+
+//
+// 'metrics_hash_queue()' - Compute the hash of a cached queue.
+//
+
+static size_t				// O - Hash value
+metrics_hash_queue(
+    metrics_queue_t *queue,		// I - Queue
+    void            *data)		// I - Callback data (unused)
+{
+  size_t	hash;			// Hash value
+  const char	*nameptr;		// Pointer into name
+
+
+  (void)data;
+
+  // Names are not case-sensitive, so hash the lowercase name...
+  for (hash = 0, nameptr = queue->name; *nameptr; nameptr ++)
+    hash = 33 * hash + (size_t)tolower(*nameptr & 255);
+
+  return (hash % METRICS_HASH_SIZE);
+}
+
+
+//
+// 'metrics_new()' - Create a metrics cache with a connection to the scheduler.
+//
+
+static metrics_cache_t *		// O - Metrics cache or `NULL` on error
+metrics_new(void)
+{
+  metrics_cache_t	*cache;		// Metrics cache
+
+
+  if ((cache = (metrics_cache_t *)calloc(1, sizeof(metrics_cache_t))) == NULL)
+    return (NULL);
+
+  cache->queues = cupsArrayNew((cups_array_cb_t)metrics_compare_queues, NULL, (cups_ahash_cb_t)metrics_hash_queue, METRICS_HASH_SIZE, NULL, (cups_afree_cb_t)free);
+  cache->jobs   = cupsArrayNew((cups_array_cb_t)metrics_compare_jobs, NULL, (cups_ahash_cb_t)metrics_hash_job, METRICS_HASH_SIZE, NULL, (cups_afree_cb_t)free);
+
+  // Keep one connection open for the life of the cache...
+  if ((cache->http = conn_acquire(cupsGetServer(), ippGetPort(), cupsGetEncryption())) == NULL || !cache->queues || !cache->jobs)
+  {
+    metrics_delete(cache);
+    return (NULL);
+  }
+
+  return (cache);
+}
+
+
+//
+// 'metrics_printf()' - Append formatted text to a metrics buffer.
+//
+
+static void
+metrics_printf(metrics_buffer_t *mb,	// I - Metrics buffer
+               const char       *format,// I - Printf-style format string
+	       ...)			// I - Additional arguments as needed
+{
+  va_list	ap;			// Pointer to arguments
+  int		bytes;			// Bytes needed
+
+
+  va_start(ap, format);
+  bytes = vsnprintf(NULL, 0, format, ap);
+  va_end(ap);
+
+  if (bytes < 0)
+    return;
+
+  if ((mb->used + (size_t)bytes + 1) > mb->alloc)
+  {
+    size_t	alloc = mb->used + (size_t)bytes + 8192;
+					// New allocation size
+    char	*data;			// New buffer
+
+    if ((data = realloc(mb->data, alloc)) == NULL)
+      return;
+
+    mb->data  = data;
+    mb->alloc = alloc;
+  }
+
+  va_start(ap, format);
+  vsnprintf(mb->data + mb->used, mb->alloc - mb->used, format, ap);
+  va_end(ap);
+
+  mb->used += (size_t)bytes;
+}
+
+
+//
+// 'metrics_puts_label()' - Append an escaped label value to a metrics buffer.
+//
+
+static void
+metrics_puts_label(
+    metrics_buffer_t *mb,		// I - Metrics buffer
+    const char       *value)		// I - Label value
+{
+  char	buffer[1024],			// Escaped value
+	*bufptr,			// Pointer into buffer
+	*bufend;			// End of buffer
+
+
+  for (bufptr = buffer, bufend = buffer + sizeof(buffer) - 2; *value && bufptr < bufend; value ++)
+  {
+    if (*value == '\\' || *value == '\"')
+    {
+      *bufptr++ = '\\';
+      *bufptr++ = *value;
+    }
+    else if (*value == '\n')
+    {
+      *bufptr++ = '\\';
+      *bufptr++ = 'n';
+    }
+    else
+    {
+      *bufptr++ = *value;
+    }
+  }
+
+  *bufptr = '\0';
+
+  metrics_printf(mb, "\"%s\"", buffer);
+}
+
+
+//
+// 'metrics_refresh()' - Refresh the metrics cache from the scheduler.
+//
+// The queue list is always refreshed since it is a single small request.  Jobs
+// are refreshed incrementally: only jobs newer than the last job seen are
+// requested, and a queue's jobs are only re-read when the cached count no
+// longer matches its "queued-job-count" value.
+//
+
+static bool				// O - `true` on success, `false` on error
+metrics_refresh(metrics_cache_t *cache)	// I - Metrics cache
+{
+  ipp_t		*request,		// IPP request
+		*response;		// IPP response
+  ipp_attribute_t *attr;		// Current attribute
+  metrics_queue_t *queue,		// Current queue
+		key;			// Search key
+  metrics_job_t	*job;			// Current job
+  static const char * const pattrs[] =	// Attributes we need for printers...
+  {
+    "printer-is-accepting-jobs",
+    "printer-name",
+    "printer-state",
+    "printer-state-reasons",
+    "queued-job-count"
+  };
+
+
+  cache->updated = time(NULL);
+  cache->up      = false;
+
+  // Build a CUPS-Get-Printers request, which requires the following
+  // attributes:
+  //
+  //   attributes-charset
+  //   attributes-natural-language
+  //   requested-attributes
+  //   requesting-user-name
+  request = ippNewRequest(IPP_OP_CUPS_GET_PRINTERS);
+
+  ippAddStrings(request, IPP_TAG_OPERATION, IPP_TAG_KEYWORD, "requested-attributes", sizeof(pattrs) / sizeof(pattrs[0]), NULL, pattrs);
+  ippAddString(request, IPP_TAG_OPERATION, IPP_TAG_NAME, "requesting-user-name", NULL, cupsGetUser());
+
+  response = cupsDoRequest(cache->http, request, "/");
+
+  if (cupsLastError() > IPP_STATUS_OK_CONFLICTING && cupsLastError() != IPP_STATUS_ERROR_NOT_FOUND)
+  {
+    ippDelete(response);
+    return (false);
+  }
+
+  for (queue = (metrics_queue_t *)cupsArrayGetFirst(cache->queues); queue; queue = (metrics_queue_t *)cupsArrayGetNext(cache->queues))
+    queue->seen = false;
+
+  for (attr = ippGetFirstAttribute(response); attr; attr = ippGetNextAttribute(response))
+  {
+    const char	*printer = NULL;	// Printer name
+    ipp_pstate_t pstate = IPP_PSTATE_IDLE;
+					// Printer state
+    bool	accepting = true;	// Accepting jobs?
+    int		queued = 0;		// Number of queued jobs
+    ipp_attribute_t *reasons = NULL;	// Printer state reasons
+
+    // Skip leading attributes until we hit a printer...
+    while (attr && ippGetGroupTag(attr) != IPP_TAG_PRINTER)
+      attr = ippGetNextAttribute(response);
+
+    if (!attr)
+      break;
+
+    // Pull the needed attributes from this printer...
+    while (attr && ippGetGroupTag(attr) == IPP_TAG_PRINTER)
+    {
+      const char	*name = ippGetName(attr);
+      ipp_tag_t		value_tag = ippGetValueTag(attr);
+
+      if (!strcmp(name, "printer-name") && value_tag == IPP_TAG_NAME)
+	printer = ippGetString(attr, 0, NULL);
+      else if (!strcmp(name, "printer-state") && value_tag == IPP_TAG_ENUM)
+	pstate = (ipp_pstate_t)ippGetInteger(attr, 0);
+      else if (!strcmp(name, "printer-is-accepting-jobs") && value_tag == IPP_TAG_BOOLEAN)
+	accepting = ippGetBoolean(attr, 0);
+      else if (!strcmp(name, "queued-job-count") && value_tag == IPP_TAG_INTEGER)
+	queued = ippGetInteger(attr, 0);
+      else if (!strcmp(name, "printer-state-reasons") && value_tag == IPP_TAG_KEYWORD)
+	reasons = attr;
+
+      attr = ippGetNextAttribute(response);
+    }
+
+    if (printer)
+    {
+      // Update (or add) the cached queue...
+      cupsCopyString(key.name, printer, sizeof(key.name));
+
+      if ((queue = (metrics_queue_t *)cupsArrayFind(cache->queues, &key)) == NULL)
+      {
+        if ((queue = (metrics_queue_t *)calloc(1, sizeof(metrics_queue_t))) == NULL)
+          break;
+
+        cupsCopyString(queue->name, printer, sizeof(queue->name));
+        cupsArrayAdd(cache->queues, queue);
+      }
+
+      queue->state      = pstate;
+      queue->accepting  = accepting;
+      queue->queued     = queued;
+      queue->reasons[0] = '\0';
+      queue->seen       = true;
+
+      if (reasons)
+      {
+        size_t	i,			// Looping var
+		count;			// Number of values
+
+        for (i = 0, count = ippGetCount(reasons); i < count; i ++)
+        {
+          const char *reason = ippGetString(reasons, i, NULL);
+					// Current reason
+
+          if (!strcmp(reason, "none"))
+            continue;
+
+          if (queue->reasons[0])
+            cupsConcatString(queue->reasons, " ", sizeof(queue->reasons));
+	  cupsConcatString(queue->reasons, reason, sizeof(queue->reasons));
+        }
+      }
+    }
+
+    if (!attr)
+      break;
+  }
+
+  ippDelete(response);
+
+  // Forget queues that have been deleted...
+  for (queue = (metrics_queue_t *)cupsArrayGetFirst(cache->queues); queue; queue = (metrics_queue_t *)cupsArrayGetNext(cache->queues))
+  {
+    if (!queue->seen)
+      cupsArrayRemove(cache->queues, queue);
+    else
+      queue->num_jobs = 0;
+  }
+
+  // Add jobs created since the last refresh...
+  metrics_refresh_jobs(cache, NULL, cache->last_job_id + 1);
+
+  // Count the cached jobs on each queue, forgetting jobs on deleted queues...
+  for (job = (metrics_job_t *)cupsArrayGetFirst(cache->jobs); job; job = (metrics_job_t *)cupsArrayGetNext(cache->jobs))
+  {
+    cupsCopyString(key.name, job->queue, sizeof(key.name));
+
+    if ((queue = (metrics_queue_t *)cupsArrayFind(cache->queues, &key)) != NULL)
+      queue->num_jobs ++;
+    else
+      cupsArrayRemove(cache->jobs, job);
+  }
+
+  // Only re-read the jobs of queues whose counts have changed...
+  for (queue = (metrics_queue_t *)cupsArrayGetFirst(cache->queues); queue; queue = (metrics_queue_t *)cupsArrayGetNext(cache->queues))
+  {
+    if (queue->num_jobs != (size_t)queue->queued)
+      queue->num_jobs = metrics_refresh_jobs(cache, queue->name, 0);
+  }
+
+  cache->up = true;
+
+  return (true);
+}
+
+
+//
+// 'metrics_refresh_jobs()' - Refresh cached jobs.
+//
+// When "queue" is `NULL`, active jobs starting at "first_job_id" are added to
+// the cache.  Otherwise all cached jobs for the named queue are replaced with
+// the active jobs currently on that queue.
+//
+
+static size_t				// O - Number of jobs read for the queue
+metrics_refresh_jobs(
+    metrics_cache_t *cache,		// I - Metrics cache
+    const char      *queue,		// I - Queue name or `NULL` for all queues
+    int             first_job_id)	// I - First job ID or `0` for all
+{
+  size_t	count = 0;		// Number of jobs
+  ipp_t		*request,		// IPP request
+		*response;		// IPP response
+  ipp_attribute_t *attr;		// Current attribute
+  metrics_job_t	*job,			// Current job
+		key;			// Search key
+  char		uri[HTTP_MAX_URI];	// Printer URI
+  static const char * const jattrs[] =	// Attributes we need for jobs...
+  {
+    "job-id",
+    "job-printer-uri",
+    "time-at-creation"
+  };
+
+
+  // Build a Get-Jobs request, which requires the following attributes:
+  //
+  //   attributes-charset
+  //   attributes-natural-language
+  //   printer-uri
+  //   requested-attributes
+  //   requesting-user-name
+  //   which-jobs
+  request = ippNewRequest(IPP_OP_GET_JOBS);
+
+  if (queue)
+    httpAssembleURIf(HTTP_URI_CODING_ALL, uri, sizeof(uri), "ipp", NULL, "localhost", 0, "/printers/%s", queue);
+  else
+    cupsCopyString(uri, "ipp://localhost/", sizeof(uri));
+
+  ippAddString(request, IPP_TAG_OPERATION, IPP_TAG_URI, "printer-uri", NULL, uri);
+  ippAddStrings(request, IPP_TAG_OPERATION, IPP_TAG_KEYWORD, "requested-attributes", sizeof(jattrs) / sizeof(jattrs[0]), NULL, jattrs);
+  ippAddString(request, IPP_TAG_OPERATION, IPP_TAG_NAME, "requesting-user-name", NULL, cupsGetUser());
+  ippAddString(request, IPP_TAG_OPERATION, IPP_TAG_KEYWORD, "which-jobs", NULL, "not-completed");
+
+  if (first_job_id > 1)
+    ippAddInteger(request, IPP_TAG_OPERATION, IPP_TAG_INTEGER, "first-job-id", first_job_id);
+
+  if ((response = cupsDoRequest(cache->http, request, "/")) == NULL)
+    return (0);
+
+  if (queue)
+  {
+    // Mark the existing jobs for this queue so we can find stale ones...
+    for (job = (metrics_job_t *)cupsArrayGetFirst(cache->jobs); job; job = (metrics_job_t *)cupsArrayGetNext(cache->jobs))
+    {
+      if (!strcasecmp(job->queue, queue))
+        job->seen = false;
+    }
+  }
+
+  for (attr = ippGetFirstAttribute(response); attr; attr = ippGetNextAttribute(response))
+  {
+    int		jobid = 0;		// job-id
+    const char	*dest = NULL;		// Queue name
+    time_t	created = 0;		// time-at-creation
+
+    // Skip leading attributes until we hit a job...
+    while (attr && ippGetGroupTag(attr) != IPP_TAG_JOB)
+      attr = ippGetNextAttribute(response);
+
+    if (!attr)
+      break;
+
+    // Pull the needed attributes from this job...
+    while (attr && ippGetGroupTag(attr) == IPP_TAG_JOB)
+    {
+      const char	*name = ippGetName(attr);
+      ipp_tag_t		value_tag = ippGetValueTag(attr);
+
+      if (!strcmp(name, "job-id") && value_tag == IPP_TAG_INTEGER)
+      {
+	jobid = ippGetInteger(attr, 0);
+      }
+      else if (!strcmp(name, "job-printer-uri") && value_tag == IPP_TAG_URI)
+      {
+	if ((dest = strrchr(ippGetString(attr, 0, NULL), '/')) != NULL)
+	  dest ++;
+      }
+      else if (!strcmp(name, "time-at-creation") && value_tag == IPP_TAG_INTEGER)
+      {
+	created = (time_t)ippGetInteger(attr, 0);
+      }
+
+      attr = ippGetNextAttribute(response);
+    }
+
+    if (jobid > 0 && dest)
+    {
+      // Update (or add) the cached job...
+      if (jobid > cache->last_job_id)
+        cache->last_job_id = jobid;
+
+      key.id = jobid;
+
+      if ((job = (metrics_job_t *)cupsArrayFind(cache->jobs, &key)) == NULL)
+      {
+        if ((job = (metrics_job_t *)calloc(1, sizeof(metrics_job_t))) == NULL)
+          break;
+
+        job->id = jobid;
+        cupsArrayAdd(cache->jobs, job);
+      }
+
+      cupsCopyString(job->queue, dest, sizeof(job->queue));
+      job->created = created;
+      job->seen    = true;
+
+      if (!queue || !strcasecmp(dest, queue))
+        count ++;
+    }
+
+    if (!attr)
+      break;
+  }
+
+  ippDelete(response);
+
+  if (queue)
+  {
+    // Forget jobs that are no longer active on this queue...
+    for (job = (metrics_job_t *)cupsArrayGetFirst(cache->jobs); job; job = (metrics_job_t *)cupsArrayGetNext(cache->jobs))
+    {
+      if (!job->seen && !strcasecmp(job->queue, queue))
+        cupsArrayRemove(cache->jobs, job);
+    }
+  }
+
+  return (count);
+}
+
+
+//
+// 'metrics_render()' - Render the cached state in OpenMetrics text format.
+//
+
+static void
+metrics_render(metrics_cache_t  *cache,	// I - Metrics cache
+               metrics_buffer_t *mb)	// I - Output buffer
+{
+  size_t	i;			// Looping var
+  time_t	curtime = time(NULL);	// Current time
+  metrics_queue_t *queue,		// Current queue
+		key;			// Search key
+  metrics_job_t	*job;			// Current job
+
+
+  // Compute the job age histograms...
+  for (queue = (metrics_queue_t *)cupsArrayGetFirst(cache->queues); queue; queue = (metrics_queue_t *)cupsArrayGetNext(cache->queues))
+  {
+    queue->num_jobs = 0;
+    queue->age_sum  = 0.0;
+    memset(queue->buckets, 0, sizeof(queue->buckets));
+  }
+
+  for (job = (metrics_job_t *)cupsArrayGetFirst(cache->jobs); job; job = (metrics_job_t *)cupsArrayGetNext(cache->jobs))
+  {
+    double age = job->created > 0 && job->created < curtime ? (double)(curtime - job->created) : 0.0;
+					// Age of job in seconds
+
+    cupsCopyString(key.name, job->queue, sizeof(key.name));
+
+    if ((queue = (metrics_queue_t *)cupsArrayFind(cache->queues, &key)) == NULL)
+      continue;
+
+    queue->num_jobs ++;
+    queue->age_sum += age;
+
+    for (i = 0; i < (sizeof(metrics_ages) / sizeof(metrics_ages[0])); i ++)
+    {
+      if (age <= metrics_ages[i])
+        queue->buckets[i] ++;
+    }
+  }
+
+  // Write each metric family...
+  metrics_printf(mb, "# HELP cups_up Whether the last refresh from the scheduler succeeded.\n");
+  metrics_printf(mb, "# TYPE cups_up gauge\n");
+  metrics_printf(mb, "cups_up %d\n", cache->up ? 1 : 0);
+
+  metrics_printf(mb, "# HELP cups_queued_jobs Number of active jobs on the queue (queued-job-count).\n");
+  metrics_printf(mb, "# TYPE cups_queued_jobs gauge\n");
+  for (queue = (metrics_queue_t *)cupsArrayGetFirst(cache->queues); queue; queue = (metrics_queue_t *)cupsArrayGetNext(cache->queues))
+  {
+    metrics_printf(mb, "cups_queued_jobs{queue=");
+    metrics_puts_label(mb, queue->name);
+    metrics_printf(mb, "} %d\n", queue->queued);
+  }
+
+  metrics_printf(mb, "# HELP cups_printer_state Printer state (printer-state): 3 = idle, 4 = processing, 5 = stopped.\n");
+  metrics_printf(mb, "# TYPE cups_printer_state gauge\n");
+  for (queue = (metrics_queue_t *)cupsArrayGetFirst(cache->queues); queue; queue = (metrics_queue_t *)cupsArrayGetNext(cache->queues))
+  {
+    metrics_printf(mb, "cups_printer_state{queue=");
+    metrics_puts_label(mb, queue->name);
+    metrics_printf(mb, "} %d\n", (int)queue->state);
+  }
+
+  metrics_printf(mb, "# HELP cups_printer_accepting_jobs Whether the queue is accepting jobs (printer-is-accepting-jobs).\n");
+  metrics_printf(mb, "# TYPE cups_printer_accepting_jobs gauge\n");
+  for (queue = (metrics_queue_t *)cupsArrayGetFirst(cache->queues); queue; queue = (metrics_queue_t *)cupsArrayGetNext(cache->queues))
+  {
+    metrics_printf(mb, "cups_printer_accepting_jobs{queue=");
+    metrics_puts_label(mb, queue->name);
+    metrics_printf(mb, "} %d\n", queue->accepting ? 1 : 0);
+  }
+
+  metrics_printf(mb, "# HELP cups_printer_state_reason Active printer state reasons (printer-state-reasons).\n");
+  metrics_printf(mb, "# TYPE cups_printer_state_reason gauge\n");
+  for (queue = (metrics_queue_t *)cupsArrayGetFirst(cache->queues); queue; queue = (metrics_queue_t *)cupsArrayGetNext(cache->queues))
+  {
+    char	reasons[1024],		// Copy of reasons
+		*reason,		// Current reason
+		*next;			// Next reason
+
+    cupsCopyString(reasons, queue->reasons, sizeof(reasons));
+
+    for (reason = reasons; *reason; reason = next)
+    {
+      if ((next = strchr(reason, ' ')) != NULL)
+        *next++ = '\0';
+      else
+        next = reason + strlen(reason);
+
+      metrics_printf(mb, "cups_printer_state_reason{queue=");
+      metrics_puts_label(mb, queue->name);
+      metrics_printf(mb, ",reason=");
+      metrics_puts_label(mb, reason);
+      metrics_printf(mb, "} 1\n");
+    }
+  }
+
+  metrics_printf(mb, "# HELP cups_job_age_seconds Time since creation of active jobs on the queue.\n");
+  metrics_printf(mb, "# TYPE cups_job_age_seconds histogram\n");
+  metrics_printf(mb, "# UNIT cups_job_age_seconds seconds\n");
+  for (queue = (metrics_queue_t *)cupsArrayGetFirst(cache->queues); queue; queue = (metrics_queue_t *)cupsArrayGetNext(cache->queues))
+  {
+    for (i = 0; i < (sizeof(metrics_ages) / sizeof(metrics_ages[0])); i ++)
+    {
+      metrics_printf(mb, "cups_job_age_seconds_bucket{queue=");
+      metrics_puts_label(mb, queue->name);
+      metrics_printf(mb, ",le=\"%d.0\"} %u\n", metrics_ages[i], (unsigned)queue->buckets[i]);
+    }
+
+    metrics_printf(mb, "cups_job_age_seconds_bucket{queue=");
+    metrics_puts_label(mb, queue->name);
+    metrics_printf(mb, ",le=\"+Inf\"} %u\n", (unsigned)queue->num_jobs);
+
+    metrics_printf(mb, "cups_job_age_seconds_count{queue=");
+    metrics_puts_label(mb, queue->name);
+    metrics_printf(mb, "} %u\n", (unsigned)queue->num_jobs);
+
+    metrics_printf(mb, "cups_job_age_seconds_sum{queue=");
+    metrics_puts_label(mb, queue->name);
+    metrics_printf(mb, "} %.1f\n", queue->age_sum);
+  }
+
+  metrics_printf(mb, "# EOF\n");
+}
+
+
+//
+// 'metrics_serve()' - Run a long-lived OpenMetrics exporter.
+//
+// Scrapes are answered from the metrics cache, which is refreshed over a
+// single persistent scheduler connection at most once every "interval"
+// seconds.
+//
+
+static int				// O - Exit status
+metrics_serve(const char *listen,	// I - Listen address ("[address:]port")
+              int        interval)	// I - Refresh interval in seconds
+{
+  char		host[256],		// Listen host
+		*hostptr,		// Pointer to host name
+		*portptr;		// Pointer to port number
+  int		port;			// Port number
+  http_addrlist_t *addrlist,		// Listen addresses
+		*addr;			// Current address
+  struct pollfd	pfds[METRICS_MAX_LISTEN];
+					// Listen sockets
+  nfds_t	i,			// Looping var
+		num_pfds;		// Number of listen sockets
+  metrics_cache_t *cache;		// Metrics cache
+  metrics_buffer_t mb;			// Output buffer
+
+
+  // Separate the address and port...
+  cupsCopyString(host, listen, sizeof(host));
+
+  if ((portptr = strrchr(host, ':')) != NULL && !strchr(portptr, ']'))
+  {
+    *portptr++ = '\0';
+    hostptr    = host;
+
+    if (*hostptr == '[')
+    {
+      char *bracket;			// Closing bracket
+
+      hostptr ++;
+      if ((bracket = strchr(hostptr, ']')) != NULL)
+        *bracket = '\0';
+    }
+
+    if (!*hostptr || !strcmp(hostptr, "*"))
+      hostptr = NULL;
+  }
+  else
+  {
+    portptr = host;
+    hostptr = NULL;
+  }
+
+  if ((port = atoi(portptr)) < 1 || port > 65535)
+  {
+    cupsLangPrintf(stderr, _("%s: Error - bad listen address \"%s\"."), "lpstat", listen);
+    return (1);
+  }
+
+  // Create the listen sockets...
+  addrlist = httpAddrGetList(hostptr, AF_UNSPEC, portptr);
+
+  for (addr = addrlist, num_pfds = 0; addr && num_pfds < METRICS_MAX_LISTEN; addr = addr->next)
+  {
+    if ((pfds[num_pfds].fd = httpAddrListen(&(addr->addr), port)) >= 0)
+    {
+      pfds[num_pfds].events = POLLIN;
+      num_pfds ++;
+    }
+  }
+
+  httpAddrFreeList(addrlist);
+
+  if (num_pfds == 0)
+  {
+    cupsLangPrintf(stderr, _("%s: Unable to listen on \"%s\": %s"), "lpstat", listen, strerror(errno));
+    return (1);
+  }
+
+  if ((cache = metrics_new()) == NULL)
+  {
+    cupsLangPrintf(stderr, _("%s: Unable to connect to server."), "lpstat");
+    return (1);
+  }
+
+  signal(SIGPIPE, SIG_IGN);
+
+  memset(&mb, 0, sizeof(mb));
+
+  // Answer scrapes until we are killed...
+  for (;;)
+  {
+    if (poll(pfds, num_pfds, -1) < 0)
+    {
+      if (errno == EINTR || errno == EAGAIN)
+        continue;
+
+      cupsLangPrintf(stderr, "lpstat: %s", strerror(errno));
+      break;
+    }
+
+    for (i = 0; i < num_pfds; i ++)
+    {
+      http_t	*client;		// Client connection
+
+      if (!(pfds[i].revents & POLLIN))
+        continue;
+
+      if ((client = httpAcceptConnection(pfds[i].fd, /*blocking*/true)) != NULL)
+      {
+        metrics_serve_client(cache, &mb, client, interval);
+        httpClose(client);
+      }
+    }
+  }
+
+  for (i = 0; i < num_pfds; i ++)
+    close(pfds[i].fd);
+
+  free(mb.data);
+  metrics_delete(cache);
+
+  return (1);
+}
+
+
+//
+// 'metrics_serve_client()' - Answer a HTTP request from a metrics client.
+//
+// Clients are served one at a time, so the connection is closed after a
+// single response to keep one scraper from blocking the others.
+//
+
+static void
+metrics_serve_client(
+    metrics_cache_t  *cache,		// I - Metrics cache
+    metrics_buffer_t *mb,		// I - Output buffer
+    http_t           *client,		// I - Client connection
+    int              interval)		// I - Refresh interval in seconds
+{
+  http_state_t	hstate;			// HTTP request state
+  http_status_t	hstatus;		// HTTP status
+  char		resource[1024];		// Resource path
+  const char	*data,			// Response data
+		*type;			// Response content type
+  size_t	length;			// Length of response data
+
+
+  if (!httpWait(client, 5000))
+    return;
 
-  if (!name)
-    return (false);
+  // Read the request line and header fields...
+  if ((hstate = httpReadRequest(client, resource, sizeof(resource))) == HTTP_STATE_WAITING || hstate == HTTP_STATE_ERROR || hstate == HTTP_STATE_UNKNOWN_METHOD || hstate == HTTP_STATE_UNKNOWN_VERSION)
+    return;
 
-  do
-  {
-    // Skip leading whitespace and commas...
-    while (isspace(*list & 255) || *list == ',')
-      list ++;
+  while ((hstatus = httpUpdate(client)) == HTTP_STATUS_CONTINUE);
 
-    if (!*list)
-      break;
+  if (hstatus != HTTP_STATUS_OK)
+    return;
 
-    // Compare names...
-    for (nameptr = name;
-	 *nameptr && *list && tolower(*nameptr & 255) == tolower(*list & 255);
-	 nameptr ++, list ++);
+  // Only "GET /metrics" (and "GET /") is supported...
+  if (hstate != HTTP_STATE_GET && hstate != HTTP_STATE_HEAD)
+  {
+    hstatus = HTTP_STATUS_METHOD_NOT_ALLOWED;
+  }
+  else if (strcmp(resource, "/metrics") && strcmp(resource, "/"))
+  {
+    hstatus = HTTP_STATUS_NOT_FOUND;
+  }
+  else
+  {
+    if ((time(NULL) - cache->updated) >= interval)
+      metrics_refresh(cache);
 
-    if (!*nameptr && (!*list || *list == ',' || isspace(*list & 255)))
-      return (true);
+    mb->used = 0;
+    metrics_render(cache, mb);
 
-    while (*list && !isspace(*list & 255) && *list != ',')
-      list ++;
+    hstatus = HTTP_STATUS_OK;
   }
-  while (*list);
 
-  return (false);
+  if (hstatus == HTTP_STATUS_OK)
+  {
+    data   = mb->data;
+    length = mb->used;
+    type   = "application/openmetrics-text; version=1.0.0; charset=utf-8";
+  }
+  else
+  {
+    data   = httpStatusString(hstatus);
+    length = strlen(data);
+    type   = "text/plain";
+  }
+
+  // Send the response...
+  httpSetField(client, HTTP_FIELD_CONTENT_TYPE, type);
+  httpSetLength(client, length);
+
+  if (!httpWriteResponse(client, hstatus))
+    return;
+
+  if (hstate != HTTP_STATE_HEAD && httpWrite(client, data, length) < 0)
+    return;
+
+  httpFlushWrite(client);
 }
 
 
@@ -641,6 +1701,7 @@ show_accepting(const char  *printers,	// I - Destinations
   size_t	i;			// Looping var
   ipp_t		*request,		// IPP Request
 		*response;		// IPP Response
+  stream_t	*stream;		// Streaming response
   ipp_attribute_t *attr;		// Current attribute
   const char	*printer,		// Printer name
 		*message;		// Printer device URI
@@ -674,28 +1735,28 @@ show_accepting(const char  *printers,	// I - Destinations
   ippAddString(request, IPP_TAG_OPERATION, IPP_TAG_NAME, "requesting-user-name",  NULL, cupsGetUser());
 
   // Do the request and get back a response...
-  response = cupsDoRequest(CUPS_HTTP_DEFAULT, request, "/");
+  stream = stream_open(conn_get_agent(conn_get_default()), request, "/");
 
-  if (cupsLastError() == IPP_STATUS_ERROR_SERVICE_UNAVAILABLE)
+  if (stream_get_status(stream) == IPP_STATUS_ERROR_SERVICE_UNAVAILABLE)
   {
     cupsLangPrintf(stderr, _("%s: Scheduler is not running."), "lpstat");
-    ippDelete(response);
+    stream_close(stream);
     return (1);
   }
-  else if (cupsLastError() == IPP_STATUS_ERROR_BAD_REQUEST || cupsLastError() == IPP_STATUS_ERROR_VERSION_NOT_SUPPORTED)
+  else if (stream_get_status(stream) == IPP_STATUS_ERROR_BAD_REQUEST || stream_get_status(stream) == IPP_STATUS_ERROR_VERSION_NOT_SUPPORTED)
   {
     cupsLangPrintf(stderr, _("%s: Error - add '/version=1.1' to server name."), "lpstat");
-    ippDelete(response);
+    stream_close(stream);
     return (1);
   }
-  else if (cupsLastError() > IPP_STATUS_OK_CONFLICTING)
+  else if (stream_get_status(stream) > IPP_STATUS_OK_CONFLICTING)
   {
-    cupsLangPrintf(stderr, "lpstat: %s", cupsLastErrorString());
-    ippDelete(response);
+    cupsLangPrintf(stderr, "lpstat: %s", stream_get_status_message(stream));
+    stream_close(stream);
     return (1);
   }
 
-  if (response)
+  while ((response = stream_next(stream)) != NULL)
   {
     // Loop through the printers returned in the list and display
     // their devices...
@@ -777,10 +1838,17 @@ show_accepting(const char  *printers,	// I - Destinations
       if (attr == NULL)
         break;
     }
+  }
 
-    ippDelete(response);
+  if (stream_get_status(stream) > IPP_STATUS_OK_CONFLICTING)
+  {
+    cupsLangPrintf(stderr, "lpstat: %s", stream_get_status_message(stream));
+    stream_close(stream);
+    return (1);
   }
 
+  stream_close(stream);
+
   return (0);
 }
 
@@ -797,6 +1865,7 @@ show_classes(const char *dests)		// I - Destinations
   ipp_t		*request,		// IPP Request
 		*response,		// IPP Response
 		*response2;		// IPP response from remote server
+  stream_t	*stream;		// Streaming response
   http_t	*http2;			// Remote server
   ipp_attribute_t *attr;		// Current attribute
   const char	*printer,		// Printer class name
@@ -831,37 +1900,30 @@ show_classes(const char *dests)		// I - Destinations
   ippAddString(request, IPP_TAG_OPERATION, IPP_TAG_NAME, "requesting-user-name", NULL, cupsGetUser());
 
   // Do the request and get back a response...
-  response = cupsDoRequest(CUPS_HTTP_DEFAULT, request, "/");
+  stream = stream_open(conn_get_agent(conn_get_default()), request, "/");
 
-  if (cupsLastError() == IPP_STATUS_ERROR_SERVICE_UNAVAILABLE)
+  if (stream_get_status(stream) == IPP_STATUS_ERROR_SERVICE_UNAVAILABLE)
   {
     cupsLangPrintf(stderr, _("%s: Scheduler is not running."), "lpstat");
-    ippDelete(response);
+    stream_close(stream);
     return (1);
   }
 
-  if (cupsLastError() == IPP_STATUS_ERROR_BAD_REQUEST || cupsLastError() == IPP_STATUS_ERROR_VERSION_NOT_SUPPORTED)
+  if (stream_get_status(stream) == IPP_STATUS_ERROR_BAD_REQUEST || stream_get_status(stream) == IPP_STATUS_ERROR_VERSION_NOT_SUPPORTED)
   {
     cupsLangPrintf(stderr, _("%s: Error - add '/version=1.1' to server name."), "lpstat");
-    ippDelete(response);
+    stream_close(stream);
     return (1);
   }
-  else if (cupsLastError() > IPP_STATUS_OK_CONFLICTING)
+  else if (stream_get_status(stream) > IPP_STATUS_OK_CONFLICTING)
   {
-    cupsLangPrintf(stderr, "lpstat: %s", cupsLastErrorString());
-    ippDelete(response);
+    cupsLangPrintf(stderr, "lpstat: %s", stream_get_status_message(stream));
+    stream_close(stream);
     return (1);
   }
 
-  if (response)
+  while ((response = stream_next(stream)) != NULL)
   {
-    if (ippGetStatusCode(response) > IPP_STATUS_OK_CONFLICTING)
-    {
-      cupsLangPrintf(stderr, "lpstat: %s", cupsLastErrorString());
-      ippDelete(response);
-      return (1);
-    }
-
     // Loop through the printers returned in the list and display
     // their devices...
     for (attr = ippGetFirstAttribute(response); attr != NULL; attr = ippGetNextAttribute(response))
@@ -903,9 +1965,9 @@ show_classes(const char *dests)		// I - Destinations
         httpSeparateURI(HTTP_URI_CODING_ALL, printer_uri, method, sizeof(method), username, sizeof(username), server, sizeof(server), &port, resource, sizeof(resource));
 
         if (!strcasecmp(server, cupsGetServer()))
-	  http2 = CUPS_HTTP_DEFAULT;
+	  http2 = conn_get_default();
 	else
-	  http2 = httpConnect(server, port, /*addrlist*/NULL, AF_UNSPEC, cupsGetEncryption(), /*blocking*/true, /*msec*/30000, /*cancel*/NULL);
+	  http2 = conn_get(server, port, cupsGetEncryption());
 
         // Build an Get-Printer-Attributes request, which requires the following
         // attributes:
@@ -922,9 +1984,6 @@ show_classes(const char *dests)		// I - Destinations
 
 	if ((response2 = cupsDoRequest(http2, request, "/")) != NULL)
 	  members = ippFindAttribute(response2, "member-names", IPP_TAG_NAME);
-
-	if (http2)
-	  httpClose(http2);
       }
 
       // See if we have everything needed...
@@ -961,10 +2020,17 @@ show_classes(const char *dests)		// I - Destinations
       if (attr == NULL)
         break;
     }
+  }
 
-    ippDelete(response);
+  if (stream_get_status(stream) > IPP_STATUS_OK_CONFLICTING)
+  {
+    cupsLangPrintf(stderr, "lpstat: %s", stream_get_status_message(stream));
+    stream_close(stream);
+    return (1);
   }
 
+  stream_close(stream);
+
   return (0);
 }
 
@@ -1026,6 +2092,7 @@ show_devices(const char  *printers,	// I - Destinations
   size_t	i;			// Looping var
   ipp_t		*request,		// IPP Request
 		*response;		// IPP Response
+  stream_t	*stream;		// Streaming response
   ipp_attribute_t *attr;		// Current attribute
   const char	*printer,		// Printer name
 		*uri,			// Printer URI
@@ -1054,28 +2121,28 @@ show_devices(const char  *printers,	// I - Destinations
   ippAddString(request, IPP_TAG_OPERATION, IPP_TAG_NAME, "requesting-user-name", NULL, cupsGetUser());
 
   // Do the request and get back a response...
-  response = cupsDoRequest(CUPS_HTTP_DEFAULT, request, "/");
+  stream = stream_open(conn_get_agent(conn_get_default()), request, "/");
 
-  if (cupsLastError() == IPP_STATUS_ERROR_SERVICE_UNAVAILABLE)
+  if (stream_get_status(stream) == IPP_STATUS_ERROR_SERVICE_UNAVAILABLE)
   {
     cupsLangPrintf(stderr, _("%s: Scheduler is not running."), "lpstat");
-    ippDelete(response);
+    stream_close(stream);
     return (1);
   }
-  else if (cupsLastError() == IPP_STATUS_ERROR_BAD_REQUEST || cupsLastError() == IPP_STATUS_ERROR_VERSION_NOT_SUPPORTED)
+  else if (stream_get_status(stream) == IPP_STATUS_ERROR_BAD_REQUEST || stream_get_status(stream) == IPP_STATUS_ERROR_VERSION_NOT_SUPPORTED)
   {
     cupsLangPrintf(stderr, _("%s: Error - add '/version=1.1' to server name."), "lpstat");
-    ippDelete(response);
+    stream_close(stream);
     return (1);
   }
-  else if (cupsLastError() > IPP_STATUS_OK_CONFLICTING)
+  else if (stream_get_status(stream) > IPP_STATUS_OK_CONFLICTING)
   {
-    cupsLangPrintf(stderr, "lpstat: %s", cupsLastErrorString());
-    ippDelete(response);
+    cupsLangPrintf(stderr, "lpstat: %s", stream_get_status_message(stream));
+    stream_close(stream);
     return (1);
   }
 
-  if (response)
+  while ((response = stream_next(stream)) != NULL)
   {
     // Loop through the printers returned in the list and display their devices...
     for (attr = ippGetFirstAttribute(response); attr != NULL; attr = ippGetNextAttribute(response))
@@ -1145,14 +2212,76 @@ show_devices(const char  *printers,	// I - Destinations
       if (attr == NULL)
         break;
     }
+  }
 
-    ippDelete(response);
+  if (stream_get_status(stream) > IPP_STATUS_OK_CONFLICTING)
+  {
+    cupsLangPrintf(stderr, "lpstat: %s", stream_get_status_message(stream));
+    stream_close(stream);
+    return (1);
   }
 
+  stream_close(stream);
+
   return (0);
 }
 
 
+//
+// 'show_job()' - Show a job.
+//
+
+static void
+show_job(watch_t      *watch,		// I - Job list dashboard or `NULL` for the standard output
+         lpstat_job_t *job,		// I - Job information
+         int          rank,		// I - Rank in queue
+         int          long_status,	// I - Show long status?
+         int          ranking)		// I - Show job ranking?
+{
+  size_t	i;			// Looping var
+  char		temp[255],		// Temporary buffer
+		date[255];		// Date buffer
+
+
+  snprintf(temp, sizeof(temp), "%s-%d", job->dest, job->id);
+
+  str_date(date, sizeof(date), job->time);
+
+  if (ranking)
+    watch_printf(watch, "%3d %-21s %-13s %8.0f %s", rank, temp, job->user ? job->user : "unknown", 1024.0 * job->size, date);
+  else
+    watch_printf(watch, "%-23s %-13s %8.0f   %s", temp, job->user ? job->user : "unknown", 1024.0 * job->size, date);
+
+  if (long_status)
+  {
+    if (job->message)
+      watch_printf(watch, _("\tStatus: %s"), job->message);
+
+    if (job->reasons)
+    {
+      char	alerts[1024],		// Alerts string
+		*aptr;			// Pointer into alerts string
+      size_t	count = ippGetCount(job->reasons);
+					// Number of values
+
+      for (i = 0, aptr = alerts; i < count; i ++)
+      {
+	if (i)
+	  snprintf(aptr, sizeof(alerts) - (size_t)(aptr - alerts), " %s", ippGetString(job->reasons, i, NULL));
+	else
+	  cupsCopyString(alerts, ippGetString(job->reasons, i, NULL), sizeof(alerts));
+
+	aptr += strlen(aptr);
+      }
+
+      watch_printf(watch, _("\tAlerts: %s"), alerts);
+    }
+
+    watch_printf(watch, _("\tqueued for %s"), job->dest);
+  }
+}
+
+
 //
 // 'show_jobs()' - Show active print jobs.
 //
@@ -1164,38 +2293,38 @@ show_jobs(const char *dests,		// I - Destinations
           int        ranking,		// I - Show job ranking?
 	  const char *which)		// I - Show which jobs?
 {
-  size_t	i;			// Looping var
   ipp_t		*request,		// IPP Request
 		*response;		// IPP Response
-  ipp_attribute_t *attr,		// Current attribute
-		*reasons;		// Job state reasons attribute
-  const char	*dest,			// Pointer into job-printer-uri
-		*username,		// Pointer to job-originating-user-name
-		*message,		// Pointer to job-printer-state-message
-		*time_at;		// time-at-xxx attribute name to use
-  int		rank,			// Rank in queue
-		jobid,			// job-id
-		size;			// job-k-octets
-  time_t	jobtime;		// time-at-creation
-  char		temp[255],		// Temporary buffer
-		date[255];		// Date buffer
-  static const char *jattrs[] =		// Attributes we need for jobs...
-		{
-		  "job-id",
-		  "job-k-octets",
-		  "job-name",
-		  "job-originating-user-name",
-		  "job-printer-state-message",
-		  "job-printer-uri",
-		  "job-state-reasons",
-		  "time-at-creation",
-		  "time-at-completed"
-		};
+  stream_t	*stream;		// Streaming response
+  ipp_attribute_t *attr;		// Current attribute
+  lpstat_job_t	job;			// Current job
+  const char	*time_at;		// time-at-xxx attribute name to use
+  int		rank;			// Rank in queue
+  size_t	num_jattrs = 0;		// Number of job attributes
+  const char	*jattrs[7];		// Attributes we need for jobs...
 
 
   if (dests != NULL && !strcmp(dests, "all"))
     dests = NULL;
 
+  if (!strcmp(which, "aborted") || !strcmp(which, "canceled") || !strcmp(which, "completed"))
+    time_at = "time-at-completed";
+  else
+    time_at = "time-at-creation";
+
+  // Only ask for the attributes that will be shown...
+  jattrs[num_jattrs ++] = "job-id";
+  jattrs[num_jattrs ++] = "job-k-octets";
+  jattrs[num_jattrs ++] = "job-originating-user-name";
+  jattrs[num_jattrs ++] = "job-printer-uri";
+  jattrs[num_jattrs ++] = time_at;
+
+  if (long_status)
+  {
+    jattrs[num_jattrs ++] = "job-printer-state-message";
+    jattrs[num_jattrs ++] = "job-state-reasons";
+  }
+
   // Build a Get-Jobs request, which requires the following attributes:
   //
   //   attributes-charset
@@ -1207,42 +2336,41 @@ show_jobs(const char *dests,		// I - Destinations
   request = ippNewRequest(IPP_OP_GET_JOBS);
 
   ippAddString(request, IPP_TAG_OPERATION, IPP_TAG_URI, "printer-uri", NULL, "ipp://localhost/");
-  ippAddStrings(request, IPP_TAG_OPERATION, IPP_TAG_KEYWORD, "requested-attributes", sizeof(jattrs) / sizeof(jattrs[0]), NULL, jattrs);
+  ippAddStrings(request, IPP_TAG_OPERATION, IPP_TAG_KEYWORD, "requested-attributes", num_jattrs, NULL, jattrs);
   ippAddString(request, IPP_TAG_OPERATION, IPP_TAG_NAME, "requesting-user-name", NULL, cupsGetUser());
   ippAddString(request, IPP_TAG_OPERATION, IPP_TAG_KEYWORD, "which-jobs", NULL, which);
 
+  // Keep the list on the terminal up-to-date when watching...
+  if (watch_interval > 0 && isatty(1))
+    return (watch_jobs(request, dests, users, long_status, ranking, time_at));
+
   // Do the request and get back a response...
-  response = cupsDoRequest(CUPS_HTTP_DEFAULT, request, "/");
+  stream = stream_open(conn_get_agent(conn_get_default()), request, "/");
 
-  if (cupsLastError() == IPP_STATUS_ERROR_SERVICE_UNAVAILABLE)
+  if (stream_get_status(stream) == IPP_STATUS_ERROR_SERVICE_UNAVAILABLE)
   {
     cupsLangPrintf(stderr, _("%s: Scheduler is not running."), "lpstat");
-    ippDelete(response);
+    stream_close(stream);
     return (1);
   }
-  else if (cupsLastError() == IPP_STATUS_ERROR_BAD_REQUEST || cupsLastError() == IPP_STATUS_ERROR_VERSION_NOT_SUPPORTED)
+  else if (stream_get_status(stream) == IPP_STATUS_ERROR_BAD_REQUEST || stream_get_status(stream) == IPP_STATUS_ERROR_VERSION_NOT_SUPPORTED)
   {
     cupsLangPrintf(stderr, _("%s: Error - add '/version=1.1' to server name."), "lpstat");
-    ippDelete(response);
+    stream_close(stream);
     return (1);
   }
-  else if (cupsLastError() > IPP_STATUS_OK_CONFLICTING)
+  else if (stream_get_status(stream) > IPP_STATUS_OK_CONFLICTING)
   {
-    cupsLangPrintf(stderr, "lpstat: %s", cupsLastErrorString());
-    ippDelete(response);
+    cupsLangPrintf(stderr, "lpstat: %s", stream_get_status_message(stream));
+    stream_close(stream);
     return (1);
   }
 
-  if (response)
-  {
-    // Loop through the job list and display them...
-    if (!strcmp(which, "aborted") || !strcmp(which, "canceled") || !strcmp(which, "completed"))
-      time_at = "time-at-completed";
-    else
-      time_at = "time-at-creation";
-
-    rank = -1;
+  rank = -1;
 
+  // Loop through the job list and display jobs as they are received...
+  while ((response = stream_next(stream)) != NULL)
+  {
     for (attr = ippGetFirstAttribute(response); attr != NULL; attr = ippGetNextAttribute(response))
     {
       // Skip leading attributes until we hit a job...
@@ -1253,54 +2381,10 @@ show_jobs(const char *dests,		// I - Destinations
         break;
 
       // Pull the needed attributes from this job...
-      jobid    = 0;
-      size     = 0;
-      username = NULL;
-      dest     = NULL;
-      jobtime  = 0;
-      message  = NULL;
-      reasons  = NULL;
-
-      while (attr != NULL && ippGetGroupTag(attr) == IPP_TAG_JOB)
-      {
-        const char	*name = ippGetName(attr);
-        ipp_tag_t	value_tag = ippGetValueTag(attr);
-
-        if (!strcmp(name, "job-id") && value_tag == IPP_TAG_INTEGER)
-	{
-	  jobid = ippGetInteger(attr, 0);
-        }
-        else if (!strcmp(name, "job-k-octets") && value_tag == IPP_TAG_INTEGER)
-	{
-	  size = ippGetInteger(attr, 0);
-        }
-        else if (!strcmp(name, time_at) && value_tag == IPP_TAG_INTEGER)
-	{
-	  jobtime = ippGetInteger(attr, 0);
-        }
-        else if (!strcmp(name, "job-printer-state-message") && value_tag == IPP_TAG_TEXT)
-	{
-	  message = ippGetString(attr, 0, NULL);
-        }
-        else if (!strcmp(name, "job-printer-uri") && value_tag == IPP_TAG_URI)
-	{
-	  if ((dest = strrchr(ippGetString(attr, 0, NULL), '/')) != NULL)
-	    dest ++;
-        }
-        else if (!strcmp(name, "job-originating-user-name") && value_tag == IPP_TAG_NAME)
-	{
-	  username = ippGetString(attr, 0, NULL);
-        }
-        else if (!strcmp(name, "job-state-reasons") && value_tag == IPP_TAG_KEYWORD)
-	{
-	  reasons = attr;
-	}
-
-        attr = ippGetNextAttribute(response);
-      }
+      attr = get_job(response, attr, time_at, &job);
 
       // See if we have everything needed...
-      if (dest == NULL || jobid == 0)
+      if (job.dest == NULL || job.id == 0)
       {
         if (attr == NULL)
 	  break;
@@ -1311,51 +2395,61 @@ show_jobs(const char *dests,		// I - Destinations
       // Display the job...
       rank ++;
 
-      if (match_list(dests, dest) && match_list(users, username))
-      {
-        snprintf(temp, sizeof(temp), "%s-%d", dest, jobid);
+      if (match_list(dests, job.dest) && match_list(users, job.user))
+        show_job(NULL, &job, rank, long_status, ranking);
 
-	str_date(date, sizeof(date), jobtime);
+      if (attr == NULL)
+        break;
+    }
+  }
 
-	if (ranking)
-	  cupsLangPrintf(stdout, "%3d %-21s %-13s %8.0f %s", rank, temp, username ? username : "unknown", 1024.0 * size, date);
-	else
-	  cupsLangPrintf(stdout, "%-23s %-13s %8.0f   %s", temp, username ? username : "unknown", 1024.0 * size, date);
+  if (stream_get_status(stream) > IPP_STATUS_OK_CONFLICTING)
+  {
+    cupsLangPrintf(stderr, "lpstat: %s", stream_get_status_message(stream));
+    stream_close(stream);
+    return (1);
+  }
 
-	if (long_status)
-	{
-	  if (message)
-	    cupsLangPrintf(stdout, _("\tStatus: %s"), message);
+  stream_close(stream);
 
-	  if (reasons)
-	  {
-	    char	alerts[1024],	// Alerts string
-			*aptr;		// Pointer into alerts string
-            size_t	count = ippGetCount(reasons);
-					// Number of values
+  return (0);
+}
 
-	    for (i = 0, aptr = alerts; i < count; i ++)
-	    {
-	      if (i)
-		snprintf(aptr, sizeof(alerts) - (size_t)(aptr - alerts), " %s", ippGetString(reasons, i, NULL));
-	      else
-		cupsCopyString(alerts, ippGetString(reasons, i, NULL), sizeof(alerts));
 
-	      aptr += strlen(aptr);
-	    }
+//
+// 'show_metrics()' - Show queue metrics in OpenMetrics text format.
+//
 
-	    cupsLangPrintf(stdout, _("\tAlerts: %s"), alerts);
-	  }
+static int				// O - 0 on success, 1 on fail
+show_metrics(void)
+{
+  metrics_cache_t	*cache;		// Metrics cache
+  metrics_buffer_t	mb;		// Output buffer
+  bool			ret;		// Refresh status
 
-	  cupsLangPrintf(stdout, _("\tqueued for %s"), dest);
-	}
-      }
 
-      if (attr == NULL)
-        break;
-    }
+  if ((cache = metrics_new()) == NULL)
+  {
+    cupsLangPrintf(stderr, _("%s: Unable to connect to server."), "lpstat");
+    return (1);
+  }
 
-    ippDelete(response);
+  memset(&mb, 0, sizeof(mb));
+
+  ret = metrics_refresh(cache);
+
+  metrics_render(cache, &mb);
+
+  if (mb.data)
+    fwrite(mb.data, 1, mb.used, stdout);
+
+  free(mb.data);
+  metrics_delete(cache);
+
+  if (!ret)
+  {
+    cupsLangPrintf(stderr, "lpstat: %s", cupsLastErrorString());
+    return (1);
   }
 
   return (0);
@@ -1377,6 +2471,7 @@ show_printers(const char  *printers,	// I - Destinations
   ipp_t		*request,		// IPP Request
 		*response,		// IPP Response
 		*jobs;			// IPP Get Jobs response
+  stream_t	*stream;		// Streaming response
   ipp_attribute_t *attr,		// Current attribute
 		*jobattr,		// Job ID attribute
 		*reasons;		// Job state reasons attribute
@@ -1392,21 +2487,8 @@ show_printers(const char  *printers,	// I - Destinations
   char		printer_uri[HTTP_MAX_URI],
 					// Printer URI
 		printer_state_time[255];// Printer state time
-  static const char *pattrs[] =		// Attributes we need for printers...
-  {
-    "printer-name",
-    "printer-state",
-    "printer-state-message",
-    "printer-state-reasons",
-    "printer-state-change-time",
-    "printer-type",
-    "printer-info",
-    "printer-location",
-    "printer-make-and-model",
-    "printer-uri-supported",
-    "requesting-user-name-allowed",
-    "requesting-user-name-denied"
-  };
+  size_t	num_pattrs = 0;		// Number of printer attributes
+  const char	*pattrs[9];		// Attributes we need for printers...
   static const char *jattrs[] =		// Attributes we need for jobs...
   {
     "job-id",
@@ -1417,6 +2499,23 @@ show_printers(const char  *printers,	// I - Destinations
   if (printers != NULL && !strcmp(printers, "all"))
     printers = NULL;
 
+  // Only ask for the attributes that will be shown...
+  pattrs[num_pattrs ++] = "printer-name";
+  pattrs[num_pattrs ++] = "printer-state";
+  pattrs[num_pattrs ++] = "printer-state-change-time";
+  pattrs[num_pattrs ++] = "printer-state-message";
+  pattrs[num_pattrs ++] = "printer-state-reasons";
+
+  if (long_status)
+    pattrs[num_pattrs ++] = "printer-info";
+
+  if (long_status > 1)
+  {
+    pattrs[num_pattrs ++] = "printer-location";
+    pattrs[num_pattrs ++] = "requesting-user-name-allowed";
+    pattrs[num_pattrs ++] = "requesting-user-name-denied";
+  }
+
   // Build a CUPS-Get-Printers request, which requires the following
   // attributes:
   //
@@ -1426,32 +2525,32 @@ show_printers(const char  *printers,	// I - Destinations
   //   requesting-user-name
   request = ippNewRequest(IPP_OP_CUPS_GET_PRINTERS);
 
-  ippAddStrings(request, IPP_TAG_OPERATION, IPP_TAG_KEYWORD, "requested-attributes", sizeof(pattrs) / sizeof(pattrs[0]), NULL, pattrs);
+  ippAddStrings(request, IPP_TAG_OPERATION, IPP_TAG_KEYWORD, "requested-attributes", num_pattrs, NULL, pattrs);
   ippAddString(request, IPP_TAG_OPERATION, IPP_TAG_NAME, "requesting-user-name", NULL, cupsGetUser());
 
   // Do the request and get back a response...
-  response = cupsDoRequest(CUPS_HTTP_DEFAULT, request, "/");
+  stream = stream_open(conn_get_agent(conn_get_default()), request, "/");
 
-  if (cupsLastError() == IPP_STATUS_ERROR_SERVICE_UNAVAILABLE)
+  if (stream_get_status(stream) == IPP_STATUS_ERROR_SERVICE_UNAVAILABLE)
   {
     cupsLangPrintf(stderr, _("%s: Scheduler is not running."), "lpstat");
-    ippDelete(response);
+    stream_close(stream);
     return (1);
   }
-  else if (cupsLastError() == IPP_STATUS_ERROR_BAD_REQUEST || cupsLastError() == IPP_STATUS_ERROR_VERSION_NOT_SUPPORTED)
+  else if (stream_get_status(stream) == IPP_STATUS_ERROR_BAD_REQUEST || stream_get_status(stream) == IPP_STATUS_ERROR_VERSION_NOT_SUPPORTED)
   {
     cupsLangPrintf(stderr, _("%s: Error - add '/version=1.1' to server name."), "lpstat");
-    ippDelete(response);
+    stream_close(stream);
     return (1);
   }
-  else if (cupsLastError() > IPP_STATUS_OK_CONFLICTING)
+  else if (stream_get_status(stream) > IPP_STATUS_OK_CONFLICTING)
   {
-    cupsLangPrintf(stderr, "lpstat: %s", cupsLastErrorString());
-    ippDelete(response);
+    cupsLangPrintf(stderr, "lpstat: %s", stream_get_status_message(stream));
+    stream_close(stream);
     return (1);
   }
 
-  if (response)
+  while ((response = stream_next(stream)) != NULL)
   {
     // Loop through the printers returned in the list and display their status...
     for (attr = ippGetFirstAttribute(response); attr != NULL; attr = ippGetNextAttribute(response))
@@ -1533,7 +2632,7 @@ show_printers(const char  *printers,	// I - Destinations
 	  httpAssembleURIf(HTTP_URI_CODING_ALL, printer_uri, sizeof(printer_uri), "ipp", NULL, "localhost", 0, "/printers/%s", printer);
 	  ippAddString(request, IPP_TAG_OPERATION, IPP_TAG_URI, "printer-uri", NULL, printer_uri);
 
-          if ((jobs = cupsDoRequest(CUPS_HTTP_DEFAULT, request, "/")) != NULL)
+          if ((jobs = cupsDoRequest(conn_get_agent(conn_get_default()), request, "/")) != NULL)
 	  {
 	    // Get the current active job on this queue...
             ipp_jstate_t jobstate = IPP_JSTATE_PENDING;
@@ -1749,10 +2848,17 @@ show_printers(const char  *printers,	// I - Destinations
       if (attr == NULL)
         break;
     }
+  }
 
-    ippDelete(response);
+  if (stream_get_status(stream) > IPP_STATUS_OK_CONFLICTING)
+  {
+    cupsLangPrintf(stderr, "lpstat: %s", stream_get_status_message(stream));
+    stream_close(stream);
+    return (1);
   }
 
+  stream_close(stream);
+
   return (0);
 }
 
@@ -1764,13 +2870,9 @@ show_printers(const char  *printers,	// I - Destinations
 static int				// 1 on success, 0 on failure
 show_scheduler(void)
 {
-  http_t	*http;			// Connection to server
-
-
-  if ((http = httpConnect(cupsGetServer(), ippGetPort(), /*addrlist*/NULL, AF_UNSPEC, cupsGetEncryption(), /*blocking*/true, /*msec*/30000, /*cancel*/NULL)) != NULL)
+  if (conn_get_default())
   {
     cupsLangPuts(stdout, _("scheduler is running"));
-    httpClose(http);
     return (1);
   }
   else
@@ -1846,6 +2948,96 @@ usage(void)
   cupsLangPuts(stdout, _("-t                      Show all status information"));
   cupsLangPuts(stdout, _("-u [user(s)]            Show jobs queued by the current or specified users"));
   cupsLangPuts(stdout, _("-v [printer(s)]         Show the devices for each destination"));
+  cupsLangPuts(stdout, _("--metrics               Show queue metrics in OpenMetrics format"));
+  cupsLangPuts(stdout, _("--metrics-interval seconds\n"
+                         "                        Set the metrics refresh interval"));
+  cupsLangPuts(stdout, _("--metrics-listen [address:]port\n"
+                         "                        Serve queue metrics over HTTP"));
+  cupsLangPuts(stdout, _("--servers filename      Query each server listed in the file"));
+  cupsLangPuts(stdout, _("--timeout seconds       Set the time limit for each server"));
+  cupsLangPuts(stdout, _("--watch                 Keep the job list up-to-date on the terminal"));
+  cupsLangPuts(stdout, _("--watch-interval seconds\n"
+                         "                        Set the job list refresh interval"));
 
   exit(1);
 }
+
+
+//
+// 'watch_jobs()' - Show the jobs on the terminal until interrupted.
+//
+// Only the lines that change are drawn again after each interval.
+//
+
+static int				// O - 0 on success, 1 on fail
+watch_jobs(ipp_t      *request,		// I - Get-Jobs request
+           const char *dests,		// I - Destinations
+           const char *users,		// I - Users
+           int        long_status,	// I - Show long status?
+           int        ranking,		// I - Show job ranking?
+           const char *time_at)		// I - time-at-xxx attribute name to use
+{
+  http_t	*http;			// Connection to the scheduler
+  watch_t	*watch;			// Job list dashboard
+  watch_diff_t	diff;			// Changes to the job list
+  ipp_t		*attrs;			// Job attributes
+  lpstat_job_t	job;			// Current job
+  size_t	i,			// Looping var
+		count;			// Number of jobs
+  int		rank;			// Rank in queue
+  char		message[1024];		// Error message
+
+
+  // Subscriptions need the scheduler itself, not the caching agent...
+  if ((http = conn_get_default()) == NULL)
+  {
+    cupsLangPrintf(stderr, _("%s: Scheduler is not running."), "lpstat");
+    ippDelete(request);
+    return (1);
+  }
+
+  if ((watch = watch_new(http, request)) == NULL)
+  {
+    cupsLangPrintf(stderr, _("%s: Unable to allocate memory."), "lpstat");
+    return (1);
+  }
+
+  // Draw the list whenever it changes...
+  while (watch_update(watch, watch_interval, &diff))
+  {
+    if (!diff.redraw)
+      continue;
+
+    for (i = 0, count = watch_get_count(watch), rank = -1; i < count; i ++)
+    {
+      attrs = watch_get_job(watch, i);
+
+      get_job(attrs, ippGetFirstAttribute(attrs), time_at, &job);
+
+      if (job.dest == NULL || job.id == 0)
+        continue;
+
+      rank ++;
+
+      if (match_list(dests, job.dest) && match_list(users, job.user))
+        show_job(watch, &job, rank, long_status, ranking);
+    }
+
+    watch_flush(watch);
+  }
+
+  if (watch_get_status(watch) > IPP_STATUS_OK_CONFLICTING)
+    cupsCopyString(message, watch_get_status_message(watch), sizeof(message));
+  else
+    message[0] = '\0';
+
+  watch_delete(watch);
+
+  if (message[0])
+  {
+    cupsLangPrintf(stderr, "lpstat: %s", message);
+    return (1);
+  }
+
+  return (0);
+}
@@ -0,0 +1,32 @@
+//
+// Message catalog compiler for the CUPS commands.
+//
+// Copyright © 2026 by OpenPrinting.
+//
+// Licensed under Apache License v2.0.  See the file "LICENSE" for more
+// information.
+//
+// Usage:
+//
+//   ./mkcatalog FILENAME.strings FILENAME.catalog
+//
+
+#include "catalog.h"
+
+
+//
+// 'main()' - Compile a ".strings" file.
+//
+
+int					// O - Exit status
+main(int  argc,				// I - Number of command-line arguments
+     char *argv[])			// I - Command-line arguments
+{
+  if (argc != 3)
+  {
+    fputs("Usage: mkcatalog FILENAME.strings FILENAME.catalog\n", stderr);
+    return (1);
+  }
+
+  return (catalog_compile(argv[1], argv[2]) ? 0 : 1);
+}
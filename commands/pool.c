@@ -0,0 +1,521 @@
+//
+// IPP request pool for the CUPS commands.
+//
+// Copyright © 2026 by OpenPrinting.
+//
+// Licensed under Apache License v2.0.  See the file "LICENSE" for more
+// information.
+//
+// The request pool sends a list of IPP requests to the current server over a
+// small set of keep-alive connections, one worker thread per connection.
+// Requests are added with `pool_add_request` and then sent with `pool_run`,
+// after which the responses can be read back in the order the requests were
+// added.  The connections come from the connection manager and stay open for
+// later runs and later pools.
+//
+// A sequence of requests can also be added with `pool_add_requests`.  The
+// requests in a sequence are sent one after another on the same connection,
+// stopping at the first failure, and the status of the sequence is that of
+// the last request sent.
+//
+// With `pool_set_stop_on_error`, no more requests are started once a request
+// fails; `pool_get_sent` tells how many requests were sent.
+//
+// The server, user, and password callback are per-thread settings in libcups,
+// so the pool saves the server and user when it is created and sets them in
+// each worker thread.  libcups does not provide the current password
+// callback, so workers use one that asks with the default callback, one
+// worker at a time, and shares the answer with the other workers.
+//
+
+#include "pool.h"
+#include "conn.h"
+
+
+//
+// Local types...
+//
+
+typedef struct pool_request_s		// Request in the pool
+{
+  size_t	num_steps;		// Number of requests in sequence
+  ipp_t		**steps,		// IPP requests
+		*response;		// IPP response
+  char		resource[256];		// Resource path
+  ipp_status_t	status;			// IPP status
+  char		*message;		// Status message
+} pool_request_t;
+
+typedef struct pool_conn_s		// Connection in the pool
+{
+  pool_t	*pool;			// Pool
+  http_t	*http;			// HTTP connection to server
+  cups_thread_t	thread;			// Worker thread
+  char		password[256];		// Password for this connection
+  int		password_tries;		// Number of password requests
+} pool_conn_t;
+
+struct pool_s				// IPP request pool
+{
+  cups_mutex_t	mutex;			// Mutex for next_request
+  char		server[256];		// Server name
+  int		port;			// Port number
+  http_encryption_t encryption;		// Type of encryption
+  char		user[256];		// User name
+  cups_mutex_t	password_mutex;		// Mutex for password
+  char		password[256];		// Password shared by the workers
+  bool		stop_on_error,		// Stop after a failure?
+		failed;			// Did a request fail?
+  size_t	num_conns;		// Number of connections
+  pool_conn_t	*conns;			// Connections
+  size_t	num_requests,		// Number of requests
+		alloc_requests,		// Allocated requests
+		next_request;		// Next request to send
+  pool_request_t *requests;		// Requests
+};
+
+
+//
+// Local functions...
+//
+
+static const char *pool_password_cb(const char *prompt, http_t *http, const char *method, const char *resource, pool_t *pool);
+static void	*pool_run_conn(pool_conn_t *conn);
+static void	*pool_run_thread(pool_conn_t *conn);
+
+
+//
+// 'pool_add_request()' - Add a request to the pool.
+//
+// The pool takes ownership of the request.  Requests must not be added while
+// `pool_run` is running.
+//
+
+size_t					// O - Request number
+pool_add_request(pool_t     *pool,	// I - Request pool
+                 ipp_t      *request,	// I - IPP request
+                 const char *resource)	// I - Resource path
+{
+  return (pool_add_requests(pool, 1, &request, resource));
+}
+
+
+//
+// 'pool_add_requests()' - Add a sequence of requests to the pool.
+//
+// The pool takes ownership of the requests.  Requests must not be added while
+// `pool_run` is running.
+//
+
+size_t					// O - Request number
+pool_add_requests(pool_t     *pool,	// I - Request pool
+                  size_t     num_steps,	// I - Number of requests
+                  ipp_t      **steps,	// I - IPP requests
+                  const char *resource)	// I - Resource path
+{
+  size_t		i;		// Looping var
+  pool_request_t	*r;		// New request
+  ipp_t			**copy;		// Copy of requests
+
+
+  if ((copy = calloc(num_steps, sizeof(ipp_t *))) == NULL)
+  {
+    for (i = 0; i < num_steps; i ++)
+      ippDelete(steps[i]);
+
+    return (SIZE_MAX);
+  }
+
+  memcpy(copy, steps, num_steps * sizeof(ipp_t *));
+
+  if (pool->num_requests >= pool->alloc_requests)
+  {
+    size_t		alloc = pool->alloc_requests + 64;
+					// New allocation size
+    pool_request_t	*requests;	// New requests
+
+    if ((requests = realloc(pool->requests, alloc * sizeof(pool_request_t))) == NULL)
+    {
+      for (i = 0; i < num_steps; i ++)
+        ippDelete(steps[i]);
+
+      free(copy);
+      return (SIZE_MAX);
+    }
+
+    pool->requests       = requests;
+    pool->alloc_requests = alloc;
+  }
+
+  r = pool->requests + pool->num_requests;
+
+  memset(r, 0, sizeof(pool_request_t));
+  r->num_steps = num_steps;
+  r->steps     = copy;
+  r->status    = IPP_STATUS_OK;
+  cupsCopyString(r->resource, resource, sizeof(r->resource));
+
+  return (pool->num_requests ++);
+}
+
+
+//
+// 'pool_delete()' - Release all connections and free the pool.
+//
+
+void
+pool_delete(pool_t *pool)		// I - Request pool
+{
+  size_t		i, j;		// Looping vars
+  pool_request_t	*r;		// Current request
+
+
+  if (!pool)
+    return;
+
+  for (i = 0; i < pool->num_conns; i ++)
+    conn_release(pool->conns[i].http);
+
+  for (i = pool->num_requests, r = pool->requests; i > 0; i --, r ++)
+  {
+    for (j = 0; j < r->num_steps; j ++)
+      ippDelete(r->steps[j]);
+
+    ippDelete(r->response);
+    free(r->steps);
+    free(r->message);
+  }
+
+  cupsMutexDestroy(&pool->mutex);
+  cupsMutexDestroy(&pool->password_mutex);
+
+  free(pool->conns);
+  free(pool->requests);
+  free(pool);
+}
+
+
+//
+// 'pool_get_count()' - Get the number of requests in the pool.
+//
+
+size_t					// O - Number of requests
+pool_get_count(pool_t *pool)		// I - Request pool
+{
+  return (pool ? pool->num_requests : 0);
+}
+
+
+//
+// 'pool_get_response()' - Get the response for a request.
+//
+// The response belongs to the pool and is freed by `pool_delete`.
+//
+
+ipp_t *					// O - IPP response or `NULL` if none
+pool_get_response(pool_t *pool,		// I - Request pool
+                  size_t n)		// I - Request number
+{
+  return (pool && n < pool->num_requests ? pool->requests[n].response : NULL);
+}
+
+
+//
+// 'pool_get_sent()' - Get the number of requests that were sent.
+//
+// Requests are sent in the order they were added, so requests numbered at or
+// above this count were not sent because of an earlier failure.
+//
+
+size_t					// O - Number of requests sent
+pool_get_sent(pool_t *pool)		// I - Request pool
+{
+  return (pool ? pool->next_request : 0);
+}
+
+
+//
+// 'pool_get_status()' - Get the status for a request.
+//
+
+ipp_status_t				// O - IPP status
+pool_get_status(pool_t *pool,		// I - Request pool
+                size_t n)		// I - Request number
+{
+  return (pool && n < pool->num_requests ? pool->requests[n].status : IPP_STATUS_ERROR_INTERNAL);
+}
+
+
+//
+// 'pool_get_status_message()' - Get the status message for a request.
+//
+
+const char *				// O - Status message
+pool_get_status_message(pool_t *pool,	// I - Request pool
+                        size_t n)	// I - Request number
+{
+  if (!pool || n >= pool->num_requests)
+    return ("");
+  else if (pool->requests[n].message)
+    return (pool->requests[n].message);
+  else
+    return (ippErrorString(pool->requests[n].status));
+}
+
+
+//
+// 'pool_new()' - Create a request pool for the current server.
+//
+
+pool_t *				// O - Request pool or `NULL` on error
+pool_new(size_t max_connections)	// I - Maximum number of connections
+{
+  pool_t	*pool;			// Request pool
+  size_t	i;			// Looping var
+
+
+  if (max_connections < 1)
+    max_connections = 1;
+
+  if ((pool = (pool_t *)calloc(1, sizeof(pool_t))) == NULL)
+    return (NULL);
+
+  if ((pool->conns = (pool_conn_t *)calloc(max_connections, sizeof(pool_conn_t))) == NULL)
+  {
+    free(pool);
+    return (NULL);
+  }
+
+  for (i = 0; i < max_connections; i ++)
+    pool->conns[i].pool = pool;
+
+  pool->num_conns = max_connections;
+
+  // The server settings are per-thread, so save them for the workers...
+  cupsCopyString(pool->server, cupsGetServer(), sizeof(pool->server));
+  pool->port       = ippGetPort();
+  pool->encryption = cupsGetEncryption();
+  cupsCopyString(pool->user, cupsGetUser(), sizeof(pool->user));
+
+  cupsMutexInit(&pool->mutex);
+  cupsMutexInit(&pool->password_mutex);
+
+  return (pool);
+}
+
+
+//
+// 'pool_run()' - Send all pending requests in the pool.
+//
+// Up to the maximum number of connections are used at the same time.  This
+// function returns once every pending request has a response.
+//
+
+bool					// O - `true` if all requests succeeded
+pool_run(pool_t *pool)			// I - Request pool
+{
+  size_t	i,			// Looping var
+		first,			// First pending request
+		num_threads;		// Number of worker threads
+
+
+  if (!pool)
+    return (false);
+
+  first        = pool->next_request;
+  pool->failed = false;
+  num_threads = pool->num_requests - first;
+
+  if (num_threads > pool->num_conns)
+    num_threads = pool->num_conns;
+
+  if (num_threads == 1)
+  {
+    // No need for threads with a single connection...
+    pool_run_conn(pool->conns);
+  }
+  else if (num_threads > 1)
+  {
+    for (i = 0; i < num_threads; i ++)
+    {
+      if ((pool->conns[i].thread = cupsThreadCreate((cups_thread_func_t)pool_run_thread, pool->conns + i)) == CUPS_THREAD_INVALID)
+        break;
+    }
+
+    if (i == 0)
+    {
+      // Unable to create any threads, send everything from this thread...
+      pool_run_conn(pool->conns);
+    }
+    else
+    {
+      while (i > 0)
+        cupsThreadWait(pool->conns[-- i].thread);
+    }
+  }
+
+  for (i = first; i < pool->num_requests; i ++)
+  {
+    if (pool->requests[i].status > IPP_STATUS_OK_CONFLICTING)
+      return (false);
+  }
+
+  return (true);
+}
+
+
+//
+// 'pool_set_stop_on_error()' - Set whether to stop after a failure.
+//
+// When set, `pool_run` does not start any more requests once a request fails.
+// Requests that were already started still finish.
+//
+
+void
+pool_set_stop_on_error(
+    pool_t *pool,			// I - Request pool
+    bool   stop_on_error)		// I - `true` to stop after a failure
+{
+  if (pool)
+    pool->stop_on_error = stop_on_error;
+}
+
+
+//
+// 'pool_password_cb()' - Get a password for a worker thread.
+//
+// The first worker to need a password asks for it using the default password
+// callback and the other workers reuse the answer.  A worker that needs a
+// password again for the same connection (because the shared one was wrong)
+// asks again.
+//
+
+static const char *			// O - Password or `NULL` to give up
+pool_password_cb(const char *prompt,	// I - Prompt
+                 http_t     *http,	// I - HTTP connection
+                 const char *method,	// I - Request method
+                 const char *resource,	// I - Resource path
+                 pool_t     *pool)	// I - Request pool
+{
+  size_t	i;			// Looping var
+  pool_conn_t	*conn = NULL;		// Connection
+  const char	*password;		// Password from the user
+
+
+  for (i = 0; i < pool->num_conns; i ++)
+  {
+    if (pool->conns[i].http == http)
+    {
+      conn = pool->conns + i;
+      break;
+    }
+  }
+
+  if (!conn)
+    return (NULL);
+
+  cupsMutexLock(&pool->password_mutex);
+
+  if (conn->password_tries > 0 || !pool->password[0])
+  {
+    // Ask using the default callback, then restore ours...
+    cupsSetPasswordCB(NULL, NULL);
+    password = cupsGetPassword(prompt, http, method, resource);
+    cupsSetPasswordCB((cups_password_cb_t)pool_password_cb, pool);
+
+    cupsCopyString(pool->password, password ? password : "", sizeof(pool->password));
+  }
+
+  cupsCopyString(conn->password, pool->password, sizeof(conn->password));
+  conn->password_tries ++;
+
+  cupsMutexUnlock(&pool->password_mutex);
+
+  return (conn->password[0] ? conn->password : NULL);
+}
+
+
+//
+// 'pool_run_conn()' - Send pending requests on a single connection.
+//
+
+static void *				// O - Thread exit status
+pool_run_conn(pool_conn_t *conn)	// I - Connection
+{
+  pool_t		*pool = conn->pool;
+					// Request pool
+  pool_request_t	*r;		// Current request
+  size_t		i;		// Looping var
+
+
+  for (;;)
+  {
+    // Get the next request...
+    cupsMutexLock(&pool->mutex);
+    if (pool->next_request < pool->num_requests && !(pool->stop_on_error && pool->failed))
+      r = pool->requests + pool->next_request ++;
+    else
+      r = NULL;
+    cupsMutexUnlock(&pool->mutex);
+
+    if (!r)
+      break;
+
+    // Open the connection as needed and send the request(s)...
+    if (!conn->http && (conn->http = conn_acquire(pool->server, pool->port, pool->encryption)) == NULL)
+    {
+      r->status  = IPP_STATUS_ERROR_SERVICE_UNAVAILABLE;
+      r->message = strdup(strerror(errno));
+    }
+    else
+    {
+      for (i = 0; i < r->num_steps; i ++)
+      {
+        ippDelete(r->response);
+        free(r->message);
+
+        r->response = cupsDoRequest(conn->http, r->steps[i], r->resource);
+        r->steps[i] = NULL;
+        r->status   = cupsLastError();
+        r->message  = strdup(cupsLastErrorString());
+
+        if (r->status > IPP_STATUS_OK_CONFLICTING)
+          break;
+      }
+    }
+
+    // Free any requests that were not sent...
+    for (i = 0; i < r->num_steps; i ++)
+    {
+      ippDelete(r->steps[i]);
+      r->steps[i] = NULL;
+    }
+
+    if (r->status > IPP_STATUS_OK_CONFLICTING)
+    {
+      cupsMutexLock(&pool->mutex);
+      pool->failed = true;
+      cupsMutexUnlock(&pool->mutex);
+    }
+  }
+
+  return (NULL);
+}
+
+
+//
+// 'pool_run_thread()' - Send pending requests from a worker thread.
+//
+
+static void *				// O - Thread exit status
+pool_run_thread(pool_conn_t *conn)	// I - Connection
+{
+  pool_t	*pool = conn->pool;	// Request pool
+
+
+  // Use the same user as the main thread...
+  cupsSetUser(pool->user);
+  cupsSetPasswordCB((cups_password_cb_t)pool_password_cb, pool);
+
+  return (pool_run_conn(conn));
+}
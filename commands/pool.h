@@ -0,0 +1,46 @@
+//
+// IPP request pool definitions for the CUPS commands.
+//
+// Copyright © 2026 by OpenPrinting.
+//
+// Licensed under Apache License v2.0.  See the file "LICENSE" for more
+// information.
+//
+
+#ifndef POOL_H
+#  define POOL_H
+#  include "localize.h"
+
+
+//
+// Constants...
+//
+
+#  define POOL_MAX_CONNECTIONS	4	// Default number of connections
+
+
+//
+// Types...
+//
+
+typedef struct pool_s pool_t;		// IPP request pool
+
+
+//
+// Functions...
+//
+
+extern size_t		pool_add_request(pool_t *pool, ipp_t *request, const char *resource);
+extern size_t		pool_add_requests(pool_t *pool, size_t num_steps, ipp_t **steps, const char *resource);
+extern void		pool_delete(pool_t *pool);
+extern size_t		pool_get_count(pool_t *pool);
+extern ipp_t		*pool_get_response(pool_t *pool, size_t n);
+extern size_t		pool_get_sent(pool_t *pool);
+extern ipp_status_t	pool_get_status(pool_t *pool, size_t n);
+extern const char	*pool_get_status_message(pool_t *pool, size_t n);
+extern pool_t		*pool_new(size_t max_connections);
+extern bool		pool_run(pool_t *pool);
+extern void		pool_set_stop_on_error(pool_t *pool, bool stop_on_error);
+
+
+#endif // !POOL_H
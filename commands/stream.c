@@ -0,0 +1,429 @@
+//
+// Streaming IPP responses for the CUPS commands.
+//
+// Copyright © 2026 by OpenPrinting.
+//
+// Licensed under Apache License v2.0.  See the file "LICENSE" for more
+// information.
+//
+// `cupsDoRequest` reads the whole response before returning it.  For list
+// operations like Get-Jobs and CUPS-Get-Printers, `stream_open` instead sends
+// the request and only reads the operation attributes, after which each call
+// to `stream_next` returns the next attribute group (one printer or job) as
+// soon as it has been read from the connection.  Each group is freed by the
+// following call, so memory use does not grow with the length of the list.
+//
+// Groups are found by walking the tag and length fields of the encoded
+// attributes and are then decoded with `ippReadIO`.  If the server answers
+// with anything other than "200 OK" (authentication, upgrades, etc.), the
+// request is sent again with `cupsDoRequest` and the first call to
+// `stream_next` returns the complete response instead.
+//
+
+#include "stream.h"
+#include "conn.h"
+
+
+//
+// Local constants...
+//
+
+#define STREAM_HEADER	8		// Size of IPP message header
+
+
+//
+// Local types...
+//
+
+struct stream_s				// Streaming IPP response
+{
+  http_t	*http;			// Connection to server
+  bool		acquired;		// Connection from `conn_borrow`?
+  ipp_status_t	status;			// IPP status
+  char		*message;		// Status message
+  ipp_t		*response,		// Complete response, if not streamed
+		*pending,		// First group, read by `stream_open`
+		*group;			// Current group
+  bool		done;			// Done reading groups?
+  unsigned char	*data;			// Message header and current group
+  size_t	used,			// Bytes in buffer
+		alloc,			// Allocated bytes
+		next;			// Offset of next group
+};
+
+typedef struct stream_mem_s		// Memory buffer for `ippReadIO`
+{
+  unsigned char	*ptr,			// Current position
+		*end;			// End of buffer
+} stream_mem_t;
+
+
+//
+// Local functions...
+//
+
+static bool	stream_fill(stream_t *stream, size_t bytes);
+static ipp_t	*stream_read_group(stream_t *stream, ipp_tag_t *group_tag);
+static ssize_t	stream_read_mem(stream_mem_t *mem, unsigned char *buffer, size_t bytes);
+
+
+//
+// 'stream_close()' - Close a streaming response.
+//
+// Any unread groups are discarded so the connection can be used again.
+//
+
+void
+stream_close(stream_t *stream)		// I - Streaming response
+{
+  if (!stream)
+    return;
+
+  if (stream->http && httpGetState(stream->http) != HTTP_STATE_WAITING)
+    httpFlush(stream->http);
+
+  if (stream->acquired)
+    conn_release(stream->http);
+
+  ippDelete(stream->response);
+  ippDelete(stream->pending);
+  ippDelete(stream->group);
+
+  free(stream->data);
+  free(stream->message);
+  free(stream);
+}
+
+
+//
+// 'stream_get_status()' - Get the status of a streaming response.
+//
+
+ipp_status_t				// O - IPP status
+stream_get_status(stream_t *stream)	// I - Streaming response
+{
+  return (stream ? stream->status : IPP_STATUS_ERROR_INTERNAL);
+}
+
+
+//
+// 'stream_get_status_message()' - Get the status message of a streaming response.
+//
+
+const char *				// O - Status message
+stream_get_status_message(
+    stream_t *stream)			// I - Streaming response
+{
+  if (!stream)
+    return (ippErrorString(IPP_STATUS_ERROR_INTERNAL));
+  else if (stream->message)
+    return (stream->message);
+  else
+    return (ippErrorString(stream->status));
+}
+
+
+//
+// 'stream_next()' - Get the next attribute group.
+//
+// The group belongs to the stream and is freed by the next call to
+// `stream_next` or `stream_close`.  Groups are normally returned one at a
+// time, but a response that was not streamed is returned all at once.
+//
+
+ipp_t *					// O - Attributes or `NULL` at the end
+stream_next(stream_t *stream)		// I - Streaming response
+{
+  ipp_tag_t	group_tag;		// Group tag
+
+
+  if (!stream)
+    return (NULL);
+
+  ippDelete(stream->group);
+
+  if (stream->response)
+  {
+    stream->group    = stream->response;
+    stream->response = NULL;
+  }
+  else if (stream->pending)
+  {
+    stream->group   = stream->pending;
+    stream->pending = NULL;
+  }
+  else
+  {
+    stream->group = stream_read_group(stream, &group_tag);
+  }
+
+  return (stream->group);
+}
+
+
+//
+// 'stream_open()' - Send a request and start reading the response.
+//
+// The request is freed.  `CUPS_HTTP_DEFAULT` means the shared connection to
+// the user's agent for the current server, if one is running, or to the
+// current server.  A shared connection is borrowed for as long as the
+// response is being read; when it is already busy, a connection of its own
+// is acquired from the connection manager instead.
+//
+
+stream_t *				// O - Streaming response or `NULL` on error
+stream_open(http_t     *http,		// I - Connection to server or `CUPS_HTTP_DEFAULT`
+            ipp_t      *request,	// I - IPP request
+            const char *resource)	// I - Resource path
+{
+  stream_t	*stream;		// Streaming response
+  http_status_t	hstatus = HTTP_STATUS_ERROR;
+					// HTTP status
+  ipp_t		*group;			// First group
+  ipp_tag_t	group_tag;		// Group tag
+  const char	*message;		// Status message
+
+
+  if ((stream = (stream_t *)calloc(1, sizeof(stream_t))) == NULL)
+  {
+    ippDelete(request);
+    return (NULL);
+  }
+
+  if (!http)
+    http = conn_get_agent(conn_get_default());
+
+  // Borrow the shared connection so nothing else uses it while we read...
+  stream->acquired = conn_borrow(&http);
+
+  if (!http)
+  {
+    stream->status  = IPP_STATUS_ERROR_SERVICE_UNAVAILABLE;
+    stream->message = strdup(strerror(errno));
+    stream->done    = true;
+
+    ippDelete(request);
+    return (stream);
+  }
+
+  stream->http = http;
+
+  // Send the request...
+  httpClearFields(http);
+  httpSetField(http, HTTP_FIELD_CONTENT_TYPE, "application/ipp");
+  httpSetLength(http, ippGetLength(request));
+
+  if (httpWriteRequest(http, "POST", resource) && ippWrite(http, request) == IPP_STATE_DATA)
+  {
+    while ((hstatus = httpUpdate(http)) == HTTP_STATUS_CONTINUE);
+  }
+
+  if (hstatus != HTTP_STATUS_OK)
+  {
+    // Let cupsDoRequest handle authentication, upgrades, and errors...
+    if (hstatus != HTTP_STATUS_ERROR)
+      httpFlush(http);
+
+    ippSetState(request, IPP_STATE_IDLE);
+
+    stream->response = cupsDoRequest(http, request, resource);
+    stream->status   = cupsLastError();
+    stream->message  = strdup(cupsLastErrorString());
+    stream->done     = true;
+
+    return (stream);
+  }
+
+  ippDelete(request);
+
+  // Read the message header and operation attributes...
+  if (!stream_fill(stream, STREAM_HEADER))
+  {
+    stream->status = IPP_STATUS_ERROR_INTERNAL;
+    stream->done   = true;
+
+    return (stream);
+  }
+
+  stream->next   = STREAM_HEADER;
+  stream->status = (ipp_status_t)((stream->data[2] << 8) | stream->data[3]);
+
+  if ((group = stream_read_group(stream, &group_tag)) != NULL && group_tag == IPP_TAG_OPERATION)
+  {
+    if ((message = ippGetString(ippFindAttribute(group, "status-message", IPP_TAG_TEXT), 0, NULL)) != NULL)
+      stream->message = strdup(message);
+
+    ippDelete(group);
+
+    group = stream_read_group(stream, &group_tag);
+  }
+
+  stream->pending = group;
+
+  return (stream);
+}
+
+
+//
+// 'stream_fill()' - Read data until the buffer holds the given number of bytes.
+//
+
+static bool				// O - `true` on success, `false` on error
+stream_fill(stream_t *stream,		// I - Streaming response
+            size_t   bytes)		// I - Number of bytes needed
+{
+  ssize_t	rbytes;			// Bytes read
+
+
+  if (bytes > stream->alloc)
+  {
+    size_t		alloc;		// New allocation size
+    unsigned char	*data;		// New buffer
+
+    if ((alloc = 2 * stream->alloc) < 32768)
+      alloc = 32768;
+    if (alloc < bytes)
+      alloc = bytes;
+
+    if ((data = realloc(stream->data, alloc)) == NULL)
+      return (false);
+
+    stream->data  = data;
+    stream->alloc = alloc;
+  }
+
+  while (stream->used < bytes)
+  {
+    if ((rbytes = httpRead(stream->http, (char *)stream->data + stream->used, stream->alloc - stream->used)) <= 0)
+      return (false);
+
+    stream->used += (size_t)rbytes;
+  }
+
+  return (true);
+}
+
+
+//
+// 'stream_read_group()' - Read and decode the next attribute group.
+//
+// The buffer holds the message header followed by the group.  The delimiter
+// that follows the group is briefly replaced by an end tag so that the header
+// and group can be decoded as a complete IPP message.
+//
+
+static ipp_t *				// O - Attributes or `NULL` at the end or on error
+stream_read_group(stream_t  *stream,	// I - Streaming response
+                  ipp_tag_t *group_tag)	// O - Group tag
+{
+  size_t	bytes,			// End of group
+		i;			// Looping var
+  unsigned char	tag,			// Delimiter tag for group
+		delim;			// Delimiter tag after group
+  ipp_t		*group;			// Attributes
+  ipp_state_t	istate;			// IPP read state
+  stream_mem_t	mem;			// Memory buffer
+
+
+  if (stream->done)
+    return (NULL);
+
+  // Drop the previous group, keeping the message header...
+  if (stream->next > STREAM_HEADER)
+  {
+    memmove(stream->data + STREAM_HEADER, stream->data + stream->next, stream->used - stream->next);
+    stream->used -= stream->next - STREAM_HEADER;
+    stream->next = STREAM_HEADER;
+  }
+
+  // Get the delimiter tag for the group...
+  if (!stream_fill(stream, STREAM_HEADER + 1))
+    goto error;
+
+  if ((tag = stream->data[STREAM_HEADER]) == IPP_TAG_END)
+  {
+    stream->done = true;
+    return (NULL);
+  }
+  else if (tag == IPP_TAG_ZERO || tag >= IPP_TAG_UNSUPPORTED_VALUE)
+  {
+    goto error;
+  }
+
+  // Find the end of the group, which is the next delimiter tag...
+  for (bytes = STREAM_HEADER + 1;;)
+  {
+    if (!stream_fill(stream, bytes + 1))
+      goto error;
+
+    if (stream->data[bytes] < IPP_TAG_UNSUPPORTED_VALUE)
+      break;
+
+    // Skip the value tag, name, and value...
+    bytes += stream->data[bytes] == IPP_TAG_EXTENSION ? 5 : 1;
+
+    for (i = 0; i < 2; i ++)
+    {
+      if (!stream_fill(stream, bytes + 2))
+        goto error;
+
+      bytes += 2 + (size_t)((stream->data[bytes] << 8) | stream->data[bytes + 1]);
+    }
+  }
+
+  // Decode the header and group...
+  delim               = stream->data[bytes];
+  stream->data[bytes] = IPP_TAG_END;
+
+  mem.ptr = stream->data;
+  mem.end = stream->data + bytes + 1;
+
+  group  = ippNew();
+  istate = ippReadIO(&mem, (ipp_io_cb_t)stream_read_mem, /*blocking*/true, /*parent*/NULL, group);
+
+  stream->data[bytes] = delim;
+  stream->next        = bytes;
+
+  if (istate != IPP_STATE_DATA)
+  {
+    ippDelete(group);
+    goto error;
+  }
+
+  *group_tag = (ipp_tag_t)tag;
+
+  return (group);
+
+  // If we get here the response is bad or the connection failed...
+  error:
+
+  stream->done = true;
+
+  if (stream->status <= IPP_STATUS_OK_CONFLICTING)
+  {
+    stream->status = IPP_STATUS_ERROR_INTERNAL;
+    free(stream->message);
+    stream->message = NULL;
+  }
+
+  return (NULL);
+}
+
+
+//
+// 'stream_read_mem()' - Read IPP data from a memory buffer.
+//
+
+static ssize_t				// O - Number of bytes read
+stream_read_mem(stream_mem_t  *mem,	// I - Memory buffer
+                unsigned char *buffer,	// I - Buffer
+                size_t        bytes)	// I - Number of bytes to read
+{
+  if (bytes > (size_t)(mem->end - mem->ptr))
+    bytes = (size_t)(mem->end - mem->ptr);
+
+  memcpy(buffer, mem->ptr, bytes);
+  mem->ptr += bytes;
+
+  return ((ssize_t)bytes);
+}
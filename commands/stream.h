@@ -0,0 +1,33 @@
+//
+// Streaming IPP response definitions for the CUPS commands.
+//
+// Copyright © 2026 by OpenPrinting.
+//
+// Licensed under Apache License v2.0.  See the file "LICENSE" for more
+// information.
+//
+
+#ifndef STREAM_H
+#  define STREAM_H
+#  include "localize.h"
+
+
+//
+// Types...
+//
+
+typedef struct stream_s stream_t;	// Streaming IPP response
+
+
+//
+// Functions...
+//
+
+extern void		stream_close(stream_t *stream);
+extern ipp_status_t	stream_get_status(stream_t *stream);
+extern const char	*stream_get_status_message(stream_t *stream);
+extern ipp_t		*stream_next(stream_t *stream);
+extern stream_t		*stream_open(http_t *http, ipp_t *request, const char *resource);
+
+
+#endif // !STREAM_H
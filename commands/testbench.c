@@ -0,0 +1,608 @@
+//
+// End-to-end benchmarks for the CUPS commands.
+//
+// Copyright © 2026 by OpenPrinting.
+//
+// Licensed under Apache License v2.0.  See the file "LICENSE" for more
+// information.
+//
+// Usage:
+//
+//   ./testbench [-c CLASSES] [-d MSEC] [-j JOBS] [-n RUNS] [-o FILENAME.json] [-p PRINTERS]
+//
+// The benchmarks start the "./testsched" mock scheduler with the given number
+// of printers, classes, and jobs and response delay, then run each benchmark
+// RUNS times (default 5) using the commands in the current directory.  The
+// timings and the number of connections, IPP requests, and response bytes seen
+// by the mock scheduler are written as JSON to the named file or the standard
+// output.  The "lpadmin --apply" benchmark is skipped when "./lpadmin" has not
+// been built.
+//
+
+#include "localize.h"
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <time.h>
+
+
+//
+// Local constants...
+//
+
+#define BENCH_CANCEL_IDS	100	// Maximum number of job IDs for cancel
+
+
+//
+// Local types...
+//
+
+typedef enum bench_e			// Benchmarks
+{
+  BENCH_LPSTAT_T,			// lpstat -t
+  BENCH_LPSTAT_O,			// lpstat -o
+  BENCH_LPQ,				// lpq -a
+  BENCH_LP_1K,				// lp of a 1k file
+  BENCH_LP_64K,				// lp of a 64k file
+  BENCH_LP_1M,				// lp of a 1M file
+  BENCH_LP_16M,				// lp of a 16M file
+  BENCH_CANCEL,				// cancel of many job IDs
+  BENCH_LPADMIN,			// lpadmin --apply of every printer
+  BENCH_MAX
+} bench_t;
+
+
+//
+// Local globals...
+//
+
+static const char * const bench_names[] =
+{					// Benchmark names
+  "lpstat -t",
+  "lpstat -o",
+  "lpq -a",
+  "lp 1k",
+  "lp 64k",
+  "lp 1m",
+  "lp 16m",
+  "cancel",
+  "lpadmin --apply"
+};
+static const size_t	bench_sizes[] =	// Sizes of lp files
+{
+  1024,
+  65536,
+  1048576,
+  16777216
+};
+
+
+//
+// Local functions...
+//
+
+static bool	get_stats(int port, char *buffer, size_t bufsize);
+static double	get_time(void);
+static int	make_args(bench_t bench, int run, int num_printers, int num_jobs, int runs, const char *tempdir, char **args, size_t num_args, char *buffer, size_t bufsize);
+static bool	make_file(const char *filename, size_t bytes);
+static bool	make_manifest(const char *filename, int num_printers, int run);
+static int	run_command(char **args);
+static pid_t	start_sched(int port, int num_printers, int num_classes, int num_jobs, int delay);
+static void	usage(void) _CUPS_NORETURN;
+
+
+//
+// 'main()' - Main entry.
+//
+
+int					// O - Exit status
+main(int  argc,				// I - Number of command-line arguments
+     char *argv[])			// I - Command-line arguments
+{
+  int		i;			// Looping var
+  int		num_printers = 10,	// Number of printers
+		num_classes = 2,	// Number of classes
+		num_jobs = 1000,	// Number of jobs
+		delay = 0,		// Response delay in milliseconds
+		runs = 5,		// Number of runs per benchmark
+		port,			// Port for mock scheduler
+		run,			// Current run
+		failures,		// Number of failed runs
+		num_results = 0;	// Number of benchmarks reported
+  const char	*outfile = NULL;	// Output file
+  FILE		*out;			// Output file
+  pid_t		pid;			// Mock scheduler process ID
+  char		portname[256],		// CUPS_SERVER value
+		tempdir[256],		// Temporary directory
+		filename[1024],		// Temporary file
+		stats[32768],		// Statistics from mock scheduler
+		argbuf[4096],		// Argument buffer
+		*args[BENCH_CANCEL_IDS + 3];
+					// Command arguments
+  bench_t	bench;			// Current benchmark
+  double	start,			// Start time
+		elapsed,		// Elapsed time
+		total,			// Total time
+		min_time,		// Minimum time
+		max_time;		// Maximum time
+  int		status = 0;		// Exit status
+
+
+  // Parse the command-line...
+  for (i = 1; i < argc; i ++)
+  {
+    if (!strcmp(argv[i], "-c") && (i + 1) < argc)
+      num_classes = atoi(argv[++ i]);
+    else if (!strcmp(argv[i], "-d") && (i + 1) < argc)
+      delay = atoi(argv[++ i]);
+    else if (!strcmp(argv[i], "-j") && (i + 1) < argc)
+      num_jobs = atoi(argv[++ i]);
+    else if (!strcmp(argv[i], "-n") && (i + 1) < argc)
+      runs = atoi(argv[++ i]);
+    else if (!strcmp(argv[i], "-o") && (i + 1) < argc)
+      outfile = argv[++ i];
+    else if (!strcmp(argv[i], "-p") && (i + 1) < argc)
+      num_printers = atoi(argv[++ i]);
+    else
+      usage();
+  }
+
+  if (num_printers < 1 || num_classes < 0 || num_jobs < 0 || delay < 0 || runs < 1)
+    usage();
+
+  // Create the temporary directory and files...
+  snprintf(tempdir, sizeof(tempdir), "/tmp/testbench%d", (int)getpid());
+  if (mkdir(tempdir, 0700))
+  {
+    fprintf(stderr, "testbench: Unable to create \"%s\": %s\n", tempdir, strerror(errno));
+    return (1);
+  }
+
+  for (i = 0; i < (int)(sizeof(bench_sizes) / sizeof(bench_sizes[0])); i ++)
+  {
+    snprintf(filename, sizeof(filename), "%s/%lu.txt", tempdir, (unsigned long)bench_sizes[i]);
+    if (!make_file(filename, bench_sizes[i]))
+    {
+      fprintf(stderr, "testbench: Unable to create \"%s\": %s\n", filename, strerror(errno));
+      status = 1;
+      goto cleanup;
+    }
+  }
+
+  // Start the mock scheduler and point the commands at it...
+  port = 9000 + (int)(getpid() % 1000);
+
+  if ((pid = start_sched(port, num_printers, num_classes, num_jobs, delay)) <= 0)
+  {
+    status = 1;
+    goto cleanup;
+  }
+
+  snprintf(portname, sizeof(portname), "localhost:%d", port);
+  setenv("CUPS_SERVER", portname, 1);
+  unsetenv("LPDEST");
+  unsetenv("PRINTER");
+
+  // Run the benchmarks...
+  if (outfile)
+  {
+    if ((out = fopen(outfile, "w")) == NULL)
+    {
+      fprintf(stderr, "testbench: Unable to create \"%s\": %s\n", outfile, strerror(errno));
+      status = 1;
+      goto stop;
+    }
+  }
+  else
+  {
+    out = stdout;
+  }
+
+  fprintf(out, "{\n  \"printers\": %d,\n  \"classes\": %d,\n  \"jobs\": %d,\n  \"delay-ms\": %d,\n  \"runs\": %d,\n  \"benchmarks\": [\n", num_printers, num_classes, num_jobs, delay, runs);
+
+  for (bench = BENCH_LPSTAT_T; bench < BENCH_MAX; bench ++)
+  {
+    if (bench == BENCH_LPADMIN && access("./lpadmin", X_OK))
+    {
+      fprintf(stderr, "testbench: Skipping \"%s\" since \"./lpadmin\" has not been built.\n", bench_names[bench]);
+      continue;
+    }
+
+    // Reset the request counts...
+    get_stats(port, stats, sizeof(stats));
+
+    failures = 0;
+    total    = 0.0;
+    min_time = 0.0;
+    max_time = 0.0;
+
+    for (run = 0; run < runs; run ++)
+    {
+      if (make_args(bench, run, num_printers, num_jobs, runs, tempdir, args, sizeof(args) / sizeof(args[0]), argbuf, sizeof(argbuf)) < 0)
+      {
+        failures ++;
+        continue;
+      }
+
+      start = get_time();
+
+      if (run_command(args))
+        failures ++;
+
+      elapsed = get_time() - start;
+      total   += elapsed;
+
+      if (run == 0 || elapsed < min_time)
+        min_time = elapsed;
+      if (run == 0 || elapsed > max_time)
+        max_time = elapsed;
+    }
+
+    if (!get_stats(port, stats, sizeof(stats)))
+      cupsCopyString(stats, "null", sizeof(stats));
+
+    fprintf(out, "%s    {\n      \"name\": \"%s\",\n      \"failures\": %d,\n      \"min-ms\": %.3f,\n      \"avg-ms\": %.3f,\n      \"max-ms\": %.3f,\n      \"server\": %s\n    }", num_results ++ ? ",\n" : "", bench_names[bench], failures, min_time * 1000.0, total * 1000.0 / runs, max_time * 1000.0, stats);
+    fflush(out);
+
+    if (failures)
+    {
+      fprintf(stderr, "testbench: \"%s\" failed %d of %d times.\n", bench_names[bench], failures, runs);
+      status = 1;
+    }
+  }
+
+  fputs("\n  ]\n}\n", out);
+
+  if (out != stdout)
+    fclose(out);
+
+  // Stop the mock scheduler and clean up...
+  stop:
+
+  kill(pid, SIGTERM);
+  waitpid(pid, NULL, 0);
+
+  cleanup:
+
+  for (i = 0; i < (int)(sizeof(bench_sizes) / sizeof(bench_sizes[0])); i ++)
+  {
+    snprintf(filename, sizeof(filename), "%s/%lu.txt", tempdir, (unsigned long)bench_sizes[i]);
+    unlink(filename);
+  }
+
+  snprintf(filename, sizeof(filename), "%s/manifest", tempdir);
+  unlink(filename);
+  rmdir(tempdir);
+
+  return (status);
+}
+
+
+//
+// 'get_stats()' - Get and reset the statistics from the mock scheduler.
+//
+
+static bool				// O - `true` on success, `false` on error
+get_stats(int    port,			// I - Port number
+          char   *buffer,		// I - Buffer
+          size_t bufsize)		// I - Size of buffer
+{
+  http_t	*http;			// Connection to mock scheduler
+  http_status_t	hstatus;		// HTTP status
+  size_t	used = 0;		// Bytes in buffer
+  ssize_t	bytes;			// Bytes read
+
+
+  *buffer = '\0';
+
+  if ((http = httpConnect("localhost", port, /*addrlist*/NULL, AF_UNSPEC, HTTP_ENCRYPTION_NEVER, /*blocking*/true, /*msec*/30000, /*cancel*/NULL)) == NULL)
+    return (false);
+
+  httpClearFields(http);
+
+  if (!httpWriteRequest(http, "GET", "/stats"))
+  {
+    httpClose(http);
+    return (false);
+  }
+
+  while ((hstatus = httpUpdate(http)) == HTTP_STATUS_CONTINUE);
+
+  if (hstatus == HTTP_STATUS_OK)
+  {
+    while (used < (bufsize - 1) && (bytes = httpRead(http, buffer + used, bufsize - used - 1)) > 0)
+      used += (size_t)bytes;
+  }
+
+  buffer[used] = '\0';
+
+  httpClose(http);
+
+  return (hstatus == HTTP_STATUS_OK && used > 0);
+}
+
+
+//
+// 'get_time()' - Get the current time in seconds.
+//
+
+static double				// O - Time in seconds
+get_time(void)
+{
+  struct timespec	ts;		// Current time
+
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+
+  return ((double)ts.tv_sec + 0.000000001 * ts.tv_nsec);
+}
+
+
+//
+// 'make_args()' - Make the command arguments for a benchmark run.
+//
+// Each run of the "cancel" benchmark cancels a different set of jobs so that
+// every request cancels a pending job.
+//
+
+static int				// O - Number of arguments or -1 on error
+make_args(bench_t    bench,		// I - Benchmark
+          int        run,		// I - Run number, starting at 0
+          int        num_printers,	// I - Number of printers
+          int        num_jobs,		// I - Number of jobs
+          int        runs,		// I - Number of runs
+          const char *tempdir,		// I - Temporary directory
+          char       **args,		// I - Argument array
+          size_t     num_args,		// I - Size of argument array
+          char       *buffer,		// I - Argument buffer
+          size_t     bufsize)		// I - Size of argument buffer
+{
+  int		ac = 0;			// Number of arguments
+  int		i,			// Looping var
+		count,			// Number of job IDs
+		first;			// First job ID
+  char		*bufptr = buffer,	// Pointer into buffer
+		*bufend = buffer + bufsize;
+					// End of buffer
+
+
+  switch (bench)
+  {
+    case BENCH_LPSTAT_T :
+    case BENCH_LPSTAT_O :
+        args[ac ++] = "./lpstat";
+        args[ac ++] = bench == BENCH_LPSTAT_T ? "-t" : "-o";
+        break;
+
+    case BENCH_LPQ :
+        args[ac ++] = "./lpq";
+        args[ac ++] = "-a";
+        break;
+
+    case BENCH_LP_1K :
+    case BENCH_LP_64K :
+    case BENCH_LP_1M :
+    case BENCH_LP_16M :
+        args[ac ++] = "./lp";
+        args[ac ++] = "-d";
+        args[ac ++] = "printer001";
+        args[ac ++] = bufptr;
+        snprintf(bufptr, (size_t)(bufend - bufptr), "%s/%lu.txt", tempdir, (unsigned long)bench_sizes[bench - BENCH_LP_1K]);
+        break;
+
+    case BENCH_CANCEL :
+        if ((count = num_jobs / runs) > BENCH_CANCEL_IDS)
+          count = BENCH_CANCEL_IDS;
+
+        if (count < 1 || (size_t)count > (num_args - 2))
+          return (-1);
+
+        args[ac ++] = "./cancel";
+
+        for (i = 0, first = run * count + 1; i < count && bufptr < bufend; i ++)
+        {
+          args[ac ++] = bufptr;
+          snprintf(bufptr, (size_t)(bufend - bufptr), "%d", first + i);
+          bufptr += strlen(bufptr) + 1;
+        }
+        break;
+
+    case BENCH_LPADMIN :
+        snprintf(bufptr, (size_t)(bufend - bufptr), "%s/manifest", tempdir);
+
+        if (!make_manifest(bufptr, num_printers, run))
+          return (-1);
+
+        args[ac ++] = "./lpadmin";
+        args[ac ++] = "--apply";
+        args[ac ++] = bufptr;
+        break;
+
+    default :
+        return (-1);
+  }
+
+  args[ac] = NULL;
+
+  return (ac);
+}
+
+
+//
+// 'make_file()' - Make a text file of the given size.
+//
+
+static bool				// O - `true` on success, `false` on error
+make_file(const char *filename,		// I - Filename
+          size_t     bytes)		// I - Size of file
+{
+  cups_file_t	*fp;			// File
+  size_t	i;			// Looping var
+  char		line[64];		// Line of text
+
+
+  if ((fp = cupsFileOpen(filename, "w")) == NULL)
+    return (false);
+
+  memset(line, 'x', sizeof(line) - 1);
+  line[sizeof(line) - 1] = '\n';
+
+  for (i = bytes; i >= sizeof(line); i -= sizeof(line))
+    cupsFileWrite(fp, line, sizeof(line));
+
+  if (i > 0)
+    cupsFileWrite(fp, line + sizeof(line) - i, i);
+
+  return (cupsFileClose(fp));
+}
+
+
+//
+// 'make_manifest()' - Make an lpadmin manifest changing every printer.
+//
+
+static bool				// O - `true` on success, `false` on error
+make_manifest(const char *filename,	// I - Filename
+              int        num_printers,	// I - Number of printers
+              int        run)		// I - Run number
+{
+  cups_file_t	*fp;			// File
+  int		i;			// Looping var
+
+
+  if ((fp = cupsFileOpen(filename, "w")) == NULL)
+    return (false);
+
+  for (i = 1; i <= num_printers; i ++)
+  {
+    cupsFilePrintf(fp, "<Printer printer%03d>\n", i);
+    cupsFilePrintf(fp, "Info Benchmark printer %d, run %d\n", i, run + 1);
+    cupsFilePrintf(fp, "Location Benchmark room %d\n", run + 1);
+    cupsFilePuts(fp, "</Printer>\n");
+  }
+
+  return (cupsFileClose(fp));
+}
+
+
+//
+// 'run_command()' - Run a command with its output discarded.
+//
+
+static int				// O - Exit status
+run_command(char **args)		// I - Command arguments
+{
+  pid_t		pid;			// Child process ID
+  int		status,			// Exit status
+		fd;			// /dev/null
+
+
+  if ((pid = fork()) < 0)
+  {
+    return (1);
+  }
+  else if (pid == 0)
+  {
+    if ((fd = open("/dev/null", O_RDWR)) >= 0)
+    {
+      dup2(fd, 0);
+      dup2(fd, 1);
+      dup2(fd, 2);
+      close(fd);
+    }
+
+    execv(args[0], args);
+    _exit(127);
+  }
+
+  while (waitpid(pid, &status, 0) < 0)
+  {
+    if (errno != EINTR)
+      return (1);
+  }
+
+  return (WIFEXITED(status) ? WEXITSTATUS(status) : 1);
+}
+
+
+//
+// 'start_sched()' - Start the mock scheduler and wait for it to answer.
+//
+
+static pid_t				// O - Process ID or 0 on error
+start_sched(int port,			// I - Port number
+            int num_printers,		// I - Number of printers
+            int num_classes,		// I - Number of classes
+            int num_jobs,		// I - Number of jobs
+            int delay)			// I - Response delay in milliseconds
+{
+  pid_t		pid;			// Process ID
+  int		i;			// Looping var
+  char		values[5][32],		// Argument values
+		stats[32768];		// Statistics
+  struct timespec timeout;		// Time between connection attempts
+
+
+  snprintf(values[0], sizeof(values[0]), "%d", port);
+  snprintf(values[1], sizeof(values[1]), "%d", num_printers);
+  snprintf(values[2], sizeof(values[2]), "%d", num_classes);
+  snprintf(values[3], sizeof(values[3]), "%d", num_jobs);
+  snprintf(values[4], sizeof(values[4]), "%d", delay);
+
+  if ((pid = fork()) < 0)
+  {
+    fprintf(stderr, "testbench: Unable to start testsched: %s\n", strerror(errno));
+    return (0);
+  }
+  else if (pid == 0)
+  {
+    execl("./testsched", "./testsched", "-P", values[0], "-p", values[1], "-c", values[2], "-j", values[3], "-d", values[4], (char *)NULL);
+    _exit(127);
+  }
+
+  // Wait up to 10 seconds for the mock scheduler to answer...
+  timeout.tv_sec  = 0;
+  timeout.tv_nsec = 100000000;
+
+  for (i = 0; i < 100; i ++)
+  {
+    if (waitpid(pid, NULL, WNOHANG) == pid)
+      break;
+
+    if (get_stats(port, stats, sizeof(stats)))
+      return (pid);
+
+    nanosleep(&timeout, NULL);
+  }
+
+  fputs("testbench: Unable to start testsched.\n", stderr);
+
+  if (i < 100)
+    return (0);
+
+  kill(pid, SIGTERM);
+  waitpid(pid, NULL, 0);
+
+  return (0);
+}
+
+
+//
+// 'usage()' - Show program usage and exit.
+//
+
+static void
+usage(void)
+{
+  puts("Usage: ./testbench [options]");
+  puts("Options:");
+  puts("-c CLASSES              Number of classes (default 2)");
+  puts("-d MSEC                 Delay for each IPP response (default 0)");
+  puts("-j JOBS                 Number of jobs (default 1000)");
+  puts("-n RUNS                 Number of runs for each benchmark (default 5)");
+  puts("-o FILENAME.json        Write the results to the named file");
+  puts("-p PRINTERS             Number of printers (default 10)");
+
+  exit(1);
+}
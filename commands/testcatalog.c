@@ -0,0 +1,250 @@
+//
+// Message catalog test and startup benchmark for the CUPS commands.
+//
+// Copyright © 2026 by OpenPrinting.
+//
+// Licensed under Apache License v2.0.  See the file "LICENSE" for more
+// information.
+//
+// Usage:
+//
+//   ./testcatalog [-n COUNT] FILENAME.strings
+//
+// The ".strings" file is compiled to a temporary catalog and every message is
+// looked up to check the catalog.  Then COUNT child processes (default 1000)
+// are started for each loader, each loading the messages and looking up one
+// message the way a command does at startup, and the average time per child
+// is reported.
+//
+
+#include "catalog.h"
+#include <sys/wait.h>
+#include <time.h>
+
+
+//
+// Local functions...
+//
+
+static double	bench(const char *title, int count, bool (*func)(const char *filename, const char *key), const char *filename, const char *key);
+static bool	load_catalog(const char *filename, const char *key);
+static bool	load_strings(const char *filename, const char *key);
+static double	get_time(void);
+
+
+//
+// 'main()' - Main entry.
+//
+
+int					// O - Exit status
+main(int  argc,				// I - Number of command-line arguments
+     char *argv[])			// I - Command-line arguments
+{
+  int		i;			// Looping var
+  int		count = 1000;		// Number of children
+  const char	*strings_file = NULL;	// ".strings" file
+  char		catalog_file[1024];	// Catalog file
+  catalog_t	cat;			// Catalog
+  uint32_t	j,			// Looping var
+		num_strings = 0;	// Number of strings
+  const char	*key = NULL,		// Key to look up
+		*value;			// Value from catalog
+  bool		pass = true;		// Did the checks pass?
+  double	text_time,		// Time for ".strings" loader
+		cat_time;		// Time for catalog loader
+
+
+  for (i = 1; i < argc; i ++)
+  {
+    if (!strcmp(argv[i], "-n") && (i + 1) < argc)
+    {
+      count = atoi(argv[++ i]);
+    }
+    else if (argv[i][0] != '-' && !strings_file)
+    {
+      strings_file = argv[i];
+    }
+    else
+    {
+      fputs("Usage: ./testcatalog [-n COUNT] FILENAME.strings\n", stderr);
+      return (1);
+    }
+  }
+
+  if (!strings_file)
+  {
+    fputs("Usage: ./testcatalog [-n COUNT] FILENAME.strings\n", stderr);
+    return (1);
+  }
+
+  // Compile and check the catalog...
+  snprintf(catalog_file, sizeof(catalog_file), "/tmp/testcatalog%d.catalog", (int)getpid());
+
+  printf("catalog_compile(%s): ", strings_file);
+  fflush(stdout);
+  if (!catalog_compile(strings_file, catalog_file))
+  {
+    puts("FAIL");
+    return (1);
+  }
+  puts("PASS");
+
+  printf("catalog_open: ");
+  if (!catalog_open(&cat, catalog_file))
+  {
+    printf("FAIL (%s)\n", strerror(errno));
+    unlink(catalog_file);
+    return (1);
+  }
+  puts("PASS");
+
+  printf("catalog_lookup: ");
+  for (j = 0; j < cat.num_slots; j ++)
+  {
+    if (!cat.slots[j].key)
+      continue;
+
+    num_strings ++;
+
+    if (!key)
+      key = cat.pool + cat.slots[j].key;
+
+    if ((value = catalog_lookup(&cat, cat.pool + cat.slots[j].key)) != cat.pool + cat.slots[j].value)
+    {
+      printf("FAIL (\"%s\" = \"%s\")\n", cat.pool + cat.slots[j].key, value ? value : "(null)");
+      pass = false;
+      break;
+    }
+  }
+
+  if (pass && catalog_lookup(&cat, "This message is not in the catalog.") != NULL)
+  {
+    puts("FAIL (found missing message)");
+    pass = false;
+  }
+  else if (pass)
+  {
+    printf("PASS (%u messages)\n", (unsigned)num_strings);
+  }
+
+  catalog_close(&cat);
+
+  // Run the startup benchmark...
+  if (pass && count > 0 && key)
+  {
+    text_time = bench("strings", count, load_strings, strings_file, key);
+    cat_time  = bench("catalog", count, load_catalog, catalog_file, key);
+
+    if (text_time > 0.0 && cat_time > 0.0)
+      printf("catalog startup is %.1fx faster\n", text_time / cat_time);
+  }
+
+  unlink(catalog_file);
+
+  return (pass ? 0 : 1);
+}
+
+
+//
+// 'bench()' - Time a loader in child processes.
+//
+
+static double				// O - Average time per child in seconds or 0.0 on error
+bench(const char *title,		// I - Title
+      int        count,			// I - Number of children
+      bool       (*func)(const char *filename, const char *key),
+					// I - Loader function
+      const char *filename,		// I - Filename
+      const char *key)			// I - Key to look up
+{
+  int		i;			// Looping var
+  pid_t		pid;			// Child process ID
+  int		status;			// Exit status
+  double	start,			// Start time
+		elapsed;		// Elapsed time
+
+
+  start = get_time();
+
+  for (i = 0; i < count; i ++)
+  {
+    if ((pid = fork()) < 0)
+    {
+      printf("%s: FAIL (%s)\n", title, strerror(errno));
+      return (0.0);
+    }
+    else if (pid == 0)
+    {
+      _exit((func)(filename, key) ? 0 : 1);
+    }
+
+    if (waitpid(pid, &status, 0) < 0 || !WIFEXITED(status) || WEXITSTATUS(status))
+    {
+      printf("%s: FAIL (child failed)\n", title);
+      return (0.0);
+    }
+  }
+
+  elapsed = (get_time() - start) / count;
+
+  printf("%s: %d startups, %.3f ms each\n", title, count, elapsed * 1000.0);
+
+  return (elapsed);
+}
+
+
+//
+// 'get_time()' - Get the current time in seconds.
+//
+
+static double				// O - Time in seconds
+get_time(void)
+{
+  struct timespec	ts;		// Current time
+
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+
+  return ((double)ts.tv_sec + 0.000000001 * ts.tv_nsec);
+}
+
+
+//
+// 'load_catalog()' - Map a catalog and look up a message.
+//
+
+static bool				// O - `true` on success, `false` on error
+load_catalog(const char *filename,	// I - Catalog file
+             const char *key)		// I - Key to look up
+{
+  catalog_t	cat;			// Catalog
+  bool		ret;			// Return value
+
+
+  if (!catalog_open(&cat, filename))
+    return (false);
+
+  ret = catalog_lookup(&cat, key) != NULL;
+
+  catalog_close(&cat);
+
+  return (ret);
+}
+
+
+//
+// 'load_strings()' - Load a ".strings" file and look up a message.
+//
+
+static bool				// O - `true` on success, `false` on error
+load_strings(const char *filename,	// I - ".strings" file
+             const char *key)		// I - Key to look up
+{
+  cups_lang_t	*lang;			// Language
+
+
+  if ((lang = cupsLangFind("en")) == NULL || !cupsLangLoadStrings(lang, filename, NULL))
+    return (false);
+
+  return (cupsLangGetString(lang, key) != NULL);
+}
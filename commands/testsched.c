@@ -0,0 +1,1444 @@
+//
+// Mock IPP scheduler for benchmarking the CUPS commands.
+//
+// Copyright © 2026 by OpenPrinting.
+//
+// Licensed under Apache License v2.0.  See the file "LICENSE" for more
+// information.
+//
+// Usage:
+//
+//   ./testsched [-c CLASSES] [-d MSEC] [-j JOBS] [-P PORT] [-p PRINTERS]
+//
+// The mock scheduler listens on "localhost" (default port 8631) and answers
+// the IPP operations used by the commands from a set of printers, classes, and
+// jobs that is synthesized at startup and kept in memory.  Printers are named
+// "printer001" and up, classes "class001" and up with two printers each, and
+// jobs are spread over the printers.  Each IPP response is delayed by MSEC
+// milliseconds to simulate a slow or remote server.
+//
+// "GET /stats" returns the number of connections, IPP requests, document bytes
+// received, and IPP response bytes sent since the last "GET /stats" as a JSON
+// object, along with the number of requests for each IPP operation.
+//
+
+#include "localize.h"
+#include <poll.h>
+#include <signal.h>
+#include <time.h>
+
+
+//
+// Local constants...
+//
+
+#define SCHED_MAX_LISTEN	4	// Maximum number of listen sockets
+
+
+//
+// Local types...
+//
+
+typedef struct sched_dest_s		// Printer or class
+{
+  char		name[128];		// Name
+  bool		is_class;		// Is this a class?
+  ipp_t		*attrs;			// Printer attributes
+} sched_dest_t;
+
+typedef struct sched_job_s		// Job
+{
+  int		id;			// Job ID
+  char		dest[128],		// Destination name
+		name[256],		// Job name
+		user[256];		// Job owner
+  ipp_jstate_t	state;			// Job state
+  size_t	bytes;			// Size of document data
+  time_t	created,		// Time of creation
+		completed;		// Time of completion
+} sched_job_t;
+
+
+//
+// Local globals...
+//
+
+static cups_mutex_t	sched_mutex;	// Mutex for everything below
+static int		sched_port = 8631;
+					// Port number
+static int		sched_delay = 0;// Delay for each response in milliseconds
+static cups_array_t	*sched_dests = NULL;
+					// Printers and classes
+static char		sched_default[128] = "";
+					// Default destination
+static size_t		sched_num_jobs = 0,
+					// Number of jobs
+			sched_alloc_jobs = 0;
+					// Allocated jobs
+static sched_job_t	*sched_jobs = NULL;
+					// Jobs, indexed by job ID - 1
+static size_t		stats_connections = 0,
+					// Number of connections
+			stats_active = 0,
+					// Number of active connections
+			stats_max_active = 0,
+					// Maximum number of active connections
+			stats_requests = 0,
+					// Number of IPP requests
+			stats_bytes = 0,// Number of document bytes
+			stats_response_bytes = 0,
+					// Number of IPP response bytes
+			stats_ops[2][128];
+					// Requests for each standard and CUPS operation
+
+
+//
+// Local functions...
+//
+
+static sched_dest_t *add_dest(const char *name, bool is_class, size_t num_members, const char **members);
+static sched_job_t *add_job(sched_dest_t *dest, const char *name, const char *user, size_t bytes);
+static void	add_job_attrs(ipp_t *response, sched_job_t *job, cups_array_t *ra);
+static int	compare_dests(sched_dest_t *a, sched_dest_t *b, void *data);
+static bool	filter_attr(cups_array_t *ra, ipp_t *dst, ipp_attribute_t *attr);
+static sched_dest_t *find_dest(const char *name);
+static void	free_dest(sched_dest_t *dest, void *data);
+static sched_dest_t *get_dest(ipp_t *request, bool *all);
+static sched_job_t *get_job(ipp_t *request);
+static ipp_status_t ipp_add_modify_dest(ipp_t *request, bool is_class);
+static ipp_status_t ipp_cancel_jobs(ipp_t *request, ipp_op_t op);
+static ipp_status_t ipp_create_job(ipp_t *request, ipp_t *response, cups_array_t *ra, size_t bytes);
+static ipp_status_t ipp_get_jobs(ipp_t *request, ipp_t *response, cups_array_t *ra);
+static ipp_status_t ipp_get_printers(ipp_t *request, ipp_t *response, cups_array_t *ra);
+static void	*process_client(http_t *client);
+static ipp_t	*process_ipp(ipp_t *request, size_t bytes);
+static size_t	queued_jobs(sched_dest_t *dest);
+static bool	respond_http(http_t *client, http_state_t hstate, http_status_t hstatus, const char *type, const char *data);
+static void	set_dest_attr(sched_dest_t *dest, ipp_attribute_t *attr);
+static void	set_dest_state(sched_dest_t *dest, ipp_pstate_t state, const char *reasons);
+static void	stats_string(char *buffer, size_t bufsize);
+static void	usage(void) _CUPS_NORETURN;
+
+
+//
+// 'main()' - Main entry.
+//
+
+int					// O - Exit status
+main(int  argc,				// I - Number of command-line arguments
+     char *argv[])			// I - Command-line arguments
+{
+  int		i;			// Looping var
+  int		num_printers = 10,	// Number of printers
+		num_classes = 2,	// Number of classes
+		num_jobs = 100;		// Number of jobs
+  char		name[128],		// Destination name
+		members[2][128],	// Class member names
+		portname[32];		// Port number string
+  const char	*mptrs[2];		// Pointers to member names
+  sched_dest_t	*dest;			// Current destination
+  sched_job_t	*job;			// Current job
+  http_addrlist_t *addrlist,		// Listen addresses
+		*addr;			// Current address
+  struct pollfd	pfds[SCHED_MAX_LISTEN];	// Listen sockets
+  nfds_t	j,			// Looping var
+		num_pfds;		// Number of listen sockets
+  http_t	*client;		// Client connection
+  cups_thread_t	thread;			// Client thread
+
+
+  // Parse the command-line...
+  for (i = 1; i < argc; i ++)
+  {
+    if (!strcmp(argv[i], "-c") && (i + 1) < argc)
+      num_classes = atoi(argv[++ i]);
+    else if (!strcmp(argv[i], "-d") && (i + 1) < argc)
+      sched_delay = atoi(argv[++ i]);
+    else if (!strcmp(argv[i], "-j") && (i + 1) < argc)
+      num_jobs = atoi(argv[++ i]);
+    else if (!strcmp(argv[i], "-P") && (i + 1) < argc)
+      sched_port = atoi(argv[++ i]);
+    else if (!strcmp(argv[i], "-p") && (i + 1) < argc)
+      num_printers = atoi(argv[++ i]);
+    else
+      usage();
+  }
+
+  if (num_printers < 0 || num_classes < 0 || num_jobs < 0 || sched_delay < 0 || sched_port < 1 || sched_port > 65535)
+    usage();
+
+  if (num_printers < 2)
+    num_classes = 0;
+
+  if (num_printers < 1)
+    num_jobs = 0;
+
+  // Synthesize the printers, classes, and jobs...
+  cupsMutexInit(&sched_mutex);
+
+  sched_dests = cupsArrayNew((cups_array_cb_t)compare_dests, NULL, NULL, 0, NULL, (cups_afree_cb_t)free_dest);
+
+  for (i = 1; i <= num_printers; i ++)
+  {
+    snprintf(name, sizeof(name), "printer%03d", i);
+    add_dest(name, false, 0, NULL);
+
+    if (i == 1)
+      cupsCopyString(sched_default, name, sizeof(sched_default));
+  }
+
+  for (i = 1; i <= num_classes; i ++)
+  {
+    snprintf(name, sizeof(name), "class%03d", i);
+    snprintf(members[0], sizeof(members[0]), "printer%03d", (i - 1) % num_printers + 1);
+    snprintf(members[1], sizeof(members[1]), "printer%03d", i % num_printers + 1);
+    mptrs[0] = members[0];
+    mptrs[1] = members[1];
+
+    add_dest(name, true, 2, mptrs);
+  }
+
+  for (i = 1; i <= num_jobs; i ++)
+  {
+    snprintf(name, sizeof(name), "printer%03d", (i - 1) % num_printers + 1);
+    dest = find_dest(name);
+
+    snprintf(name, sizeof(name), "job-%d", i);
+    snprintf(members[0], sizeof(members[0]), "user%d", i % 4 + 1);
+
+    if ((job = add_job(dest, name, members[0], (size_t)(i * 37 % 1000 + 1) * 1024)) == NULL)
+    {
+      fputs("testsched: Unable to allocate memory.\n", stderr);
+      return (1);
+    }
+
+    job->created -= num_jobs - i;
+  }
+
+  // Create the listen sockets...
+  snprintf(portname, sizeof(portname), "%d", sched_port);
+  addrlist = httpAddrGetList("localhost", AF_UNSPEC, portname);
+
+  for (addr = addrlist, num_pfds = 0; addr && num_pfds < SCHED_MAX_LISTEN; addr = addr->next)
+  {
+    if ((pfds[num_pfds].fd = httpAddrListen(&(addr->addr), sched_port)) >= 0)
+    {
+      pfds[num_pfds].events = POLLIN;
+      num_pfds ++;
+    }
+  }
+
+  httpAddrFreeList(addrlist);
+
+  if (num_pfds == 0)
+  {
+    fprintf(stderr, "testsched: Unable to listen on port %d: %s\n", sched_port, strerror(errno));
+    return (1);
+  }
+
+  signal(SIGPIPE, SIG_IGN);
+
+  // Accept connections until we are killed...
+  for (;;)
+  {
+    if (poll(pfds, num_pfds, -1) < 0)
+    {
+      if (errno == EINTR || errno == EAGAIN)
+        continue;
+
+      fprintf(stderr, "testsched: %s\n", strerror(errno));
+      break;
+    }
+
+    for (j = 0; j < num_pfds; j ++)
+    {
+      if (!(pfds[j].revents & POLLIN))
+        continue;
+
+      if ((client = httpAcceptConnection(pfds[j].fd, /*blocking*/true)) == NULL)
+        continue;
+
+      cupsMutexLock(&sched_mutex);
+      stats_connections ++;
+      if (++ stats_active > stats_max_active)
+        stats_max_active = stats_active;
+      cupsMutexUnlock(&sched_mutex);
+
+      if ((thread = cupsThreadCreate((cups_thread_func_t)process_client, client)) == CUPS_THREAD_INVALID)
+      {
+        httpClose(client);
+
+        cupsMutexLock(&sched_mutex);
+        stats_active --;
+        cupsMutexUnlock(&sched_mutex);
+      }
+      else
+      {
+        cupsThreadDetach(thread);
+      }
+    }
+  }
+
+  for (j = 0; j < num_pfds; j ++)
+    close(pfds[j].fd);
+
+  return (1);
+}
+
+
+//
+// 'add_dest()' - Add a printer or class.
+//
+
+static sched_dest_t *			// O - New destination
+add_dest(const char *name,		// I - Name
+         bool       is_class,		// I - Is this a class?
+         size_t     num_members,	// I - Number of class members
+         const char **members)		// I - Class member names
+{
+  sched_dest_t	*dest;			// New destination
+  size_t	i;			// Looping var
+  char		uri[1024];		// Printer URI
+  ipp_attribute_t *attr;		// Member URIs
+  static const char * const formats[] =	// document-format-supported values
+  {
+    "application/octet-stream",
+    "application/pdf",
+    "image/jpeg",
+    "text/plain"
+  };
+  static const char * const media[] =	// media-supported values
+  {
+    "iso_a4_210x297mm",
+    "na_legal_8.5x14in",
+    "na_letter_8.5x11in"
+  };
+  static const char * const sides[] =	// sides-supported values
+  {
+    "one-sided",
+    "two-sided-long-edge",
+    "two-sided-short-edge"
+  };
+  static const char * const creation[] =// job-creation-attributes-supported values
+  {
+    "copies",
+    "media",
+    "sides"
+  };
+  static const char * const versions[] =// ipp-versions-supported values
+  {
+    "1.1",
+    "2.0"
+  };
+
+
+  if ((dest = (sched_dest_t *)calloc(1, sizeof(sched_dest_t))) == NULL)
+    return (NULL);
+
+  cupsCopyString(dest->name, name, sizeof(dest->name));
+  dest->is_class = is_class;
+  dest->attrs    = ippNew();
+
+  httpAssembleURIf(HTTP_URI_CODING_ALL, uri, sizeof(uri), "ipp", NULL, "localhost", sched_port, is_class ? "/classes/%s" : "/printers/%s", name);
+
+  ippAddString(dest->attrs, IPP_TAG_PRINTER, IPP_TAG_NAME, "printer-name", NULL, name);
+  ippAddString(dest->attrs, IPP_TAG_PRINTER, IPP_TAG_URI, "printer-uri-supported", NULL, uri);
+  ippAddString(dest->attrs, IPP_TAG_PRINTER, IPP_TAG_KEYWORD, "uri-authentication-supported", NULL, "none");
+  ippAddString(dest->attrs, IPP_TAG_PRINTER, IPP_TAG_KEYWORD, "uri-security-supported", NULL, "none");
+  ippAddString(dest->attrs, IPP_TAG_PRINTER, IPP_TAG_TEXT, "printer-info", NULL, name);
+  ippAddString(dest->attrs, IPP_TAG_PRINTER, IPP_TAG_TEXT, "printer-location", NULL, "Benchmark Lab");
+  ippAddString(dest->attrs, IPP_TAG_PRINTER, IPP_TAG_TEXT, "printer-make-and-model", NULL, is_class ? "Local Printer Class" : "Mock Printer");
+  ippAddInteger(dest->attrs, IPP_TAG_PRINTER, IPP_TAG_ENUM, "printer-type", is_class ? CUPS_PRINTER_CLASS : CUPS_PRINTER_COPIES | CUPS_PRINTER_DUPLEX);
+  ippAddInteger(dest->attrs, IPP_TAG_PRINTER, IPP_TAG_ENUM, "printer-state", IPP_PSTATE_IDLE);
+  ippAddString(dest->attrs, IPP_TAG_PRINTER, IPP_TAG_KEYWORD, "printer-state-reasons", NULL, "none");
+  ippAddString(dest->attrs, IPP_TAG_PRINTER, IPP_TAG_TEXT, "printer-state-message", NULL, "");
+  ippAddInteger(dest->attrs, IPP_TAG_PRINTER, IPP_TAG_INTEGER, "printer-state-change-time", (int)time(NULL));
+  ippAddBoolean(dest->attrs, IPP_TAG_PRINTER, "printer-is-accepting-jobs", true);
+  ippAddBoolean(dest->attrs, IPP_TAG_PRINTER, "printer-is-shared", false);
+  ippAddInteger(dest->attrs, IPP_TAG_PRINTER, IPP_TAG_INTEGER, "printer-up-time", (int)time(NULL));
+
+  if (is_class && num_members > 0)
+  {
+    ippAddStrings(dest->attrs, IPP_TAG_PRINTER, IPP_TAG_NAME, "member-names", num_members, NULL, members);
+
+    attr = ippAddStrings(dest->attrs, IPP_TAG_PRINTER, IPP_TAG_URI, "member-uris", num_members, NULL, NULL);
+    for (i = 0; i < num_members; i ++)
+    {
+      httpAssembleURIf(HTTP_URI_CODING_ALL, uri, sizeof(uri), "ipp", NULL, "localhost", sched_port, "/printers/%s", members[i]);
+      ippSetString(dest->attrs, &attr, i, uri);
+    }
+  }
+  else if (!is_class)
+  {
+    ippAddString(dest->attrs, IPP_TAG_PRINTER, IPP_TAG_URI, "device-uri", NULL, "file:///dev/null");
+  }
+
+  ippAddString(dest->attrs, IPP_TAG_PRINTER, IPP_TAG_CHARSET, "charset-configured", NULL, "utf-8");
+  ippAddString(dest->attrs, IPP_TAG_PRINTER, IPP_TAG_CHARSET, "charset-supported", NULL, "utf-8");
+  ippAddString(dest->attrs, IPP_TAG_PRINTER, IPP_TAG_LANGUAGE, "natural-language-configured", NULL, "en");
+  ippAddString(dest->attrs, IPP_TAG_PRINTER, IPP_TAG_LANGUAGE, "generated-natural-language-supported", NULL, "en");
+  ippAddStrings(dest->attrs, IPP_TAG_PRINTER, IPP_TAG_KEYWORD, "ipp-versions-supported", sizeof(versions) / sizeof(versions[0]), NULL, versions);
+  ippAddString(dest->attrs, IPP_TAG_PRINTER, IPP_TAG_MIMETYPE, "document-format-default", NULL, "application/octet-stream");
+  ippAddStrings(dest->attrs, IPP_TAG_PRINTER, IPP_TAG_MIMETYPE, "document-format-supported", sizeof(formats) / sizeof(formats[0]), NULL, formats);
+  ippAddStrings(dest->attrs, IPP_TAG_PRINTER, IPP_TAG_KEYWORD, "job-creation-attributes-supported", sizeof(creation) / sizeof(creation[0]), NULL, creation);
+  ippAddInteger(dest->attrs, IPP_TAG_PRINTER, IPP_TAG_INTEGER, "copies-default", 1);
+  ippAddRange(dest->attrs, IPP_TAG_PRINTER, "copies-supported", 1, 999);
+  ippAddString(dest->attrs, IPP_TAG_PRINTER, IPP_TAG_KEYWORD, "media-default", NULL, "na_letter_8.5x11in");
+  ippAddStrings(dest->attrs, IPP_TAG_PRINTER, IPP_TAG_KEYWORD, "media-supported", sizeof(media) / sizeof(media[0]), NULL, media);
+  ippAddString(dest->attrs, IPP_TAG_PRINTER, IPP_TAG_KEYWORD, "sides-default", NULL, "one-sided");
+  ippAddStrings(dest->attrs, IPP_TAG_PRINTER, IPP_TAG_KEYWORD, "sides-supported", sizeof(sides) / sizeof(sides[0]), NULL, sides);
+
+  cupsArrayAdd(sched_dests, dest);
+
+  return (dest);
+}
+
+
+//
+// 'add_job()' - Add a pending job.
+//
+
+static sched_job_t *			// O - New job or `NULL` on error
+add_job(sched_dest_t *dest,		// I - Destination
+        const char   *name,		// I - Job name
+        const char   *user,		// I - Job owner
+        size_t       bytes)		// I - Size of document data
+{
+  sched_job_t	*job;			// New job
+
+
+  if (sched_num_jobs >= sched_alloc_jobs)
+  {
+    size_t	alloc = sched_alloc_jobs + 1024;
+					// New allocation size
+    sched_job_t	*jobs;			// New jobs
+
+    if ((jobs = realloc(sched_jobs, alloc * sizeof(sched_job_t))) == NULL)
+      return (NULL);
+
+    sched_jobs       = jobs;
+    sched_alloc_jobs = alloc;
+  }
+
+  job = sched_jobs + sched_num_jobs;
+
+  memset(job, 0, sizeof(sched_job_t));
+  job->id      = (int)++ sched_num_jobs;
+  job->state   = IPP_JSTATE_PENDING;
+  job->bytes   = bytes;
+  job->created = time(NULL);
+
+  cupsCopyString(job->dest, dest->name, sizeof(job->dest));
+  cupsCopyString(job->name, name, sizeof(job->name));
+  cupsCopyString(job->user, user, sizeof(job->user));
+
+  return (job);
+}
+
+
+//
+// 'add_job_attrs()' - Add the requested job attributes to a response.
+//
+
+static void
+add_job_attrs(ipp_t        *response,	// I - IPP response
+              sched_job_t  *job,	// I - Job
+              cups_array_t *ra)		// I - Requested attributes or `NULL` for all
+{
+  ipp_t		*attrs;			// Job attributes
+  char		uri[1024];		// Job or printer URI
+  sched_dest_t	*dest;			// Job destination
+  const char	*reasons;		// Job state reasons
+
+
+  switch (job->state)
+  {
+    case IPP_JSTATE_PENDING :
+        reasons = "none";
+        break;
+    case IPP_JSTATE_HELD :
+        reasons = "job-hold-until-specified";
+        break;
+    case IPP_JSTATE_PROCESSING :
+        reasons = "job-printing";
+        break;
+    case IPP_JSTATE_STOPPED :
+        reasons = "printer-stopped";
+        break;
+    case IPP_JSTATE_CANCELED :
+        reasons = "job-canceled-by-user";
+        break;
+    case IPP_JSTATE_ABORTED :
+        reasons = "aborted-by-system";
+        break;
+    default :
+        reasons = "job-completed-successfully";
+        break;
+  }
+
+  attrs = ippNew();
+
+  ippAddInteger(attrs, IPP_TAG_JOB, IPP_TAG_INTEGER, "job-id", job->id);
+  httpAssembleURIf(HTTP_URI_CODING_ALL, uri, sizeof(uri), "ipp", NULL, "localhost", sched_port, "/jobs/%d", job->id);
+  ippAddString(attrs, IPP_TAG_JOB, IPP_TAG_URI, "job-uri", NULL, uri);
+  dest = find_dest(job->dest);
+  httpAssembleURIf(HTTP_URI_CODING_ALL, uri, sizeof(uri), "ipp", NULL, "localhost", sched_port, dest && dest->is_class ? "/classes/%s" : "/printers/%s", job->dest);
+  ippAddString(attrs, IPP_TAG_JOB, IPP_TAG_URI, "job-printer-uri", NULL, uri);
+  ippAddString(attrs, IPP_TAG_JOB, IPP_TAG_NAME, "job-name", NULL, job->name);
+  ippAddString(attrs, IPP_TAG_JOB, IPP_TAG_NAME, "job-originating-user-name", NULL, job->user);
+  ippAddInteger(attrs, IPP_TAG_JOB, IPP_TAG_ENUM, "job-state", (int)job->state);
+  ippAddString(attrs, IPP_TAG_JOB, IPP_TAG_KEYWORD, "job-state-reasons", NULL, reasons);
+  ippAddInteger(attrs, IPP_TAG_JOB, IPP_TAG_INTEGER, "job-k-octets", (int)((job->bytes + 1023) / 1024));
+  ippAddInteger(attrs, IPP_TAG_JOB, IPP_TAG_INTEGER, "job-priority", 50);
+  ippAddInteger(attrs, IPP_TAG_JOB, IPP_TAG_INTEGER, "job-media-sheets-completed", 0);
+  ippAddInteger(attrs, IPP_TAG_JOB, IPP_TAG_INTEGER, "number-of-documents", job->bytes ? 1 : 0);
+  ippAddInteger(attrs, IPP_TAG_JOB, IPP_TAG_INTEGER, "time-at-creation", (int)job->created);
+
+  if (job->completed)
+    ippAddInteger(attrs, IPP_TAG_JOB, IPP_TAG_INTEGER, "time-at-completed", (int)job->completed);
+  else
+    ippAddOutOfBand(attrs, IPP_TAG_JOB, IPP_TAG_NOVALUE, "time-at-completed");
+
+  ippCopyAttributes(response, attrs, /*quickcopy*/false, (ipp_copy_cb_t)filter_attr, ra);
+  ippDelete(attrs);
+}
+
+
+//
+// 'compare_dests()' - Compare two destinations by name.
+//
+
+static int				// O - Result of comparison
+compare_dests(sched_dest_t *a,		// I - First destination
+              sched_dest_t *b,		// I - Second destination
+              void         *data)	// I - Callback data (unused)
+{
+  (void)data;
+
+  return (strcasecmp(a->name, b->name));
+}
+
+
+//
+// 'filter_attr()' - Filter attributes by the requested attributes.
+//
+
+static bool				// O - `true` to copy, `false` to skip
+filter_attr(cups_array_t    *ra,	// I - Requested attributes or `NULL` for all
+            ipp_t           *dst,	// I - Destination (unused)
+            ipp_attribute_t *attr)	// I - Attribute
+{
+  (void)dst;
+
+  return (!ra || cupsArrayFind(ra, (void *)ippGetName(attr)) != NULL);
+}
+
+
+//
+// 'find_dest()' - Find a destination by name.
+//
+
+static sched_dest_t *			// O - Destination or `NULL` if not found
+find_dest(const char *name)		// I - Name
+{
+  sched_dest_t	key;			// Search key
+
+
+  cupsCopyString(key.name, name, sizeof(key.name));
+
+  return ((sched_dest_t *)cupsArrayFind(sched_dests, &key));
+}
+
+
+//
+// 'free_dest()' - Free a destination.
+//
+
+static void
+free_dest(sched_dest_t *dest,		// I - Destination
+          void         *data)		// I - Callback data (unused)
+{
+  (void)data;
+
+  ippDelete(dest->attrs);
+  free(dest);
+}
+
+
+//
+// 'get_dest()' - Get the destination for a request.
+//
+// `all` is set to `true` when the "printer-uri" attribute names the server
+// rather than a printer or class.
+//
+
+static sched_dest_t *			// O - Destination or `NULL` if none
+get_dest(ipp_t *request,		// I - IPP request
+         bool  *all)			// O - `true` for all destinations
+{
+  const char	*uri;			// Printer URI
+  char		scheme[32],		// URI scheme
+		userpass[256],		// Username:password
+		host[256],		// Hostname
+		resource[256];		// Resource path
+  int		port;			// Port number
+
+
+  *all = false;
+
+  if ((uri = ippGetString(ippFindAttribute(request, "printer-uri", IPP_TAG_URI), 0, NULL)) == NULL)
+  {
+    *all = true;
+    return (NULL);
+  }
+
+  if (httpSeparateURI(HTTP_URI_CODING_ALL, uri, scheme, sizeof(scheme), userpass, sizeof(userpass), host, sizeof(host), &port, resource, sizeof(resource)) < HTTP_URI_STATUS_OK)
+    return (NULL);
+
+  if (!strncmp(resource, "/printers/", 10) && resource[10])
+    return (find_dest(resource + 10));
+  else if (!strncmp(resource, "/classes/", 9) && resource[9])
+    return (find_dest(resource + 9));
+
+  *all = true;
+
+  return (NULL);
+}
+
+
+//
+// 'get_job()' - Get the job for a request.
+//
+
+static sched_job_t *			// O - Job or `NULL` if not found
+get_job(ipp_t *request)			// I - IPP request
+{
+  int		id = 0;			// Job ID
+  ipp_attribute_t *attr;		// Job ID or URI
+  const char	*uri;			// Job URI
+
+
+  if ((attr = ippFindAttribute(request, "job-id", IPP_TAG_INTEGER)) != NULL)
+  {
+    id = ippGetInteger(attr, 0);
+  }
+  else if ((uri = ippGetString(ippFindAttribute(request, "job-uri", IPP_TAG_URI), 0, NULL)) != NULL)
+  {
+    const char	*ptr;			// Pointer to job ID
+
+    if ((ptr = strrchr(uri, '/')) != NULL)
+      id = atoi(ptr + 1);
+  }
+
+  if (id < 1 || (size_t)id > sched_num_jobs)
+    return (NULL);
+
+  return (sched_jobs + id - 1);
+}
+
+
+//
+// 'ipp_add_modify_dest()' - Add or modify a printer or class.
+//
+
+static ipp_status_t			// O - IPP status
+ipp_add_modify_dest(ipp_t *request,	// I - IPP request
+                    bool  is_class)	// I - Add a class?
+{
+  const char	*uri,			// Printer URI
+		*name;			// Destination name
+  sched_dest_t	*dest;			// Destination
+  bool		all;			// All destinations?
+  ipp_attribute_t *attr;		// Current attribute
+
+
+  if ((dest = get_dest(request, &all)) == NULL)
+  {
+    // Add a new printer or class with the name from the URI...
+    if (all || (uri = ippGetString(ippFindAttribute(request, "printer-uri", IPP_TAG_URI), 0, NULL)) == NULL || (name = strrchr(uri, '/')) == NULL || !name[1])
+      return (IPP_STATUS_ERROR_BAD_REQUEST);
+
+    if ((dest = add_dest(name + 1, is_class, 0, NULL)) == NULL)
+      return (IPP_STATUS_ERROR_INTERNAL);
+  }
+  else if (dest->is_class != is_class)
+  {
+    return (IPP_STATUS_ERROR_NOT_POSSIBLE);
+  }
+
+  // Copy the printer attributes from the request...
+  for (attr = ippGetFirstAttribute(request); attr; attr = ippGetNextAttribute(request))
+  {
+    if (ippGetGroupTag(attr) != IPP_TAG_PRINTER || !ippGetName(attr))
+      continue;
+
+    set_dest_attr(dest, attr);
+
+    if (!strcmp(ippGetName(attr), "member-uris"))
+    {
+      // Update the member names to match...
+      size_t		i,		// Looping var
+			count = ippGetCount(attr);
+					// Number of members
+      ipp_t		*temp;		// Temporary attributes
+      ipp_attribute_t	*names;		// Member names
+      const char	*member;	// Member name
+
+      temp  = ippNew();
+      names = ippAddStrings(temp, IPP_TAG_PRINTER, IPP_TAG_NAME, "member-names", count, NULL, NULL);
+
+      for (i = 0; i < count; i ++)
+      {
+        if ((member = strrchr(ippGetString(attr, i, NULL), '/')) != NULL)
+          member ++;
+        else
+          member = ippGetString(attr, i, NULL);
+
+        ippSetString(temp, &names, i, member);
+      }
+
+      set_dest_attr(dest, names);
+      ippDelete(temp);
+    }
+  }
+
+  ippDeleteAttribute(dest->attrs, ippFindAttribute(dest->attrs, "printer-state-change-time", IPP_TAG_INTEGER));
+  ippAddInteger(dest->attrs, IPP_TAG_PRINTER, IPP_TAG_INTEGER, "printer-state-change-time", (int)time(NULL));
+
+  return (IPP_STATUS_OK);
+}
+
+
+//
+// 'ipp_cancel_jobs()' - Cancel some or all jobs.
+//
+
+static ipp_status_t			// O - IPP status
+ipp_cancel_jobs(ipp_t    *request,	// I - IPP request
+                ipp_op_t op)		// I - Operation
+{
+  sched_dest_t	*dest;			// Destination
+  bool		all;			// All destinations?
+  ipp_attribute_t *ids;			// Job IDs
+  const char	*user;			// Requesting user
+  size_t	i, j,			// Looping vars
+		count;			// Number of job IDs
+  sched_job_t	*job;			// Current job
+
+
+  if ((dest = get_dest(request, &all)) == NULL && !all)
+    return (IPP_STATUS_ERROR_NOT_FOUND);
+
+  ids   = ippFindAttribute(request, "job-ids", IPP_TAG_INTEGER);
+  count = ippGetCount(ids);
+  user  = ippGetString(ippFindAttribute(request, "requesting-user-name", IPP_TAG_NAME), 0, NULL);
+
+  // Like cupsd, fail the whole request if a listed job does not exist or,
+  // for Cancel-My-Jobs, belongs to another user...
+  for (j = 0; j < count; j ++)
+  {
+    for (i = sched_num_jobs, job = sched_jobs; i > 0; i --, job ++)
+    {
+      if (job->id == ippGetInteger(ids, j))
+        break;
+    }
+
+    if (i == 0 || (op == IPP_OP_CANCEL_MY_JOBS && (!user || strcmp(job->user, user))))
+      return (IPP_STATUS_ERROR_NOT_FOUND);
+  }
+
+  for (i = sched_num_jobs, job = sched_jobs; i > 0; i --, job ++)
+  {
+    if (job->state >= IPP_JSTATE_CANCELED)
+      continue;
+
+    if (dest && strcasecmp(job->dest, dest->name))
+      continue;
+
+    if (op == IPP_OP_CANCEL_MY_JOBS && (!user || strcmp(job->user, user)))
+      continue;
+
+    if (ids)
+    {
+      for (j = 0; j < count; j ++)
+      {
+        if (ippGetInteger(ids, j) == job->id)
+          break;
+      }
+
+      if (j >= count)
+        continue;
+    }
+
+    job->state     = IPP_JSTATE_CANCELED;
+    job->completed = time(NULL);
+  }
+
+  return (IPP_STATUS_OK);
+}
+
+
+//
+// 'ipp_create_job()' - Create a job with Print-Job or Create-Job.
+//
+
+static ipp_status_t			// O - IPP status
+ipp_create_job(ipp_t        *request,	// I - IPP request
+               ipp_t        *response,	// I - IPP response
+               cups_array_t *ra,	// I - Requested attributes
+               size_t       bytes)	// I - Size of document data
+{
+  sched_dest_t	*dest;			// Destination
+  bool		all;			// All destinations?
+  const char	*name,			// Job name
+		*user;			// Requesting user
+  sched_job_t	*job;			// New job
+
+
+  if ((dest = get_dest(request, &all)) == NULL)
+    return (IPP_STATUS_ERROR_NOT_FOUND);
+
+  if (!ippGetBoolean(ippFindAttribute(dest->attrs, "printer-is-accepting-jobs", IPP_TAG_BOOLEAN), 0))
+    return (IPP_STATUS_ERROR_NOT_ACCEPTING_JOBS);
+
+  if ((name = ippGetString(ippFindAttribute(request, "job-name", IPP_TAG_NAME), 0, NULL)) == NULL)
+    name = "Untitled";
+
+  if ((user = ippGetString(ippFindAttribute(request, "requesting-user-name", IPP_TAG_NAME), 0, NULL)) == NULL)
+    user = "anonymous";
+
+  if ((job = add_job(dest, name, user, bytes)) == NULL)
+    return (IPP_STATUS_ERROR_INTERNAL);
+
+  add_job_attrs(response, job, ra);
+
+  return (IPP_STATUS_OK);
+}
+
+
+//
+// 'ipp_get_jobs()' - Get a list of jobs.
+//
+
+static ipp_status_t			// O - IPP status
+ipp_get_jobs(ipp_t        *request,	// I - IPP request
+             ipp_t        *response,	// I - IPP response
+             cups_array_t *ra)		// I - Requested attributes
+{
+  sched_dest_t	*dest;			// Destination
+  bool		all;			// All destinations?
+  const char	*which,			// Which jobs
+		*user = NULL;		// Requesting user
+  int		limit,			// Maximum number of jobs
+		count = 0;		// Number of jobs returned
+  size_t	i;			// Looping var
+  sched_job_t	*job;			// Current job
+
+
+  if ((dest = get_dest(request, &all)) == NULL && !all)
+    return (IPP_STATUS_ERROR_NOT_FOUND);
+
+  if ((which = ippGetString(ippFindAttribute(request, "which-jobs", IPP_TAG_KEYWORD), 0, NULL)) == NULL)
+    which = "not-completed";
+
+  if (ippGetBoolean(ippFindAttribute(request, "my-jobs", IPP_TAG_BOOLEAN), 0))
+    user = ippGetString(ippFindAttribute(request, "requesting-user-name", IPP_TAG_NAME), 0, NULL);
+
+  limit = ippGetInteger(ippFindAttribute(request, "limit", IPP_TAG_INTEGER), 0);
+
+  for (i = sched_num_jobs, job = sched_jobs; i > 0 && (limit <= 0 || count < limit); i --, job ++)
+  {
+    if (!strcmp(which, "completed") && job->state <= IPP_JSTATE_STOPPED)
+      continue;
+    else if (!strcmp(which, "not-completed") && job->state > IPP_JSTATE_STOPPED)
+      continue;
+
+    if (dest && strcasecmp(job->dest, dest->name))
+      continue;
+
+    if (user && strcmp(job->user, user))
+      continue;
+
+    if (count > 0)
+      ippAddSeparator(response);
+
+    add_job_attrs(response, job, ra);
+    count ++;
+  }
+
+  return (IPP_STATUS_OK);
+}
+
+
+//
+// 'ipp_get_printers()' - Get a list of printers or classes.
+//
+
+static ipp_status_t			// O - IPP status
+ipp_get_printers(ipp_t        *request,	// I - IPP request
+                 ipp_t        *response,// I - IPP response
+                 cups_array_t *ra)	// I - Requested attributes
+{
+  bool		classes_only;		// Only return classes?
+  int		type,			// printer-type value
+		mask,			// printer-type-mask value
+		dtype,			// Destination printer-type
+		limit,			// Maximum number of destinations
+		count = 0;		// Number of destinations returned
+  sched_dest_t	*dest;			// Current destination
+
+
+  classes_only = ippGetOperation(request) == IPP_OP_CUPS_GET_CLASSES;
+  type         = ippGetInteger(ippFindAttribute(request, "printer-type", IPP_TAG_ENUM), 0);
+  mask         = ippGetInteger(ippFindAttribute(request, "printer-type-mask", IPP_TAG_ENUM), 0);
+  limit        = ippGetInteger(ippFindAttribute(request, "limit", IPP_TAG_INTEGER), 0);
+
+  for (dest = (sched_dest_t *)cupsArrayGetFirst(sched_dests); dest && (limit <= 0 || count < limit); dest = (sched_dest_t *)cupsArrayGetNext(sched_dests))
+  {
+    if (classes_only && !dest->is_class)
+      continue;
+
+    dtype = ippGetInteger(ippFindAttribute(dest->attrs, "printer-type", IPP_TAG_ENUM), 0);
+
+    if ((dtype & mask) != (type & mask))
+      continue;
+
+    if (count > 0)
+      ippAddSeparator(response);
+
+    ippCopyAttributes(response, dest->attrs, /*quickcopy*/false, (ipp_copy_cb_t)filter_attr, ra);
+
+    if (!ra || cupsArrayFind(ra, "queued-job-count"))
+      ippAddInteger(response, IPP_TAG_PRINTER, IPP_TAG_INTEGER, "queued-job-count", (int)queued_jobs(dest));
+
+    count ++;
+  }
+
+  return (count > 0 ? IPP_STATUS_OK : IPP_STATUS_ERROR_NOT_FOUND);
+}
+
+
+//
+// 'process_client()' - Answer HTTP and IPP requests from a client.
+//
+
+static void *				// O - Thread exit status
+process_client(http_t *client)		// I - Client connection
+{
+  http_state_t	hstate;			// HTTP request state
+  http_status_t	hstatus;		// HTTP status
+  ipp_state_t	istate;			// IPP read/write state
+  char		resource[1024],		// Resource path
+		buffer[32768];		// Document data or statistics
+  const char	*type;			// Content type
+  ipp_t		*request,		// IPP request
+		*response;		// IPP response
+  size_t	bytes,			// Document bytes
+		length;			// Response bytes
+  ssize_t	rbytes;			// Bytes read
+
+
+  while (httpWait(client, 30000))
+  {
+    // Read the request line and header fields...
+    if ((hstate = httpReadRequest(client, resource, sizeof(resource))) == HTTP_STATE_WAITING)
+      continue;
+    else if (hstate == HTTP_STATE_ERROR || hstate == HTTP_STATE_UNKNOWN_METHOD || hstate == HTTP_STATE_UNKNOWN_VERSION)
+      break;
+
+    while ((hstatus = httpUpdate(client)) == HTTP_STATUS_CONTINUE);
+
+    if (hstatus != HTTP_STATUS_OK)
+      break;
+
+    if (hstate == HTTP_STATE_POST)
+    {
+      // IPP request...
+      if ((type = httpGetField(client, HTTP_FIELD_CONTENT_TYPE)) == NULL || strcmp(type, "application/ipp"))
+      {
+        respond_http(client, hstate, HTTP_STATUS_BAD_REQUEST, NULL, NULL);
+        break;
+      }
+
+      if (httpGetExpect(client) == HTTP_STATUS_CONTINUE && !httpWriteResponse(client, HTTP_STATUS_CONTINUE))
+        break;
+
+      request = ippNew();
+
+      while ((istate = ippRead(client, request)) != IPP_STATE_DATA)
+      {
+        if (istate == IPP_STATE_ERROR)
+          break;
+      }
+
+      if (istate == IPP_STATE_ERROR)
+      {
+        ippDelete(request);
+        respond_http(client, hstate, HTTP_STATUS_BAD_REQUEST, NULL, NULL);
+        break;
+      }
+
+      // Read and discard any document data...
+      for (bytes = 0; (rbytes = httpRead(client, buffer, sizeof(buffer))) > 0; bytes += (size_t)rbytes);
+
+      response = process_ipp(request, bytes);
+      ippDelete(request);
+
+      if (sched_delay > 0)
+      {
+        struct timespec	delay;		// Response delay
+
+        delay.tv_sec  = sched_delay / 1000;
+        delay.tv_nsec = (sched_delay % 1000) * 1000000;
+
+        nanosleep(&delay, NULL);
+      }
+
+      length = ippGetLength(response);
+
+      cupsMutexLock(&sched_mutex);
+      stats_response_bytes += length;
+      cupsMutexUnlock(&sched_mutex);
+
+      httpSetField(client, HTTP_FIELD_CONTENT_TYPE, "application/ipp");
+      httpSetLength(client, length);
+
+      if (!httpWriteResponse(client, HTTP_STATUS_OK) || ippWrite(client, response) != IPP_STATE_DATA)
+      {
+        ippDelete(response);
+        break;
+      }
+
+      ippDelete(response);
+      httpFlushWrite(client);
+    }
+    else if ((hstate == HTTP_STATE_GET || hstate == HTTP_STATE_HEAD) && !strcmp(resource, "/stats"))
+    {
+      // Statistics...
+      stats_string(buffer, sizeof(buffer));
+
+      if (!respond_http(client, hstate, HTTP_STATUS_OK, "application/json", buffer))
+        break;
+    }
+    else if (!respond_http(client, hstate, hstate == HTTP_STATE_GET || hstate == HTTP_STATE_HEAD ? HTTP_STATUS_NOT_FOUND : HTTP_STATUS_METHOD_NOT_ALLOWED, NULL, NULL))
+    {
+      break;
+    }
+
+    if (!httpGetKeepAlive(client))
+      break;
+  }
+
+  httpClose(client);
+
+  cupsMutexLock(&sched_mutex);
+  stats_active --;
+  cupsMutexUnlock(&sched_mutex);
+
+  return (NULL);
+}
+
+
+//
+// 'process_ipp()' - Process an IPP request.
+//
+
+static ipp_t *				// O - IPP response
+process_ipp(ipp_t  *request,		// I - IPP request
+            size_t bytes)		// I - Size of document data
+{
+  ipp_t		*response;		// IPP response
+  ipp_status_t	status;			// IPP status
+  ipp_op_t	op;			// Operation
+  cups_array_t	*ra;			// Requested attributes
+  sched_dest_t	*dest;			// Destination
+  sched_job_t	*job;			// Job
+  bool		all;			// All destinations?
+
+
+  response = ippNewResponse(request);
+  ra       = ippCreateRequestedArray(request);
+  op       = ippGetOperation(request);
+
+  cupsMutexLock(&sched_mutex);
+
+  stats_requests ++;
+  stats_bytes += bytes;
+  stats_ops[(op & 0x4000) ? 1 : 0][op & 127] ++;
+
+  switch (op)
+  {
+    case IPP_OP_CUPS_GET_CLASSES :
+    case IPP_OP_CUPS_GET_PRINTERS :
+        status = ipp_get_printers(request, response, ra);
+        break;
+
+    case IPP_OP_CUPS_GET_DEFAULT :
+        if ((dest = find_dest(sched_default)) == NULL)
+        {
+          status = IPP_STATUS_ERROR_NOT_FOUND;
+        }
+        else
+        {
+          ippCopyAttributes(response, dest->attrs, /*quickcopy*/false, (ipp_copy_cb_t)filter_attr, ra);
+          status = IPP_STATUS_OK;
+        }
+        break;
+
+    case IPP_OP_GET_PRINTER_ATTRIBUTES :
+        if ((dest = get_dest(request, &all)) == NULL)
+        {
+          status = IPP_STATUS_ERROR_NOT_FOUND;
+        }
+        else
+        {
+          ippCopyAttributes(response, dest->attrs, /*quickcopy*/false, (ipp_copy_cb_t)filter_attr, ra);
+
+          if (!ra || cupsArrayFind(ra, "queued-job-count"))
+            ippAddInteger(response, IPP_TAG_PRINTER, IPP_TAG_INTEGER, "queued-job-count", (int)queued_jobs(dest));
+
+          status = IPP_STATUS_OK;
+        }
+        break;
+
+    case IPP_OP_GET_JOBS :
+        status = ipp_get_jobs(request, response, ra);
+        break;
+
+    case IPP_OP_GET_JOB_ATTRIBUTES :
+        if ((job = get_job(request)) == NULL)
+        {
+          status = IPP_STATUS_ERROR_NOT_FOUND;
+        }
+        else
+        {
+          add_job_attrs(response, job, ra);
+          status = IPP_STATUS_OK;
+        }
+        break;
+
+    case IPP_OP_PRINT_JOB :
+    case IPP_OP_CREATE_JOB :
+        status = ipp_create_job(request, response, ra, bytes);
+        break;
+
+    case IPP_OP_SEND_DOCUMENT :
+        if ((job = get_job(request)) == NULL)
+        {
+          status = IPP_STATUS_ERROR_NOT_FOUND;
+        }
+        else if (job->state > IPP_JSTATE_STOPPED)
+        {
+          status = IPP_STATUS_ERROR_NOT_POSSIBLE;
+        }
+        else
+        {
+          job->bytes += bytes;
+          add_job_attrs(response, job, ra);
+          status = IPP_STATUS_OK;
+        }
+        break;
+
+    case IPP_OP_CANCEL_JOB :
+        if ((job = get_job(request)) == NULL)
+        {
+          status = IPP_STATUS_ERROR_NOT_FOUND;
+        }
+        else if (job->state > IPP_JSTATE_STOPPED)
+        {
+          status = IPP_STATUS_ERROR_NOT_POSSIBLE;
+        }
+        else
+        {
+          job->state     = IPP_JSTATE_CANCELED;
+          job->completed = time(NULL);
+          status         = IPP_STATUS_OK;
+        }
+        break;
+
+    case IPP_OP_CANCEL_JOBS :
+    case IPP_OP_CANCEL_MY_JOBS :
+    case IPP_OP_PURGE_JOBS :
+        status = ipp_cancel_jobs(request, op);
+        break;
+
+    case IPP_OP_RESTART_JOB :
+        if ((job = get_job(request)) == NULL)
+        {
+          status = IPP_STATUS_ERROR_NOT_FOUND;
+        }
+        else
+        {
+          job->state     = IPP_JSTATE_PENDING;
+          job->completed = 0;
+          status         = IPP_STATUS_OK;
+        }
+        break;
+
+    case IPP_OP_SET_JOB_ATTRIBUTES :
+        status = get_job(request) ? IPP_STATUS_OK : IPP_STATUS_ERROR_NOT_FOUND;
+        break;
+
+    case IPP_OP_CUPS_MOVE_JOB :
+        {
+          const char	*uri;		// Target printer URI
+
+          if ((uri = ippGetString(ippFindAttribute(request, "job-printer-uri", IPP_TAG_URI), 0, NULL)) == NULL || (uri = strrchr(uri, '/')) == NULL || !find_dest(uri + 1))
+          {
+            status = IPP_STATUS_ERROR_NOT_FOUND;
+          }
+          else if ((job = get_job(request)) != NULL)
+          {
+            cupsCopyString(job->dest, uri + 1, sizeof(job->dest));
+            status = IPP_STATUS_OK;
+          }
+          else if ((dest = get_dest(request, &all)) != NULL)
+          {
+            size_t	i;		// Looping var
+
+            for (i = sched_num_jobs, job = sched_jobs; i > 0; i --, job ++)
+            {
+              if (job->state <= IPP_JSTATE_STOPPED && !strcasecmp(job->dest, dest->name))
+                cupsCopyString(job->dest, uri + 1, sizeof(job->dest));
+            }
+
+            status = IPP_STATUS_OK;
+          }
+          else
+          {
+            status = IPP_STATUS_ERROR_NOT_FOUND;
+          }
+        }
+        break;
+
+    case IPP_OP_PAUSE_PRINTER :
+    case IPP_OP_RESUME_PRINTER :
+    case IPP_OP_ENABLE_PRINTER :
+    case IPP_OP_CUPS_ACCEPT_JOBS :
+    case IPP_OP_CUPS_REJECT_JOBS :
+    case IPP_OP_HOLD_NEW_JOBS :
+    case IPP_OP_RELEASE_HELD_NEW_JOBS :
+    case IPP_OP_CUPS_SET_DEFAULT :
+        if ((dest = get_dest(request, &all)) == NULL)
+        {
+          status = IPP_STATUS_ERROR_NOT_FOUND;
+          break;
+        }
+
+        if (op == IPP_OP_PAUSE_PRINTER)
+        {
+          set_dest_state(dest, IPP_PSTATE_STOPPED, "paused");
+        }
+        else if (op == IPP_OP_RESUME_PRINTER || op == IPP_OP_ENABLE_PRINTER)
+        {
+          set_dest_state(dest, IPP_PSTATE_IDLE, "none");
+        }
+        else if (op == IPP_OP_CUPS_ACCEPT_JOBS || op == IPP_OP_CUPS_REJECT_JOBS)
+        {
+          ipp_attribute_t *attr = ippFindAttribute(dest->attrs, "printer-is-accepting-jobs", IPP_TAG_BOOLEAN);
+					// printer-is-accepting-jobs
+
+          ippSetBoolean(dest->attrs, &attr, 0, op == IPP_OP_CUPS_ACCEPT_JOBS);
+        }
+        else if (op == IPP_OP_CUPS_SET_DEFAULT)
+        {
+          cupsCopyString(sched_default, dest->name, sizeof(sched_default));
+        }
+
+        status = IPP_STATUS_OK;
+        break;
+
+    case IPP_OP_CUPS_ADD_MODIFY_CLASS :
+    case IPP_OP_CUPS_ADD_MODIFY_PRINTER :
+        status = ipp_add_modify_dest(request, op == IPP_OP_CUPS_ADD_MODIFY_CLASS);
+        break;
+
+    case IPP_OP_CUPS_DELETE_CLASS :
+    case IPP_OP_CUPS_DELETE_PRINTER :
+        if ((dest = get_dest(request, &all)) == NULL)
+        {
+          status = IPP_STATUS_ERROR_NOT_FOUND;
+        }
+        else
+        {
+          cupsArrayRemove(sched_dests, dest);
+          status = IPP_STATUS_OK;
+        }
+        break;
+
+    default :
+        status = IPP_STATUS_ERROR_OPERATION_NOT_SUPPORTED;
+        break;
+  }
+
+  cupsMutexUnlock(&sched_mutex);
+
+  cupsArrayDelete(ra);
+
+  ippSetStatusCode(response, status);
+
+  return (response);
+}
+
+
+//
+// 'queued_jobs()' - Count the pending jobs for a destination.
+//
+
+static size_t				// O - Number of jobs
+queued_jobs(sched_dest_t *dest)		// I - Destination
+{
+  size_t	i,			// Looping var
+		count = 0;		// Number of jobs
+  sched_job_t	*job;			// Current job
+
+
+  for (i = sched_num_jobs, job = sched_jobs; i > 0; i --, job ++)
+  {
+    if (job->state <= IPP_JSTATE_STOPPED && !strcasecmp(job->dest, dest->name))
+      count ++;
+  }
+
+  return (count);
+}
+
+
+//
+// 'respond_http()' - Send a HTTP response.
+//
+
+static bool				// O - `true` on success, `false` on error
+respond_http(http_t        *client,	// I - Client connection
+             http_state_t  hstate,	// I - HTTP request state
+             http_status_t hstatus,	// I - HTTP status
+             const char    *type,	// I - Content type or `NULL` for status text
+             const char    *data)	// I - Response data or `NULL` for status text
+{
+  size_t	length;			// Length of response data
+
+
+  if (!type || !data)
+  {
+    type = "text/plain";
+    data = httpStatusString(hstatus);
+  }
+
+  length = strlen(data);
+
+  httpSetField(client, HTTP_FIELD_CONTENT_TYPE, type);
+  httpSetLength(client, length);
+
+  if (!httpWriteResponse(client, hstatus))
+    return (false);
+
+  if (hstate != HTTP_STATE_HEAD && httpWrite(client, data, length) < 0)
+    return (false);
+
+  httpFlushWrite(client);
+
+  return (true);
+}
+
+
+//
+// 'set_dest_attr()' - Set or replace a printer attribute.
+//
+
+static void
+set_dest_attr(sched_dest_t    *dest,	// I - Destination
+              ipp_attribute_t *attr)	// I - New attribute
+{
+  ippDeleteAttribute(dest->attrs, ippFindAttribute(dest->attrs, ippGetName(attr), IPP_TAG_ZERO));
+  ippCopyAttribute(dest->attrs, attr, /*quickcopy*/false);
+}
+
+
+//
+// 'set_dest_state()' - Set the state of a printer or class.
+//
+
+static void
+set_dest_state(sched_dest_t *dest,	// I - Destination
+               ipp_pstate_t state,	// I - New state
+               const char   *reasons)	// I - New state reasons
+{
+  ipp_attribute_t	*attr;		// Current attribute
+
+
+  attr = ippFindAttribute(dest->attrs, "printer-state", IPP_TAG_ENUM);
+  ippSetInteger(dest->attrs, &attr, 0, (int)state);
+
+  attr = ippFindAttribute(dest->attrs, "printer-state-reasons", IPP_TAG_KEYWORD);
+  ippSetString(dest->attrs, &attr, 0, reasons);
+
+  attr = ippFindAttribute(dest->attrs, "printer-state-change-time", IPP_TAG_INTEGER);
+  ippSetInteger(dest->attrs, &attr, 0, (int)time(NULL));
+}
+
+
+//
+// 'stats_string()' - Format the statistics as JSON and reset them.
+//
+
+static void
+stats_string(char   *buffer,		// I - Buffer
+             size_t bufsize)		// I - Size of buffer
+{
+  size_t	i, j;			// Looping vars
+  char		*bufptr,		// Pointer into buffer
+		*bufend;		// End of buffer
+  const char	*prefix = "";		// Prefix for next operation
+
+
+  // The connection asking for the statistics is not counted...
+  cupsMutexLock(&sched_mutex);
+
+  snprintf(buffer, bufsize, "{\"connections\":%u,\"max-active-connections\":%u,\"requests\":%u,\"document-bytes\":%lu,\"response-bytes\":%lu,\"operations\":{", (unsigned)(stats_connections - 1), (unsigned)(stats_max_active - 1), (unsigned)stats_requests, (unsigned long)stats_bytes, (unsigned long)stats_response_bytes);
+
+  bufptr = buffer + strlen(buffer);
+  bufend = buffer + bufsize - 2;
+
+  for (i = 0; i < 2; i ++)
+  {
+    for (j = 0; j < 128 && bufptr < bufend; j ++)
+    {
+      if (!stats_ops[i][j])
+        continue;
+
+      snprintf(bufptr, (size_t)(bufend - bufptr), "%s\"%s\":%u", prefix, ippOpString((ipp_op_t)((i ? 0x4000 : 0) | j)), (unsigned)stats_ops[i][j]);
+      bufptr += strlen(bufptr);
+      prefix = ",";
+    }
+  }
+
+  cupsCopyString(bufptr, "}}", (size_t)(buffer + bufsize - bufptr));
+
+  // Reset the counters, counting the other active connections as new...
+  stats_connections    = stats_max_active = stats_active - 1;
+  stats_requests       = 0;
+  stats_bytes          = 0;
+  stats_response_bytes = 0;
+
+  memset(stats_ops, 0, sizeof(stats_ops));
+
+  cupsMutexUnlock(&sched_mutex);
+}
+
+
+//
+// 'usage()' - Show program usage and exit.
+//
+
+static void
+usage(void)
+{
+  puts("Usage: ./testsched [options]");
+  puts("Options:");
+  puts("-c CLASSES              Number of classes (default 2)");
+  puts("-d MSEC                 Delay for each IPP response (default 0)");
+  puts("-j JOBS                 Number of jobs (default 100)");
+  puts("-P PORT                 Port number (default 8631)");
+  puts("-p PRINTERS             Number of printers (default 10)");
+
+  exit(1);
+}
@@ -0,0 +1,1225 @@
+//
+// Job list dashboard for the CUPS commands.
+//
+// Copyright © 2026 by OpenPrinting.
+//
+// Licensed under Apache License v2.0.  See the file "LICENSE" for more
+// information.
+//
+// `watch_new` takes the Get-Jobs (or Get-Job-Attributes) request of a job
+// listing, and each call to `watch_update` brings a table of the listed jobs,
+// keyed by job ID, up to date and reports how many jobs were added, finished,
+// changed state, or moved in the list since the previous update.
+//
+// The first update loads every job.  The watch then subscribes to the job and
+// printer events of the listed destination, and later updates pull the new
+// events with Get-Notifications and load only the jobs they name, so an update
+// without events costs a single small request.  When events are lost, the
+// subscription goes away, or the server does not support subscriptions, all
+// jobs are loaded again.
+//
+// The command draws the list with `watch_printf` and `watch_flush`, which
+// compare the new lines with those on the terminal and only rewrite the lines
+// that changed.
+//
+
+#include "watch.h"
+#include "pool.h"
+#include "stream.h"
+#include <signal.h>
+#include <sys/ioctl.h>
+
+
+//
+// Local constants...
+//
+
+#define WATCH_LINE	1024		// Maximum length of a line
+#define WATCH_NEW	((size_t)-1)	// Position of a new job
+
+
+//
+// Local types...
+//
+
+typedef struct watch_job_s		// Listed job
+{
+  int		id,			// Job ID
+		priority;		// Job priority
+  ipp_jstate_t	state,			// Job state
+		prev_state;		// Job state at the previous update
+  size_t	prev_index;		// Position at the previous update or `WATCH_NEW`
+  bool		seen;			// Seen while loading all jobs?
+  ipp_t		*attrs;			// Job attributes
+} watch_job_t;
+
+struct watch_s				// Job list dashboard
+{
+  http_t	*http;			// Connection to server
+  ipp_t		*request;		// Request for the job list
+  const char	*printer_uri,		// Printer or server URI
+		*dest,			// Destination name or `NULL` for all
+		*user,			// Requesting user name
+		*which;			// Which jobs are listed
+  bool		my_jobs;		// Only list the user's jobs?
+  int		job_id;			// Only list this job or `0` for all
+  ipp_status_t	status;			// Status of last update
+  char		*message;		// Status message
+  bool		loaded,			// Jobs loaded?
+		can_subscribe;		// Subscriptions supported?
+  int		sub_id,			// Subscription ID
+		seq;			// Next event sequence number
+  time_t	renew_time;		// Time to renew the subscription
+  cups_array_t	*jobs;			// Jobs, by job ID
+  size_t	num_order,		// Number of listed jobs
+		alloc_order;		// Allocated listed jobs
+  watch_job_t	**order;		// Jobs in list order
+  int		rows,			// Terminal rows
+		columns;		// Terminal columns
+  bool		full;			// Clear the terminal for the next frame?
+  size_t	num_lines,		// Number of lines on the terminal
+		alloc_lines,		// Allocated lines on the terminal
+		num_next,		// Number of lines in the next frame
+		alloc_next;		// Allocated lines in the next frame
+  char		**lines,		// Lines on the terminal
+		**next;			// Lines in the next frame
+};
+
+
+//
+// Local globals...
+//
+
+static volatile sig_atomic_t watch_stop = 0;
+					// Stop watching?
+
+static const char * const watch_events[] =
+{					// Events to subscribe to
+  "job-config-changed",
+  "job-state-changed",
+  "printer-state-changed",
+  "server-restarted"
+};
+
+
+//
+// Local functions...
+//
+
+static void	watch_add_groups(watch_t *watch, ipp_t *response, watch_diff_t *diff);
+static int	watch_compare_ids(watch_job_t *a, watch_job_t *b, void *data);
+static int	watch_compare_order(watch_job_t **a, watch_job_t **b);
+static bool	watch_copy_attr(void *data, ipp_t *dst, ipp_attribute_t *attr);
+static void	watch_free_job(watch_job_t *job, void *data);
+static bool	watch_get_events(watch_t *watch, int *ids, size_t *num_ids, watch_diff_t *diff, bool *reload);
+static bool	watch_get_size(watch_t *watch);
+static bool	watch_load_all(watch_t *watch, watch_diff_t *diff);
+static bool	watch_load_jobs(watch_t *watch, int *ids, size_t num_ids, watch_diff_t *diff);
+static bool	watch_match(watch_t *watch, ipp_t *attrs, int id, ipp_jstate_t state);
+static void	watch_remove_job(watch_t *watch, watch_job_t *job, watch_diff_t *diff);
+static bool	watch_renew(watch_t *watch);
+static void	watch_set_job(watch_t *watch, ipp_t *attrs, watch_diff_t *diff);
+static void	watch_set_status(watch_t *watch, ipp_status_t status, const char *message);
+static void	watch_signal(int sig);
+static void	watch_sort(watch_t *watch, watch_diff_t *diff);
+static int	watch_subscribe(watch_t *watch);
+
+
+//
+// 'watch_delete()' - Stop watching a job list.
+//
+// The subscription is cancelled and the cursor is moved below the list.
+//
+
+void
+watch_delete(watch_t *watch)		// I - Job list dashboard
+{
+  size_t	i;			// Looping var
+  ipp_t		*request;		// IPP request
+
+
+  if (!watch)
+    return;
+
+  if (watch->sub_id)
+  {
+    request = ippNewRequest(IPP_OP_CANCEL_SUBSCRIPTION);
+
+    ippAddString(request, IPP_TAG_OPERATION, IPP_TAG_URI, "printer-uri", NULL, "ipp://localhost/");
+    ippAddInteger(request, IPP_TAG_OPERATION, IPP_TAG_INTEGER, "notify-subscription-id", watch->sub_id);
+    ippAddString(request, IPP_TAG_OPERATION, IPP_TAG_NAME, "requesting-user-name", NULL, watch->user);
+
+    ippDelete(cupsDoRequest(watch->http, request, "/"));
+  }
+
+  // Show the cursor again after the list...
+  i = watch->num_lines < (size_t)(watch->rows - 1) ? watch->num_lines : (size_t)(watch->rows - 1);
+
+  printf("\033[%d;1H\033[?25h", (int)i + 1);
+  fflush(stdout);
+
+  signal(SIGINT, SIG_DFL);
+  signal(SIGTERM, SIG_DFL);
+  signal(SIGWINCH, SIG_DFL);
+
+  for (i = 0; i < watch->num_lines; i ++)
+    free(watch->lines[i]);
+  for (i = 0; i < watch->num_next; i ++)
+    free(watch->next[i]);
+
+  cupsArrayDelete(watch->jobs);
+  ippDelete(watch->request);
+
+  free(watch->lines);
+  free(watch->next);
+  free(watch->order);
+  free(watch->message);
+  free(watch);
+}
+
+
+//
+// 'watch_flush()' - Draw the lines added with `watch_printf`.
+//
+// Only the lines that differ from those on the terminal are written.  Lines
+// that do not fit on the terminal are not shown.
+//
+
+void
+watch_flush(watch_t *watch)		// I - Job list dashboard
+{
+  size_t	i,			// Looping var
+		max_lines,		// Maximum number of lines shown
+		num_lines;		// Number of lines on the terminal
+  int		row = -1;		// Current cursor row
+  char		**lines;		// Lines on the terminal
+
+
+  if (!watch)
+    return;
+
+  // Keep the last row free so that the terminal never scrolls...
+  max_lines = watch->rows > 1 ? (size_t)(watch->rows - 1) : 1;
+
+  if (watch->full)
+  {
+    fputs("\033[H\033[2J", stdout);
+    num_lines   = 0;
+    watch->full = false;
+  }
+  else
+  {
+    num_lines = watch->num_lines < max_lines ? watch->num_lines : max_lines;
+  }
+
+  for (i = 0; i < watch->num_next && i < max_lines; i ++)
+  {
+    if (i < num_lines && !strcmp(watch->lines[i], watch->next[i]))
+      continue;
+
+    // Move to the start of the line, using CR LF for the next line...
+    if (row >= 0 && (size_t)row + 1 == i)
+      fputs("\r\n", stdout);
+    else
+      printf("\033[%d;1H", (int)i + 1);
+
+    fputs(watch->next[i], stdout);
+
+    if (i < num_lines)
+      fputs("\033[K", stdout);
+
+    row = (int)i;
+  }
+
+  if (i < num_lines)
+  {
+    // Clear the lines that are no longer used...
+    printf("\033[%d;1H\033[J", (int)i + 1);
+  }
+
+  fflush(stdout);
+
+  // The new lines are now on the terminal...
+  for (i = 0; i < watch->num_lines; i ++)
+    free(watch->lines[i]);
+
+  lines              = watch->lines;
+  watch->lines       = watch->next;
+  watch->next        = lines;
+  watch->num_lines   = watch->num_next;
+  watch->num_next    = 0;
+
+  i                  = watch->alloc_lines;
+  watch->alloc_lines = watch->alloc_next;
+  watch->alloc_next  = i;
+}
+
+
+//
+// 'watch_get_count()' - Get the number of listed jobs.
+//
+
+size_t					// O - Number of jobs
+watch_get_count(watch_t *watch)		// I - Job list dashboard
+{
+  return (watch ? watch->num_order : 0);
+}
+
+
+//
+// 'watch_get_job()' - Get the attributes of a listed job.
+//
+// Jobs are listed in scheduling order: active jobs by priority and job ID,
+// then the other jobs by job ID.
+//
+
+ipp_t *					// O - Job attributes or `NULL`
+watch_get_job(watch_t *watch,		// I - Job list dashboard
+              size_t  n)		// I - Job number (`0`-based)
+{
+  if (!watch || n >= watch->num_order)
+    return (NULL);
+
+  return (watch->order[n]->attrs);
+}
+
+
+//
+// 'watch_get_status()' - Get the status of the last update.
+//
+
+ipp_status_t				// O - IPP status
+watch_get_status(watch_t *watch)	// I - Job list dashboard
+{
+  return (watch ? watch->status : IPP_STATUS_ERROR_INTERNAL);
+}
+
+
+//
+// 'watch_get_status_message()' - Get the status message of the last update.
+//
+
+const char *				// O - Status message
+watch_get_status_message(
+    watch_t *watch)			// I - Job list dashboard
+{
+  if (!watch)
+    return (ippErrorString(IPP_STATUS_ERROR_INTERNAL));
+  else if (watch->message)
+    return (watch->message);
+  else
+    return (ippErrorString(watch->status));
+}
+
+
+//
+// 'watch_new()' - Start watching a job list on the terminal.
+//
+// The request is a Get-Jobs or Get-Job-Attributes request and is freed by
+// `watch_delete`.  The attributes needed to sort and filter the jobs are added
+// to the requested attributes.  Interrupts stop the next call to
+// `watch_update`.
+//
+
+watch_t *				// O - Job list dashboard or `NULL` on error
+watch_new(http_t *http,			// I - Connection to server
+          ipp_t  *request)		// I - IPP request for the job list
+{
+  watch_t	*watch;			// Job list dashboard
+  ipp_attribute_t *attr;		// Requested attributes
+  const char	*uri,			// Job or printer URI
+		*ptr;			// Pointer into URI
+  size_t	i,			// Looping var
+		num_required = 0;	// Number of required attributes
+  const char	*required[5];		// Attributes needed for the list
+
+
+  if ((watch = (watch_t *)calloc(1, sizeof(watch_t))) == NULL)
+  {
+    ippDelete(request);
+    return (NULL);
+  }
+
+  watch->http          = http;
+  watch->request       = request;
+  watch->status        = IPP_STATUS_OK;
+  watch->can_subscribe = true;
+  watch->full          = true;
+  watch->jobs          = cupsArrayNew((cups_array_cb_t)watch_compare_ids, NULL, NULL, 0, NULL, (cups_afree_cb_t)watch_free_job);
+
+  // Get the jobs to list from the request...
+  if (ippGetOperation(request) == IPP_OP_GET_JOB_ATTRIBUTES)
+  {
+    watch->printer_uri = "ipp://localhost/";
+
+    if ((uri = ippGetString(ippFindAttribute(request, "job-uri", IPP_TAG_URI), 0, NULL)) != NULL && (ptr = strrchr(uri, '/')) != NULL)
+      watch->job_id = atoi(ptr + 1);
+  }
+  else if ((watch->printer_uri = ippGetString(ippFindAttribute(request, "printer-uri", IPP_TAG_URI), 0, NULL)) == NULL)
+  {
+    watch->printer_uri = "ipp://localhost/";
+  }
+  else if ((ptr = strrchr(watch->printer_uri, '/')) != NULL && ptr[1])
+  {
+    watch->dest = ptr + 1;
+  }
+
+  if ((watch->user = ippGetString(ippFindAttribute(request, "requesting-user-name", IPP_TAG_NAME), 0, NULL)) == NULL)
+    watch->user = cupsGetUser();
+
+  if ((watch->which = ippGetString(ippFindAttribute(request, "which-jobs", IPP_TAG_KEYWORD), 0, NULL)) == NULL)
+    watch->which = "not-completed";
+
+  watch->my_jobs = ippGetBoolean(ippFindAttribute(request, "my-jobs", IPP_TAG_BOOLEAN), 0);
+
+  if ((attr = ippFindAttribute(request, "requested-attributes", IPP_TAG_KEYWORD)) != NULL)
+  {
+    required[num_required ++] = "job-id";
+    required[num_required ++] = "job-priority";
+    required[num_required ++] = "job-state";
+
+    if (watch->my_jobs)
+      required[num_required ++] = "job-originating-user-name";
+    if (watch->dest)
+      required[num_required ++] = "job-printer-uri";
+
+    for (i = 0; i < num_required; i ++)
+    {
+      if (!ippContainsString(attr, required[i]))
+        ippSetString(request, &attr, ippGetCount(attr), required[i]);
+    }
+  }
+
+  watch_get_size(watch);
+
+  signal(SIGINT, watch_signal);
+  signal(SIGTERM, watch_signal);
+  signal(SIGWINCH, watch_signal);
+
+  // Hide the cursor while the list is shown...
+  fputs("\033[?25l", stdout);
+
+  return (watch);
+}
+
+
+//
+// 'watch_printf()' - Add a line to the next frame.
+//
+// The message is localized and formatted.  Tabs are expanded, control
+// characters are replaced, and the line is cut at the width of the terminal.
+// Each newline starts another line.  If `watch` is `NULL`, the message is
+// written to the standard output instead.
+//
+
+void
+watch_printf(watch_t    *watch,		// I - Job list dashboard or `NULL`
+             const char *message,	// I - Printf-style message
+             ...)			// I - Additional arguments as needed
+{
+  va_list	ap;			// Pointer to arguments
+  char		buffer[WATCH_LINE],	// Formatted message
+		line[WATCH_LINE],	// Line for terminal
+		*start,			// Start of line in message
+		*end,			// End of line in message
+		*ptr,			// Pointer into message
+		*lineptr,		// Pointer into line
+		**next;			// New lines
+  int		column;			// Current column
+
+
+  va_start(ap, message);
+  vsnprintf(buffer, sizeof(buffer), cupsLangGetString(cupsLangDefault(), message), ap);
+  va_end(ap);
+
+  if (!watch)
+  {
+    cupsLangPrintf(stdout, "%s", buffer);
+    return;
+  }
+
+  for (start = buffer; start; start = *end ? end + 1 : NULL)
+  {
+    if ((end = strchr(start, '\n')) == NULL)
+      end = start + strlen(start);
+
+    for (ptr = start, lineptr = line, column = 0; ptr < end && lineptr < (line + sizeof(line) - 9); ptr ++)
+    {
+      if ((*ptr & 0xc0) == 0x80)
+      {
+        // Continuation of a UTF-8 character...
+        *lineptr++ = *ptr;
+        continue;
+      }
+      else if (column >= watch->columns)
+      {
+        break;
+      }
+      else if (*ptr == '\t')
+      {
+        do
+        {
+          *lineptr++ = ' ';
+          column ++;
+        }
+        while ((column & 7) && column < watch->columns);
+      }
+      else
+      {
+        *lineptr++ = (*ptr & 255) < ' ' || *ptr == 0x7f ? '?' : *ptr;
+        column ++;
+      }
+    }
+
+    *lineptr = '\0';
+
+    if (watch->num_next >= watch->alloc_next)
+    {
+      if ((next = realloc(watch->next, (watch->alloc_next + 32) * sizeof(char *))) == NULL)
+        return;
+
+      watch->next       = next;
+      watch->alloc_next += 32;
+    }
+
+    if ((watch->next[watch->num_next] = strdup(line)) != NULL)
+      watch->num_next ++;
+  }
+}
+
+
+//
+// 'watch_update()' - Wait for the next update and bring the jobs up to date.
+//
+// The first update does not wait.  `false` is returned when watching was
+// interrupted or the jobs could not be loaded, see `watch_get_status`.
+//
+
+bool					// O - `true` on success, `false` to stop
+watch_update(watch_t      *watch,	// I - Job list dashboard
+             int          interval,	// I - Update interval in seconds
+             watch_diff_t *diff)	// O - Changes to the list
+{
+  size_t	i;			// Looping var
+  int		ids[WATCH_MAX_CHANGES];	// Changed jobs
+  size_t	num_ids = 0;		// Number of changed jobs
+  bool		reload,			// Load all jobs?
+		ret;			// Return value
+
+
+  memset(diff, 0, sizeof(watch_diff_t));
+
+  if (!watch)
+    return (false);
+
+  if (watch->loaded && interval > 0 && !watch_stop)
+    sleep((unsigned)interval);
+
+  if (watch_stop)
+    return (false);
+
+  if (watch_get_size(watch))
+    diff->redraw = true;
+
+  // Remember where each job was listed...
+  for (i = 0; i < watch->num_order; i ++)
+  {
+    watch->order[i]->prev_index = i;
+    watch->order[i]->prev_state = watch->order[i]->state;
+  }
+
+  // Find out which jobs changed...
+  reload = !watch->loaded;
+
+  if (watch->sub_id)
+  {
+    if ((time(NULL) >= watch->renew_time && !watch_renew(watch)) || !watch_get_events(watch, ids, &num_ids, diff, &reload))
+      watch->sub_id = 0;
+  }
+
+  if (!watch->sub_id)
+  {
+    // Subscribe before loading so that no changes are missed...
+    if (watch->can_subscribe && (watch->sub_id = watch_subscribe(watch)) == 0)
+      watch->can_subscribe = false;
+
+    reload = true;
+  }
+
+  // Load them...
+  if (reload)
+    ret = watch_load_all(watch, diff);
+  else
+    ret = watch_load_jobs(watch, ids, num_ids, diff);
+
+  if (!ret)
+    return (false);
+
+  watch->loaded = true;
+
+  watch_sort(watch, diff);
+
+  return (true);
+}
+
+
+//
+// 'watch_add_groups()' - Add or update the jobs in a response.
+//
+
+static void
+watch_add_groups(watch_t      *watch,	// I - Job list dashboard
+                 ipp_t        *response,// I - IPP response
+                 watch_diff_t *diff)	// I - Changes to the list
+{
+  ipp_attribute_t *attr;		// Current attribute
+  ipp_t		*attrs = NULL;		// Job attributes
+
+
+  for (attr = ippGetFirstAttribute(response); attr; attr = ippGetNextAttribute(response))
+  {
+    if (ippGetGroupTag(attr) != IPP_TAG_JOB || !ippGetName(attr))
+    {
+      // End of a job...
+      if (attrs)
+      {
+        watch_set_job(watch, attrs, diff);
+        attrs = NULL;
+      }
+
+      continue;
+    }
+
+    if (!attrs)
+      attrs = ippNew();
+
+    ippCopyAttribute(attrs, attr, /*quickcopy*/false);
+  }
+
+  if (attrs)
+    watch_set_job(watch, attrs, diff);
+}
+
+
+//
+// 'watch_compare_ids()' - Compare the IDs of two jobs.
+//
+
+static int				// O - Result of comparison
+watch_compare_ids(watch_job_t *a,	// I - First job
+                  watch_job_t *b,	// I - Second job
+                  void        *data)	// I - Callback data (unused)
+{
+  (void)data;
+
+  return (a->id - b->id);
+}
+
+
+//
+// 'watch_compare_order()' - Compare two jobs in list order.
+//
+// Like the scheduler, active jobs are ordered by priority and then by job ID
+// and come before the other jobs, which are ordered by job ID.
+//
+
+static int				// O - Result of comparison
+watch_compare_order(watch_job_t **a,	// I - First job
+                    watch_job_t **b)	// I - Second job
+{
+  bool	a_active = (*a)->state <= IPP_JSTATE_STOPPED,
+					// First job active?
+	b_active = (*b)->state <= IPP_JSTATE_STOPPED;
+					// Second job active?
+
+
+  if (a_active != b_active)
+    return (a_active ? -1 : 1);
+  else if (a_active && (*a)->priority != (*b)->priority)
+    return ((*b)->priority - (*a)->priority);
+  else
+    return ((*a)->id - (*b)->id);
+}
+
+
+//
+// 'watch_copy_attr()' - Copy the operation attributes of the job list request.
+//
+
+static bool				// O - `true` to copy, `false` to skip
+watch_copy_attr(void            *data,	// I - Callback data (unused)
+                ipp_t           *dst,	// I - Destination (unused)
+                ipp_attribute_t *attr)	// I - Attribute
+{
+  const char	*name = ippGetName(attr);
+					// Attribute name
+
+
+  (void)data;
+  (void)dst;
+
+  return (ippGetGroupTag(attr) == IPP_TAG_OPERATION && name && strcmp(name, "attributes-charset") && strcmp(name, "attributes-natural-language"));
+}
+
+
+//
+// 'watch_free_job()' - Free a job.
+//
+
+static void
+watch_free_job(watch_job_t *job,	// I - Job
+               void        *data)	// I - Callback data (unused)
+{
+  (void)data;
+
+  ippDelete(job->attrs);
+  free(job);
+}
+
+
+//
+// 'watch_get_events()' - Get the jobs named by new events.
+//
+// `false` is returned when the subscription is gone.
+//
+
+static bool				// O - `true` on success, `false` on error
+watch_get_events(watch_t      *watch,	// I - Job list dashboard
+                 int          *ids,	// I - Changed jobs
+                 size_t       *num_ids,	// IO - Number of changed jobs
+                 watch_diff_t *diff,	// I - Changes to the list
+                 bool         *reload)	// IO - Load all jobs?
+{
+  size_t	i;			// Looping var
+  ipp_t		*request,		// IPP request
+		*response;		// IPP response
+  ipp_attribute_t *attr;		// Current attribute
+  const char	*aname,			// Attribute name
+		*event = NULL;		// Event name
+  int		event_seq = 0,		// Event sequence number
+		id = 0;			// Job ID
+
+
+  request = ippNewRequest(IPP_OP_GET_NOTIFICATIONS);
+
+  ippAddString(request, IPP_TAG_OPERATION, IPP_TAG_URI, "printer-uri", NULL, "ipp://localhost/");
+  ippAddString(request, IPP_TAG_OPERATION, IPP_TAG_NAME, "requesting-user-name", NULL, watch->user);
+  ippAddInteger(request, IPP_TAG_OPERATION, IPP_TAG_INTEGER, "notify-subscription-ids", watch->sub_id);
+  ippAddInteger(request, IPP_TAG_OPERATION, IPP_TAG_INTEGER, "notify-sequence-numbers", watch->seq);
+
+  response = cupsDoRequest(watch->http, request, "/");
+
+  if (cupsLastError() > IPP_STATUS_OK_CONFLICTING)
+  {
+    ippDelete(response);
+    return (false);
+  }
+
+  for (attr = ippGetFirstAttribute(response);; attr = ippGetNextAttribute(response))
+  {
+    if (attr && ippGetGroupTag(attr) == IPP_TAG_EVENT_NOTIFICATION && (aname = ippGetName(attr)) != NULL)
+    {
+      if (!strcmp(aname, "notify-sequence-number"))
+        event_seq = ippGetInteger(attr, 0);
+      else if (!strcmp(aname, "notify-subscribed-event"))
+        event = ippGetString(attr, 0, NULL);
+      else if (!strcmp(aname, "notify-job-id"))
+        id = ippGetInteger(attr, 0);
+      continue;
+    }
+
+    // End of an event, skipping any we have already seen...
+    if (event && event_seq >= watch->seq)
+    {
+      // Events before this one were lost if there is a gap...
+      if (event_seq > watch->seq || !strcmp(event, "server-restarted"))
+        *reload = true;
+
+      watch->seq = event_seq + 1;
+
+      if (!strncmp(event, "printer-", 8))
+      {
+        diff->printers = true;
+        diff->redraw   = true;
+      }
+      else if (id > 0)
+      {
+        for (i = 0; i < *num_ids; i ++)
+        {
+          if (ids[i] == id)
+            break;
+        }
+
+        if (i == *num_ids)
+        {
+          if (*num_ids < WATCH_MAX_CHANGES)
+            ids[(*num_ids) ++] = id;
+          else
+            *reload = true;
+        }
+      }
+    }
+
+    event     = NULL;
+    event_seq = 0;
+    id        = 0;
+
+    if (!attr)
+      break;
+  }
+
+  ippDelete(response);
+
+  return (true);
+}
+
+
+//
+// 'watch_get_size()' - Get the size of the terminal.
+//
+
+static bool				// O - `true` if the size changed
+watch_get_size(watch_t *watch)		// I - Job list dashboard
+{
+  struct winsize size;			// Terminal size
+  int		rows = 24,		// Terminal rows
+		columns = 80;		// Terminal columns
+
+
+  if (!ioctl(1, TIOCGWINSZ, &size) && size.ws_row > 0 && size.ws_col > 0)
+  {
+    rows    = size.ws_row;
+    columns = size.ws_col;
+  }
+
+  if (rows == watch->rows && columns == watch->columns)
+    return (false);
+
+  // Draw everything again at the new size...
+  watch->rows    = rows;
+  watch->columns = columns;
+  watch->full    = true;
+
+  return (true);
+}
+
+
+//
+// 'watch_load_all()' - Load all jobs.
+//
+
+static bool				// O - `true` on success, `false` on error
+watch_load_all(watch_t      *watch,	// I - Job list dashboard
+               watch_diff_t *diff)	// I - Changes to the list
+{
+  ipp_t		*request,		// IPP request
+		*group;			// Current group
+  stream_t	*stream;		// Streaming response
+  ipp_status_t	status;			// IPP status
+  watch_job_t	*job;			// Current job
+
+
+  request = ippNewRequest(ippGetOperation(watch->request));
+
+  ippCopyAttributes(request, watch->request, /*quickcopy*/false, (ipp_copy_cb_t)watch_copy_attr, NULL);
+
+  stream = stream_open(watch->http, request, "/");
+
+  if ((status = stream_get_status(stream)) <= IPP_STATUS_OK_CONFLICTING)
+  {
+    for (job = (watch_job_t *)cupsArrayGetFirst(watch->jobs); job; job = (watch_job_t *)cupsArrayGetNext(watch->jobs))
+      job->seen = false;
+
+    while ((group = stream_next(stream)) != NULL)
+      watch_add_groups(watch, group, diff);
+
+    status = stream_get_status(stream);
+  }
+
+  if (status > IPP_STATUS_OK_CONFLICTING && status != IPP_STATUS_ERROR_NOT_FOUND)
+  {
+    watch_set_status(watch, status, stream_get_status_message(stream));
+    stream_close(stream);
+    return (false);
+  }
+
+  stream_close(stream);
+
+  // Remove the jobs that are no longer listed...
+  for (job = (watch_job_t *)cupsArrayGetFirst(watch->jobs); job; job = (watch_job_t *)cupsArrayGetNext(watch->jobs))
+  {
+    if (!job->seen || status == IPP_STATUS_ERROR_NOT_FOUND)
+      watch_remove_job(watch, job, diff);
+  }
+
+  watch_set_status(watch, IPP_STATUS_OK, NULL);
+
+  return (true);
+}
+
+
+//
+// 'watch_load_jobs()' - Load the jobs that changed.
+//
+
+static bool				// O - `true` on success, `false` on error
+watch_load_jobs(watch_t      *watch,	// I - Job list dashboard
+                int          *ids,	// I - Changed jobs
+                size_t       num_ids,	// I - Number of changed jobs
+                watch_diff_t *diff)	// I - Changes to the list
+{
+  size_t	i;			// Looping var
+  pool_t	*pool;			// Request pool
+  ipp_t		*request;		// IPP request
+  ipp_status_t	status;			// IPP status
+  watch_job_t	key,			// Search key
+		*job;			// Job
+  char		uri[1024];		// Job URI
+
+
+  if (num_ids == 0)
+    return (true);
+
+  if ((pool = pool_new(POOL_MAX_CONNECTIONS)) == NULL)
+  {
+    watch_set_status(watch, IPP_STATUS_ERROR_INTERNAL, strerror(errno));
+    return (false);
+  }
+
+  for (i = 0; i < num_ids; i ++)
+  {
+    // Build a Get-Job-Attributes request, which requires the following
+    // attributes:
+    //
+    //   attributes-charset
+    //   attributes-natural-language
+    //   job-uri
+    //   requested-attributes
+    //   requesting-user-name
+    request = ippNewRequest(IPP_OP_GET_JOB_ATTRIBUTES);
+
+    httpAssembleURIf(HTTP_URI_CODING_ALL, uri, sizeof(uri), "ipp", NULL, "localhost", 0, "/jobs/%d", ids[i]);
+    ippAddString(request, IPP_TAG_OPERATION, IPP_TAG_URI, "job-uri", NULL, uri);
+    ippAddString(request, IPP_TAG_OPERATION, IPP_TAG_NAME, "requesting-user-name", NULL, watch->user);
+    ippCopyAttribute(request, ippFindAttribute(watch->request, "requested-attributes", IPP_TAG_KEYWORD), /*quickcopy*/false);
+
+    pool_add_request(pool, request, "/");
+  }
+
+  pool_run(pool);
+
+  for (i = 0; i < num_ids; i ++)
+  {
+    status = pool_get_status(pool, i);
+
+    if (status <= IPP_STATUS_OK_CONFLICTING)
+    {
+      watch_add_groups(watch, pool_get_response(pool, i), diff);
+    }
+    else if (status == IPP_STATUS_ERROR_NOT_FOUND || status == IPP_STATUS_ERROR_FORBIDDEN || status == IPP_STATUS_ERROR_NOT_AUTHORIZED)
+    {
+      // Job was purged or cannot be seen...
+      key.id = ids[i];
+
+      if ((job = (watch_job_t *)cupsArrayFind(watch->jobs, &key)) != NULL)
+        watch_remove_job(watch, job, diff);
+    }
+    else
+    {
+      watch_set_status(watch, status, pool_get_status_message(pool, i));
+      pool_delete(pool);
+      return (false);
+    }
+  }
+
+  pool_delete(pool);
+
+  watch_set_status(watch, IPP_STATUS_OK, NULL);
+
+  return (true);
+}
+
+
+//
+// 'watch_match()' - Check whether a job belongs in the list.
+//
+
+static bool				// O - `true` if listed, `false` otherwise
+watch_match(watch_t      *watch,	// I - Job list dashboard
+            ipp_t        *attrs,	// I - Job attributes
+            int          id,		// I - Job ID
+            ipp_jstate_t state)		// I - Job state
+{
+  const char	*value;			// Attribute value
+
+
+  if (watch->job_id && id != watch->job_id)
+    return (false);
+
+  if (watch->my_jobs && ((value = ippGetString(ippFindAttribute(attrs, "job-originating-user-name", IPP_TAG_NAME), 0, NULL)) == NULL || strcmp(value, watch->user)))
+    return (false);
+
+  if (watch->dest && ((value = ippGetString(ippFindAttribute(attrs, "job-printer-uri", IPP_TAG_URI), 0, NULL)) == NULL || (value = strrchr(value, '/')) == NULL || strcasecmp(value + 1, watch->dest)))
+    return (false);
+
+  if (!strcmp(watch->which, "all"))
+    return (true);
+  else if (!strcmp(watch->which, "completed"))
+    return (state >= IPP_JSTATE_CANCELED);
+  else if (!strcmp(watch->which, "aborted"))
+    return (state == IPP_JSTATE_ABORTED);
+  else if (!strcmp(watch->which, "canceled"))
+    return (state == IPP_JSTATE_CANCELED);
+  else if (!strcmp(watch->which, "pending"))
+    return (state == IPP_JSTATE_PENDING);
+  else if (!strcmp(watch->which, "pending-held"))
+    return (state == IPP_JSTATE_HELD);
+  else if (!strcmp(watch->which, "processing"))
+    return (state == IPP_JSTATE_PROCESSING);
+  else if (!strcmp(watch->which, "processing-stopped"))
+    return (state == IPP_JSTATE_STOPPED);
+  else
+    return (state <= IPP_JSTATE_STOPPED);
+}
+
+
+//
+// 'watch_remove_job()' - Remove a job from the list.
+//
+
+static void
+watch_remove_job(watch_t      *watch,	// I - Job list dashboard
+                 watch_job_t  *job,	// I - Job
+                 watch_diff_t *diff)	// I - Changes to the list
+{
+  if (job->prev_index != WATCH_NEW)
+    diff->finished ++;
+
+  diff->redraw = true;
+
+  cupsArrayRemove(watch->jobs, job);
+}
+
+
+//
+// 'watch_renew()' - Renew the subscription.
+//
+
+static bool				// O - `true` on success, `false` on error
+watch_renew(watch_t *watch)		// I - Job list dashboard
+{
+  ipp_t		*request;		// IPP request
+
+
+  request = ippNewRequest(IPP_OP_RENEW_SUBSCRIPTION);
+
+  ippAddString(request, IPP_TAG_OPERATION, IPP_TAG_URI, "printer-uri", NULL, "ipp://localhost/");
+  ippAddInteger(request, IPP_TAG_OPERATION, IPP_TAG_INTEGER, "notify-subscription-id", watch->sub_id);
+  ippAddString(request, IPP_TAG_OPERATION, IPP_TAG_NAME, "requesting-user-name", NULL, watch->user);
+  ippAddInteger(request, IPP_TAG_SUBSCRIPTION, IPP_TAG_INTEGER, "notify-lease-duration", WATCH_LEASE);
+
+  ippDelete(cupsDoRequest(watch->http, request, "/"));
+
+  if (cupsLastError() > IPP_STATUS_OK_CONFLICTING)
+    return (false);
+
+  watch->renew_time = time(NULL) + WATCH_LEASE / 2;
+
+  return (true);
+}
+
+
+//
+// 'watch_set_job()' - Add, update, or remove a job.
+//
+// The job attributes are freed or kept by the job.
+//
+
+static void
+watch_set_job(watch_t      *watch,	// I - Job list dashboard
+              ipp_t        *attrs,	// I - Job attributes
+              watch_diff_t *diff)	// I - Changes to the list
+{
+  watch_job_t	key,			// Search key
+		*job;			// Job
+  ipp_attribute_t *attr;		// Job priority
+  ipp_jstate_t	state;			// Job state
+
+
+  key.id = ippGetInteger(ippFindAttribute(attrs, "job-id", IPP_TAG_INTEGER), 0);
+  state  = (ipp_jstate_t)ippGetInteger(ippFindAttribute(attrs, "job-state", IPP_TAG_ENUM), 0);
+  job    = (watch_job_t *)cupsArrayFind(watch->jobs, &key);
+
+  if (key.id <= 0 || !watch_match(watch, attrs, key.id, state))
+  {
+    ippDelete(attrs);
+
+    if (job)
+      watch_remove_job(watch, job, diff);
+
+    return;
+  }
+
+  if (job)
+  {
+    ippDelete(job->attrs);
+  }
+  else
+  {
+    if ((job = (watch_job_t *)calloc(1, sizeof(watch_job_t))) == NULL)
+    {
+      ippDelete(attrs);
+      return;
+    }
+
+    job->id         = key.id;
+    job->prev_index = WATCH_NEW;
+
+    cupsArrayAdd(watch->jobs, job);
+  }
+
+  job->attrs = attrs;
+  job->state = state;
+  job->seen  = true;
+
+  if ((attr = ippFindAttribute(attrs, "job-priority", IPP_TAG_INTEGER)) != NULL)
+    job->priority = ippGetInteger(attr, 0);
+  else
+    job->priority = 50;
+
+  diff->redraw = true;
+}
+
+
+//
+// 'watch_set_status()' - Set the status of the last update.
+//
+
+static void
+watch_set_status(watch_t      *watch,	// I - Job list dashboard
+                 ipp_status_t status,	// I - IPP status
+                 const char   *message)	// I - Status message or `NULL`
+{
+  free(watch->message);
+
+  watch->status  = status;
+  watch->message = message ? strdup(message) : NULL;
+}
+
+
+//
+// 'watch_signal()' - Stop watching on an interrupt.
+//
+// A change of terminal size only wakes up `watch_update`.
+//
+
+static void
+watch_signal(int sig)			// I - Signal number
+{
+  if (sig != SIGWINCH)
+    watch_stop = 1;
+}
+
+
+//
+// 'watch_sort()' - Put the jobs in list order and count the changes.
+//
+
+static void
+watch_sort(watch_t      *watch,		// I - Job list dashboard
+           watch_diff_t *diff)		// I - Changes to the list
+{
+  size_t	i,			// Looping var
+		count,			// Number of jobs
+		last = 0;		// Previous position of last job kept in place
+  bool		have_last = false;	// Have a job kept in place?
+  watch_job_t	*job,			// Current job
+		**order;		// New list order
+
+
+  if ((count = (size_t)cupsArrayGetCount(watch->jobs)) > watch->alloc_order)
+  {
+    if ((order = realloc(watch->order, count * sizeof(watch_job_t *))) == NULL)
+    {
+      watch->num_order = 0;
+      return;
+    }
+
+    watch->order       = order;
+    watch->alloc_order = count;
+  }
+
+  for (i = 0, job = (watch_job_t *)cupsArrayGetFirst(watch->jobs); job; i ++, job = (watch_job_t *)cupsArrayGetNext(watch->jobs))
+    watch->order[i] = job;
+
+  watch->num_order = count;
+
+  qsort(watch->order, count, sizeof(watch_job_t *), (int (*)(const void *, const void *))watch_compare_order);
+
+  // A job moved if it is now listed before a job that was ahead of it...
+  for (i = 0; i < count; i ++)
+  {
+    job = watch->order[i];
+
+    if (job->prev_index == WATCH_NEW)
+    {
+      diff->added ++;
+      continue;
+    }
+
+    if (job->state != job->prev_state)
+      diff->changed ++;
+
+    if (have_last && job->prev_index < last)
+    {
+      diff->moved ++;
+    }
+    else
+    {
+      last      = job->prev_index;
+      have_last = true;
+    }
+  }
+
+  if (diff->added || diff->finished || diff->changed || diff->moved)
+    diff->redraw = true;
+}
+
+
+//
+// 'watch_subscribe()' - Subscribe to the job and printer events of the list.
+//
+
+static int				// O - Subscription ID or `0` on error
+watch_subscribe(watch_t *watch)		// I - Job list dashboard
+{
+  ipp_t		*request,		// IPP request
+		*response;		// IPP response
+  int		id;			// Subscription ID
+
+
+  request = ippNewRequest(IPP_OP_CREATE_PRINTER_SUBSCRIPTIONS);
+
+  ippAddString(request, IPP_TAG_OPERATION, IPP_TAG_URI, "printer-uri", NULL, watch->printer_uri);
+  ippAddString(request, IPP_TAG_OPERATION, IPP_TAG_NAME, "requesting-user-name", NULL, watch->user);
+  ippAddStrings(request, IPP_TAG_SUBSCRIPTION, IPP_TAG_KEYWORD, "notify-events", sizeof(watch_events) / sizeof(watch_events[0]), NULL, watch_events);
+  ippAddString(request, IPP_TAG_SUBSCRIPTION, IPP_TAG_KEYWORD, "notify-pull-method", NULL, "ippget");
+  ippAddInteger(request, IPP_TAG_SUBSCRIPTION, IPP_TAG_INTEGER, "notify-lease-duration", WATCH_LEASE);
+
+  response = cupsDoRequest(watch->http, request, "/");
+
+  if (cupsLastError() > IPP_STATUS_OK_CONFLICTING)
+    id = 0;
+  else
+    id = ippGetInteger(ippFindAttribute(response, "notify-subscription-id", IPP_TAG_INTEGER), 0);
+
+  ippDelete(response);
+
+  if (id)
+  {
+    watch->seq        = 1;
+    watch->renew_time = time(NULL) + WATCH_LEASE / 2;
+  }
+
+  return (id);
+}
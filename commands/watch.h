@@ -0,0 +1,55 @@
+//
+// Job list dashboard definitions for the CUPS commands.
+//
+// Copyright © 2026 by OpenPrinting.
+//
+// Licensed under Apache License v2.0.  See the file "LICENSE" for more
+// information.
+//
+
+#ifndef WATCH_H
+#  define WATCH_H
+#  include "localize.h"
+
+
+//
+// Constants...
+//
+
+#  define WATCH_LEASE		300	// Lease for subscription in seconds
+#  define WATCH_MAX_CHANGES	100	// Maximum changed jobs to load one at a time
+
+
+//
+// Types...
+//
+
+typedef struct watch_s watch_t;		// Job list dashboard
+
+typedef struct watch_diff_s		// Changes from an update
+{
+  size_t	added,			// New jobs
+		finished,		// Jobs that are no longer listed
+		changed,		// Jobs with a new state
+		moved;			// Jobs with a new position in the list
+  bool		printers,		// Printer state changed?
+		redraw;			// List needs to be drawn again?
+} watch_diff_t;
+
+
+//
+// Functions...
+//
+
+extern void		watch_delete(watch_t *watch);
+extern void		watch_flush(watch_t *watch);
+extern size_t		watch_get_count(watch_t *watch);
+extern ipp_t		*watch_get_job(watch_t *watch, size_t n);
+extern ipp_status_t	watch_get_status(watch_t *watch);
+extern const char	*watch_get_status_message(watch_t *watch);
+extern watch_t		*watch_new(http_t *http, ipp_t *request);
+extern void		watch_printf(watch_t *watch, const char *message, ...) _CUPS_FORMAT(2, 3);
+extern bool		watch_update(watch_t *watch, int interval, watch_diff_t *diff);
+
+
+#endif // !WATCH_H